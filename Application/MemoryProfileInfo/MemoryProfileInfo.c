@@ -449,6 +449,84 @@ DumpMemoryProfileMemoryRange (
   return (VOID *) Descriptor;
 }
 
+/**
+  Dump memory profile pool slab information.
+
+  @param[in] PoolSlab           Pointer to memory profile pool slab.
+
+  @return Pointer to the end of memory profile pool slab buffer.
+
+**/
+VOID *
+DumpMemoryProfilePoolSlab (
+  IN MEMORY_PROFILE_POOL_SLAB   *PoolSlab
+  )
+{
+  MEMORY_PROFILE_POOL_SLAB_CLASS  *SlabClass;
+  UINTN                           ClassIndex;
+
+  if (PoolSlab->Header.Signature != MEMORY_PROFILE_POOL_SLAB_SIGNATURE) {
+    return NULL;
+  }
+  Print (L"MEMORY_PROFILE_POOL_SLAB\n");
+  Print (L"  Signature                     - 0x%08x\n", PoolSlab->Header.Signature);
+  Print (L"  Length                        - 0x%04x\n", PoolSlab->Header.Length);
+  Print (L"  Revision                      - 0x%04x\n", PoolSlab->Header.Revision);
+  Print (L"  SlabClassCount                - 0x%08x\n", PoolSlab->SlabClassCount);
+
+  SlabClass = (MEMORY_PROFILE_POOL_SLAB_CLASS *) ((UINTN) PoolSlab + PoolSlab->Header.Length);
+  for (ClassIndex = 0; ClassIndex < PoolSlab->SlabClassCount; ClassIndex++) {
+    if (SlabClass->Header.Signature != MEMORY_PROFILE_POOL_SLAB_CLASS_SIGNATURE) {
+      return NULL;
+    }
+    Print (L"  MEMORY_PROFILE_POOL_SLAB_CLASS (0x%x)\n", ClassIndex);
+    Print (L"    Signature               - 0x%08x\n", SlabClass->Header.Signature);
+    Print (L"    Length                  - 0x%04x\n", SlabClass->Header.Length);
+    Print (L"    Revision                - 0x%04x\n", SlabClass->Header.Revision);
+    Print (L"    ObjectSize              - 0x%08x\n", SlabClass->ObjectSize);
+    Print (L"    AllocateCount           - 0x%016lx\n", SlabClass->AllocateCount);
+    Print (L"    FreeCount               - 0x%016lx\n", SlabClass->FreeCount);
+    Print (L"    SlabAllocateCount       - 0x%016lx\n", SlabClass->SlabAllocateCount);
+    Print (L"    SlabReleaseCount        - 0x%016lx\n", SlabClass->SlabReleaseCount);
+    Print (L"    CurrentSlabPages        - 0x%016lx\n", SlabClass->CurrentSlabPages);
+    Print (L"    PeakSlabPages           - 0x%016lx\n", SlabClass->PeakSlabPages);
+    SlabClass = (MEMORY_PROFILE_POOL_SLAB_CLASS *) ((UINTN) SlabClass + SlabClass->Header.Length);
+  }
+
+  return (VOID *) SlabClass;
+}
+
+/**
+  Dump memory profile SMRAM fragmentation information.
+
+  @param[in] Fragmentation      Pointer to memory profile SMRAM fragmentation.
+
+  @return Pointer to the end of memory profile SMRAM fragmentation buffer.
+
+**/
+VOID *
+DumpMemoryProfileSmramFragmentation (
+  IN MEMORY_PROFILE_SMRAM_FRAGMENTATION   *Fragmentation
+  )
+{
+  if (Fragmentation->Header.Signature != MEMORY_PROFILE_SMRAM_FRAGMENTATION_SIGNATURE) {
+    return NULL;
+  }
+  Print (L"MEMORY_PROFILE_SMRAM_FRAGMENTATION\n");
+  Print (L"  Signature                     - 0x%08x\n", Fragmentation->Header.Signature);
+  Print (L"  Length                        - 0x%04x\n", Fragmentation->Header.Length);
+  Print (L"  Revision                      - 0x%04x\n", Fragmentation->Header.Revision);
+  Print (L"  FreePageRangeCount            - 0x%08x\n", Fragmentation->FreePageRangeCount);
+  Print (L"  TotalFreePages                - 0x%016lx\n", Fragmentation->TotalFreePages);
+  Print (L"  LargestFreePages              - 0x%016lx\n", Fragmentation->LargestFreePages);
+  Print (L"  PoolPages                     - 0x%016lx\n", Fragmentation->PoolPages);
+  Print (L"  PeakPoolPages                 - 0x%016lx\n", Fragmentation->PeakPoolPages);
+  Print (L"  PoolPageReleaseCount          - 0x%016lx\n", Fragmentation->PoolPageReleaseCount);
+  Print (L"  FreePoolSize                  - 0x%016lx\n", Fragmentation->FreePoolSize);
+
+  return (VOID *) ((UINTN) Fragmentation + Fragmentation->Header.Length);
+}
+
 /**
   Scan memory profile by Signature.
 
@@ -500,6 +578,8 @@ DumpMemoryProfile (
   MEMORY_PROFILE_CONTEXT        *Context;
   MEMORY_PROFILE_FREE_MEMORY    *FreeMemory;
   MEMORY_PROFILE_MEMORY_RANGE   *MemoryRange;
+  MEMORY_PROFILE_POOL_SLAB      *PoolSlab;
+  MEMORY_PROFILE_SMRAM_FRAGMENTATION  *Fragmentation;
 
   Context = (MEMORY_PROFILE_CONTEXT *) ScanMemoryProfileBySignature (ProfileBuffer, ProfileSize, MEMORY_PROFILE_CONTEXT_SIGNATURE);
   if (Context != NULL) {
@@ -515,6 +595,16 @@ DumpMemoryProfile (
   if (MemoryRange != NULL) {
     DumpMemoryProfileMemoryRange (MemoryRange);
   }
+
+  PoolSlab = (MEMORY_PROFILE_POOL_SLAB *) ScanMemoryProfileBySignature (ProfileBuffer, ProfileSize, MEMORY_PROFILE_POOL_SLAB_SIGNATURE);
+  if (PoolSlab != NULL) {
+    DumpMemoryProfilePoolSlab (PoolSlab);
+  }
+
+  Fragmentation = (MEMORY_PROFILE_SMRAM_FRAGMENTATION *) ScanMemoryProfileBySignature (ProfileBuffer, ProfileSize, MEMORY_PROFILE_SMRAM_FRAGMENTATION_SIGNATURE);
+  if (Fragmentation != NULL) {
+    DumpMemoryProfileSmramFragmentation (Fragmentation);
+  }
 }
 
 /**
@@ -0,0 +1,183 @@
+/** @file
+  Shell application to decode the binary status code trace rings.
+
+  The rings are located by the status code trace configuration table. The record
+  format is described in Include/Guid/StatusCodeTrace.h, so a memory dump of the
+  rings can be decoded the same way.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+
+#include <Guid/StatusCodeTrace.h>
+
+CHAR16 *mPhaseString[] = {
+  L"PEI",
+  L"DXE",
+  L"SMM",
+};
+
+/**
+  Get the string of the type of a status code.
+
+  @param[in] CodeType   The type of the status code.
+
+  @return The string of the type.
+
+**/
+CHAR16 *
+GetCodeTypeString (
+  IN EFI_STATUS_CODE_TYPE   CodeType
+  )
+{
+  switch (CodeType & EFI_STATUS_CODE_TYPE_MASK) {
+  case EFI_PROGRESS_CODE:
+    return L"PROGRESS";
+  case EFI_ERROR_CODE:
+    return L"ERROR";
+  case EFI_DEBUG_CODE:
+    return L"DEBUG";
+  default:
+    return L"UNKNOWN";
+  }
+}
+
+/**
+  Convert a performance counter value to microseconds.
+
+  @param[in] TimeStamp  The performance counter value.
+  @param[in] Frequency  The frequency of the performance counter, in Hz.
+
+  @return The time in microseconds, or TimeStamp if Frequency is 0.
+
+**/
+UINT64
+TimeStampToMicroSeconds (
+  IN UINT64     TimeStamp,
+  IN UINT64     Frequency
+  )
+{
+  UINT64        Seconds;
+  UINT64        Remainder;
+
+  if (Frequency == 0) {
+    return TimeStamp;
+  }
+
+  Seconds = DivU64x64Remainder (TimeStamp, Frequency, &Remainder);
+  return MultU64x32 (Seconds, 1000000) + DivU64x64Remainder (MultU64x32 (Remainder, 1000000), Frequency, NULL);
+}
+
+/**
+  Dump the valid records of one status code trace ring, from the oldest to the newest.
+
+  @param[in] Trace      The status code trace ring.
+
+**/
+VOID
+DumpStatusCodeTrace (
+  IN STATUS_CODE_TRACE_HEADER   *Trace
+  )
+{
+  STATUS_CODE_TRACE_RECORD      *Records;
+  STATUS_CODE_TRACE_RECORD      *Record;
+  UINT32                        WriteIndex;
+  UINT32                        Index;
+  UINT32                        Invalid;
+
+  if (Trace->Signature != STATUS_CODE_TRACE_SIGNATURE ||
+      Trace->RecordSize != sizeof (STATUS_CODE_TRACE_RECORD) ||
+      Trace->Phase >= StatusCodeTracePhaseMax ||
+      Trace->MaxRecords == 0 ||
+      (Trace->MaxRecords & (Trace->MaxRecords - 1)) != 0) {
+    Print (L"Invalid status code trace ring at 0x%p\n", Trace);
+    return;
+  }
+
+  WriteIndex = Trace->WriteIndex;
+  Print (L"==== %s status code trace ====\n", mPhaseString[Trace->Phase]);
+  Print (
+    L"Records: %d, overwritten: %d, timer frequency: %ld Hz\n",
+    WriteIndex,
+    (WriteIndex > Trace->MaxRecords) ? WriteIndex - Trace->MaxRecords : 0,
+    Trace->TimerFrequency
+    );
+
+  Records = (STATUS_CODE_TRACE_RECORD *) (Trace + 1);
+  Invalid = 0;
+  Index   = (WriteIndex > Trace->MaxRecords) ? WriteIndex - Trace->MaxRecords : 0;
+  for (; Index < WriteIndex; Index++) {
+    Record = &Records[Index & (Trace->MaxRecords - 1)];
+    //
+    // Skip the record still being written, or already overwritten by a newer one.
+    //
+    if (Record->Sequence != Index + 1) {
+      Invalid++;
+      continue;
+    }
+    Print (
+      L"%10ld us  %-8s C%08x V%08x I%x  %g\n",
+      TimeStampToMicroSeconds (Record->TimeStamp, Trace->TimerFrequency),
+      GetCodeTypeString (Record->CodeType),
+      Record->CodeType,
+      Record->Value,
+      Record->Instance,
+      &Record->CallerId
+      );
+  }
+
+  if (Invalid != 0) {
+    Print (L"%d records skipped as being updated\n", Invalid);
+  }
+  Print (L"\n");
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval EFI_NOT_FOUND     The status code trace table is not installed.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE         ImageHandle,
+  IN EFI_SYSTEM_TABLE   *SystemTable
+  )
+{
+  EFI_STATUS                Status;
+  STATUS_CODE_TRACE_TABLE   *Table;
+  UINTN                     Phase;
+
+  Status = EfiGetSystemConfigurationTable (&gEdkiiStatusCodeTraceGuid, (VOID **) &Table);
+  if (EFI_ERROR (Status) || Table->Signature != STATUS_CODE_TRACE_TABLE_SIGNATURE) {
+    Print (L"StatusCodeTraceInfo: Status code trace is not enabled, set PcdStatusCodeUseTrace to TRUE.\n");
+    return EFI_NOT_FOUND;
+  }
+
+  for (Phase = 0; Phase < StatusCodeTracePhaseMax; Phase++) {
+    if (Table->Ring[Phase] != 0) {
+      DumpStatusCodeTrace ((STATUS_CODE_TRACE_HEADER *) (UINTN) Table->Ring[Phase]);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
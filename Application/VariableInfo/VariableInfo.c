@@ -19,6 +19,7 @@
 #include <Library/UefiLib.h>
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Guid/VariableFormat.h>
+#include <Guid/VariableReclaimStatistics.h>
 
 
 /**
@@ -44,6 +45,7 @@ UefiMain (
   EFI_STATUS            Status;
   VARIABLE_INFO_ENTRY   *VariableInfo;
   VARIABLE_INFO_ENTRY   *Entry;
+  VARIABLE_RECLAIM_STATISTICS  *ReclaimStatistics;
 
   Status = EfiGetSystemConfigurationTable (&gEfiVariableGuid, (VOID **)&Entry);
   if (!EFI_ERROR (Status) && (Entry != NULL)) {
@@ -91,5 +93,26 @@ UefiMain (
 
   }
 
+  //
+  // The SMM variable driver publishes the reclaim statistics without the
+  // per-variable statistics table, so they are looked up on their own.
+  //
+  if (!EFI_ERROR (EfiGetSystemConfigurationTable (&gEdkiiVariableReclaimStatisticsGuid, (VOID **)&ReclaimStatistics)) &&
+      (ReclaimStatistics != NULL)) {
+    Print (L"Non-Volatile Variable Store Reclaim:\n");
+    Print (
+      L"  Reclaims %d (skipped %d), BytesMoved %ld, BlocksErased %ld\n",
+      ReclaimStatistics->ReclaimCount,
+      ReclaimStatistics->SkippedCount,
+      ReclaimStatistics->BytesMoved,
+      ReclaimStatistics->BlocksErased
+      );
+    Print (
+      L"  TotalTime %ldns, MaxTime %ldns\n",
+      ReclaimStatistics->TotalTimeInNanoSeconds,
+      ReclaimStatistics->MaxTimeInNanoSeconds
+      );
+  }
+
   return Status;
 }
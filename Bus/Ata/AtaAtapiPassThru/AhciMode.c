@@ -501,6 +501,8 @@ AhciDisableFisReceive (
   @param    AtapiCommand          The atapi command will be used for the transfer.
   @param    AtapiCommandLength    The length of the atapi command.
   @param    CommandSlotNumber     The command slot will be used for the transfer.
+                                  Slot 0 uses the command table of the non-queued
+                                  commands, other slots use the queued command tables.
   @param    DataPhysicalAddr      The pointer to the data buffer pci bus master address.
   @param    DataLength            The data count to be transferred.
 
@@ -528,6 +530,8 @@ AhciBuildCommand (
   UINTN      MemAddr;
   DATA_64    Data64;
   UINT32     Offset;
+  EFI_AHCI_COMMAND_TABLE  *CommandTable;
+  UINT64                  CommandTablePciAddr;
 
   //
   // Filling the PRDT
@@ -541,22 +545,35 @@ AhciBuildCommand (
   //
   ASSERT (PrdtNumber <= 65535);
 
+  if (CommandSlotNumber == 0) {
+    CommandTable        = AhciRegisters->AhciCommandTable;
+    CommandTablePciAddr = (UINT64)(UINTN) AhciRegisters->AhciCommandTablePciAddr;
+  } else {
+    ASSERT (AhciRegisters->AhciQueuedCommandTable != NULL);
+    ASSERT (PrdtNumber <= EFI_AHCI_QUEUED_MAX_PRDT_NUMBER);
+    CommandTable        = (EFI_AHCI_COMMAND_TABLE *) &AhciRegisters->AhciQueuedCommandTable[CommandSlotNumber];
+    CommandTablePciAddr = (UINT64)(UINTN) &AhciRegisters->AhciQueuedCommandTablePciAddr[CommandSlotNumber];
+  }
+
   Data64.Uint64 = (UINTN) (AhciRegisters->AhciRFis) + sizeof (EFI_AHCI_RECEIVED_FIS) * Port;
 
   BaseAddr = Data64.Uint64;
 
   ZeroMem ((VOID *)((UINTN) BaseAddr), sizeof (EFI_AHCI_RECEIVED_FIS));
 
-  ZeroMem (AhciRegisters->AhciCommandTable, sizeof (EFI_AHCI_COMMAND_TABLE));
+  //
+  // Only the PRD entries used by this command are read by the HBA.
+  //
+  ZeroMem (CommandTable, OFFSET_OF (EFI_AHCI_COMMAND_TABLE, PrdtTable) + PrdtNumber * sizeof (EFI_AHCI_COMMAND_PRDT));
 
   CommandFis->AhciCFisPmNum = PortMultiplier;
 
-  CopyMem (&AhciRegisters->AhciCommandTable->CommandFis, CommandFis, sizeof (EFI_AHCI_COMMAND_FIS));
+  CopyMem (&CommandTable->CommandFis, CommandFis, sizeof (EFI_AHCI_COMMAND_FIS));
 
   Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
   if (AtapiCommand != NULL) {
     CopyMem (
-      &AhciRegisters->AhciCommandTable->AtapiCmd,
+      &CommandTable->AtapiCmd,
       AtapiCommand,
       AtapiCommandLength
       );
@@ -575,14 +592,14 @@ AhciBuildCommand (
 
   for (PrdtIndex = 0; PrdtIndex < PrdtNumber; PrdtIndex++) {
     if (RemainedData < EFI_AHCI_MAX_DATA_PER_PRDT) {
-      AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
     } else {
-      AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
     }
 
     Data64.Uint64 = (UINT64)MemAddr;
-    AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
-    AhciRegisters->AhciCommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
     RemainedData -= EFI_AHCI_MAX_DATA_PER_PRDT;
     MemAddr      += EFI_AHCI_MAX_DATA_PER_PRDT;
   }
@@ -591,7 +608,7 @@ AhciBuildCommand (
   // Set the last PRDT to Interrupt On Complete
   //
   if (PrdtNumber > 0) {
-    AhciRegisters->AhciCommandTable->PrdtTable[PrdtNumber - 1].AhciPrdtIoc = 1;
+    CommandTable->PrdtTable[PrdtNumber - 1].AhciPrdtIoc = 1;
   }
 
   CopyMem (
@@ -600,7 +617,7 @@ AhciBuildCommand (
     sizeof (EFI_AHCI_COMMAND_LIST)
     );
 
-  Data64.Uint64 = (UINT64)(UINTN) AhciRegisters->AhciCommandTablePciAddr;
+  Data64.Uint64 = CommandTablePciAddr;
   AhciRegisters->AhciCmdList[CommandSlotNumber].AhciCmdCtba  = Data64.Uint32.Lower32;
   AhciRegisters->AhciCmdList[CommandSlotNumber].AhciCmdCtbau = Data64.Uint32.Upper32;
   AhciRegisters->AhciCmdList[CommandSlotNumber].AhciCmdPmp   = PortMultiplier;
@@ -876,6 +893,397 @@ Exit:
   return Status;
 }
 
+/**
+  Check whether a non-blocking ATA command is sent to the device with native
+  command queuing.
+
+  Only READ DMA EXT and WRITE DMA EXT commands to a device which supports native
+  command queuing are queued. They are sent as READ FPDMA QUEUED and WRITE FPDMA
+  QUEUED commands.
+
+  @param[in]  AhciRegisters   The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]  Port            The number of port.
+  @param[in]  PortMultiplier  The number of port multiplier.
+  @param[in]  Packet          A pointer to the ATA command to send.
+
+  @retval TRUE                The command is sent with native command queuing.
+  @retval FALSE               The command is sent with a non-queued command.
+
+**/
+BOOLEAN
+EFIAPI
+AhciIsQueuedCommand (
+  IN EFI_AHCI_REGISTERS                *AhciRegisters,
+  IN UINT16                            Port,
+  IN UINT16                            PortMultiplier,
+  IN EFI_ATA_PASS_THRU_COMMAND_PACKET  *Packet
+  )
+{
+  UINT32    TransferLength;
+
+  if ((AhciRegisters->AhciQueuedCommandTable == NULL) ||
+      (Port >= EFI_AHCI_MAX_PORTS) ||
+      (PortMultiplier != 0) ||
+      (AhciRegisters->QueueDepth[Port] == 0)) {
+    return FALSE;
+  }
+
+  if ((Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_UDMA_DATA_IN) &&
+      (Packet->Acb->AtaCommand == ATA_CMD_READ_DMA_EXT)) {
+    TransferLength = Packet->InTransferLength;
+  } else if ((Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_UDMA_DATA_OUT) &&
+             (Packet->Acb->AtaCommand == ATA_CMD_WRITE_DMA_EXT)) {
+    TransferLength = Packet->OutTransferLength;
+  } else {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (TransferLength <= EFI_AHCI_QUEUED_MAX_PRDT_NUMBER * EFI_AHCI_MAX_DATA_PER_PRDT);
+}
+
+/**
+  Read the NCQ command error log of the device.
+
+  After a queued command fails, the device aborts all the commands it receives
+  until the NCQ command error log is read.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  AhciRegisters      The pointer to the EFI_AHCI_REGISTERS.
+  @param  Port               The number of port.
+
+  @retval EFI_DEVICE_ERROR   The cmd abort with error occurs.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The cmd executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciReadNcqErrorLog (
+  IN EFI_PCI_IO_PROTOCOL      *PciIo,
+  IN EFI_AHCI_REGISTERS       *AhciRegisters,
+  IN UINT8                    Port
+  )
+{
+  EFI_ATA_COMMAND_BLOCK        AtaCommandBlock;
+  EFI_ATA_STATUS_BLOCK         AtaStatusBlock;
+  UINT8                        Log[0x200];
+
+  ZeroMem (&AtaCommandBlock, sizeof (EFI_ATA_COMMAND_BLOCK));
+  ZeroMem (&AtaStatusBlock, sizeof (EFI_ATA_STATUS_BLOCK));
+
+  AtaCommandBlock.AtaCommand      = EFI_AHCI_ATA_CMD_READ_LOG_EXT;
+  AtaCommandBlock.AtaSectorNumber = EFI_AHCI_NCQ_COMMAND_ERROR_LOG;
+  AtaCommandBlock.AtaSectorCount  = 1;
+
+  return AhciPioTransfer (
+           PciIo,
+           AhciRegisters,
+           Port,
+           0,
+           NULL,
+           0,
+           TRUE,
+           &AtaCommandBlock,
+           &AtaStatusBlock,
+           Log,
+           sizeof (Log),
+           ATA_ATAPI_TIMEOUT,
+           NULL
+           );
+}
+
+/**
+  Abort all outstanding queued commands.
+
+  The ports running queued commands are stopped and the data buffers of the
+  queued commands are unmapped. The tasks stay in the non-blocking task list.
+
+  @param[in]  Instance        A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciAbortQueuedCommands (
+  IN ATA_ATAPI_PASS_THRU_INSTANCE      *Instance
+  )
+{
+  EFI_PCI_IO_PROTOCOL          *PciIo;
+  EFI_AHCI_REGISTERS           *AhciRegisters;
+  LIST_ENTRY                   *Entry;
+  ATA_NONBLOCK_TASK            *Task;
+  UINT8                        Port;
+  UINT32                       Offset;
+  UINT32                       StoppedPorts;
+  UINT32                       ErrorPorts;
+
+  PciIo         = Instance->PciIo;
+  AhciRegisters = &Instance->AhciRegisters;
+  StoppedPorts  = 0;
+  ErrorPorts    = 0;
+
+  for (Entry = GetFirstNode (&Instance->NonBlockingTaskList);
+       !IsNull (&Instance->NonBlockingTaskList, Entry);
+       Entry = GetNextNode (&Instance->NonBlockingTaskList, Entry)) {
+    Task = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    if (Task->QueueSlot == 0) {
+      continue;
+    }
+
+    Port = (UINT8) Task->Port;
+    if ((StoppedPorts & ((UINT32) 1 << Port)) == 0) {
+      StoppedPorts |= (UINT32) 1 << Port;
+
+      Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_IS;
+      if ((AhciReadReg (PciIo, Offset) & EFI_AHCI_PORT_IS_TFES) != 0) {
+        ErrorPorts |= (UINT32) 1 << Port;
+      }
+      Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_TFD;
+      if ((AhciReadReg (PciIo, Offset) & EFI_AHCI_PORT_TFD_ERR) != 0) {
+        ErrorPorts |= (UINT32) 1 << Port;
+      }
+
+      //
+      // Clearing PxCMD.ST also clears PxSACT and PxCI of the port.
+      //
+      AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+      AhciDisableFisReceive (PciIo, Port, ATA_ATAPI_TIMEOUT);
+    }
+
+    PciIo->Unmap (PciIo, Task->Map);
+    AhciRegisters->PortQueuedSlots[Port] &= ~((UINT32) 1 << Task->QueueSlot);
+    Task->QueueSlot = 0;
+  }
+
+  AhciRegisters->QueuedSlots = 0;
+
+  for (Port = 0; Port < EFI_AHCI_MAX_PORTS; Port++) {
+    if ((ErrorPorts & ((UINT32) 1 << Port)) != 0) {
+      AhciReadNcqErrorLog (PciIo, AhciRegisters, Port);
+    }
+  }
+}
+
+/**
+  Start or check a DMA data transfer which is sent with native command queuing.
+
+  The command is issued in a free command slot whose number is also the tag of
+  the command, so many queued commands can be outstanding on a port at the same
+  time. A queued command is completed when the HBA clears its bit in PxSACT,
+  which can happen in any order.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]       Port                The number of port.
+  @param[in]       PortMultiplier      The number of port multiplier.
+  @param[in]       Read                The transfer direction.
+  @param[in]       AtaCommandBlock     The EFI_ATA_COMMAND_BLOCK data.
+  @param[in, out]  AtaStatusBlock      The EFI_ATA_STATUS_BLOCK data.
+  @param[in, out]  MemoryAddr          The pointer to the data buffer.
+  @param[in]       DataCount           The data count to be transferred.
+  @param[in]       Timeout             The timeout value of starting the port, uses 100ns as a unit.
+  @param[in]       Task                Pointer to the ATA_NONBLOCK_TASK used by non-blocking mode.
+
+  @retval EFI_NOT_READY       No command slot is free, or the command isn't completed yet.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer can not be mapped.
+  @retval EFI_DEVICE_ERROR    The DMA data transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_SUCCESS         The DMA data transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciQueuedDmaTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     EFI_AHCI_REGISTERS         *AhciRegisters,
+  IN     UINT8                      Port,
+  IN     UINT8                      PortMultiplier,
+  IN     BOOLEAN                    Read,
+  IN     EFI_ATA_COMMAND_BLOCK      *AtaCommandBlock,
+  IN OUT EFI_ATA_STATUS_BLOCK       *AtaStatusBlock,
+  IN OUT VOID                       *MemoryAddr,
+  IN     UINT32                     DataCount,
+  IN     UINT64                     Timeout,
+  IN     ATA_NONBLOCK_TASK          *Task
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_PCI_IO_PROTOCOL           *PciIo;
+  UINT8                         Slot;
+  UINT32                        SlotBit;
+  UINT32                        Offset;
+  UINT32                        PortIs;
+  UINT32                        PortTfd;
+  UINT32                        Issued;
+  EFI_PHYSICAL_ADDRESS          PhyAddr;
+  VOID                          *Map;
+  UINTN                         MapLength;
+  EFI_PCI_IO_PROTOCOL_OPERATION Flag;
+  EFI_AHCI_COMMAND_FIS          CFis;
+  EFI_AHCI_COMMAND_LIST         CmdList;
+
+  PciIo = Instance->PciIo;
+
+  if (!Task->IsStart) {
+    //
+    // Find a free command slot in the tag range of the device.
+    //
+    for (Slot = 1; Slot < AhciRegisters->QueueDepth[Port]; Slot++) {
+      if ((AhciRegisters->QueuedSlots & ((UINT32) 1 << Slot)) == 0) {
+        break;
+      }
+    }
+    if (Slot >= AhciRegisters->QueueDepth[Port]) {
+      return EFI_NOT_READY;
+    }
+    SlotBit = (UINT32) 1 << Slot;
+
+    if (Read) {
+      Flag = EfiPciIoOperationBusMasterWrite;
+    } else {
+      Flag = EfiPciIoOperationBusMasterRead;
+    }
+
+    MapLength = DataCount;
+    Status = PciIo->Map (
+                      PciIo,
+                      Flag,
+                      MemoryAddr,
+                      &MapLength,
+                      &PhyAddr,
+                      &Map
+                      );
+    if (EFI_ERROR (Status) || (DataCount != MapLength)) {
+      if (!EFI_ERROR (Status)) {
+        PciIo->Unmap (PciIo, Map);
+      }
+      return EFI_BAD_BUFFER_SIZE;
+    }
+
+    //
+    // READ/WRITE FPDMA QUEUED take the sector count in the Features field
+    // and the tag in bits 7:3 of the Count field.
+    //
+    AhciBuildCommandFis (&CFis, AtaCommandBlock);
+    CFis.AhciCFisCmd         = Read ? EFI_AHCI_ATA_CMD_READ_FPDMA_QUEUED : EFI_AHCI_ATA_CMD_WRITE_FPDMA_QUEUED;
+    CFis.AhciCFisFeature     = AtaCommandBlock->AtaSectorCount;
+    CFis.AhciCFisFeatureExp  = AtaCommandBlock->AtaSectorCountExp;
+    CFis.AhciCFisSecCount    = (UINT8) (Slot << 3);
+    CFis.AhciCFisSecCountExp = 0;
+    CFis.AhciCFisDevHead     = BIT6;
+
+    ZeroMem (&CmdList, sizeof (EFI_AHCI_COMMAND_LIST));
+
+    CmdList.AhciCmdCfl = EFI_AHCI_FIS_REGISTER_H2D_LENGTH / 4;
+    CmdList.AhciCmdW   = Read ? 0 : 1;
+
+    AhciBuildCommand (
+      PciIo,
+      AhciRegisters,
+      Port,
+      PortMultiplier,
+      &CFis,
+      &CmdList,
+      NULL,
+      0,
+      Slot,
+      (VOID *)(UINTN)PhyAddr,
+      DataCount
+      );
+
+    if (AhciRegisters->PortQueuedSlots[Port] == 0) {
+      //
+      // This is the only queued command of the port, so start the port.
+      //
+      AhciClearPortStatus (PciIo, Port);
+
+      Status = AhciEnableFisReceive (
+                 PciIo,
+                 Port,
+                 Timeout
+                 );
+      if (EFI_ERROR (Status)) {
+        PciIo->Unmap (PciIo, Map);
+        return Status;
+      }
+
+      Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
+      AhciOrReg (PciIo, Offset, EFI_AHCI_PORT_CMD_ST);
+    }
+
+    //
+    // PxSACT must be set before PxCI. Writing 0 to a bit of these registers has
+    // no effect, so the other outstanding commands are kept.
+    //
+    Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+    AhciWriteReg (PciIo, Offset, SlotBit);
+    Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+    AhciWriteReg (PciIo, Offset, SlotBit);
+
+    Task->IsStart   = TRUE;
+    Task->Map       = Map;
+    Task->QueueSlot = Slot;
+    AhciRegisters->QueuedSlots           |= SlotBit;
+    AhciRegisters->PortQueuedSlots[Port] |= SlotBit;
+  }
+
+  SlotBit = (UINT32) 1 << Task->QueueSlot;
+
+  //
+  // A failed queued command makes the device abort all its outstanding commands.
+  //
+  Offset  = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_IS;
+  PortIs  = AhciReadReg (PciIo, Offset);
+  Offset  = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_TFD;
+  PortTfd = AhciReadReg (PciIo, Offset);
+  if (((PortIs & EFI_AHCI_PORT_IS_TFES) != 0) || ((PortTfd & EFI_AHCI_PORT_TFD_ERR) != 0)) {
+    Status = EFI_DEVICE_ERROR;
+  } else {
+    Offset  = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+    Issued  = AhciReadReg (PciIo, Offset);
+    Offset  = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+    Issued |= AhciReadReg (PciIo, Offset);
+    if ((Issued & SlotBit) == 0) {
+      Status = EFI_SUCCESS;
+    } else {
+      Task->RetryTimes--;
+      if (Task->InfiniteWait || (Task->RetryTimes != 0)) {
+        return EFI_NOT_READY;
+      }
+      Status = EFI_TIMEOUT;
+    }
+  }
+
+  AhciDumpPortStatus (PciIo, Port, AtaStatusBlock);
+
+  //
+  // On error the caller destroys the task list, which aborts all the queued commands.
+  //
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  PciIo->Unmap (PciIo, Task->Map);
+  Task->QueueSlot = 0;
+  AhciRegisters->QueuedSlots           &= ~SlotBit;
+  AhciRegisters->PortQueuedSlots[Port] &= ~SlotBit;
+
+  if (AhciRegisters->PortQueuedSlots[Port] == 0) {
+    AhciStopCommand (
+      PciIo,
+      Port,
+      Timeout
+      );
+
+    AhciDisableFisReceive (
+      PciIo,
+      Port,
+      Timeout
+      );
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Start a DMA data transfer on specific port
 
@@ -940,6 +1348,27 @@ AhciDmaTransfer (
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // A non-blocking READ/WRITE DMA EXT command may be sent with native command queuing.
+  //
+  if ((Task != NULL) &&
+      ((Task->QueueSlot != 0) ||
+       (!Task->IsStart && AhciIsQueuedCommand (AhciRegisters, Port, PortMultiplier, Task->Packet)))) {
+    return AhciQueuedDmaTransfer (
+             Instance,
+             AhciRegisters,
+             Port,
+             PortMultiplier,
+             Read,
+             AtaCommandBlock,
+             AtaStatusBlock,
+             MemoryAddr,
+             DataCount,
+             Timeout,
+             Task
+             );
+  }
+
   //
   // Before starting the Blocking BlockIO operation, push to finish all non-blocking
   // BlockIO tasks.
@@ -1957,6 +2386,85 @@ AhciPacketCommandExecute (
   return Status;
 }
 
+/**
+  Allocate the command tables used by the queued commands.
+
+  The queued command tables are optional. If the HBA doesn't support native
+  command queuing or the allocation fails, AhciQueuedCommandTable is left NULL
+  and all the commands are sent in the non-queued command slot.
+
+  @param  PciIo                 The PCI IO protocol instance.
+  @param  AhciRegisters         The pointer to the EFI_AHCI_REGISTERS.
+
+**/
+VOID
+EFIAPI
+AhciCreateQueuedCommandTable (
+  IN     EFI_PCI_IO_PROTOCOL    *PciIo,
+  IN OUT EFI_AHCI_REGISTERS     *AhciRegisters
+  )
+{
+  EFI_STATUS            Status;
+  UINTN                 Bytes;
+  VOID                  *Buffer;
+  UINT32                Capability;
+  UINT8                 MaxCommandSlotNumber;
+  UINT64                MaxQueuedCommandTableSize;
+  EFI_PHYSICAL_ADDRESS  AhciQueuedCommandTablePciAddr;
+
+  AhciRegisters->AhciQueuedCommandTable = NULL;
+
+  Capability           = AhciReadReg (PciIo, EFI_AHCI_CAPABILITY_OFFSET);
+  MaxCommandSlotNumber = (UINT8) (((Capability & 0x1F00) >> 8) + 1);
+  if (((Capability & EFI_AHCI_CAP_SNCQ) == 0) || (MaxCommandSlotNumber < 2)) {
+    return;
+  }
+
+  Buffer = NULL;
+  MaxQueuedCommandTableSize = MaxCommandSlotNumber * sizeof (EFI_AHCI_QUEUED_COMMAND_TABLE);
+  Status = PciIo->AllocateBuffer (
+                    PciIo,
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    EFI_SIZE_TO_PAGES ((UINTN) MaxQueuedCommandTableSize),
+                    &Buffer,
+                    0
+                    );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_INFO, "AHCI native command queuing is disabled - %r\n", Status));
+    return;
+  }
+
+  ZeroMem (Buffer, (UINTN)MaxQueuedCommandTableSize);
+
+  Bytes  = (UINTN)MaxQueuedCommandTableSize;
+  Status = PciIo->Map (
+                    PciIo,
+                    EfiPciIoOperationBusMasterCommonBuffer,
+                    Buffer,
+                    &Bytes,
+                    &AhciQueuedCommandTablePciAddr,
+                    &AhciRegisters->MapQueuedCommandTable
+                    );
+  if (EFI_ERROR (Status) || (Bytes != MaxQueuedCommandTableSize) ||
+      (((Capability & EFI_AHCI_CAP_S64A) == 0) && (AhciQueuedCommandTablePciAddr > 0x100000000ULL))) {
+    DEBUG ((EFI_D_INFO, "AHCI native command queuing is disabled - map failure\n"));
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, AhciRegisters->MapQueuedCommandTable);
+    }
+    PciIo->FreeBuffer (
+             PciIo,
+             EFI_SIZE_TO_PAGES ((UINTN) MaxQueuedCommandTableSize),
+             Buffer
+             );
+    return;
+  }
+
+  AhciRegisters->AhciQueuedCommandTable        = Buffer;
+  AhciRegisters->AhciQueuedCommandTablePciAddr = (EFI_AHCI_QUEUED_COMMAND_TABLE *)(UINTN)AhciQueuedCommandTablePciAddr;
+  AhciRegisters->MaxQueuedCommandTableSize     = MaxQueuedCommandTableSize;
+}
+
 /**
   Allocate transfer-related data struct which is used at AHCI mode.
 
@@ -2164,6 +2672,8 @@ AhciCreateTransferDescriptor (
   }
   AhciRegisters->AhciCommandTablePciAddr = (EFI_AHCI_COMMAND_TABLE *)(UINTN)AhciCommandTablePciAddr;
 
+  AhciCreateQueuedCommandTable (PciIo, AhciRegisters);
+
   return EFI_SUCCESS;
   //
   // Map error or unable to map the whole CmdList buffer into a contiguous region.
@@ -2237,6 +2747,7 @@ AhciModeInitialization (
   EFI_ATA_COLLECTIVE_MODE          *SupportedModes;
   EFI_ATA_TRANSFER_MODE            TransferMode;
   UINT32                           PhyDetectDelay;
+  UINT8                            QueueDepth;
 
   if (Instance == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -2507,6 +3018,23 @@ AhciModeInitialization (
         continue;
       }
 
+      //
+      // Use native command queuing if both the HBA and the device support it.
+      // IDENTIFY word 76 bit 8 reports the NCQ support and word 75 bits 4:0
+      // report the maximum queue depth minus 1.
+      //
+      AhciRegisters->QueueDepth[Port] = 0;
+      if ((DeviceType == EfiIdeHarddisk) &&
+          (AhciRegisters->AhciQueuedCommandTable != NULL) &&
+          (Buffer.AtaData.serial_ata_capabilities != 0xFFFF) &&
+          ((Buffer.AtaData.serial_ata_capabilities & BIT8) != 0)) {
+        QueueDepth = (UINT8) MIN ((Buffer.AtaData.queue_depth & 0x1F) + 1, ((Capability & 0x1F00) >> 8) + 1);
+        if (QueueDepth > 1) {
+          AhciRegisters->QueueDepth[Port] = QueueDepth;
+          DEBUG ((EFI_D_INFO, "port [%d] uses native command queuing, queue depth [%d]\n", Port, QueueDepth));
+        }
+      }
+
       //
       // Found a ATA or ATAPI device, add it into the device list.
       //
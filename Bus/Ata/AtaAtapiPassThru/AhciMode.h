@@ -19,6 +19,7 @@
 #define EFI_AHCI_CAPABILITY_OFFSET             0x0000
 #define   EFI_AHCI_CAP_SAM                     BIT18
 #define   EFI_AHCI_CAP_SSS                     BIT27
+#define   EFI_AHCI_CAP_SNCQ                    BIT30
 #define   EFI_AHCI_CAP_S64A                    BIT31
 #define EFI_AHCI_GHC_OFFSET                    0x0004
 #define   EFI_AHCI_GHC_RESET                   BIT0
@@ -29,6 +30,17 @@
 
 #define EFI_AHCI_MAX_PORTS                     32
 
+//
+// Native command queuing. A queued command uses the command slot that equals
+// its tag, and slot 0 is kept for the non-queued commands. A queued command
+// transfers at most 0x10000 sectors, which needs no more than 8 PRD entries.
+//
+#define EFI_AHCI_ATA_CMD_READ_FPDMA_QUEUED     0x60
+#define EFI_AHCI_ATA_CMD_WRITE_FPDMA_QUEUED    0x61
+#define EFI_AHCI_ATA_CMD_READ_LOG_EXT          0x2F
+#define EFI_AHCI_NCQ_COMMAND_ERROR_LOG         0x10
+#define EFI_AHCI_QUEUED_MAX_PRDT_NUMBER        8
+
 typedef struct {
   UINT32  Lower32;
   UINT32  Upper32;
@@ -267,6 +279,17 @@ typedef struct {
   EFI_AHCI_COMMAND_PRDT     PrdtTable[65535];     // The scatter/gather list for data transfer
 } EFI_AHCI_COMMAND_TABLE;
 
+//
+// Command table of a queued command. The layout is the same as EFI_AHCI_COMMAND_TABLE
+// but the PRD table is limited to EFI_AHCI_QUEUED_MAX_PRDT_NUMBER entries.
+//
+typedef struct {
+  EFI_AHCI_COMMAND_FIS      CommandFis;       // A software constructed FIS.
+  EFI_AHCI_ATAPI_COMMAND    AtapiCmd;         // 12 or 16 bytes ATAPI cmd.
+  UINT8                     Reserved[0x30];
+  EFI_AHCI_COMMAND_PRDT     PrdtTable[EFI_AHCI_QUEUED_MAX_PRDT_NUMBER];
+} EFI_AHCI_QUEUED_COMMAND_TABLE;
+
 //
 // Received FIS structure
 //
@@ -297,6 +320,18 @@ typedef struct {
   VOID                      *MapRFis;
   VOID                      *MapCmdList;
   VOID                      *MapCommandTable;
+
+  //
+  // For native command queuing. AhciQueuedCommandTable has one entry for each
+  // command slot and is NULL if the HBA doesn't support native command queuing.
+  //
+  EFI_AHCI_QUEUED_COMMAND_TABLE *AhciQueuedCommandTable;
+  EFI_AHCI_QUEUED_COMMAND_TABLE *AhciQueuedCommandTablePciAddr;
+  UINT64                    MaxQueuedCommandTableSize;
+  VOID                      *MapQueuedCommandTable;
+  UINT8                     QueueDepth[EFI_AHCI_MAX_PORTS];      // Usable tags of the device, 0 if NCQ isn't used.
+  UINT32                    QueuedSlots;                         // Slots of all outstanding queued commands.
+  UINT32                    PortQueuedSlots[EFI_AHCI_MAX_PORTS]; // Slots of the outstanding queued commands of a port.
 } EFI_AHCI_REGISTERS;
 
 /**
@@ -394,13 +394,21 @@ AsyncNonBlockingTransferRoutine (
   //
   // Get the Taks from the Taks List and execute it, until there is
   // no task in the list or the device is busy with task (EFI_NOT_READY).
+  // A started AHCI queued command doesn't keep the following tasks from
+  // being started, so many queued commands can be outstanding.
   //
-  while (TRUE) {
-    if (!IsListEmpty (EntryHeader)) {
-      Entry = GetFirstNode (EntryHeader);
-      Task  = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
-    } else {
-      return;
+  Entry = GetFirstNode (EntryHeader);
+  while (!IsNull (EntryHeader, Entry)) {
+    Task = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+
+    //
+    // A non-queued command waits until all the queued commands are completed.
+    //
+    if ((Instance->Mode == EfiAtaAhciMode) &&
+        !Task->IsStart &&
+        (Instance->AhciRegisters.QueuedSlots != 0) &&
+        !AhciIsQueuedCommand (&Instance->AhciRegisters, Task->Port, Task->PortMultiplier, Task->Packet)) {
+      break;
     }
 
     Status = AtaPassThruPassThruExecute (
@@ -425,9 +433,12 @@ AsyncNonBlockingTransferRoutine (
     // is not finished yet. Otherwise the operation is successful.
     //
     if (Status == EFI_NOT_READY) {
-      break;
+      if (Task->QueueSlot == 0) {
+        break;
+      }
+      Entry = GetNextNode (EntryHeader, Entry);
     } else {
-      RemoveEntryList (&Task->Link);
+      Entry = RemoveEntryList (&Task->Link);
       gBS->SignalEvent (Task->Event);
       FreePool (Task);
     }
@@ -912,6 +923,17 @@ AtaAtapiPassThruStop (
 
   if (Instance->Mode == EfiAtaAhciMode) {
     AhciRegisters = &Instance->AhciRegisters;
+    if (AhciRegisters->AhciQueuedCommandTable != NULL) {
+      PciIo->Unmap (
+               PciIo,
+               AhciRegisters->MapQueuedCommandTable
+               );
+      PciIo->FreeBuffer (
+               PciIo,
+               EFI_SIZE_TO_PAGES ((UINTN) AhciRegisters->MaxQueuedCommandTableSize),
+               AhciRegisters->AhciQueuedCommandTable
+               );
+    }
     PciIo->Unmap (
              PciIo,
              AhciRegisters->MapCommandTable
@@ -1117,6 +1139,10 @@ DestroyAsynTaskList (
   EFI_TPL              OldTpl;
 
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (Instance->Mode == EfiAtaAhciMode) {
+    AhciAbortQueuedCommands (Instance);
+  }
+
   if (!IsListEmpty (&Instance->NonBlockingTaskList)) {
     //
     // Free the Subtask list.
@@ -1251,7 +1277,6 @@ AtaPassThruPassThru (
   LIST_ENTRY                      *Node;
   EFI_ATA_DEVICE_INFO             *DeviceInfo;
   EFI_IDENTIFY_DATA               *IdentifyData;
-  UINT64                          Capacity;
   UINT32                          MaxSectorCount;
   ATA_NONBLOCK_TASK               *Task;
   EFI_TPL                         OldTpl;
@@ -1296,22 +1321,17 @@ AtaPassThruPassThru (
   }
 
   //
-  // Check whether this device needs 48-bit addressing (ATAPI-6 ata device).
+  // Check whether this device supports 48-bit addressing (ATAPI-6 ata device).
   // Per ATA-6 spec, word83: bit15 is zero and bit14 is one.
   // If bit10 is one, it means the ata device support 48-bit addressing.
+  // The ATA bus driver uses the 48-bit commands whenever they are supported,
+  // whose max sector count is 0x10000, even if the capacity doesn't need them.
   //
   DeviceInfo     = ATA_ATAPI_DEVICE_INFO_FROM_THIS (Node);
   IdentifyData   = DeviceInfo->IdentifyData;
   MaxSectorCount = 0x100;
   if ((IdentifyData->AtaData.command_set_supported_83 & (BIT10 | BIT15 | BIT14)) == 0x4400) {
-    Capacity = *((UINT64 *)IdentifyData->AtaData.maximum_lba_for_48bit_addressing);
-    if (Capacity > 0xFFFFFFF) {
-      //
-      // Capacity exceeds 120GB. 48-bit addressing is really needed
-      // In this case, the max sector count is 0x10000
-      //
-      MaxSectorCount = 0x10000;
-    }
+    MaxSectorCount = 0x10000;
   }
 
   //
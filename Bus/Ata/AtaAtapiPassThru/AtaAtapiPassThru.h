@@ -140,6 +140,7 @@ struct _ATA_NONBLOCK_TASK {
   VOID                              *TableMap;       // Pointer to PRD table map.
   EFI_ATA_DMA_PRD                   *MapBaseAddress; //  Pointer to range Base address for Map.
   UINTN                             PageCount;       //  The page numbers used by PCIO freebuffer.
+  UINT8                             QueueSlot;       //  Command slot of a queued AHCI command, 0 if not queued.
 };
 
 //
@@ -1193,6 +1194,47 @@ AhciPioTransfer (
   IN     ATA_NONBLOCK_TASK          *Task
   );
 
+/**
+  Check whether a non-blocking ATA command is sent to the device with native
+  command queuing.
+
+  Only READ DMA EXT and WRITE DMA EXT commands to a device which supports native
+  command queuing are queued. They are sent as READ FPDMA QUEUED and WRITE FPDMA
+  QUEUED commands.
+
+  @param[in]  AhciRegisters   The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]  Port            The number of port.
+  @param[in]  PortMultiplier  The number of port multiplier.
+  @param[in]  Packet          A pointer to the ATA command to send.
+
+  @retval TRUE                The command is sent with native command queuing.
+  @retval FALSE               The command is sent with a non-queued command.
+
+**/
+BOOLEAN
+EFIAPI
+AhciIsQueuedCommand (
+  IN EFI_AHCI_REGISTERS                *AhciRegisters,
+  IN UINT16                            Port,
+  IN UINT16                            PortMultiplier,
+  IN EFI_ATA_PASS_THRU_COMMAND_PACKET  *Packet
+  );
+
+/**
+  Abort all outstanding queued commands.
+
+  The ports running queued commands are stopped and the data buffers of the
+  queued commands are unmapped. The tasks stay in the non-blocking task list.
+
+  @param[in]  Instance        A pointer to the ATA_ATAPI_PASS_THRU_INSTANCE instance.
+
+**/
+VOID
+EFIAPI
+AhciAbortQueuedCommands (
+  IN ATA_ATAPI_PASS_THRU_INSTANCE      *Instance
+  );
+
 /**
   Send ATA command into device with NON_DATA protocol
 
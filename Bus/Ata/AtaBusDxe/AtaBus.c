@@ -91,7 +91,11 @@ ATA_DEVICE gAtaDeviceTemplate = {
   {L'\0', },                   // ModelName
   {NULL, NULL},                // AtaTaskList
   {NULL, NULL},                // AtaSubTaskList
-  FALSE                        // Abort
+  FALSE,                       // Abort
+  0,                           // PendingSubTaskCount
+  {NULL, NULL},                // SubTaskPool
+  0,                           // SubTaskPoolCount
+  { 0, }                       // Statistics
 };
 
 /**
@@ -138,6 +142,30 @@ FreeAlignedBuffer (
 }
 
 
+/**
+  Dump the I/O statistics of the ATA device.
+
+  @param  AtaDevice         The ATA child device involved for the operation.
+
+**/
+VOID
+AtaDumpStatistics (
+  IN ATA_DEVICE  *AtaDevice
+  )
+{
+  ATA_DEVICE_STATISTICS   *Statistics;
+
+  Statistics = &AtaDevice->Statistics;
+
+  DEBUG ((EFI_D_INFO, " == ATA DEVICE STATISTICS: Port %x PortMultiplierPort %x ==\n", AtaDevice->Port, AtaDevice->PortMultiplierPort));
+  DEBUG ((EFI_D_INFO, "    Commands             : %ld\n", Statistics->Commands));
+  DEBUG ((EFI_D_INFO, "    Bytes transferred    : %ld\n", Statistics->TransferBytes));
+  DEBUG ((EFI_D_INFO, "    Queued requests      : %ld\n", Statistics->QueuedRequests));
+  DEBUG ((EFI_D_INFO, "    Merged requests      : %ld\n", Statistics->MergedRequests));
+  DEBUG ((EFI_D_INFO, "    Subtasks allocated   : %ld\n", Statistics->SubTaskAllocations));
+}
+
+
 /**
   Release all the resources allocated for the ATA device.
 
@@ -195,6 +223,8 @@ ReleaseAtaResources (
     }
   }
   gBS->RestoreTPL (OldTpl);
+  DestroyAtaSubTaskPool (AtaDevice);
+  AtaDumpStatistics (AtaDevice);
   FreePool (AtaDevice);
 }
 
@@ -294,6 +324,7 @@ RegisterAtaDevice (
   //
   InitializeListHead (&AtaDevice->AtaTaskList);
   InitializeListHead (&AtaDevice->AtaSubTaskList);
+  InitializeListHead (&AtaDevice->SubTaskPool);
 
   //
   // Report Status Code to indicate the ATA device will be enabled
@@ -1099,7 +1130,7 @@ BlockIoReadWrite (
   //
   // Invoke low level AtaDevice Access Routine.
   //
-  Status = AccessAtaDevice (AtaDevice, Buffer, Lba, NumberOfBlocks, IsWrite, Token);
+  Status = AccessAtaDevice (AtaDevice, Buffer, Lba, NumberOfBlocks, IsWrite, Token, FALSE, NULL);
 
   gBS->RestoreTPL (OldTpl);
 
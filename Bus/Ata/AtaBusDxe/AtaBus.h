@@ -75,6 +75,13 @@
 //
 #define MAX_48BIT_TRANSFER_BLOCK_NUM      0xFFFF
 
+//
+// The maximum number of non-blocking subtasks outstanding on a device. It matches
+// the maximum native command queuing depth, new BlockIo2 requests wait in AtaTaskList
+// only when the device already has this many subtasks.
+//
+#define ATA_MAX_PENDING_SUBTASKS          32
+
 //
 // The maximum model name in ATA identify data
 //
@@ -110,6 +117,17 @@ typedef struct {
   EFI_HANDLE                  DriverBindingHandle;
 } ATA_BUS_DRIVER_DATA;
 
+//
+// I/O statistics of an ATA device
+//
+typedef struct {
+  UINT64                                Commands;
+  UINT64                                TransferBytes;
+  UINT64                                QueuedRequests;       // BlockIo2 requests which waited in AtaTaskList
+  UINT64                                MergedRequests;       // Queued requests merged into the request before them
+  UINT64                                SubTaskAllocations;   // Subtasks not served by the subtask pool
+} ATA_DEVICE_STATISTICS;
+
 //
 // ATA device data structure for each child device
 //
@@ -149,6 +167,15 @@ typedef struct {
   LIST_ENTRY                            AtaTaskList;
   LIST_ENTRY                            AtaSubTaskList;
   BOOLEAN                               Abort;
+  UINTN                                 PendingSubTaskCount;
+
+  //
+  // Free subtasks kept for reuse, at most ATA_MAX_PENDING_SUBTASKS.
+  //
+  LIST_ENTRY                            SubTaskPool;
+  UINTN                                 SubTaskPoolCount;
+
+  ATA_DEVICE_STATISTICS                 Statistics;
 } ATA_DEVICE;
 
 //
@@ -162,6 +189,9 @@ typedef struct {
   EFI_ATA_PASS_THRU_COMMAND_PACKET  Packet;
   BOOLEAN                           *IsError;// Indicate whether meeting error during source allocation for new task.
   LIST_ENTRY                        TaskEntry;
+  EFI_ATA_STATUS_BLOCK              *Asb;    // Status block of the Packet, kept while the subtask is in the pool.
+  EFI_ATA_COMMAND_BLOCK             Acb;     // Command block of the Packet.
+  LIST_ENTRY                        MergedTaskList; // Queued ATA_BUS_ASYN_TASKs completed with this subtask.
 } ATA_BUS_ASYN_SUB_TASK;
 
 //
@@ -227,9 +257,28 @@ FreeAlignedBuffer (
   IN UINTN                    BufferSize
   );
 
+/**
+  Allocate a SubTask from the subtask pool of the ATA device.
+
+  A new SubTask is allocated when the pool is empty.
+
+  @param[in]  AtaDevice      The ATA child device involved for the operation.
+
+  @return The SubTask with its Packet, Acb and MergedTaskList cleared, or NULL
+          if there is not enough memory.
+
+**/
+ATA_BUS_ASYN_SUB_TASK *
+AllocateAtaSubTask (
+  IN ATA_DEVICE                 *AtaDevice
+  );
+
 /**
   Free SubTask.
 
+  The SubTask is put back to the subtask pool of its ATA device, or freed if the
+  pool is full.
+
   @param[in, out]  Task      Pointer to task to be freed.
 
 **/
@@ -239,6 +288,17 @@ FreeAtaSubTask (
   IN OUT ATA_BUS_ASYN_SUB_TASK  *Task
   );
 
+/**
+  Free all the SubTasks in the subtask pool of the ATA device.
+
+  @param[in]  AtaDevice      The ATA child device involved for the operation.
+
+**/
+VOID
+DestroyAtaSubTaskPool (
+  IN ATA_DEVICE                 *AtaDevice
+  );
+
 /**
   Wrapper for EFI_ATA_PASS_THRU_PROTOCOL.ResetDevice().
 
@@ -288,6 +348,14 @@ DiscoverAtaDevice (
   @param[in]       NumberOfBlocks  The block number or sector count of the transfer.
   @param[in]       IsWrite         Indicates whether it is a write operation.
   @param[in, out]  Token           A pointer to the token associated with the transaction.
+  @param[in]       FromTaskList    TRUE if the non-blocking request is taken from
+                                   AtaTaskList. It is submitted at once instead of
+                                   being queued again.
+  @param[in, out]  MergedTaskList  Optional. Only used when FromTaskList is TRUE. The
+                                   ATA_BUS_ASYN_TASKs in the list are merged into the
+                                   request, which must then fit in one subtask. On
+                                   success they are moved to the subtask and completed
+                                   with it. On error they are left in the list.
 
   @retval EFI_SUCCESS       The data transfer is complete successfully.
   @return others            Some error occurs when transferring data.
@@ -300,7 +368,9 @@ AccessAtaDevice(
   IN EFI_LBA                        StartLba,
   IN UINTN                          NumberOfBlocks,
   IN BOOLEAN                        IsWrite,
-  IN OUT EFI_BLOCK_IO2_TOKEN        *Token
+  IN OUT EFI_BLOCK_IO2_TOKEN        *Token,
+  IN BOOLEAN                        FromTaskList,
+  IN OUT LIST_ENTRY                 *MergedTaskList OPTIONAL
   );
 
 /**
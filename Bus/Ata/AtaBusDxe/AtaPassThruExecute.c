@@ -125,20 +125,20 @@ AtaDevicePassThru (
   EFI_STATUS                              Status;
   EFI_ATA_PASS_THRU_PROTOCOL              *AtaPassThru;
   EFI_ATA_PASS_THRU_COMMAND_PACKET        *Packet;
+  ATA_BUS_ASYN_SUB_TASK                   *SubTask;
 
   //
   // Assemble packet. If it is non blocking mode, the Ata driver should keep each
-  // subtask and clean them when the event is signaled.
+  // subtask and clean them when the event is signaled. The status block and the
+  // command block are owned by the subtask.
   //
   if (TaskPacket != NULL) {
+    SubTask = BASE_CR (TaskPacket, ATA_BUS_ASYN_SUB_TASK, Packet);
     Packet = TaskPacket;
-    Packet->Asb = AllocateAlignedBuffer (AtaDevice, sizeof (EFI_ATA_STATUS_BLOCK));
-    if (Packet->Asb == NULL) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-
+    Packet->Asb = SubTask->Asb;
     CopyMem (Packet->Asb, AtaDevice->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
-    Packet->Acb = AllocateCopyPool (sizeof (EFI_ATA_COMMAND_BLOCK), &AtaDevice->Acb);
+    Packet->Acb = &SubTask->Acb;
+    CopyMem (Packet->Acb, &AtaDevice->Acb, sizeof (EFI_ATA_COMMAND_BLOCK));
   } else {
     Packet = &AtaDevice->Packet;
     Packet->Asb = AtaDevice->Asb;
@@ -258,9 +258,9 @@ GetAtapi6Capacity (
   ATA_IDENTIFY_DATA             *IdentifyData;
 
   IdentifyData = AtaDevice->IdentifyData;
-  if ((IdentifyData->command_set_supported_83 & BIT10) == 0) {
+  if ((IdentifyData->command_set_supported_83 & (BIT10 | BIT15 | BIT14)) != 0x4400) {
     //
-    // The device doesn't support 48 bit addressing
+    // The device doesn't support 48 bit addressing, or word 83 is not valid
     //
     return 0;
   }
@@ -330,14 +330,16 @@ IdentifyAtaDevice (
   }
 
   Capacity = GetAtapi6Capacity (AtaDevice);
-  if (Capacity > MAX_28BIT_ADDRESSING_CAPACITY) {
+  if (Capacity != 0) {
     //
-    // Capacity exceeds 120GB. 48-bit addressing is really needed
+    // Use 48-bit commands whenever the device supports them, even if the capacity
+    // doesn't need 48-bit addressing, as they transfer up to 0xFFFF blocks per
+    // command instead of 0x100.
     //
     AtaDevice->Lba48Bit = TRUE;
   } else {
     //
-    // This is a hard disk <= 120GB capacity, treat it as normal hard disk
+    // The device only supports 28-bit addressing, treat it as normal hard disk
     //
     Capacity = ((UINT32)IdentifyData->user_addressable_sectors_hi << 16) | IdentifyData->user_addressable_sectors_lo;
     AtaDevice->Lba48Bit = FALSE;
@@ -560,9 +562,70 @@ TransferAtaDevice (
   return AtaDevicePassThru (AtaDevice, TaskPacket, Event);
 }
 
+/**
+  Allocate a SubTask from the subtask pool of the ATA device.
+
+  A new SubTask is allocated when the pool is empty.
+
+  @param[in]  AtaDevice      The ATA child device involved for the operation.
+
+  @return The SubTask with its Packet, Acb and MergedTaskList cleared, or NULL
+          if there is not enough memory.
+
+**/
+ATA_BUS_ASYN_SUB_TASK *
+AllocateAtaSubTask (
+  IN ATA_DEVICE                 *AtaDevice
+  )
+{
+  ATA_BUS_ASYN_SUB_TASK         *SubTask;
+  EFI_ATA_STATUS_BLOCK          *Asb;
+  EFI_TPL                       OldTpl;
+
+  SubTask = NULL;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (!IsListEmpty (&AtaDevice->SubTaskPool)) {
+    SubTask = ATA_ASYN_SUB_TASK_FROM_ENTRY (GetFirstNode (&AtaDevice->SubTaskPool));
+    RemoveEntryList (&SubTask->TaskEntry);
+    AtaDevice->SubTaskPoolCount--;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (SubTask != NULL) {
+    Asb = SubTask->Asb;
+    ZeroMem (SubTask, sizeof (ATA_BUS_ASYN_SUB_TASK));
+    SubTask->Asb = Asb;
+  } else {
+    SubTask = AllocateZeroPool (sizeof (ATA_BUS_ASYN_SUB_TASK));
+    if (SubTask == NULL) {
+      return NULL;
+    }
+
+    SubTask->Asb = AllocateAlignedBuffer (AtaDevice, sizeof (EFI_ATA_STATUS_BLOCK));
+    if (SubTask->Asb == NULL) {
+      FreePool (SubTask);
+      return NULL;
+    }
+
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    AtaDevice->Statistics.SubTaskAllocations++;
+    gBS->RestoreTPL (OldTpl);
+  }
+
+  SubTask->Signature = ATA_SUB_TASK_SIGNATURE;
+  SubTask->AtaDevice = AtaDevice;
+  InitializeListHead (&SubTask->MergedTaskList);
+
+  return SubTask;
+}
+
 /**
   Free SubTask.
 
+  The SubTask is put back to the subtask pool of its ATA device, or freed if the
+  pool is full.
+
   @param[in, out]  Task      Pointer to task to be freed.
 
 **/
@@ -572,16 +635,49 @@ FreeAtaSubTask (
   IN OUT ATA_BUS_ASYN_SUB_TASK  *Task
   )
 {
-  if (Task->Packet.Asb != NULL) {
-    FreeAlignedBuffer (Task->Packet.Asb, sizeof (EFI_ATA_STATUS_BLOCK));
-  }
-  if (Task->Packet.Acb != NULL) {
-    FreePool (Task->Packet.Acb);
+  ATA_DEVICE            *AtaDevice;
+  EFI_TPL               OldTpl;
+
+  AtaDevice = Task->AtaDevice;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (AtaDevice->SubTaskPoolCount < ATA_MAX_PENDING_SUBTASKS) {
+    InsertTailList (&AtaDevice->SubTaskPool, &Task->TaskEntry);
+    AtaDevice->SubTaskPoolCount++;
+    gBS->RestoreTPL (OldTpl);
+    return;
   }
+  gBS->RestoreTPL (OldTpl);
 
+  FreeAlignedBuffer (Task->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
   FreePool (Task);
 }
 
+/**
+  Free all the SubTasks in the subtask pool of the ATA device.
+
+  @param[in]  AtaDevice      The ATA child device involved for the operation.
+
+**/
+VOID
+DestroyAtaSubTaskPool (
+  IN ATA_DEVICE                 *AtaDevice
+  )
+{
+  ATA_BUS_ASYN_SUB_TASK         *SubTask;
+  EFI_TPL                       OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  while (!IsListEmpty (&AtaDevice->SubTaskPool)) {
+    SubTask = ATA_ASYN_SUB_TASK_FROM_ENTRY (GetFirstNode (&AtaDevice->SubTaskPool));
+    RemoveEntryList (&SubTask->TaskEntry);
+    FreeAlignedBuffer (SubTask->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
+    FreePool (SubTask);
+  }
+  AtaDevice->SubTaskPoolCount = 0;
+  gBS->RestoreTPL (OldTpl);
+}
+
 /**
   Terminate any in-flight non-blocking I/O requests by signaling an EFI_ABORTED
   in the TransactionStatus member of the EFI_BLOCK_IO2_TOKEN for the non-blocking
@@ -655,8 +751,13 @@ AtaNonBlockingCallBack (
 {
   ATA_BUS_ASYN_SUB_TASK *Task;
   ATA_BUS_ASYN_TASK     *AtaTask;
+  ATA_BUS_ASYN_TASK     *NextTask;
   ATA_DEVICE            *AtaDevice;
   LIST_ENTRY            *Entry;
+  LIST_ENTRY            MergedTaskList;
+  UINTN                 NumberOfBlocks;
+  UINTN                 MaxTransferBlockNumber;
+  UINTN                 BlockSize;
   EFI_STATUS            Status;
 
   Task = (ATA_BUS_ASYN_SUB_TASK *) Context;
@@ -694,6 +795,7 @@ AtaNonBlockingCallBack (
   // Remove the SubTask from the Task list.
   //
   RemoveEntryList (&Task->TaskEntry);
+  AtaDevice->PendingSubTaskCount--;
   if ((*Task->UnsignalledEventCount) == 0) {
     //
     // All Sub tasks are done, then signal the upper layer event.
@@ -706,31 +808,80 @@ AtaNonBlockingCallBack (
 
     FreePool (Task->UnsignalledEventCount);
     FreePool (Task->IsError);
+  }
 
+  //
+  // The requests merged into this subtask are completed with it.
+  //
+  while (!IsListEmpty (&Task->MergedTaskList)) {
+    Entry   = GetFirstNode (&Task->MergedTaskList);
+    AtaTask = ATA_ASYN_TASK_FROM_ENTRY (Entry);
+    RemoveEntryList (Entry);
+    AtaTask->Token->TransactionStatus = Task->Token->TransactionStatus;
+    gBS->SignalEvent (AtaTask->Token->Event);
+    FreePool (AtaTask);
+  }
+
+  //
+  // Move to the next tasks in AtaTaskList while the device can take more subtasks.
+  // The task is removed from AtaTaskList first, and AccessAtaDevice() is told that
+  // it comes from there, so that it is submitted instead of queued again behind the
+  // remaining tasks.
+  //
+  ASSERT ((UINTN) AtaDevice->Lba48Bit < 2);
+  MaxTransferBlockNumber = mMaxTransferBlockNumber[AtaDevice->Lba48Bit];
+  BlockSize              = AtaDevice->BlockMedia.BlockSize;
+
+  while (!IsListEmpty (&AtaDevice->AtaTaskList) &&
+         (AtaDevice->PendingSubTaskCount < ATA_MAX_PENDING_SUBTASKS)) {
+    Entry   = GetFirstNode (&AtaDevice->AtaTaskList);
+    AtaTask = ATA_ASYN_TASK_FROM_ENTRY (Entry);
+    RemoveEntryList (Entry);
 
     //
-    // Finish all subtasks and move to the next task in AtaTaskList.
+    // Merge the following reads of the adjacent blocks into the same buffer,
+    // as long as they fit in one command.
     //
-    if (!IsListEmpty (&AtaDevice->AtaTaskList)) {
-      Entry   = GetFirstNode (&AtaDevice->AtaTaskList);
-      AtaTask = ATA_ASYN_TASK_FROM_ENTRY (Entry);
-      DEBUG ((EFI_D_BLKIO, "Start to embark a new Ata Task\n"));
-      DEBUG ((EFI_D_BLKIO, "AtaTask->NumberOfBlocks = %x; AtaTask->Token=%x\n", AtaTask->NumberOfBlocks, AtaTask->Token));
-      Status = AccessAtaDevice (
-                 AtaTask->AtaDevice,
-                 AtaTask->Buffer,
-                 AtaTask->StartLba,
-                 AtaTask->NumberOfBlocks,
-                 AtaTask->IsWrite,
-                 AtaTask->Token
-                 );
-      if (EFI_ERROR (Status)) {
-        AtaTask->Token->TransactionStatus = Status;
-        gBS->SignalEvent (AtaTask->Token->Event);
+    InitializeListHead (&MergedTaskList);
+    NumberOfBlocks = AtaTask->NumberOfBlocks;
+    while (!AtaTask->IsWrite && !IsListEmpty (&AtaDevice->AtaTaskList)) {
+      NextTask = ATA_ASYN_TASK_FROM_ENTRY (GetFirstNode (&AtaDevice->AtaTaskList));
+      if (NextTask->IsWrite ||
+          (NextTask->StartLba != AtaTask->StartLba + NumberOfBlocks) ||
+          (NextTask->Buffer != AtaTask->Buffer + NumberOfBlocks * BlockSize) ||
+          (NumberOfBlocks + NextTask->NumberOfBlocks > MaxTransferBlockNumber)) {
+        break;
       }
-      RemoveEntryList (Entry);
-      FreePool (AtaTask);
+      RemoveEntryList (&NextTask->TaskEntry);
+      InsertTailList (&MergedTaskList, &NextTask->TaskEntry);
+      NumberOfBlocks += NextTask->NumberOfBlocks;
+      AtaDevice->Statistics.MergedRequests++;
     }
+
+    DEBUG ((EFI_D_BLKIO, "Start to embark a new Ata Task\n"));
+    DEBUG ((EFI_D_BLKIO, "AtaTask->NumberOfBlocks = %x; AtaTask->Token=%x\n", NumberOfBlocks, AtaTask->Token));
+    Status = AccessAtaDevice (
+               AtaTask->AtaDevice,
+               AtaTask->Buffer,
+               AtaTask->StartLba,
+               NumberOfBlocks,
+               AtaTask->IsWrite,
+               AtaTask->Token,
+               TRUE,
+               &MergedTaskList
+               );
+    if (EFI_ERROR (Status)) {
+      AtaTask->Token->TransactionStatus = Status;
+      gBS->SignalEvent (AtaTask->Token->Event);
+      while (!IsListEmpty (&MergedTaskList)) {
+        NextTask = ATA_ASYN_TASK_FROM_ENTRY (GetFirstNode (&MergedTaskList));
+        RemoveEntryList (&NextTask->TaskEntry);
+        NextTask->Token->TransactionStatus = Status;
+        gBS->SignalEvent (NextTask->Token->Event);
+        FreePool (NextTask);
+      }
+    }
+    FreePool (AtaTask);
   }
 
   DEBUG ((
@@ -762,6 +913,14 @@ AtaNonBlockingCallBack (
   @param[in]       NumberOfBlocks  The block number or sector count of the transfer.
   @param[in]       IsWrite         Indicates whether it is a write operation.
   @param[in, out]  Token           A pointer to the token associated with the transaction.
+  @param[in]       FromTaskList    TRUE if the non-blocking request is taken from
+                                   AtaTaskList. It is submitted at once instead of
+                                   being queued again.
+  @param[in, out]  MergedTaskList  Optional. Only used when FromTaskList is TRUE. The
+                                   ATA_BUS_ASYN_TASKs in the list are merged into the
+                                   request, which must then fit in one subtask. On
+                                   success they are moved to the subtask and completed
+                                   with it. On error they are left in the list.
 
   @retval EFI_SUCCESS       The data transfer is complete successfully.
   @return others            Some error occurs when transferring data.
@@ -774,7 +933,9 @@ AccessAtaDevice(
   IN EFI_LBA                        StartLba,
   IN UINTN                          NumberOfBlocks,
   IN BOOLEAN                        IsWrite,
-  IN OUT EFI_BLOCK_IO2_TOKEN        *Token
+  IN OUT EFI_BLOCK_IO2_TOKEN        *Token,
+  IN BOOLEAN                        FromTaskList,
+  IN OUT LIST_ENTRY                 *MergedTaskList OPTIONAL
   )
 {
   EFI_STATUS                        Status;
@@ -789,6 +950,7 @@ AccessAtaDevice(
   UINTN                             Index;
   BOOLEAN                           *IsError;
   EFI_TPL                           OldTpl;
+  LIST_ENTRY                        *Entry;
 
   TempCount  = 0;
   Status     = EFI_SUCCESS;
@@ -812,7 +974,13 @@ AccessAtaDevice(
   if ((Token != NULL) && (Token->Event != NULL)) {
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
 
-    if (!IsListEmpty (&AtaDevice->AtaSubTaskList)) {
+    //
+    // The request is submitted at once unless the device already has the maximum
+    // pending subtasks. Requests queued earlier are kept in order.
+    //
+    if (!FromTaskList &&
+        (!IsListEmpty (&AtaDevice->AtaTaskList) ||
+         (AtaDevice->PendingSubTaskCount >= ATA_MAX_PENDING_SUBTASKS))) {
       AtaTask = AllocateZeroPool (sizeof (ATA_BUS_ASYN_TASK));
       if (AtaTask == NULL) {
         gBS->RestoreTPL (OldTpl);
@@ -827,6 +995,7 @@ AccessAtaDevice(
       AtaTask->Token          = Token;
 
       InsertTailList (&AtaDevice->AtaTaskList, &AtaTask->TaskEntry);
+      AtaDevice->Statistics.QueuedRequests++;
       gBS->RestoreTPL (OldTpl);
       return EFI_SUCCESS;
     }
@@ -846,6 +1015,7 @@ AccessAtaDevice(
     DEBUG ((EFI_D_BLKIO, "Allocation IsError Addr=%x\n", IsError));
     *IsError = FALSE;
     TempCount   = (NumberOfBlocks + MaxTransferBlockNumber - 1) / MaxTransferBlockNumber;
+    ASSERT ((MergedTaskList == NULL) || IsListEmpty (MergedTaskList) || (TempCount == 1));
     *EventCount = TempCount;
     DEBUG ((EFI_D_BLKIO, "AccessAtaDevice, NumberOfBlocks=%x\n", NumberOfBlocks));
     DEBUG ((EFI_D_BLKIO, "AccessAtaDevice, MaxTransferBlockNumber=%x\n", MaxTransferBlockNumber));
@@ -875,7 +1045,7 @@ AccessAtaDevice(
       SubTask  = NULL;
       SubEvent = NULL;
 
-      SubTask = AllocateZeroPool (sizeof (ATA_BUS_ASYN_SUB_TASK));
+      SubTask = AllocateAtaSubTask (AtaDevice);
       if (SubTask == NULL) {
         Status = EFI_OUT_OF_RESOURCES;
         goto EXIT;
@@ -883,11 +1053,17 @@ AccessAtaDevice(
 
       OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
       SubTask->UnsignalledEventCount = EventCount;
-      SubTask->Signature             = ATA_SUB_TASK_SIGNATURE;
-      SubTask->AtaDevice             = AtaDevice;
       SubTask->Token                 = Token;
       SubTask->IsError               = IsError;
+      if (MergedTaskList != NULL) {
+        while (!IsListEmpty (MergedTaskList)) {
+          Entry = GetFirstNode (MergedTaskList);
+          RemoveEntryList (Entry);
+          InsertTailList (&SubTask->MergedTaskList, Entry);
+        }
+      }
       InsertTailList (&AtaDevice->AtaSubTaskList, &SubTask->TaskEntry);
+      AtaDevice->PendingSubTaskCount++;
       gBS->RestoreTPL (OldTpl);
 
       Status = gBS->CreateEvent (
@@ -919,6 +1095,11 @@ AccessAtaDevice(
       goto EXIT;
     }
 
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    AtaDevice->Statistics.Commands++;
+    AtaDevice->Statistics.TransferBytes += MultU64x32 (TransferBlockNumber, (UINT32) BlockSize);
+    gBS->RestoreTPL (OldTpl);
+
     Index++;
     StartLba += TransferBlockNumber;
     Buffer   += TransferBlockNumber * BlockSize;
@@ -941,7 +1122,16 @@ EXIT:
       }
 
       if (SubTask != NULL) {
+        //
+        // The merged requests are given back to the caller to be failed.
+        //
+        while (!IsListEmpty (&SubTask->MergedTaskList)) {
+          Entry = GetFirstNode (&SubTask->MergedTaskList);
+          RemoveEntryList (Entry);
+          InsertTailList (MergedTaskList, Entry);
+        }
         RemoveEntryList (&SubTask->TaskEntry);
+        AtaDevice->PendingSubTaskCount--;
         FreeAtaSubTask (SubTask);
       }
 
@@ -148,6 +148,16 @@ EnumerateNvmeDevNamespace (
     Device->BlockIo.WriteBlocks  = NvmeBlockIoWriteBlocks;
     Device->BlockIo.FlushBlocks  = NvmeBlockIoFlushBlocks;
 
+    //
+    // Create BlockIo2 Protocol instance
+    //
+    Device->BlockIo2.Media          = &Device->Media;
+    Device->BlockIo2.Reset          = NvmeBlockIoResetEx;
+    Device->BlockIo2.ReadBlocksEx   = NvmeBlockIoReadBlocksEx;
+    Device->BlockIo2.WriteBlocksEx  = NvmeBlockIoWriteBlocksEx;
+    Device->BlockIo2.FlushBlocksEx  = NvmeBlockIoFlushBlocksEx;
+    InitializeListHead (&Device->AsyncQueue);
+
     //
     // Create DiskInfo Protocol instance
     //
@@ -192,16 +202,34 @@ EnumerateNvmeDevNamespace (
     //
     Device->DeviceHandle = NULL;
 
-    Status = gBS->InstallMultipleProtocolInterfaces (
-                    &Device->DeviceHandle,
-                    &gEfiDevicePathProtocolGuid,
-                    Device->DevicePath,
-                    &gEfiBlockIoProtocolGuid,
-                    &Device->BlockIo,
-                    &gEfiDiskInfoProtocolGuid,
-                    &Device->DiskInfo,
-                    NULL
-                    );
+    //
+    // BlockIo2 is only produced when the controller has the non-blocking I/O queue.
+    //
+    if (Private->AsyncQueueSize != 0) {
+      Status = gBS->InstallMultipleProtocolInterfaces (
+                      &Device->DeviceHandle,
+                      &gEfiDevicePathProtocolGuid,
+                      Device->DevicePath,
+                      &gEfiBlockIoProtocolGuid,
+                      &Device->BlockIo,
+                      &gEfiBlockIo2ProtocolGuid,
+                      &Device->BlockIo2,
+                      &gEfiDiskInfoProtocolGuid,
+                      &Device->DiskInfo,
+                      NULL
+                      );
+    } else {
+      Status = gBS->InstallMultipleProtocolInterfaces (
+                      &Device->DeviceHandle,
+                      &gEfiDevicePathProtocolGuid,
+                      Device->DevicePath,
+                      &gEfiBlockIoProtocolGuid,
+                      &Device->BlockIo,
+                      &gEfiDiskInfoProtocolGuid,
+                      &Device->DiskInfo,
+                      NULL
+                      );
+    }
 
     if(EFI_ERROR(Status)) {
       goto Exit;
@@ -355,6 +383,15 @@ UnregisterNvmeNamespace (
 
   Device = NVME_DEVICE_PRIVATE_DATA_FROM_BLOCK_IO (BlockIo);
 
+  //
+  // The BlockIo2 requests of the namespace must be completed before its
+  // protocols are uninstalled.
+  //
+  NvmeWaitAsyncIoComplete (Device->Controller);
+  if (!IsListEmpty (&Device->AsyncQueue)) {
+    return EFI_DEVICE_ERROR;
+  }
+
   //
   // Close the child handle
   //
@@ -366,19 +403,43 @@ UnregisterNvmeNamespace (
          );
 
   //
-  // The Nvm Express driver installs the BlockIo and DiskInfo in the DriverBindingStart().
-  // Here should uninstall both of them.
+  // The Nvm Express driver installs the BlockIo, BlockIo2 and DiskInfo in the DriverBindingStart().
+  // Here should uninstall all of them. BlockIo2 is absent if the controller has no
+  // non-blocking I/O queue.
   //
-  Status = gBS->UninstallMultipleProtocolInterfaces (
+  Status = gBS->OpenProtocol (
                   Handle,
-                  &gEfiDevicePathProtocolGuid,
-                  Device->DevicePath,
-                  &gEfiBlockIoProtocolGuid,
-                  &Device->BlockIo,
-                  &gEfiDiskInfoProtocolGuid,
-                  &Device->DiskInfo,
-                  NULL
+                  &gEfiBlockIo2ProtocolGuid,
+                  NULL,
+                  This->DriverBindingHandle,
+                  Controller,
+                  EFI_OPEN_PROTOCOL_TEST_PROTOCOL
                   );
+  if (!EFI_ERROR (Status)) {
+    Status = gBS->UninstallMultipleProtocolInterfaces (
+                    Handle,
+                    &gEfiDevicePathProtocolGuid,
+                    Device->DevicePath,
+                    &gEfiBlockIoProtocolGuid,
+                    &Device->BlockIo,
+                    &gEfiBlockIo2ProtocolGuid,
+                    &Device->BlockIo2,
+                    &gEfiDiskInfoProtocolGuid,
+                    &Device->DiskInfo,
+                    NULL
+                    );
+  } else {
+    Status = gBS->UninstallMultipleProtocolInterfaces (
+                    Handle,
+                    &gEfiDevicePathProtocolGuid,
+                    Device->DevicePath,
+                    &gEfiBlockIoProtocolGuid,
+                    &Device->BlockIo,
+                    &gEfiDiskInfoProtocolGuid,
+                    &Device->DiskInfo,
+                    NULL
+                    );
+  }
 
   if (EFI_ERROR (Status)) {
     gBS->OpenProtocol (
@@ -405,6 +466,310 @@ UnregisterNvmeNamespace (
   return EFI_SUCCESS;
 }
 
+/**
+  Release the mappings and the PRP list of a nonblocking PassThru request, and
+  remove the request from the nonblocking I/O queue of the controller.
+
+  @param[in] Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in] AsyncRequest        The nonblocking PassThru request to free.
+
+**/
+VOID
+NvmeFreeAsyncPassThruRequest (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private,
+  IN NVME_PASS_THRU_ASYNC_REQ           *AsyncRequest
+  )
+{
+  EFI_PCI_IO_PROTOCOL                   *PciIo;
+
+  PciIo = Private->PciIo;
+
+  if (AsyncRequest->MapData != NULL) {
+    PciIo->Unmap (PciIo, AsyncRequest->MapData);
+  }
+
+  if (AsyncRequest->MapMeta != NULL) {
+    PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
+  }
+
+  if (AsyncRequest->MapPrpList != NULL) {
+    PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
+  }
+
+  if (AsyncRequest->PrpListSlot != NVME_PRP_LIST_NO_SLOT) {
+    NvmeFreePoolPrpList (Private, AsyncRequest->PrpListSlot);
+  } else if (AsyncRequest->PrpListHost != NULL) {
+    PciIo->FreeBuffer (PciIo, AsyncRequest->PrpListNo, AsyncRequest->PrpListHost);
+  }
+
+  RemoveEntryList (&AsyncRequest->Link);
+  Private->AsyncPassThruCount--;
+
+  FreePool (AsyncRequest);
+}
+
+/**
+  Submit the queued BlockIo2 subtasks to the nonblocking I/O queue, and complete the
+  nonblocking PassThru requests whose completion queue entries are posted.
+
+  It is the notification function of the periodic timer event of the controller,
+  and it must be called at TPL_NOTIFY.
+
+  @param[in]     Event               The timer event of the controller.
+  @param[in]     Context             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+EFIAPI
+ProcessAsyncTaskList (
+  IN EFI_EVENT                    Event,
+  IN VOID                         *Context
+  )
+{
+  NVME_CONTROLLER_PRIVATE_DATA    *Private;
+  EFI_PCI_IO_PROTOCOL             *PciIo;
+  NVME_CQ                         *Cq;
+  LIST_ENTRY                      *Link;
+  NVME_BLKIO2_REQUEST             *BlkIo2Request;
+  NVME_BLKIO2_SUBTASK             *Subtask;
+  NVME_PASS_THRU_ASYNC_REQ        *AsyncRequest;
+  EFI_EVENT                       CallerEvent;
+  EFI_STATUS                      Status;
+  BOOLEAN                         HasNewItem;
+  UINT32                          Data;
+
+  Private    = (NVME_CONTROLLER_PRIVATE_DATA *) Context;
+  PciIo      = Private->PciIo;
+  HasNewItem = FALSE;
+
+  //
+  // Submit the queued subtasks as long as the nonblocking I/O queue has free entries.
+  //
+  while (!IsListEmpty (&Private->UnsubmittedSubtasks) &&
+         (Private->AsyncPassThruCount < Private->AsyncQueueSize)) {
+    Link          = GetFirstNode (&Private->UnsubmittedSubtasks);
+    Subtask       = NVME_BLKIO2_SUBTASK_FROM_LINK (Link);
+    BlkIo2Request = Subtask->BlockIo2Request;
+
+    RemoveEntryList (Link);
+    InsertTailList (&BlkIo2Request->SubtaskList, Link);
+    BlkIo2Request->UnsubmittedSubtaskNum--;
+
+    //
+    // Do not send the rest of a request which has already failed.
+    //
+    if (EFI_ERROR (BlkIo2Request->Token->TransactionStatus)) {
+      NvmeFinishSubtask (Subtask, EFI_ABORTED);
+      continue;
+    }
+
+    Status = Private->Passthru.PassThru (
+                                 &Private->Passthru,
+                                 BlkIo2Request->Device->NamespaceId,
+                                 0,
+                                 &Subtask->CommandPacket,
+                                 Subtask->Event
+                                 );
+    if (Status == EFI_NOT_READY) {
+      RemoveEntryList (Link);
+      InsertHeadList (&Private->UnsubmittedSubtasks, Link);
+      BlkIo2Request->UnsubmittedSubtaskNum++;
+      break;
+    } else if (EFI_ERROR (Status)) {
+      NvmeFinishSubtask (Subtask, EFI_DEVICE_ERROR);
+    }
+  }
+
+  //
+  // Complete the requests whose completion queue entries are posted. The entries may
+  // be posted in any order, so they are matched with the requests by command id.
+  //
+  Cq = Private->CqBuffer[NVME_ASYNC_IO_QUEUE] + Private->CqHdbl[NVME_ASYNC_IO_QUEUE].Cqh;
+  while (Cq->Pt != Private->Pt[NVME_ASYNC_IO_QUEUE]) {
+    for (Link = GetFirstNode (&Private->AsyncPassThruQueue);
+         !IsNull (&Private->AsyncPassThruQueue, Link);
+         Link = GetNextNode (&Private->AsyncPassThruQueue, Link)) {
+      AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (Link);
+      if (AsyncRequest->CommandId == Cq->Cid) {
+        break;
+      }
+    }
+
+    if (!IsNull (&Private->AsyncPassThruQueue, Link)) {
+      CopyMem (AsyncRequest->Packet->NvmeResponse, Cq, sizeof (NVM_EXPRESS_RESPONSE));
+      if ((Cq->Sct != 0) || (Cq->Sc != 0)) {
+        DEBUG ((EFI_D_ERROR, "ProcessAsyncTaskList: command 0x%x failed, Sct = 0x%x, Sc = 0x%x\n", Cq->Cid, Cq->Sct, Cq->Sc));
+        AsyncRequest->Packet->ControllerStatus = NVM_EXPRESS_STATUS_CONTROLLER_CMD_ERROR;
+      } else {
+        AsyncRequest->Packet->ControllerStatus = NVM_EXPRESS_STATUS_CONTROLLER_READY;
+        NvmeRecordCommandStatistics (
+          Private,
+          AsyncRequest->Packet,
+          AsyncRequest->PrpListNo,
+          (BOOLEAN) (AsyncRequest->PrpListHost != NULL),
+          AsyncRequest->StartTicks
+          );
+      }
+
+      CallerEvent = AsyncRequest->CallerEvent;
+      NvmeFreeAsyncPassThruRequest (Private, AsyncRequest);
+      gBS->SignalEvent (CallerEvent);
+    } else {
+      DEBUG ((EFI_D_ERROR, "ProcessAsyncTaskList: no request for command 0x%x\n", Cq->Cid));
+    }
+
+    Private->CqHdbl[NVME_ASYNC_IO_QUEUE].Cqh++;
+    if (Private->CqHdbl[NVME_ASYNC_IO_QUEUE].Cqh > Private->AsyncQueueSize) {
+      Private->CqHdbl[NVME_ASYNC_IO_QUEUE].Cqh = 0;
+      Private->Pt[NVME_ASYNC_IO_QUEUE] ^= 1;
+    }
+
+    Cq         = Private->CqBuffer[NVME_ASYNC_IO_QUEUE] + Private->CqHdbl[NVME_ASYNC_IO_QUEUE].Cqh;
+    HasNewItem = TRUE;
+  }
+
+  //
+  // Release the consumed completion queue entries with a single doorbell write.
+  //
+  if (HasNewItem) {
+    Data = ReadUnaligned32 ((UINT32*)&Private->CqHdbl[NVME_ASYNC_IO_QUEUE]);
+    PciIo->Mem.Write (
+                 PciIo,
+                 EfiPciIoWidthUint32,
+                 NVME_BAR,
+                 NVME_CQHDBL_OFFSET(NVME_ASYNC_IO_QUEUE, Private->Cap.Dstrd),
+                 1,
+                 &Data
+                 );
+  }
+}
+
+/**
+  Dump the I/O statistics of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+NvmeDumpStatistics (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  )
+{
+  NVME_CONTROLLER_STATISTICS            *Statistics;
+  UINT64                                AverageLatency;
+
+  Statistics     = &Private->Statistics;
+  AverageLatency = 0;
+  if (Statistics->Commands != 0) {
+    AverageLatency = DivU64x64Remainder (GetTimeInNanoSecond (Statistics->LatencyTicks), Statistics->Commands, NULL);
+  }
+
+  DEBUG ((EFI_D_INFO, " == NVME CONTROLLER STATISTICS ==\n"));
+  DEBUG ((EFI_D_INFO, "    Commands             : %ld\n", Statistics->Commands));
+  DEBUG ((EFI_D_INFO, "    Bytes transferred    : %ld\n", Statistics->TransferBytes));
+  DEBUG ((EFI_D_INFO, "    PRP list pages       : %ld\n", Statistics->PrpListPages));
+  DEBUG ((EFI_D_INFO, "    PRP lists allocated  : %ld\n", Statistics->PrpListAllocations));
+  DEBUG ((EFI_D_INFO, "    Average latency (ns) : %ld\n", AverageLatency));
+}
+
+/**
+  Dump the I/O statistics of the controller when the OS takes over, since the
+  controller is normally never stopped.
+
+  @param[in]     Event               The ExitBootServices event.
+  @param[in]     Context             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+EFIAPI
+NvmeOnExitBootServices (
+  IN EFI_EVENT                          Event,
+  IN VOID                               *Context
+  )
+{
+  NvmeDumpStatistics ((NVME_CONTROLLER_PRIVATE_DATA *) Context);
+}
+
+/**
+  Wait until all the nonblocking I/O of the controller are completed.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+  @retval EFI_SUCCESS                All the nonblocking I/O are completed.
+  @retval EFI_TIMEOUT                Some nonblocking I/O are not completed in NVME_GENERIC_TIMEOUT.
+
+**/
+EFI_STATUS
+NvmeWaitAsyncIoComplete (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  )
+{
+  EFI_TPL                               OldTpl;
+  UINT64                                Index;
+  BOOLEAN                               Completed;
+
+  //
+  // Poll the queue every 100us, the completed subtasks are finished by their
+  // notification functions when the TPL is restored.
+  //
+  for (Index = 0; Index < DivU64x32 (NVME_GENERIC_TIMEOUT, 1000); Index++) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    ProcessAsyncTaskList (Private->TimerEvent, Private);
+    Completed = (BOOLEAN) (IsListEmpty (&Private->AsyncPassThruQueue) &&
+                           IsListEmpty (&Private->UnsubmittedSubtasks));
+    gBS->RestoreTPL (OldTpl);
+
+    if (Completed) {
+      return EFI_SUCCESS;
+    }
+
+    gBS->Stall (100);
+  }
+
+  return EFI_TIMEOUT;
+}
+
+/**
+  Abort all the nonblocking I/O of the controller. It is used after the controller is
+  reinitialized, which drops the commands in the nonblocking I/O queue, and before
+  the controller is stopped.
+
+  It must be called at TPL_NOTIFY.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+NvmeAbortAsyncPassThru (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  )
+{
+  LIST_ENTRY                            *Link;
+  NVME_PASS_THRU_ASYNC_REQ              *AsyncRequest;
+  NVME_BLKIO2_SUBTASK                   *Subtask;
+  EFI_EVENT                             CallerEvent;
+
+  while (!IsListEmpty (&Private->AsyncPassThruQueue)) {
+    AsyncRequest = NVME_PASS_THRU_ASYNC_REQ_FROM_THIS (GetFirstNode (&Private->AsyncPassThruQueue));
+    AsyncRequest->Packet->ControllerStatus = NVM_EXPRESS_STATUS_CONTROLLER_CMD_ABORT;
+
+    CallerEvent = AsyncRequest->CallerEvent;
+    NvmeFreeAsyncPassThruRequest (Private, AsyncRequest);
+    gBS->SignalEvent (CallerEvent);
+  }
+
+  while (!IsListEmpty (&Private->UnsubmittedSubtasks)) {
+    Link    = GetFirstNode (&Private->UnsubmittedSubtasks);
+    Subtask = NVME_BLKIO2_SUBTASK_FROM_LINK (Link);
+
+    RemoveEntryList (Link);
+    InsertTailList (&Subtask->BlockIo2Request->SubtaskList, Link);
+    Subtask->BlockIo2Request->UnsubmittedSubtaskNum--;
+
+    NvmeFinishSubtask (Subtask, EFI_ABORTED);
+  }
+}
+
 /**
   Tests to see if this driver supports a given controller. If a child device is provided,
   it further tests to see if this driver supports creating a handle for the specified child device.
@@ -617,6 +982,8 @@ NvmExpressDriverBindingStart (
   UINT64                            NamespaceUuid;
   EFI_PHYSICAL_ADDRESS              MappedAddr;
   UINTN                             Bytes;
+  UINT64                            StartTicks;
+  UINT64                            EndTicks;
 
   DEBUG ((EFI_D_INFO, "NvmExpressDriverBindingStart: start\n"));
 
@@ -661,19 +1028,21 @@ NvmExpressDriverBindingStart (
     }
 
     //
-    // 4 x 4kB aligned buffers will be carved out of this buffer.
+    // 6 x 4kB aligned buffers will be carved out of this buffer.
     // 1st 4kB boundary is the start of the admin submission queue.
     // 2nd 4kB boundary is the start of the admin completion queue.
     // 3rd 4kB boundary is the start of I/O submission queue #1.
     // 4th 4kB boundary is the start of I/O completion queue #1.
+    // 5th 4kB boundary is the start of I/O submission queue #2 for non-blocking I/O.
+    // 6th 4kB boundary is the start of I/O completion queue #2 for non-blocking I/O.
     //
-    // Allocate 4 pages of memory, then map it for bus master read and write.
+    // Allocate 6 pages of memory, then map it for bus master read and write.
     //
     Status = PciIo->AllocateBuffer (
                       PciIo,
                       AllocateAnyPages,
                       EfiBootServicesData,
-                      4,
+                      6,
                       (VOID**)&Private->Buffer,
                       0
                       );
@@ -681,7 +1050,7 @@ NvmExpressDriverBindingStart (
       goto Exit2;
     }
 
-    Bytes = EFI_PAGES_TO_SIZE (4);
+    Bytes = EFI_PAGES_TO_SIZE (6);
     Status = PciIo->Map (
                       PciIo,
                       EfiPciIoOperationBusMasterCommonBuffer,
@@ -691,12 +1060,23 @@ NvmExpressDriverBindingStart (
                       &Private->Mapping
                       );
 
-    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (4))) {
+    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (6))) {
       goto Exit2;
     }
 
     Private->BufferPciAddr = (UINT8 *)(UINTN)MappedAddr;
-    ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (4));
+    ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (6));
+
+    //
+    // The PRP lists of the commands are built in a pool which is mapped once here.
+    // Without the pool, they are allocated and mapped for each command.
+    //
+    if (EFI_ERROR (NvmeCreatePrpListPool (Private))) {
+      DEBUG ((EFI_D_INFO, "NvmExpressDriverBindingStart: failed to create the PRP list pool\n"));
+    }
+
+    Private->PerformanceCounterCountsUp = (BOOLEAN) (GetPerformanceCounterProperties (&StartTicks, &EndTicks) != 0 &&
+                                                     EndTicks >= StartTicks);
 
     Private->Signature = NVME_CONTROLLER_PRIVATE_DATA_SIGNATURE;
     Private->ControllerHandle          = Controller;
@@ -710,6 +1090,8 @@ NvmExpressDriverBindingStart (
     Private->Passthru.BuildDevicePath  = NvmExpressBuildDevicePath;
     Private->Passthru.GetNamespace     = NvmExpressGetNamespace;
     Private->PassThruMode.Attributes   = NVM_EXPRESS_PASS_THRU_ATTRIBUTES_PHYSICAL;
+    InitializeListHead (&Private->AsyncPassThruQueue);
+    InitializeListHead (&Private->UnsubmittedSubtasks);
 
     Status = NvmeControllerInit (Private);
 
@@ -717,6 +1099,45 @@ NvmExpressDriverBindingStart (
       goto Exit2;
     }
 
+    if (Private->AsyncQueueSize != 0) {
+      Private->PassThruMode.Attributes |= NVM_EXPRESS_PASS_THRU_ATTRIBUTES_NONBLOCKIO;
+    }
+
+    //
+    // Start the timer which sends the queued non-blocking I/O and checks their completion.
+    //
+    Status = gBS->CreateEvent (
+                    EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    ProcessAsyncTaskList,
+                    Private,
+                    &Private->TimerEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      goto Exit2;
+    }
+
+    Status = gBS->SetTimer (
+                    Private->TimerEvent,
+                    TimerPeriodic,
+                    NVME_HC_ASYNC_TIMER
+                    );
+    if (EFI_ERROR (Status)) {
+      goto Exit2;
+    }
+
+    Status = gBS->CreateEventEx (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    NvmeOnExitBootServices,
+                    Private,
+                    &gEfiEventExitBootServicesGuid,
+                    &Private->ExitBootServicesEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      goto Exit2;
+    }
+
     Status = gBS->InstallMultipleProtocolInterfaces (
                     &Controller,
                     &gEfiCallerIdGuid,
@@ -780,12 +1201,24 @@ Exit1:
          NULL
          );
 Exit2:
+  if ((Private != NULL) && (Private->TimerEvent != NULL)) {
+    gBS->CloseEvent (Private->TimerEvent);
+  }
+
+  if ((Private != NULL) && (Private->ExitBootServicesEvent != NULL)) {
+    gBS->CloseEvent (Private->ExitBootServicesEvent);
+  }
+
+  if (Private != NULL) {
+    NvmeFreePrpListPool (Private);
+  }
+
   if ((Private != NULL) && (Private->Mapping != NULL)) {
     PciIo->Unmap (PciIo, Private->Mapping);
   }
 
   if ((Private != NULL) && (Private->Buffer != NULL)) {
-    PciIo->FreeBuffer (PciIo, 4, Private->Buffer);
+    PciIo->FreeBuffer (PciIo, 6, Private->Buffer);
   }
 
   if (Private != NULL) {
@@ -851,6 +1284,7 @@ NvmExpressDriverBindingStop (
   BOOLEAN                             AllChildrenStopped;
   UINTN                               Index;
   NVME_CONTROLLER_PRIVATE_DATA        *Private;
+  EFI_TPL                             OldTpl;
 
   if (NumberOfChildren == 0) {
     Status = gBS->OpenProtocol (
@@ -870,12 +1304,33 @@ NvmExpressDriverBindingStop (
             NULL
             );
 
+      //
+      // The non-blocking PassThru requests of other consumers may still be pending.
+      // Give them a chance to complete, and abort the rest before their buffers and
+      // the queues are released.
+      //
+      NvmeWaitAsyncIoComplete (Private);
+
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+      NvmeAbortAsyncPassThru (Private);
+      if (Private->TimerEvent != NULL) {
+        gBS->CloseEvent (Private->TimerEvent);
+      }
+      gBS->RestoreTPL (OldTpl);
+
+      if (Private->ExitBootServicesEvent != NULL) {
+        gBS->CloseEvent (Private->ExitBootServicesEvent);
+      }
+
+      NvmeDumpStatistics (Private);
+      NvmeFreePrpListPool (Private);
+
       if (Private->Mapping != NULL) {
         Private->PciIo->Unmap (Private->PciIo, Private->Mapping);
       }
 
       if (Private->Buffer != NULL) {
-        Private->PciIo->FreeBuffer (Private->PciIo, 4, Private->Buffer);
+        Private->PciIo->FreeBuffer (Private->PciIo, 6, Private->Buffer);
       }
 
       FreePool (Private->ControllerData);
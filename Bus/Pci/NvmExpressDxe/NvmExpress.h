@@ -18,6 +18,8 @@
 
 #include <Uefi.h>
 
+#include <Guid/EventGroup.h>
+
 #include <IndustryStandard/Pci.h>
 
 #include <Protocol/ComponentName.h>
@@ -27,6 +29,7 @@
 #include <Protocol/DevicePath.h>
 #include <Protocol/PciIo.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/DiskInfo.h>
 #include <Protocol/DriverSupportedEfiVersion.h>
 
@@ -38,6 +41,7 @@
 #include <Library/DevicePathLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 
 typedef struct _NVME_CONTROLLER_PRIVATE_DATA NVME_CONTROLLER_PRIVATE_DATA;
@@ -61,8 +65,10 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 
 #define NVME_CSQ_SIZE                             1     // Number of I/O submission queue entries, which is 0-based
 #define NVME_CCQ_SIZE                             1     // Number of I/O completion queue entries, which is 0-based
+#define NVME_ASYNC_CSQ_SIZE                       63    // Max number of non-blocking I/O submission & completion queue entries, which is 0-based
 
-#define NVME_MAX_IO_QUEUES                        2     // Number of I/O queues supported by the driver
+#define NVME_MAX_IO_QUEUES                        3     // Number of queues supported by the driver, including the admin queue
+#define NVME_ASYNC_IO_QUEUE                       2     // Queue used by the non-blocking PassThru of I/O commands
 
 #define NVME_CONTROLLER_ID                        0
 
@@ -71,6 +77,30 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 //
 #define NVME_GENERIC_TIMEOUT                      EFI_TIMER_PERIOD_SECONDS (5)
 
+//
+// Interval of the timer that submits the queued non-blocking I/O and checks their completion
+//
+#define NVME_HC_ASYNC_TIMER                       EFI_TIMER_PERIOD_MILLISECONDS (1)
+
+//
+// Number of one page PRP lists preallocated for each controller, one for every command
+// which can be outstanding at the same time.
+//
+#define NVME_PRP_LIST_POOL_SIZE                   (NVME_ASYNC_CSQ_SIZE + 1)
+#define NVME_PRP_LIST_NO_SLOT                     ((UINTN) -1)
+
+//
+// I/O statistics of a controller. The average latency of the commands is
+// LatencyTicks / Commands, in performance counter ticks.
+//
+typedef struct {
+  UINT64                          Commands;
+  UINT64                          TransferBytes;
+  UINT64                          PrpListPages;
+  UINT64                          PrpListAllocations;       // PRP lists not served by the pool
+  UINT64                          LatencyTicks;
+} NVME_CONTROLLER_STATISTICS;
+
 //
 // Unique signature for private data structure.
 //
@@ -102,11 +132,11 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   //
   // 6 x 4kB aligned buffers will be carved out of this buffer.
   // 1st 4kB boundary is the start of the admin submission queue.
-  // 2nd 4kB boundary is the start of submission queue #1.
-  // 3rd 4kB boundary is the start of the admin completion queue.
-  // 4th 4kB boundary is the start of completion queue #1.
-  // 5th 4kB boundary is the start of the first PRP list page.
-  // 6th 4kB boundary is the start of the second PRP list page.
+  // 2nd 4kB boundary is the start of the admin completion queue.
+  // 3rd 4kB boundary is the start of I/O submission queue #1.
+  // 4th 4kB boundary is the start of I/O completion queue #1.
+  // 5th 4kB boundary is the start of I/O submission queue #2 for non-blocking I/O.
+  // 6th 4kB boundary is the start of I/O completion queue #2 for non-blocking I/O.
   //
   UINT8                           *Buffer;
   UINT8                           *BufferPciAddr;
@@ -125,15 +155,41 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   NVME_SQTDBL                     SqTdbl[NVME_MAX_IO_QUEUES];
   NVME_CQHDBL                     CqHdbl[NVME_MAX_IO_QUEUES];
 
-  UINT8                           Pt[2];
-  UINT16                          Cid[2];
+  UINT8                           Pt[NVME_MAX_IO_QUEUES];
+  UINT16                          Cid[NVME_MAX_IO_QUEUES];
 
   //
   // Nvme controller capabilities
   //
   NVME_CAP                        Cap;
-
   VOID                            *Mapping;
+
+  //
+  // Non-blocking I/O. The PassThru requests being executed in the non-blocking I/O
+  // queue, and the BlockIo2 subtasks waiting for a free entry of it.
+  // AsyncQueueSize is the 0-based number of entries of the queue, limited by Cap.Mqes.
+  // It is 0 when the controller refused to create the queue, and then only blocking
+  // I/O is supported.
+  //
+  EFI_EVENT                       TimerEvent;
+  UINT16                          AsyncQueueSize;
+  LIST_ENTRY                      AsyncPassThruQueue;
+  UINTN                           AsyncPassThruCount;
+  LIST_ENTRY                      UnsubmittedSubtasks;
+
+  //
+  // Preallocated one page PRP lists, which are mapped once for the lifetime of the
+  // controller. PrpListFreeSlots is a stack of the indexes of the free ones.
+  //
+  UINT8                           *PrpListPool;
+  UINT8                           *PrpListPoolPciAddr;
+  VOID                            *PrpListPoolMapping;
+  UINT8                           PrpListFreeSlots[NVME_PRP_LIST_POOL_SIZE];
+  UINTN                           PrpListFreeCount;
+
+  BOOLEAN                         PerformanceCounterCountsUp;
+  NVME_CONTROLLER_STATISTICS      Statistics;
+  EFI_EVENT                       ExitBootServicesEvent;
 };
 
 #define NVME_CONTROLLER_PRIVATE_DATA_FROM_PASS_THRU(a) \
@@ -167,6 +223,7 @@ struct _NVME_DEVICE_PRIVATE_DATA {
 
   EFI_BLOCK_IO_MEDIA                Media;
   EFI_BLOCK_IO_PROTOCOL             BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL            BlockIo2;
   EFI_DISK_INFO_PROTOCOL            DiskInfo;
 
   EFI_LBA                           NumBlocks;
@@ -176,6 +233,10 @@ struct _NVME_DEVICE_PRIVATE_DATA {
 
   NVME_CONTROLLER_PRIVATE_DATA      *Controller;
 
+  //
+  // The BlockIo2 requests of the namespace which are not completed yet.
+  //
+  LIST_ENTRY                        AsyncQueue;
 };
 
 //
@@ -188,6 +249,13 @@ struct _NVME_DEVICE_PRIVATE_DATA {
       NVME_DEVICE_PRIVATE_DATA_SIGNATURE \
       )
 
+#define NVME_DEVICE_PRIVATE_DATA_FROM_BLOCK_IO2(a) \
+  CR (a, \
+      NVME_DEVICE_PRIVATE_DATA, \
+      BlockIo2, \
+      NVME_DEVICE_PRIVATE_DATA_SIGNATURE \
+      )
+
 #define NVME_DEVICE_PRIVATE_DATA_FROM_DISK_INFO(a) \
   CR (a, \
       NVME_DEVICE_PRIVATE_DATA, \
@@ -195,6 +263,35 @@ struct _NVME_DEVICE_PRIVATE_DATA {
       NVME_DEVICE_PRIVATE_DATA_SIGNATURE \
       )
 
+//
+// Nvme non-blocking PassThru request, which is being executed by the controller.
+//
+#define NVME_PASS_THRU_ASYNC_REQ_SIG           SIGNATURE_32 ('N','P','T','R')
+
+typedef struct {
+  UINT32                                   Signature;
+  LIST_ENTRY                               Link;
+
+  NVM_EXPRESS_PASS_THRU_COMMAND_PACKET     *Packet;
+  UINT16                                   CommandId;
+  VOID                                     *MapData;
+  VOID                                     *MapMeta;
+  VOID                                     *MapPrpList;
+  UINTN                                    PrpListNo;
+  VOID                                     *PrpListHost;
+  UINTN                                    PrpListSlot;
+  UINT64                                   StartTicks;
+
+  EFI_EVENT                                CallerEvent;
+} NVME_PASS_THRU_ASYNC_REQ;
+
+#define NVME_PASS_THRU_ASYNC_REQ_FROM_THIS(a) \
+  CR (a, \
+      NVME_PASS_THRU_ASYNC_REQ, \
+      Link, \
+      NVME_PASS_THRU_ASYNC_REQ_SIG \
+      )
+
 /**
   Retrieves a Unicode string that is the user readable name of the driver.
 
@@ -611,4 +708,110 @@ NvmExpressBuildDevicePath (
   IN OUT EFI_DEVICE_PATH_PROTOCOL                    **DevicePath
   );
 
+/**
+  Allocate the PRP list pool of the controller, and map it for bus master common
+  buffer access.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+  @retval EFI_SUCCESS                The PRP list pool is created.
+  @retval EFI_OUT_OF_RESOURCES       The PRP list pool can not be allocated or mapped. The
+                                     PRP lists are then allocated for each command.
+
+**/
+EFI_STATUS
+NvmeCreatePrpListPool (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  );
+
+/**
+  Unmap and free the PRP list pool of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+NvmeFreePrpListPool (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  );
+
+/**
+  Return a PRP list page to the PRP list pool of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     Slot                The index of the page in the pool.
+
+**/
+VOID
+NvmeFreePoolPrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private,
+  IN UINTN                              Slot
+  );
+
+/**
+  Account a command completed without error in the I/O statistics of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     Packet              The command packet of the completed command.
+  @param[in]     PrpListPages        The number of PRP list pages used by the command.
+  @param[in]     PrpListAllocated    TRUE if the PRP list was not served by the PRP list pool.
+  @param[in]     StartTicks          The performance counter value when the command was submitted.
+
+**/
+VOID
+NvmeRecordCommandStatistics (
+  IN NVME_CONTROLLER_PRIVATE_DATA          *Private,
+  IN NVM_EXPRESS_PASS_THRU_COMMAND_PACKET  *Packet,
+  IN UINTN                                 PrpListPages,
+  IN BOOLEAN                               PrpListAllocated,
+  IN UINT64                                StartTicks
+  );
+
+/**
+  Submit the queued BlockIo2 subtasks to the nonblocking I/O queue, and complete the
+  nonblocking PassThru requests whose completion queue entries are posted.
+
+  It is the notification function of the periodic timer event of the controller,
+  and it must be called at TPL_NOTIFY.
+
+  @param[in]     Event               The timer event of the controller.
+  @param[in]     Context             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+EFIAPI
+ProcessAsyncTaskList (
+  IN EFI_EVENT                    Event,
+  IN VOID                         *Context
+  );
+
+/**
+  Wait until all the nonblocking I/O of the controller are completed.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+  @retval EFI_SUCCESS                All the nonblocking I/O are completed.
+  @retval EFI_TIMEOUT                Some nonblocking I/O are not completed in NVME_GENERIC_TIMEOUT.
+
+**/
+EFI_STATUS
+NvmeWaitAsyncIoComplete (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  );
+
+/**
+  Abort all the nonblocking I/O of the controller. It is used after the controller is
+  reinitialized, which drops the commands in the nonblocking I/O queue, and before
+  the controller is stopped.
+
+  It must be called at TPL_NOTIFY.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+NvmeAbortAsyncPassThru (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  );
+
 #endif
@@ -312,6 +312,255 @@ NvmeFlush (
   return Status;
 }
 
+/**
+  Finish a BlockIo2 subtask. The subtask is freed, and when it is the last one of
+  its request, the request is freed and the token of the request is signaled.
+
+  It must be called at TPL_NOTIFY.
+
+  @param  Subtask              The subtask to finish. It must be in the subtask list
+                               of its request.
+  @param  Status               The status of the subtask. The token of the request
+                               reports the first error of its subtasks.
+
+**/
+VOID
+NvmeFinishSubtask (
+  IN NVME_BLKIO2_SUBTASK      *Subtask,
+  IN EFI_STATUS               Status
+  )
+{
+  NVME_BLKIO2_REQUEST         *BlkIo2Request;
+  EFI_BLOCK_IO2_TOKEN         *Token;
+
+  BlkIo2Request = Subtask->BlockIo2Request;
+  Token         = BlkIo2Request->Token;
+
+  if (EFI_ERROR (Status) && !EFI_ERROR (Token->TransactionStatus)) {
+    Token->TransactionStatus = Status;
+  }
+
+  RemoveEntryList (&Subtask->Link);
+  gBS->CloseEvent (Subtask->Event);
+  FreePool (Subtask);
+
+  if ((BlkIo2Request->UnsubmittedSubtaskNum == 0) && IsListEmpty (&BlkIo2Request->SubtaskList)) {
+    RemoveEntryList (&BlkIo2Request->Link);
+    FreePool (BlkIo2Request);
+    gBS->SignalEvent (Token->Event);
+  }
+}
+
+/**
+  The notification function of the event of a BlockIo2 subtask, which is signaled
+  when the command of the subtask is completed.
+
+  @param  Event                The event of the subtask.
+  @param  Context              The pointer to the NVME_BLKIO2_SUBTASK data structure.
+
+**/
+VOID
+EFIAPI
+AsyncIoCallback (
+  IN EFI_EVENT                Event,
+  IN VOID                     *Context
+  )
+{
+  NVME_BLKIO2_SUBTASK         *Subtask;
+  EFI_STATUS                  Status;
+
+  Subtask = (NVME_BLKIO2_SUBTASK *) Context;
+
+  switch (Subtask->CommandPacket.ControllerStatus) {
+  case NVM_EXPRESS_STATUS_CONTROLLER_READY:
+    Status = EFI_SUCCESS;
+    break;
+  case NVM_EXPRESS_STATUS_CONTROLLER_CMD_ABORT:
+    Status = EFI_ABORTED;
+    break;
+  default:
+    Status = EFI_DEVICE_ERROR;
+    break;
+  }
+
+  NvmeFinishSubtask (Subtask, Status);
+}
+
+/**
+  Create a BlockIo2 subtask which reads or writes some sectors of the device.
+
+  @param  BlkIo2Request          The BlockIo2 request the subtask belongs to.
+  @param  Buffer                 The buffer of the data to transfer.
+  @param  Lba                    The start block number.
+  @param  Blocks                 Total block number to transfer.
+  @param  IsWrite                TRUE to write the sectors, FALSE to read them.
+
+  @return The subtask created, or NULL if there is not enough resource.
+
+**/
+NVME_BLKIO2_SUBTASK *
+NvmeCreateSubtask (
+  IN NVME_BLKIO2_REQUEST                *BlkIo2Request,
+  IN UINT64                             Buffer,
+  IN UINT64                             Lba,
+  IN UINT32                             Blocks,
+  IN BOOLEAN                            IsWrite
+  )
+{
+  NVME_DEVICE_PRIVATE_DATA                 *Device;
+  NVME_BLKIO2_SUBTASK                      *Subtask;
+  EFI_STATUS                               Status;
+
+  Device  = BlkIo2Request->Device;
+  Subtask = AllocateZeroPool (sizeof (NVME_BLKIO2_SUBTASK));
+  if (Subtask == NULL) {
+    return NULL;
+  }
+
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  AsyncIoCallback,
+                  Subtask,
+                  &Subtask->Event
+                  );
+  if (EFI_ERROR (Status)) {
+    FreePool (Subtask);
+    return NULL;
+  }
+
+  Subtask->Signature       = NVME_BLKIO2_SUBTASK_SIGNATURE;
+  Subtask->BlockIo2Request = BlkIo2Request;
+
+  Subtask->CommandPacket.NvmeCmd      = &Subtask->Command;
+  Subtask->CommandPacket.NvmeResponse = &Subtask->Response;
+
+  Subtask->Command.Cdw0.Opcode = IsWrite ? NVME_IO_WRITE_OPC : NVME_IO_READ_OPC;
+  Subtask->Command.Nsid        = Device->NamespaceId;
+  Subtask->CommandPacket.TransferBuffer = (VOID *)(UINTN)Buffer;
+
+  Subtask->CommandPacket.TransferLength = Blocks * Device->Media.BlockSize;
+  Subtask->CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
+  Subtask->CommandPacket.QueueId        = NVME_IO_QUEUE;
+
+  Subtask->Command.Cdw10 = (UINT32)Lba;
+  Subtask->Command.Cdw11 = (UINT32)(Lba >> 32);
+  Subtask->Command.Cdw12 = (Blocks - 1) & 0xFFFF;
+
+  Subtask->Command.Flags = CDW10_VALID | CDW11_VALID | CDW12_VALID;
+
+  return Subtask;
+}
+
+/**
+  Read or write some blocks of the device through the non-blocking I/O queue.
+
+  The request is split into subtasks no larger than the maximum data transfer size
+  of the controller. The subtasks are executed concurrently, and the token is
+  signaled when all of them are completed.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  Buffer                 The buffer of the data to transfer.
+  @param  Lba                    The start block number.
+  @param  Blocks                 Total block number to transfer.
+  @param  IsWrite                TRUE to write the blocks, FALSE to read them.
+  @param  Token                  The token of the request.
+
+  @retval EFI_SUCCESS            The request is queued.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough resource to queue the request.
+
+**/
+EFI_STATUS
+NvmeAsyncReadWrite (
+  IN NVME_DEVICE_PRIVATE_DATA           *Device,
+  IN VOID                               *Buffer,
+  IN UINT64                             Lba,
+  IN UINTN                              Blocks,
+  IN BOOLEAN                            IsWrite,
+  IN EFI_BLOCK_IO2_TOKEN                *Token
+  )
+{
+  NVME_CONTROLLER_PRIVATE_DATA     *Controller;
+  NVME_BLKIO2_REQUEST              *BlkIo2Request;
+  NVME_BLKIO2_SUBTASK              *Subtask;
+  LIST_ENTRY                       SubtaskList;
+  LIST_ENTRY                       *Link;
+  UINT32                           BlockSize;
+  UINT32                           MaxTransferBlocks;
+  UINT32                           TransferBlocks;
+  EFI_STATUS                       Status;
+  EFI_TPL                          OldTpl;
+
+  Status     = EFI_SUCCESS;
+  Controller = Device->Controller;
+  BlockSize  = Device->Media.BlockSize;
+
+  if (Controller->ControllerData->Mdts != 0) {
+    MaxTransferBlocks = (1 << (Controller->ControllerData->Mdts)) * (1 << (Controller->Cap.Mpsmin + 12)) / BlockSize;
+  } else {
+    MaxTransferBlocks = 1024;
+  }
+
+  BlkIo2Request = AllocateZeroPool (sizeof (NVME_BLKIO2_REQUEST));
+  if (BlkIo2Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  BlkIo2Request->Signature = NVME_BLKIO2_REQUEST_SIGNATURE;
+  BlkIo2Request->Device    = Device;
+  BlkIo2Request->Token     = Token;
+  InitializeListHead (&BlkIo2Request->SubtaskList);
+  InitializeListHead (&SubtaskList);
+
+  while (Blocks > 0) {
+    TransferBlocks = (Blocks > MaxTransferBlocks) ? MaxTransferBlocks : (UINT32)Blocks;
+
+    Subtask = NvmeCreateSubtask (BlkIo2Request, (UINT64)(UINTN)Buffer, Lba, TransferBlocks, IsWrite);
+    if (Subtask == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+
+    InsertTailList (&SubtaskList, &Subtask->Link);
+    BlkIo2Request->UnsubmittedSubtaskNum++;
+
+    Blocks -= TransferBlocks;
+    Buffer  = (VOID *)(UINTN)((UINT64)(UINTN)Buffer + TransferBlocks * BlockSize);
+    Lba    += TransferBlocks;
+  }
+
+  if (EFI_ERROR (Status)) {
+    while (!IsListEmpty (&SubtaskList)) {
+      Subtask = NVME_BLKIO2_SUBTASK_FROM_LINK (GetFirstNode (&SubtaskList));
+      RemoveEntryList (&Subtask->Link);
+      gBS->CloseEvent (Subtask->Event);
+      FreePool (Subtask);
+    }
+    FreePool (BlkIo2Request);
+    return Status;
+  }
+
+  Token->TransactionStatus = EFI_SUCCESS;
+
+  //
+  // Queue the subtasks to the controller, and send as many of them as the
+  // non-blocking I/O queue can take right away.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  InsertTailList (&Device->AsyncQueue, &BlkIo2Request->Link);
+  while (!IsListEmpty (&SubtaskList)) {
+    Link = GetFirstNode (&SubtaskList);
+    RemoveEntryList (Link);
+    InsertTailList (&Controller->UnsubmittedSubtasks, Link);
+  }
+
+  ProcessAsyncTaskList (Controller->TimerEvent, Controller);
+
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
 
 /**
   Reset the Block Device.
@@ -340,17 +589,26 @@ NvmeBlockIoReset (
     return EFI_INVALID_PARAMETER;
   }
 
-  //
-  // For Nvm Express subsystem, reset block device means reset controller.
-  //
-  OldTpl  = gBS->RaiseTPL (TPL_CALLBACK);
-
   Device  = NVME_DEVICE_PRIVATE_DATA_FROM_BLOCK_IO (This);
 
   Private = Device->Controller;
 
+  //
+  // Give the pending non-blocking I/O a chance to complete before the reset.
+  //
+  NvmeWaitAsyncIoComplete (Private);
+
+  //
+  // For Nvm Express subsystem, reset block device means reset controller.
+  // The timer of the non-blocking I/O must not run while the queues are re-created,
+  // and the non-blocking I/O which are still pending are dropped by the reset.
+  //
+  OldTpl  = gBS->RaiseTPL (TPL_NOTIFY);
+
   Status  = NvmeControllerInit (Private);
 
+  NvmeAbortAsyncPassThru (Private);
+
   gBS->RestoreTPL (OldTpl);
 
   return Status;
@@ -561,3 +819,271 @@ NvmeBlockIoFlushBlocks (
 
   return Status;
 }
+
+/**
+  Reset the Block Device through Block I/O2 protocol.
+
+  @param  This                 Indicates a pointer to the calling context.
+  @param  ExtendedVerification Driver may perform diagnostics on reset.
+
+  @retval EFI_SUCCESS          The device was reset.
+  @retval EFI_DEVICE_ERROR     The device is not functioning properly and could
+                               not be reset.
+
+**/
+EFI_STATUS
+EFIAPI
+NvmeBlockIoResetEx (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN  BOOLEAN                 ExtendedVerification
+  )
+{
+  NVME_DEVICE_PRIVATE_DATA        *Device;
+
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Device = NVME_DEVICE_PRIVATE_DATA_FROM_BLOCK_IO2 (This);
+
+  return NvmeBlockIoReset (&Device->BlockIo, ExtendedVerification);
+}
+
+/**
+  Read or write BufferSize bytes through Block I/O2 protocol.
+
+  @param  This       Indicates a pointer to the calling context.
+  @param  MediaId    Id of the media, changes every time the media is replaced.
+  @param  Lba        The starting Logical Block Address to transfer.
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize Size of Buffer, must be a multiple of device block size.
+  @param  Buffer     A pointer to the buffer of the data.
+  @param  IsWrite    TRUE to write the blocks, FALSE to read them.
+
+  @retval EFI_SUCCESS           The request was queued if Event is not NULL.
+                                The data was transferred correctly if the Event is NULL.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the transfer.
+  @retval EFI_MEDIA_CHANGED     The MediaId does not matched the current device.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER The request contains LBAs that are not valid,
+                                or the buffer is not on proper alignment.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+NvmeBlockIo2ReadWrite (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN OUT VOID                   *Buffer,
+  IN     BOOLEAN                IsWrite
+  )
+{
+  NVME_DEVICE_PRIVATE_DATA          *Device;
+  EFI_STATUS                        Status;
+  EFI_BLOCK_IO_MEDIA                *Media;
+  UINTN                             BlockSize;
+  UINTN                             NumberOfBlocks;
+  UINTN                             IoAlign;
+  EFI_TPL                           OldTpl;
+
+  //
+  // Check parameters.
+  //
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Media = This->Media;
+
+  if (MediaId != Media->MediaId) {
+    return EFI_MEDIA_CHANGED;
+  }
+
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (BufferSize == 0) {
+    if ((Token != NULL) && (Token->Event != NULL)) {
+      Token->TransactionStatus = EFI_SUCCESS;
+      gBS->SignalEvent (Token->Event);
+    }
+    return EFI_SUCCESS;
+  }
+
+  BlockSize = Media->BlockSize;
+  if ((BufferSize % BlockSize) != 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  NumberOfBlocks  = BufferSize / BlockSize;
+  if ((Lba + NumberOfBlocks - 1) > Media->LastBlock) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  IoAlign = Media->IoAlign;
+  if (IoAlign > 0 && (((UINTN) Buffer & (IoAlign - 1)) != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Device = NVME_DEVICE_PRIVATE_DATA_FROM_BLOCK_IO2 (This);
+
+  //
+  // A controller reset may fail to re-create the non-blocking I/O queue. The
+  // request is then completed blocking.
+  //
+  if ((Token != NULL) && (Token->Event != NULL) && (Device->Controller->AsyncQueueSize != 0)) {
+    return NvmeAsyncReadWrite (Device, Buffer, Lba, NumberOfBlocks, IsWrite, Token);
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (IsWrite) {
+    Status = NvmeWrite (Device, Buffer, Lba, NumberOfBlocks);
+  } else {
+    Status = NvmeRead (Device, Buffer, Lba, NumberOfBlocks);
+  }
+
+  gBS->RestoreTPL (OldTpl);
+
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = Status;
+    gBS->SignalEvent (Token->Event);
+    return EFI_SUCCESS;
+  }
+
+  return Status;
+}
+
+/**
+  Read BufferSize bytes from Lba into Buffer through Block I/O2 protocol.
+
+  @param  This       Indicates a pointer to the calling context.
+  @param  MediaId    Id of the media, changes every time the media is replaced.
+  @param  Lba        The starting Logical Block Address to read from.
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize Size of Buffer, must be a multiple of device block size.
+  @param  Buffer     A pointer to the destination buffer for the data. The caller is
+                     responsible for either having implicit or explicit ownership of the buffer.
+
+  @retval EFI_SUCCESS           The read request was queued if Event is not NULL.
+                                The data was read correctly from the device if
+                                the Event is NULL.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing
+                                the read.
+  @retval EFI_NO_MEDIA          There is no media in the device.
+  @retval EFI_MEDIA_CHANGED     The MediaId is not for the current media.
+  @retval EFI_BAD_BUFFER_SIZE   The BufferSize parameter is not a multiple of the
+                                intrinsic block size of the device.
+  @retval EFI_INVALID_PARAMETER The read request contains LBAs that are not valid,
+                                or the buffer is not on proper alignment.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+EFIAPI
+NvmeBlockIoReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+     OUT VOID                   *Buffer
+  )
+{
+  return NvmeBlockIo2ReadWrite (This, MediaId, Lba, Token, BufferSize, Buffer, FALSE);
+}
+
+/**
+  Write BufferSize bytes from Buffer into Lba through Block I/O2 protocol.
+
+  @param  This       Indicates a pointer to the calling context.
+  @param  MediaId    The media ID that the write request is for.
+  @param  Lba        The starting logical block address to be written. The caller is
+                     responsible for writing to only legitimate locations.
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize Size of Buffer, must be a multiple of device block size.
+  @param  Buffer     A pointer to the source buffer for the data.
+
+  @retval EFI_SUCCESS           The write request was queued if Event is not NULL.
+                                The data was written correctly to the device if
+                                the Event is NULL.
+  @retval EFI_WRITE_PROTECTED   The device can not be written to.
+  @retval EFI_DEVICE_ERROR      The device reported an error while performing the write.
+  @retval EFI_NO_MEDIA          There is no media in the device.
+  @retval EFI_MEDIA_CHNAGED     The MediaId does not matched the current device.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER The write request contains LBAs that are not valid,
+                                or the buffer is not on proper alignment.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+EFIAPI
+NvmeBlockIoWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  return NvmeBlockIo2ReadWrite (This, MediaId, Lba, Token, BufferSize, Buffer, TRUE);
+}
+
+/**
+  Flush the Block Device through Block I/O2 protocol.
+
+  The non-blocking I/O which are pending are completed first, so the flush covers
+  the data they write.
+
+  @param  This              Indicates a pointer to the calling context.
+  @param  Token             A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All outstanding data was written to the device
+  @retval EFI_DEVICE_ERROR  The device reported an error while writing back the data
+  @retval EFI_NO_MEDIA      There is no media in the device.
+
+**/
+EFI_STATUS
+EFIAPI
+NvmeBlockIoFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  NVME_DEVICE_PRIVATE_DATA          *Device;
+  EFI_STATUS                        Status;
+  EFI_TPL                           OldTpl;
+
+  //
+  // Check parameters.
+  //
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Device = NVME_DEVICE_PRIVATE_DATA_FROM_BLOCK_IO2 (This);
+
+  Status = NvmeWaitAsyncIoComplete (Device->Controller);
+  if (!EFI_ERROR (Status)) {
+    OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+    Status = NvmeFlush (Device);
+    gBS->RestoreTPL (OldTpl);
+  }
+
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = Status;
+    gBS->SignalEvent (Token->Event);
+    return EFI_SUCCESS;
+  }
+
+  return Status;
+}
@@ -667,12 +667,13 @@ NvmeIdentifyNamespace (
 }
 
 /**
-  Create io completion queue.
+  Create io completion queues. Queue #1 is used by blocking I/O, and queue #2 is
+  used by non-blocking I/O.
 
   @param  Private          The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
 
-  @return EFI_SUCCESS      Successfully create io completion queue.
-  @return EFI_DEVICE_ERROR Fail to create io completion queue.
+  @return EFI_SUCCESS      Successfully create io completion queues.
+  @return EFI_DEVICE_ERROR Fail to create io completion queues.
 
 **/
 EFI_STATUS
@@ -685,46 +686,68 @@ NvmeCreateIoCompletionQueue (
   NVM_EXPRESS_RESPONSE                     Response;
   EFI_STATUS                               Status;
   NVME_ADMIN_CRIOCQ                        CrIoCq;
+  UINT16                                   Index;
 
-  ZeroMem (&CommandPacket, sizeof(NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
-  ZeroMem (&Command, sizeof(NVM_EXPRESS_COMMAND));
-  ZeroMem (&Response, sizeof(NVM_EXPRESS_RESPONSE));
-  ZeroMem (&CrIoCq, sizeof(NVME_ADMIN_CRIOCQ));
+  Status = EFI_SUCCESS;
 
-  CommandPacket.NvmeCmd      = &Command;
-  CommandPacket.NvmeResponse = &Response;
-
-  Command.Cdw0.Opcode = NVME_ADMIN_CRIOCQ_OPC;
-  Command.Cdw0.Cid    = Private->Cid[0]++;
-  CommandPacket.TransferBuffer = Private->CqBufferPciAddr[1];
-  CommandPacket.TransferLength = EFI_PAGE_SIZE;
-  CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
-  CommandPacket.QueueId        = NVME_ADMIN_QUEUE;
-
-  CrIoCq.Qid   = NVME_IO_QUEUE;
-  CrIoCq.Qsize = NVME_CCQ_SIZE;
-  CrIoCq.Pc    = 1;
-  CopyMem (&CommandPacket.NvmeCmd->Cdw10, &CrIoCq, sizeof (NVME_ADMIN_CRIOCQ));
-  CommandPacket.NvmeCmd->Flags = CDW10_VALID | CDW11_VALID;
+  for (Index = NVME_IO_QUEUE; Index < NVME_MAX_IO_QUEUES; Index++) {
+    if ((Index == NVME_ASYNC_IO_QUEUE) && (Private->AsyncQueueSize == 0)) {
+      break;
+    }
 
-  Status = Private->Passthru.PassThru (
-                               &Private->Passthru,
-                               0,
-                               0,
-                               &CommandPacket,
-                               NULL
-                               );
+    ZeroMem (&CommandPacket, sizeof(NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
+    ZeroMem (&Command, sizeof(NVM_EXPRESS_COMMAND));
+    ZeroMem (&Response, sizeof(NVM_EXPRESS_RESPONSE));
+    ZeroMem (&CrIoCq, sizeof(NVME_ADMIN_CRIOCQ));
+
+    CommandPacket.NvmeCmd      = &Command;
+    CommandPacket.NvmeResponse = &Response;
+
+    Command.Cdw0.Opcode = NVME_ADMIN_CRIOCQ_OPC;
+    Command.Cdw0.Cid    = Private->Cid[0]++;
+    CommandPacket.TransferBuffer = Private->CqBufferPciAddr[Index];
+    CommandPacket.TransferLength = EFI_PAGE_SIZE;
+    CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
+    CommandPacket.QueueId        = NVME_ADMIN_QUEUE;
+
+    CrIoCq.Qid   = Index;
+    CrIoCq.Qsize = (Index == NVME_ASYNC_IO_QUEUE) ? Private->AsyncQueueSize : NVME_CCQ_SIZE;
+    CrIoCq.Pc    = 1;
+    CopyMem (&CommandPacket.NvmeCmd->Cdw10, &CrIoCq, sizeof (NVME_ADMIN_CRIOCQ));
+    CommandPacket.NvmeCmd->Flags = CDW10_VALID | CDW11_VALID;
+
+    Status = Private->Passthru.PassThru (
+                                 &Private->Passthru,
+                                 0,
+                                 0,
+                                 &CommandPacket,
+                                 NULL
+                                 );
+    if (EFI_ERROR (Status)) {
+      if (Index == NVME_ASYNC_IO_QUEUE) {
+        //
+        // The controller may support a single I/O queue only. It is still usable
+        // by blocking I/O.
+        //
+        DEBUG ((EFI_D_INFO, "NvmeCreateIoCompletionQueue: no non-blocking I/O queue - %r\n", Status));
+        Private->AsyncQueueSize = 0;
+        Status = EFI_SUCCESS;
+      }
+      break;
+    }
+  }
 
   return Status;
 }
 
 /**
-  Create io submission queue.
+  Create io submission queues. Queue #1 is used by blocking I/O, and queue #2 is
+  used by non-blocking I/O.
 
   @param  Private          The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
 
-  @return EFI_SUCCESS      Successfully create io submission queue.
-  @return EFI_DEVICE_ERROR Fail to create io submission queue.
+  @return EFI_SUCCESS      Successfully create io submission queues.
+  @return EFI_DEVICE_ERROR Fail to create io submission queues.
 
 **/
 EFI_STATUS
@@ -737,37 +760,57 @@ NvmeCreateIoSubmissionQueue (
   NVM_EXPRESS_RESPONSE                     Response;
   EFI_STATUS                               Status;
   NVME_ADMIN_CRIOSQ                        CrIoSq;
+  UINT16                                   Index;
 
-  ZeroMem (&CommandPacket, sizeof(NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
-  ZeroMem (&Command, sizeof(NVM_EXPRESS_COMMAND));
-  ZeroMem (&Response, sizeof(NVM_EXPRESS_RESPONSE));
-  ZeroMem (&CrIoSq, sizeof(NVME_ADMIN_CRIOSQ));
+  Status = EFI_SUCCESS;
 
-  CommandPacket.NvmeCmd      = &Command;
-  CommandPacket.NvmeResponse = &Response;
-
-  Command.Cdw0.Opcode = NVME_ADMIN_CRIOSQ_OPC;
-  Command.Cdw0.Cid    = Private->Cid[0]++;
-  CommandPacket.TransferBuffer = Private->SqBufferPciAddr[1];
-  CommandPacket.TransferLength = EFI_PAGE_SIZE;
-  CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
-  CommandPacket.QueueId        = NVME_ADMIN_QUEUE;
-
-  CrIoSq.Qid   = NVME_IO_QUEUE;
-  CrIoSq.Qsize = NVME_CSQ_SIZE;
-  CrIoSq.Pc    = 1;
-  CrIoSq.Cqid  = NVME_IO_QUEUE;
-  CrIoSq.Qprio = 0;
-  CopyMem (&CommandPacket.NvmeCmd->Cdw10, &CrIoSq, sizeof (NVME_ADMIN_CRIOSQ));
-  CommandPacket.NvmeCmd->Flags = CDW10_VALID | CDW11_VALID;
+  for (Index = NVME_IO_QUEUE; Index < NVME_MAX_IO_QUEUES; Index++) {
+    if ((Index == NVME_ASYNC_IO_QUEUE) && (Private->AsyncQueueSize == 0)) {
+      break;
+    }
 
-  Status = Private->Passthru.PassThru (
-                               &Private->Passthru,
-                               0,
-                               0,
-                               &CommandPacket,
-                               NULL
-                               );
+    ZeroMem (&CommandPacket, sizeof(NVM_EXPRESS_PASS_THRU_COMMAND_PACKET));
+    ZeroMem (&Command, sizeof(NVM_EXPRESS_COMMAND));
+    ZeroMem (&Response, sizeof(NVM_EXPRESS_RESPONSE));
+    ZeroMem (&CrIoSq, sizeof(NVME_ADMIN_CRIOSQ));
+
+    CommandPacket.NvmeCmd      = &Command;
+    CommandPacket.NvmeResponse = &Response;
+
+    Command.Cdw0.Opcode = NVME_ADMIN_CRIOSQ_OPC;
+    Command.Cdw0.Cid    = Private->Cid[0]++;
+    CommandPacket.TransferBuffer = Private->SqBufferPciAddr[Index];
+    CommandPacket.TransferLength = EFI_PAGE_SIZE;
+    CommandPacket.CommandTimeout = NVME_GENERIC_TIMEOUT;
+    CommandPacket.QueueId        = NVME_ADMIN_QUEUE;
+
+    CrIoSq.Qid   = Index;
+    CrIoSq.Qsize = (Index == NVME_ASYNC_IO_QUEUE) ? Private->AsyncQueueSize : NVME_CSQ_SIZE;
+    CrIoSq.Pc    = 1;
+    CrIoSq.Cqid  = Index;
+    CrIoSq.Qprio = 0;
+    CopyMem (&CommandPacket.NvmeCmd->Cdw10, &CrIoSq, sizeof (NVME_ADMIN_CRIOSQ));
+    CommandPacket.NvmeCmd->Flags = CDW10_VALID | CDW11_VALID;
+
+    Status = Private->Passthru.PassThru (
+                                 &Private->Passthru,
+                                 0,
+                                 0,
+                                 &CommandPacket,
+                                 NULL
+                                 );
+    if (EFI_ERROR (Status)) {
+      if (Index == NVME_ASYNC_IO_QUEUE) {
+        //
+        // The completion queue #2 is left unused, only blocking I/O is supported.
+        //
+        DEBUG ((EFI_D_INFO, "NvmeCreateIoSubmissionQueue: no non-blocking I/O queue - %r\n", Status));
+        Private->AsyncQueueSize = 0;
+        Status = EFI_SUCCESS;
+      }
+      break;
+    }
+  }
 
   return Status;
 }
@@ -816,7 +859,11 @@ NvmeControllerInit (
                     );
 
   if (!EFI_ERROR (Status)) {
-    Supports &= (UINT64)EFI_PCI_DEVICE_ENABLE;
+    //
+    // NVMe controllers are 64-bit bus masters. With dual address cycle enabled, the
+    // I/O buffers above 4GB are mapped in place instead of being bounced below 4GB.
+    //
+    Supports &= (UINT64)(EFI_PCI_DEVICE_ENABLE | EFI_PCI_IO_ATTRIBUTE_DUAL_ADDRESS_CYCLE);
     Status    = PciIo->Attributes (
                          PciIo,
                          EfiPciIoAttributeOperationEnable,
@@ -848,8 +895,10 @@ NvmeControllerInit (
   //
   ASSERT ((Private->Cap.Mpsmin + 12) <= EFI_PAGE_SHIFT);
 
-  Private->Cid[0] = 0;
-  Private->Cid[1] = 0;
+  //
+  // The non-blocking I/O queue can't be larger than the controller supports.
+  //
+  Private->AsyncQueueSize = (UINT16) MIN (NVME_ASYNC_CSQ_SIZE, Private->Cap.Mqes);
 
   Status = NvmeDisableController (Private);
 
@@ -857,6 +906,16 @@ NvmeControllerInit (
     return Status;
   }
 
+  //
+  // The disabled controller has dropped all its queues, so restart the queues of
+  // the driver from their first entries.
+  //
+  ZeroMem (Private->Cid, sizeof (Private->Cid));
+  ZeroMem (Private->Pt, sizeof (Private->Pt));
+  ZeroMem (Private->SqTdbl, sizeof (Private->SqTdbl));
+  ZeroMem (Private->CqHdbl, sizeof (Private->CqHdbl));
+  ZeroMem (Private->Buffer, EFI_PAGES_TO_SIZE (6));
+
   //
   // set number of entries admin submission & completion queues.
   //
@@ -888,6 +947,10 @@ NvmeControllerInit (
   Private->SqBufferPciAddr[1] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + 2 * EFI_PAGE_SIZE);
   Private->CqBuffer[1]        = (NVME_CQ *)(UINTN)(Private->Buffer + 3 * EFI_PAGE_SIZE);
   Private->CqBufferPciAddr[1] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 3 * EFI_PAGE_SIZE);
+  Private->SqBuffer[2]        = (NVME_SQ *)(UINTN)(Private->Buffer + 4 * EFI_PAGE_SIZE);
+  Private->SqBufferPciAddr[2] = (NVME_SQ *)(UINTN)(Private->BufferPciAddr + 4 * EFI_PAGE_SIZE);
+  Private->CqBuffer[2]        = (NVME_CQ *)(UINTN)(Private->Buffer + 5 * EFI_PAGE_SIZE);
+  Private->CqBufferPciAddr[2] = (NVME_CQ *)(UINTN)(Private->BufferPciAddr + 5 * EFI_PAGE_SIZE);
 
   DEBUG ((EFI_D_INFO, "Private->Buffer = [%016X]\n", (UINT64)(UINTN)Private->Buffer));
   DEBUG ((EFI_D_INFO, "Admin Submission Queue size (Aqa.Asqs) = [%08X]\n", Aqa.Asqs));
@@ -896,6 +959,8 @@ NvmeControllerInit (
   DEBUG ((EFI_D_INFO, "Admin Completion Queue (CqBuffer[0]) = [%016X]\n", Private->CqBuffer[0]));
   DEBUG ((EFI_D_INFO, "I/O   Submission Queue (SqBuffer[1]) = [%016X]\n", Private->SqBuffer[1]));
   DEBUG ((EFI_D_INFO, "I/O   Completion Queue (CqBuffer[1]) = [%016X]\n", Private->CqBuffer[1]));
+  DEBUG ((EFI_D_INFO, "Async I/O Submission Queue (SqBuffer[2]) = [%016X]\n", Private->SqBuffer[2]));
+  DEBUG ((EFI_D_INFO, "Async I/O Completion Queue (CqBuffer[2]) = [%016X]\n", Private->CqBuffer[2]));
 
   //
   // Program admin queue attributes.
@@ -930,7 +995,7 @@ NvmeControllerInit (
   }
 
   //
-  // Create one I/O completion queue.
+  // Create two I/O completion queues. The one for non-blocking I/O is optional.
   //
   Status = NvmeCreateIoCompletionQueue (Private);
   if (EFI_ERROR(Status)) {
@@ -938,7 +1003,7 @@ NvmeControllerInit (
   }
 
   //
-  // Create one I/O Submission queue.
+  // Create two I/O Submission queues. The one for non-blocking I/O is optional.
   //
   Status = NvmeCreateIoSubmissionQueue (Private);
   if (EFI_ERROR(Status)) {
@@ -332,6 +332,209 @@ EXIT:
   return NULL;
 }
 
+/**
+  Allocate the PRP list pool of the controller, and map it for bus master common
+  buffer access.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+  @retval EFI_SUCCESS                The PRP list pool is created.
+  @retval EFI_OUT_OF_RESOURCES       The PRP list pool can not be allocated or mapped. The
+                                     PRP lists are then allocated for each command.
+
+**/
+EFI_STATUS
+NvmeCreatePrpListPool (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  )
+{
+  EFI_PCI_IO_PROTOCOL                   *PciIo;
+  EFI_PHYSICAL_ADDRESS                  MappedAddr;
+  UINTN                                 Bytes;
+  UINTN                                 Index;
+  EFI_STATUS                            Status;
+
+  PciIo = Private->PciIo;
+  Private->PrpListFreeCount = 0;
+
+  Status = PciIo->AllocateBuffer (
+                    PciIo,
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    NVME_PRP_LIST_POOL_SIZE,
+                    (VOID **) &Private->PrpListPool,
+                    0
+                    );
+  if (EFI_ERROR (Status)) {
+    Private->PrpListPool = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Bytes  = EFI_PAGES_TO_SIZE (NVME_PRP_LIST_POOL_SIZE);
+  Status = PciIo->Map (
+                    PciIo,
+                    EfiPciIoOperationBusMasterCommonBuffer,
+                    Private->PrpListPool,
+                    &Bytes,
+                    &MappedAddr,
+                    &Private->PrpListPoolMapping
+                    );
+  if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (NVME_PRP_LIST_POOL_SIZE))) {
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, Private->PrpListPoolMapping);
+    }
+    PciIo->FreeBuffer (PciIo, NVME_PRP_LIST_POOL_SIZE, Private->PrpListPool);
+    Private->PrpListPool        = NULL;
+    Private->PrpListPoolMapping = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Private->PrpListPoolPciAddr = (UINT8 *) (UINTN) MappedAddr;
+  for (Index = 0; Index < NVME_PRP_LIST_POOL_SIZE; Index++) {
+    Private->PrpListFreeSlots[Index] = (UINT8) Index;
+  }
+  Private->PrpListFreeCount = NVME_PRP_LIST_POOL_SIZE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Unmap and free the PRP list pool of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+
+**/
+VOID
+NvmeFreePrpListPool (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private
+  )
+{
+  if (Private->PrpListPoolMapping != NULL) {
+    Private->PciIo->Unmap (Private->PciIo, Private->PrpListPoolMapping);
+    Private->PrpListPoolMapping = NULL;
+  }
+
+  if (Private->PrpListPool != NULL) {
+    Private->PciIo->FreeBuffer (Private->PciIo, NVME_PRP_LIST_POOL_SIZE, Private->PrpListPool);
+    Private->PrpListPool = NULL;
+  }
+
+  Private->PrpListFreeCount = 0;
+}
+
+/**
+  Build a PRP list in a free page of the PRP list pool of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     PhysicalAddr        The physical base address of the data pages.
+  @param[in]     Pages               The number of data pages the PRP list describes.
+  @param[out]    Slot                The index of the pool page holding the PRP list.
+
+  @return The PCI address of the PRP list, or NULL if the PRP list does not fit in
+          one page or the pool has no free page.
+
+**/
+VOID*
+NvmeBuildPoolPrpList (
+  IN     NVME_CONTROLLER_PRIVATE_DATA *Private,
+  IN     EFI_PHYSICAL_ADDRESS         PhysicalAddr,
+  IN     UINTN                        Pages,
+     OUT UINTN                        *Slot
+  )
+{
+  UINT64                      *PrpList;
+  UINTN                       PrpEntryIndex;
+  EFI_TPL                     OldTpl;
+
+  if (Pages > EFI_PAGE_SIZE / sizeof (UINT64)) {
+    return NULL;
+  }
+
+  //
+  // The pool is shared by the blocking I/O and the non-blocking I/O, which is
+  // submitted at TPL_NOTIFY.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  if (Private->PrpListFreeCount == 0) {
+    gBS->RestoreTPL (OldTpl);
+    return NULL;
+  }
+  Private->PrpListFreeCount--;
+  *Slot = Private->PrpListFreeSlots[Private->PrpListFreeCount];
+  gBS->RestoreTPL (OldTpl);
+
+  PrpList = (UINT64 *) (Private->PrpListPool + *Slot * EFI_PAGE_SIZE);
+  for (PrpEntryIndex = 0; PrpEntryIndex < Pages; ++PrpEntryIndex) {
+    PrpList[PrpEntryIndex] = PhysicalAddr;
+    PhysicalAddr += EFI_PAGE_SIZE;
+  }
+
+  return Private->PrpListPoolPciAddr + *Slot * EFI_PAGE_SIZE;
+}
+
+/**
+  Return a PRP list page to the PRP list pool of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     Slot                The index of the page in the pool.
+
+**/
+VOID
+NvmeFreePoolPrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA       *Private,
+  IN UINTN                              Slot
+  )
+{
+  EFI_TPL                               OldTpl;
+
+  ASSERT (Slot < NVME_PRP_LIST_POOL_SIZE);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  ASSERT (Private->PrpListFreeCount < NVME_PRP_LIST_POOL_SIZE);
+  Private->PrpListFreeSlots[Private->PrpListFreeCount] = (UINT8) Slot;
+  Private->PrpListFreeCount++;
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Account a command completed without error in the I/O statistics of the controller.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     Packet              The command packet of the completed command.
+  @param[in]     PrpListPages        The number of PRP list pages used by the command.
+  @param[in]     PrpListAllocated    TRUE if the PRP list was not served by the PRP list pool.
+  @param[in]     StartTicks          The performance counter value when the command was submitted.
+
+**/
+VOID
+NvmeRecordCommandStatistics (
+  IN NVME_CONTROLLER_PRIVATE_DATA          *Private,
+  IN NVM_EXPRESS_PASS_THRU_COMMAND_PACKET  *Packet,
+  IN UINTN                                 PrpListPages,
+  IN BOOLEAN                               PrpListAllocated,
+  IN UINT64                                StartTicks
+  )
+{
+  UINT64                                   EndTicks;
+  EFI_TPL                                  OldTpl;
+
+  EndTicks = GetPerformanceCounter ();
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Private->Statistics.Commands++;
+  Private->Statistics.TransferBytes += Packet->TransferLength;
+  Private->Statistics.PrpListPages  += PrpListPages;
+  if (PrpListAllocated) {
+    Private->Statistics.PrpListAllocations++;
+  }
+  if (Private->PerformanceCounterCountsUp) {
+    Private->Statistics.LatencyTicks += EndTicks - StartTicks;
+  } else {
+    Private->Statistics.LatencyTicks += StartTicks - EndTicks;
+  }
+  gBS->RestoreTPL (OldTpl);
+}
+
 
 /**
   Sends an NVM Express Command Packet to an NVM Express controller or namespace. This function supports
@@ -395,6 +598,10 @@ NvmExpressPassThru (
   VOID                          *PrpListHost;
   UINTN                         PrpListNo;
   UINT32                        Data;
+  NVME_PASS_THRU_ASYNC_REQ      *AsyncRequest;
+  EFI_TPL                       OldTpl;
+  UINTN                         PrpListSlot;
+  UINT64                        StartTicks;
 
   //
   // check the data fields in Packet parameter.
@@ -421,28 +628,65 @@ NvmExpressPassThru (
   Prp         = NULL;
   TimerEvent  = NULL;
   Status      = EFI_SUCCESS;
-
-  Qid = Packet->QueueId;
-  Sq  = Private->SqBuffer[Qid] + Private->SqTdbl[Qid].Sqt;
-  Cq  = Private->CqBuffer[Qid] + Private->CqHdbl[Qid].Cqh;
+  AsyncRequest = NULL;
+  OldTpl       = TPL_APPLICATION;
+  PrpListSlot  = NVME_PRP_LIST_NO_SLOT;
+  StartTicks   = 0;
 
   if (Packet->NvmeCmd->Nsid != NamespaceId) {
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // Nonblocking I/O commands are sent to a dedicated I/O queue, and are completed by
+  // the timer event of the controller. Admin commands are always executed blocking,
+  // and so are all commands when the controller has no nonblocking I/O queue.
+  //
+  Qid = Packet->QueueId;
+  if ((Event != NULL) && (Qid == NVME_IO_QUEUE) && (Private->AsyncQueueSize != 0)) {
+    AsyncRequest = AllocateZeroPool (sizeof (NVME_PASS_THRU_ASYNC_REQ));
+    if (AsyncRequest == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    AsyncRequest->Signature   = NVME_PASS_THRU_ASYNC_REQ_SIG;
+    AsyncRequest->Packet      = Packet;
+    AsyncRequest->CallerEvent = Event;
+
+    Qid    = NVME_ASYNC_IO_QUEUE;
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    if (Private->AsyncPassThruCount >= Private->AsyncQueueSize) {
+      gBS->RestoreTPL (OldTpl);
+      FreePool (AsyncRequest);
+      return EFI_NOT_READY;
+    }
+  }
+
+  Sq  = Private->SqBuffer[Qid] + Private->SqTdbl[Qid].Sqt;
+  Cq  = Private->CqBuffer[Qid] + Private->CqHdbl[Qid].Cqh;
+
   ZeroMem (Sq, sizeof (NVME_SQ));
   Sq->Opc  = Packet->NvmeCmd->Cdw0.Opcode;
   Sq->Fuse = Packet->NvmeCmd->Cdw0.FusedOperation;
   Sq->Cid  = Packet->NvmeCmd->Cdw0.Cid;
   Sq->Nsid = Packet->NvmeCmd->Nsid;
 
+  //
+  // The completions of the nonblocking I/O queue are matched with the requests by command id.
+  //
+  if (AsyncRequest != NULL) {
+    Sq->Cid = Private->Cid[Qid]++;
+    AsyncRequest->CommandId = Sq->Cid;
+  }
+
   //
   // Currently we only support PRP for data transfer, SGL is NOT supported.
   //
   ASSERT (Sq->Psdt == 0);
   if (Sq->Psdt != 0) {
     DEBUG ((EFI_D_ERROR, "NvmExpressPassThru: doesn't support SGL mechanism\n"));
-    return EFI_UNSUPPORTED;
+    Status = EFI_UNSUPPORTED;
+    goto EXIT;
   }
 
   Sq->Prp[0] = (UINT64)(UINTN)Packet->TransferBuffer;
@@ -469,7 +713,8 @@ NvmExpressPassThru (
                       &MapData
                       );
     if (EFI_ERROR (Status) || (Packet->TransferLength != MapLength)) {
-      return EFI_OUT_OF_RESOURCES;
+      Status = EFI_OUT_OF_RESOURCES;
+      goto EXIT;
     }
 
     Sq->Prp[0] = PhyAddr;
@@ -487,12 +732,8 @@ NvmExpressPassThru (
                         &MapMeta
                         );
       if (EFI_ERROR (Status) || (Packet->MetadataLength != MapLength)) {
-        PciIo->Unmap (
-                 PciIo,
-                 MapData
-                 );
-
-        return EFI_OUT_OF_RESOURCES;
+        Status = EFI_OUT_OF_RESOURCES;
+        goto EXIT;
       }
       Sq->Mptr = PhyAddr;
     }
@@ -506,12 +747,19 @@ NvmExpressPassThru (
 
   if ((Offset + Bytes) > (EFI_PAGE_SIZE * 2)) {
     //
-    // Create PrpList for remaining data buffer.
+    // Create PrpList for remaining data buffer. A PRP list which fits in one page is
+    // built in the PRP list pool of the controller, which is already mapped.
     //
     PhyAddr = (Sq->Prp[0] + EFI_PAGE_SIZE) & ~(EFI_PAGE_SIZE - 1);
-    Prp = NvmeCreatePrpList (PciIo, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
-    if (Prp == NULL) {
-      goto EXIT;
+    Prp = NvmeBuildPoolPrpList (Private, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListSlot);
+    if (Prp != NULL) {
+      PrpListNo = 1;
+    } else {
+      Prp = NvmeCreatePrpList (PciIo, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
+      if (Prp == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto EXIT;
+      }
     }
 
     Sq->Prp[1] = (UINT64)(UINTN)Prp;
@@ -541,7 +789,12 @@ NvmExpressPassThru (
   //
   // Ring the submission queue doorbell.
   //
-  Private->SqTdbl[Qid].Sqt ^= 1;
+  StartTicks = GetPerformanceCounter ();
+  if (AsyncRequest != NULL) {
+    Private->SqTdbl[Qid].Sqt = (UINT16) ((Private->SqTdbl[Qid].Sqt + 1) % (Private->AsyncQueueSize + 1));
+  } else {
+    Private->SqTdbl[Qid].Sqt ^= 1;
+  }
   Data = ReadUnaligned32 ((UINT32*)&Private->SqTdbl[Qid]);
   PciIo->Mem.Write (
                PciIo,
@@ -552,6 +805,26 @@ NvmExpressPassThru (
                &Data
                );
 
+  //
+  // From now on the nonblocking request owns the mappings and the PRP list, which are
+  // released by ProcessAsyncTaskList () when the command completes.
+  //
+  if (AsyncRequest != NULL) {
+    AsyncRequest->MapData     = MapData;
+    AsyncRequest->MapMeta     = MapMeta;
+    AsyncRequest->MapPrpList  = MapPrpList;
+    AsyncRequest->PrpListNo   = PrpListNo;
+    AsyncRequest->PrpListHost = (Prp != NULL) ? PrpListHost : NULL;
+    AsyncRequest->PrpListSlot = PrpListSlot;
+    AsyncRequest->StartTicks  = StartTicks;
+
+    InsertTailList (&Private->AsyncPassThruQueue, &AsyncRequest->Link);
+    Private->AsyncPassThruCount++;
+
+    gBS->RestoreTPL (OldTpl);
+    return EFI_SUCCESS;
+  }
+
   Status = gBS->CreateEvent (
                   EVT_TIMER,
                   TPL_CALLBACK,
@@ -599,6 +872,14 @@ NvmExpressPassThru (
     NvmeDumpStatus(Cq);
   DEBUG_CODE_END();
 
+  //
+  // Only the commands completed without error are accounted, as for the
+  // nonblocking I/O.
+  //
+  if (!EFI_ERROR (Status) && (Cq->Sct == 0) && (Cq->Sc == 0)) {
+    NvmeRecordCommandStatistics (Private, Packet, PrpListNo, (BOOLEAN) (PrpListHost != NULL), StartTicks);
+  }
+
   Data = ReadUnaligned32 ((UINT32*)&Private->CqHdbl[Qid]);
   PciIo->Mem.Write (
                PciIo,
@@ -631,13 +912,25 @@ EXIT:
              );
   }
 
-  if (Prp != NULL) {
+  if (PrpListSlot != NVME_PRP_LIST_NO_SLOT) {
+    NvmeFreePoolPrpList (Private, PrpListSlot);
+  } else if (Prp != NULL) {
     PciIo->FreeBuffer (PciIo, PrpListNo, PrpListHost);
   }
 
   if (TimerEvent != NULL) {
     gBS->CloseEvent (TimerEvent);
   }
+
+  if (AsyncRequest != NULL) {
+    gBS->RestoreTPL (OldTpl);
+    FreePool (AsyncRequest);
+  } else if ((Event != NULL) && !EFI_ERROR (Status)) {
+    //
+    // Admin commands are executed blocking, so the caller's event is signaled on return.
+    //
+    gBS->SignalEvent (Event);
+  }
   return Status;
 }
 
@@ -209,6 +209,7 @@ ScsiDiskDriverBindingStart (
   UINT8                 MaxRetry;
   BOOLEAN               NeedRetry;
   BOOLEAN               MustReadCapacity;
+  EFI_EXT_SCSI_PASS_THRU_PROTOCOL *ExtScsiPassThru;
 
   MustReadCapacity = TRUE;
 
@@ -239,7 +240,13 @@ ScsiDiskDriverBindingStart (
   ScsiDiskDevice->BlkIo.ReadBlocks     = ScsiDiskReadBlocks;
   ScsiDiskDevice->BlkIo.WriteBlocks    = ScsiDiskWriteBlocks;
   ScsiDiskDevice->BlkIo.FlushBlocks    = ScsiDiskFlushBlocks;
+  ScsiDiskDevice->BlkIo2.Media         = &ScsiDiskDevice->BlkIoMedia;
+  ScsiDiskDevice->BlkIo2.Reset         = ScsiDiskResetEx;
+  ScsiDiskDevice->BlkIo2.ReadBlocksEx  = ScsiDiskReadBlocksEx;
+  ScsiDiskDevice->BlkIo2.WriteBlocksEx = ScsiDiskWriteBlocksEx;
+  ScsiDiskDevice->BlkIo2.FlushBlocksEx = ScsiDiskFlushBlocksEx;
   ScsiDiskDevice->Handle               = Controller;
+  InitializeListHead (&ScsiDiskDevice->AsyncRequestQueue);
 
   ScsiIo->GetDeviceType (ScsiIo, &(ScsiDiskDevice->DeviceType));
   switch (ScsiDiskDevice->DeviceType) {
@@ -304,10 +311,23 @@ ScsiDiskDriverBindingStart (
     //
     if (DetermineInstallBlockIo(Controller)) {
       InitializeInstallDiskInfo(ScsiDiskDevice, Controller);
+      //
+      // Only the EXT SCSI pass thru which supports non-blocking I/O executes the
+      // SCSI commands with an event. Otherwise the Block I/O2 requests are done in
+      // blocking mode, which is the case for all the EXT SCSI pass thru drivers of
+      // this package (ATA/ATAPI, UFS and iSCSI).
+      //
+      ExtScsiPassThru = (EFI_EXT_SCSI_PASS_THRU_PROTOCOL *) GetParentProtocol (&gEfiExtScsiPassThruProtocolGuid, Controller);
+      if ((ExtScsiPassThru != NULL) &&
+          ((ExtScsiPassThru->Mode->Attributes & EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_NONBLOCKIO) != 0)) {
+        ScsiDiskDevice->AsyncIoSupported = TRUE;
+      }
       Status = gBS->InstallMultipleProtocolInterfaces (
                       &Controller,
                       &gEfiBlockIoProtocolGuid,
                       &ScsiDiskDevice->BlkIo,
+                      &gEfiBlockIo2ProtocolGuid,
+                      &ScsiDiskDevice->BlkIo2,
                       &gEfiDiskInfoProtocolGuid,
                       &ScsiDiskDevice->DiskInfo,
                       NULL
@@ -391,10 +411,22 @@ ScsiDiskDriverBindingStop (
   }
 
   ScsiDiskDevice = SCSI_DISK_DEV_FROM_THIS (BlkIo);
+
+  //
+  // Wait for the non-blocking requests in flight to complete. The device can't
+  // be freed while the SCSI pass thru may still complete one of them.
+  //
+  Status = ScsiDiskWaitAsyncRequests (ScsiDiskDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
+  }
+
   Status = gBS->UninstallMultipleProtocolInterfaces (
                   Controller,
                   &gEfiBlockIoProtocolGuid,
                   &ScsiDiskDevice->BlkIo,
+                  &gEfiBlockIo2ProtocolGuid,
+                  &ScsiDiskDevice->BlkIo2,
                   &gEfiDiskInfoProtocolGuid,
                   &ScsiDiskDevice->DiskInfo,
                   NULL
@@ -522,6 +554,12 @@ ScsiDiskReadBlocks (
             &ScsiDiskDevice->BlkIo,
             &ScsiDiskDevice->BlkIo
             );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
       Status = EFI_MEDIA_CHANGED;
       goto Done;
     }
@@ -640,6 +678,12 @@ ScsiDiskWriteBlocks (
             &ScsiDiskDevice->BlkIo,
             &ScsiDiskDevice->BlkIo
             );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
       Status = EFI_MEDIA_CHANGED;
       goto Done;
     }
@@ -724,6 +768,304 @@ ScsiDiskFlushBlocks (
   return EFI_SUCCESS;
 }
 
+/**
+  Reset SCSI Disk through Block I/O2 protocol.
+
+  The non-blocking requests in flight are completed before the reset.
+
+  @param  This                 The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  ExtendedVerification The flag about if extend verificate
+
+  @retval EFI_SUCCESS          The device was reset.
+  @retval EFI_DEVICE_ERROR     The device is not functioning properly and could
+                               not be reset.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskResetEx (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN  BOOLEAN                 ExtendedVerification
+  )
+{
+  SCSI_DISK_DEV *ScsiDiskDevice;
+
+  ScsiDiskDevice = SCSI_DISK_DEV_FROM_BLKIO2 (This);
+
+  //
+  // The reset is still done if the requests time out, it aborts them.
+  //
+  ScsiDiskWaitAsyncRequests (ScsiDiskDevice);
+
+  return ScsiDiskReset (&ScsiDiskDevice->BlkIo, ExtendedVerification);
+}
+
+/**
+  Read or write blocks of SCSI Disk through Block I/O2 protocol.
+
+  @param  ScsiDiskDevice The pointer of SCSI_DISK_DEV.
+  @param  MediaId        The Id of Media detected
+  @param  Lba            The logic block address
+  @param  Token          A pointer to the token associated with the transaction.
+  @param  BufferSize     The size of Buffer
+  @param  Buffer         The buffer of the data
+  @param  IsWrite        Indicates whether it is a write operation
+
+  @retval EFI_SUCCESS           The request was queued if Token->Event is not NULL.
+                                The data was transferred correctly if Token->Event
+                                is NULL.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+ScsiDiskReadWriteBlocksEx (
+  IN     SCSI_DISK_DEV          *ScsiDiskDevice,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN OUT VOID                   *Buffer,
+  IN     BOOLEAN                IsWrite
+  )
+{
+  EFI_BLOCK_IO_MEDIA  *Media;
+  EFI_STATUS          Status;
+  UINTN               BlockSize;
+  UINTN               NumberOfBlocks;
+  BOOLEAN             MediaChange;
+  EFI_TPL             OldTpl;
+
+  MediaChange    = FALSE;
+  OldTpl         = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (!IS_DEVICE_FIXED(ScsiDiskDevice)) {
+
+    Status = ScsiDiskDetectMedia (ScsiDiskDevice, FALSE, &MediaChange);
+    if (EFI_ERROR (Status)) {
+      Status = EFI_DEVICE_ERROR;
+      goto Done;
+    }
+
+    if (MediaChange) {
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIoProtocolGuid,
+            &ScsiDiskDevice->BlkIo,
+            &ScsiDiskDevice->BlkIo
+            );
+      gBS->ReinstallProtocolInterface (
+            ScsiDiskDevice->Handle,
+            &gEfiBlockIo2ProtocolGuid,
+            &ScsiDiskDevice->BlkIo2,
+            &ScsiDiskDevice->BlkIo2
+            );
+      Status = EFI_MEDIA_CHANGED;
+      goto Done;
+    }
+  }
+  //
+  // Get the intrinsic block size
+  //
+  Media           = ScsiDiskDevice->BlkIo2.Media;
+  BlockSize       = Media->BlockSize;
+
+  NumberOfBlocks  = BufferSize / BlockSize;
+
+  if (!(Media->MediaPresent)) {
+    Status = EFI_NO_MEDIA;
+    goto Done;
+  }
+
+  if (MediaId != Media->MediaId) {
+    Status = EFI_MEDIA_CHANGED;
+    goto Done;
+  }
+
+  if (Buffer == NULL) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if (BufferSize == 0) {
+    if ((Token != NULL) && (Token->Event != NULL)) {
+      Token->TransactionStatus = EFI_SUCCESS;
+      gBS->SignalEvent (Token->Event);
+    }
+    Status = EFI_SUCCESS;
+    goto Done;
+  }
+
+  if (BufferSize % BlockSize != 0) {
+    Status = EFI_BAD_BUFFER_SIZE;
+    goto Done;
+  }
+
+  if (Lba > Media->LastBlock) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if ((Lba + NumberOfBlocks - 1) > Media->LastBlock) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  if ((Media->IoAlign > 1) && (((UINTN) Buffer & (Media->IoAlign - 1)) != 0)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto Done;
+  }
+
+  //
+  // If all the parameters are valid, then perform the sectors commands. They are
+  // non-blocking if there is an event to signal.
+  //
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Status = ScsiDiskAsyncTransferSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks, IsWrite, Token);
+  } else if (IsWrite) {
+    Status = ScsiDiskWriteSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
+  } else {
+    Status = ScsiDiskReadSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
+  }
+
+Done:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  The function is to Read Block from SCSI Disk through Block I/O2 protocol.
+
+  If Token->Event is not NULL, the read is split into SCSI commands of at most
+  SCSI_DISK_ASYNC_TRANSFER_LENGTH bytes, which are executed concurrently.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer to fill the read out data
+
+  @retval EFI_SUCCESS           The read request was queued if Token->Event is not
+                                NULL. The data was read correctly from the device
+                                if Token->Event is NULL.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+     OUT VOID                   *Buffer
+  )
+{
+  return ScsiDiskReadWriteBlocksEx (
+           SCSI_DISK_DEV_FROM_BLKIO2 (This),
+           MediaId,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer,
+           FALSE
+           );
+}
+
+/**
+  The function is to Write Block to SCSI Disk through Block I/O2 protocol.
+
+  If Token->Event is not NULL, the write is split into SCSI commands of at most
+  SCSI_DISK_ASYNC_TRANSFER_LENGTH bytes, which are executed concurrently.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer of data to be written into SCSI Disk
+
+  @retval EFI_SUCCESS           The write request was queued if Token->Event is not
+                                NULL. The data was written correctly to the device
+                                if Token->Event is NULL.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  return ScsiDiskReadWriteBlocksEx (
+           SCSI_DISK_DEV_FROM_BLKIO2 (This),
+           MediaId,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer,
+           TRUE
+           );
+}
+
+/**
+  Flush Block to Disk through Block I/O2 protocol.
+
+  The non-blocking requests in flight are completed before the Token is signaled.
+
+  @param  This              The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  Token             A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All outstanding data was written to the device
+  @retval EFI_DEVICE_ERROR  The non-blocking requests in flight do not complete in time
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  EFI_STATUS    Status;
+
+  Status = ScsiDiskWaitAsyncRequests (SCSI_DISK_DEV_FROM_BLKIO2 (This));
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return EFI_SUCCESS;
+}
+
 
 /**
   Detect Device and read out capacity ,if error occurs, parse the sense key.
@@ -2050,6 +2392,480 @@ ScsiDiskWriteSectors (
   return EFI_SUCCESS;
 }
 
+/**
+  Submit a non-blocking Read/Write(10) or Read/Write(16) command of a BlockIo2 request.
+
+  @param  Command         The pointer of SCSI_ASYNC_COMMAND
+
+  @return  EFI_STATUS is returned by calling EFI_SCSI_IO_PROTOCOL.ExecuteScsiCommand().
+
+**/
+EFI_STATUS
+ScsiDiskAsyncSubmitCommand (
+  IN  SCSI_ASYNC_COMMAND  *Command
+  )
+{
+  SCSI_DISK_DEV                     *ScsiDiskDevice;
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET   *Packet;
+  UINT32                            ByteCount;
+  EFI_EVENT                         Event;
+  EFI_STATUS                        Status;
+
+  ScsiDiskDevice = Command->ScsiDiskDevice;
+  Packet         = &Command->Packet;
+  ByteCount      = Command->SectorCount * ScsiDiskDevice->BlkIo.Media->BlockSize;
+
+  ZeroMem (Packet, sizeof (EFI_SCSI_IO_SCSI_REQUEST_PACKET));
+  ZeroMem (Command->Cdb, sizeof (Command->Cdb));
+
+  if (!ScsiDiskDevice->Cdb16Byte) {
+    Command->Cdb[0] = Command->IsWrite ? EFI_SCSI_OP_WRITE10 : EFI_SCSI_OP_READ10;
+    WriteUnaligned32 ((UINT32 *) &Command->Cdb[2], SwapBytes32 ((UINT32) Command->Lba));
+    WriteUnaligned16 ((UINT16 *) &Command->Cdb[7], SwapBytes16 ((UINT16) Command->SectorCount));
+    Packet->CdbLength = 10;
+  } else {
+    Command->Cdb[0] = Command->IsWrite ? EFI_SCSI_OP_WRITE16 : EFI_SCSI_OP_READ16;
+    WriteUnaligned64 ((UINT64 *) &Command->Cdb[2], SwapBytes64 (Command->Lba));
+    WriteUnaligned32 ((UINT32 *) &Command->Cdb[10], SwapBytes32 (Command->SectorCount));
+    Packet->CdbLength = 16;
+  }
+
+  //
+  // The timeout is calculated in the same way as ScsiDiskReadSectors().
+  //
+  Packet->Timeout         = EFI_TIMER_PERIOD_SECONDS (ByteCount / 2100000 + 31);
+  Packet->Cdb             = Command->Cdb;
+  Packet->SenseData       = &Command->SenseData;
+  Packet->SenseDataLength = (UINT8) sizeof (EFI_SCSI_SENSE_DATA);
+  if (Command->IsWrite) {
+    Packet->OutDataBuffer     = Command->Buffer;
+    Packet->OutTransferLength = ByteCount;
+    Packet->DataDirection     = EFI_SCSI_DATA_OUT;
+  } else {
+    Packet->InDataBuffer      = Command->Buffer;
+    Packet->InTransferLength  = ByteCount;
+    Packet->DataDirection     = EFI_SCSI_DATA_IN;
+  }
+
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  ScsiDiskAsyncCommandNotify,
+                  Command,
+                  &Event
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = ScsiDiskDevice->ScsiIo->ExecuteScsiCommand (ScsiDiskDevice->ScsiIo, Packet, Event);
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (Event);
+  }
+
+  return Status;
+}
+
+/**
+  Remove a SCSI command from its BlockIo2 request, and complete the request
+  if it has no more commands.
+
+  The caller must be at TPL_NOTIFY.
+
+  @param  Command         The pointer of SCSI_ASYNC_COMMAND
+  @param  Status          The status of the command
+
+**/
+VOID
+ScsiDiskAsyncFinishCommand (
+  IN  SCSI_ASYNC_COMMAND  *Command,
+  IN  EFI_STATUS          Status
+  )
+{
+  SCSI_DISK_DEV         *ScsiDiskDevice;
+  SCSI_BLKIO2_REQUEST   *Request;
+  SCSI_ASYNC_COMMAND    *Unsubmitted;
+  LIST_ENTRY            *Link;
+  LIST_ENTRY            *NextLink;
+
+  ScsiDiskDevice = Command->ScsiDiskDevice;
+  Request        = Command->Request;
+
+  if (Command->Submitted) {
+    ScsiDiskDevice->AsyncCommandCount--;
+  }
+  RemoveEntryList (&Command->Link);
+  FreePool (Command);
+
+  if (EFI_ERROR (Status)) {
+    //
+    // The request fails, so its commands which are not submitted yet are dropped.
+    //
+    if (!EFI_ERROR (Request->Token->TransactionStatus)) {
+      Request->Token->TransactionStatus = Status;
+    }
+    for (Link = GetFirstNode (&Request->CommandQueue);
+         !IsNull (&Request->CommandQueue, Link);
+         Link = NextLink) {
+      NextLink    = GetNextNode (&Request->CommandQueue, Link);
+      Unsubmitted = SCSI_ASYNC_COMMAND_FROM_LINK (Link);
+      if (!Unsubmitted->Submitted) {
+        RemoveEntryList (Link);
+        FreePool (Unsubmitted);
+      }
+    }
+  }
+
+  if (IsListEmpty (&Request->CommandQueue)) {
+    RemoveEntryList (&Request->Link);
+    gBS->SignalEvent (Request->Token->Event);
+    FreePool (Request);
+  }
+}
+
+/**
+  Submit the queued SCSI commands of the BlockIo2 requests of SCSI Disk, in order,
+  while less than SCSI_DISK_MAX_ASYNC_COMMANDS of them are in flight.
+
+  The caller must be at TPL_NOTIFY.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskAsyncSubmitCommands (
+  IN  SCSI_DISK_DEV       *ScsiDiskDevice
+  )
+{
+  SCSI_BLKIO2_REQUEST   *Request;
+  SCSI_ASYNC_COMMAND    *Command;
+  LIST_ENTRY            *RequestLink;
+  LIST_ENTRY            *NextRequestLink;
+  LIST_ENTRY            *Link;
+  EFI_STATUS            Status;
+
+  for (RequestLink = GetFirstNode (&ScsiDiskDevice->AsyncRequestQueue);
+       !IsNull (&ScsiDiskDevice->AsyncRequestQueue, RequestLink);
+       RequestLink = NextRequestLink) {
+    //
+    // The request may be completed and freed below if a command fails to be submitted.
+    //
+    NextRequestLink = GetNextNode (&ScsiDiskDevice->AsyncRequestQueue, RequestLink);
+    Request         = SCSI_BLKIO2_REQUEST_FROM_LINK (RequestLink);
+
+    for (Link = GetFirstNode (&Request->CommandQueue);
+         !IsNull (&Request->CommandQueue, Link);
+         Link = GetNextNode (&Request->CommandQueue, Link)) {
+      Command = SCSI_ASYNC_COMMAND_FROM_LINK (Link);
+      if (Command->Submitted) {
+        continue;
+      }
+
+      if (ScsiDiskDevice->AsyncCommandCount >= SCSI_DISK_MAX_ASYNC_COMMANDS) {
+        return;
+      }
+
+      Status = ScsiDiskAsyncSubmitCommand (Command);
+      if (!EFI_ERROR (Status)) {
+        Command->Submitted = TRUE;
+        ScsiDiskDevice->AsyncCommandCount++;
+        continue;
+      }
+
+      if ((Status == EFI_NOT_READY) && (ScsiDiskDevice->AsyncCommandCount != 0)) {
+        //
+        // The SCSI pass thru is busy. Try again when one of the commands in flight completes.
+        //
+        return;
+      }
+
+      DEBUG ((EFI_D_ERROR, "ScsiDisk: Fail to submit non-blocking command - %r\n", Status));
+      ScsiDiskAsyncFinishCommand (Command, EFI_DEVICE_ERROR);
+      break;
+    }
+  }
+}
+
+/**
+  Call back function when a non-blocking SCSI command completes.
+
+  The command is submitted again if it fails with a status which needs a retry,
+  or if the device transfers less data than requested.
+
+  @param  Event           The Event this notify function registered to.
+  @param  Context         Pointer to the SCSI_ASYNC_COMMAND.
+
+**/
+VOID
+EFIAPI
+ScsiDiskAsyncCommandNotify (
+  IN  EFI_EVENT           Event,
+  IN  VOID                *Context
+  )
+{
+  SCSI_ASYNC_COMMAND                *Command;
+  SCSI_DISK_DEV                     *ScsiDiskDevice;
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET   *Packet;
+  EFI_STATUS                        Status;
+  BOOLEAN                           NeedRetry;
+  UINTN                             Action;
+  UINT32                            BlockSize;
+  UINT32                            TransferLength;
+  UINT32                            SectorCount;
+
+  gBS->CloseEvent (Event);
+
+  Command        = (SCSI_ASYNC_COMMAND *) Context;
+  ScsiDiskDevice = Command->ScsiDiskDevice;
+  Packet         = &Command->Packet;
+  BlockSize      = ScsiDiskDevice->BlkIo.Media->BlockSize;
+  NeedRetry      = FALSE;
+
+  ScsiDiskDevice->AsyncCompletionCount++;
+
+  //
+  // Check HostAdapterStatus and TargetStatus as ScsiDiskRead10() does, except
+  // that the bus and the device are not reset here.
+  //
+  Status = CheckHostAdapterStatus (Packet->HostAdapterStatus);
+  if ((Status == EFI_TIMEOUT) || (Status == EFI_NOT_READY)) {
+    NeedRetry = TRUE;
+    Status    = EFI_DEVICE_ERROR;
+  } else if (!EFI_ERROR (Status)) {
+    Status = CheckTargetStatus (Packet->TargetStatus);
+    if (Status == EFI_NOT_READY) {
+      NeedRetry = TRUE;
+      Status    = EFI_DEVICE_ERROR;
+    } else if (!EFI_ERROR (Status) && (Packet->TargetStatus == EFI_EXT_SCSI_STATUS_TARGET_CHECK_CONDITION)) {
+      DEBUG ((EFI_D_ERROR, "ScsiDisk: Check Condition happened on non-blocking command!\n"));
+      DetectMediaParsingSenseKeys (
+        ScsiDiskDevice,
+        &Command->SenseData,
+        Packet->SenseDataLength / sizeof (EFI_SCSI_SENSE_DATA),
+        &Action
+        );
+      NeedRetry = (BOOLEAN) (Action == ACTION_RETRY_COMMAND_LATER);
+      Status    = EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (!EFI_ERROR (Status)) {
+    TransferLength = Command->IsWrite ? Packet->OutTransferLength : Packet->InTransferLength;
+    SectorCount    = TransferLength / BlockSize;
+    if ((SectorCount != 0) && (SectorCount < Command->SectorCount)) {
+      //
+      // Transfer the rest of the data with the same command.
+      //
+      Command->Buffer      += SectorCount * BlockSize;
+      Command->Lba         += SectorCount;
+      Command->SectorCount -= SectorCount;
+      Command->RetryCount   = 0;
+      NeedRetry             = TRUE;
+    } else if (SectorCount == 0) {
+      Status = EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (NeedRetry && (Command->RetryCount < SCSI_DISK_ASYNC_MAX_RETRY)) {
+    if (EFI_ERROR (Status)) {
+      Command->RetryCount++;
+    }
+    Status = ScsiDiskAsyncSubmitCommand (Command);
+    if (!EFI_ERROR (Status)) {
+      return;
+    }
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  ScsiDiskAsyncFinishCommand (Command, Status);
+  ScsiDiskAsyncSubmitCommands (ScsiDiskDevice);
+}
+
+/**
+  Read or write sectors of SCSI Disk with non-blocking SCSI commands.
+
+  The transfer is split into SCSI commands of at most SCSI_DISK_ASYNC_TRANSFER_LENGTH
+  bytes. Up to SCSI_DISK_MAX_ASYNC_COMMANDS of them are executed at the same time,
+  and Token->Event is signaled when all of them are completed.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Buffer          The buffer of the data
+  @param  Lba             Logic block address
+  @param  NumberOfBlocks  The number of blocks to transfer
+  @param  IsWrite         Indicates whether it is a write operation
+  @param  Token           A pointer to the token associated with the transaction
+
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued due to a lack of resources.
+  @retval EFI_SUCCESS           The request is queued.
+
+**/
+EFI_STATUS
+ScsiDiskAsyncTransferSectors (
+  IN     SCSI_DISK_DEV        *ScsiDiskDevice,
+  IN     VOID                 *Buffer,
+  IN     EFI_LBA              Lba,
+  IN     UINTN                NumberOfBlocks,
+  IN     BOOLEAN              IsWrite,
+  IN OUT EFI_BLOCK_IO2_TOKEN  *Token
+  )
+{
+  SCSI_BLKIO2_REQUEST   *Request;
+  SCSI_ASYNC_COMMAND    *Command;
+  UINT8                 *PtrBuffer;
+  UINT32                BlockSize;
+  UINT32                MaxBlock;
+  UINT32                SectorCount;
+  EFI_STATUS            Status;
+  EFI_TPL               OldTpl;
+
+  if (!ScsiDiskDevice->AsyncIoSupported) {
+    //
+    // The SCSI pass thru can't execute the commands with an event, so the data is
+    // transferred in blocking mode and the Token is signaled when it is done.
+    //
+    if (IsWrite) {
+      Status = ScsiDiskWriteSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
+    } else {
+      Status = ScsiDiskReadSectors (ScsiDiskDevice, Buffer, Lba, NumberOfBlocks);
+    }
+    Token->TransactionStatus = Status;
+    gBS->SignalEvent (Token->Event);
+    return EFI_SUCCESS;
+  }
+
+  Request = AllocateZeroPool (sizeof (SCSI_BLKIO2_REQUEST));
+  if (Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Request->Signature = SCSI_BLKIO2_REQUEST_SIGNATURE;
+  Request->Token     = Token;
+  InitializeListHead (&Request->CommandQueue);
+
+  //
+  // limit the data bytes that can be transferred by one command, so that a big
+  // request is pipelined by several commands
+  //
+  BlockSize = ScsiDiskDevice->BlkIo.Media->BlockSize;
+  MaxBlock  = SCSI_DISK_ASYNC_TRANSFER_LENGTH / BlockSize;
+  if (MaxBlock == 0) {
+    MaxBlock = 1;
+  }
+  if (!ScsiDiskDevice->Cdb16Byte && (MaxBlock > 0xFFFF)) {
+    MaxBlock = 0xFFFF;
+  }
+
+  PtrBuffer = Buffer;
+  while (NumberOfBlocks > 0) {
+    SectorCount = (NumberOfBlocks > MaxBlock) ? MaxBlock : (UINT32) NumberOfBlocks;
+
+    Command = AllocateZeroPool (sizeof (SCSI_ASYNC_COMMAND));
+    if (Command == NULL) {
+      while (!IsListEmpty (&Request->CommandQueue)) {
+        Command = SCSI_ASYNC_COMMAND_FROM_LINK (GetFirstNode (&Request->CommandQueue));
+        RemoveEntryList (&Command->Link);
+        FreePool (Command);
+      }
+      FreePool (Request);
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Command->Signature      = SCSI_ASYNC_COMMAND_SIGNATURE;
+    Command->ScsiDiskDevice = ScsiDiskDevice;
+    Command->Request        = Request;
+    Command->IsWrite        = IsWrite;
+    Command->Buffer         = PtrBuffer;
+    Command->Lba            = Lba;
+    Command->SectorCount    = SectorCount;
+    InsertTailList (&Request->CommandQueue, &Command->Link);
+
+    Lba            += SectorCount;
+    PtrBuffer      += SectorCount * BlockSize;
+    NumberOfBlocks -= SectorCount;
+  }
+
+  Token->TransactionStatus = EFI_SUCCESS;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  InsertTailList (&ScsiDiskDevice->AsyncRequestQueue, &Request->Link);
+  ScsiDiskAsyncSubmitCommands (ScsiDiskDevice);
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait until all the non-blocking requests of SCSI Disk are completed.
+
+  The wait gives up when none of the SCSI commands in flight completes within
+  the longest of their timeouts.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+  @retval EFI_SUCCESS     All the non-blocking requests are completed.
+  @retval EFI_TIMEOUT     The SCSI commands in flight do not complete in time.
+
+**/
+EFI_STATUS
+ScsiDiskWaitAsyncRequests (
+  IN  SCSI_DISK_DEV     *ScsiDiskDevice
+  )
+{
+  SCSI_BLKIO2_REQUEST   *Request;
+  SCSI_ASYNC_COMMAND    *Command;
+  LIST_ENTRY            *RequestLink;
+  LIST_ENTRY            *Link;
+  UINTN                 CompletionCount;
+  UINT64                Timeout;
+  UINT64                Elapsed;
+  EFI_TPL               OldTpl;
+
+  CompletionCount = 0;
+  Elapsed         = 0;
+  Timeout         = SCSI_DISK_TIMEOUT;
+
+  while (TRUE) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    if (IsListEmpty (&ScsiDiskDevice->AsyncRequestQueue)) {
+      gBS->RestoreTPL (OldTpl);
+      return EFI_SUCCESS;
+    }
+
+    //
+    // Start counting again whenever a command completes, and give up when the
+    // commands in flight run past the longest of their timeouts.
+    //
+    if ((Elapsed == 0) || (CompletionCount != ScsiDiskDevice->AsyncCompletionCount)) {
+      CompletionCount = ScsiDiskDevice->AsyncCompletionCount;
+      Elapsed         = 0;
+      Timeout         = SCSI_DISK_TIMEOUT;
+      for (RequestLink = GetFirstNode (&ScsiDiskDevice->AsyncRequestQueue);
+           !IsNull (&ScsiDiskDevice->AsyncRequestQueue, RequestLink);
+           RequestLink = GetNextNode (&ScsiDiskDevice->AsyncRequestQueue, RequestLink)) {
+        Request = SCSI_BLKIO2_REQUEST_FROM_LINK (RequestLink);
+        for (Link = GetFirstNode (&Request->CommandQueue);
+             !IsNull (&Request->CommandQueue, Link);
+             Link = GetNextNode (&Request->CommandQueue, Link)) {
+          Command = SCSI_ASYNC_COMMAND_FROM_LINK (Link);
+          if (Command->Submitted && (Command->Packet.Timeout > Timeout)) {
+            Timeout = Command->Packet.Timeout;
+          }
+        }
+      }
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    if (Elapsed >= Timeout) {
+      DEBUG ((EFI_D_ERROR, "ScsiDisk: Timeout waiting for non-blocking requests\n"));
+      return EFI_TIMEOUT;
+    }
+
+    //
+    // Stall for 100us, which is 1000 units of 100ns.
+    //
+    gBS->Stall (100);
+    Elapsed += 1000;
+  }
+}
+
 
 /**
   Submit Read(10) command.
@@ -22,6 +22,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/ScsiIo.h>
 #include <Protocol/ComponentName.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/DriverBinding.h>
 #include <Protocol/ScsiPassThruExt.h>
 #include <Protocol/ScsiPassThru.h>
@@ -29,6 +30,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 
 #include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/UefiLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -50,6 +52,7 @@ typedef struct {
   EFI_HANDLE                Handle;
 
   EFI_BLOCK_IO_PROTOCOL     BlkIo;
+  EFI_BLOCK_IO2_PROTOCOL    BlkIo2;
   EFI_BLOCK_IO_MEDIA        BlkIoMedia;
   EFI_SCSI_IO_PROTOCOL      *ScsiIo;
   UINT8                     DeviceType;
@@ -75,10 +78,23 @@ typedef struct {
   // The flag indicates if 16-byte command can be used
   //
   BOOLEAN                   Cdb16Byte;
+
+  //
+  // Non-blocking I/O. The flag indicates if the SCSI pass thru executes commands
+  // with an event, the BlockIo2 requests which are not completed yet, the
+  // number of their SCSI commands being executed, and the number of SCSI
+  // commands completed so far.
+  //
+  BOOLEAN                   AsyncIoSupported;
+  LIST_ENTRY                AsyncRequestQueue;
+  UINTN                     AsyncCommandCount;
+  UINTN                     AsyncCompletionCount;
 } SCSI_DISK_DEV;
 
 #define SCSI_DISK_DEV_FROM_THIS(a)  CR (a, SCSI_DISK_DEV, BlkIo, SCSI_DISK_DEV_SIGNATURE)
 
+#define SCSI_DISK_DEV_FROM_BLKIO2(a)  CR (a, SCSI_DISK_DEV, BlkIo2, SCSI_DISK_DEV_SIGNATURE)
+
 #define SCSI_DISK_DEV_FROM_DISKINFO(a) CR (a, SCSI_DISK_DEV, DiskInfo, SCSI_DISK_DEV_SIGNATURE)
 
 //
@@ -104,6 +120,53 @@ extern EFI_COMPONENT_NAME2_PROTOCOL  gScsiDiskComponentName2;
 //
 #define SCSI_DISK_TIMEOUT           EFI_TIMER_PERIOD_SECONDS (3)
 
+//
+// Non-blocking I/O. Maximum number of SCSI commands kept in flight for a SCSI
+// disk, maximum length of each of them and maximum retries of a failed one
+//
+#define SCSI_DISK_MAX_ASYNC_COMMANDS      8
+#define SCSI_DISK_ASYNC_TRANSFER_LENGTH   SIZE_1MB
+#define SCSI_DISK_ASYNC_MAX_RETRY         2
+
+//
+// A BlockIo2 request, which is completed when all of its SCSI commands are.
+//
+#define SCSI_BLKIO2_REQUEST_SIGNATURE SIGNATURE_32 ('s', 'b', 'r', 'q')
+
+typedef struct {
+  UINT32                    Signature;
+  LIST_ENTRY                Link;
+  EFI_BLOCK_IO2_TOKEN       *Token;
+  LIST_ENTRY                CommandQueue;
+} SCSI_BLKIO2_REQUEST;
+
+#define SCSI_BLKIO2_REQUEST_FROM_LINK(a) \
+  CR (a, SCSI_BLKIO2_REQUEST, Link, SCSI_BLKIO2_REQUEST_SIGNATURE)
+
+//
+// A Read/Write(10) or Read/Write(16) command of a BlockIo2 request.
+//
+#define SCSI_ASYNC_COMMAND_SIGNATURE SIGNATURE_32 ('s', 'a', 'c', 'm')
+
+typedef struct {
+  UINT32                            Signature;
+  LIST_ENTRY                        Link;
+  SCSI_DISK_DEV                     *ScsiDiskDevice;
+  SCSI_BLKIO2_REQUEST               *Request;
+  BOOLEAN                           Submitted;
+  BOOLEAN                           IsWrite;
+  UINT8                             RetryCount;
+  UINT8                             *Buffer;
+  EFI_LBA                           Lba;
+  UINT32                            SectorCount;
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET   Packet;
+  UINT8                             Cdb[16];
+  EFI_SCSI_SENSE_DATA               SenseData;
+} SCSI_ASYNC_COMMAND;
+
+#define SCSI_ASYNC_COMMAND_FROM_LINK(a) \
+  CR (a, SCSI_ASYNC_COMMAND, Link, SCSI_ASYNC_COMMAND_SIGNATURE)
+
 /**
   Test to see if this driver supports ControllerHandle.
 
@@ -409,6 +472,151 @@ ScsiDiskFlushBlocks (
   IN  EFI_BLOCK_IO_PROTOCOL   *This
   );
 
+/**
+  Reset SCSI Disk through Block I/O2 protocol.
+
+  The non-blocking requests in flight are completed before the reset.
+
+  @param  This                 The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  ExtendedVerification The flag about if extend verificate
+
+  @retval EFI_SUCCESS          The device was reset.
+  @retval EFI_DEVICE_ERROR     The device is not functioning properly and could
+                               not be reset.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskResetEx (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN  BOOLEAN                 ExtendedVerification
+  );
+
+/**
+  Read or write blocks of SCSI Disk through Block I/O2 protocol.
+
+  @param  ScsiDiskDevice The pointer of SCSI_DISK_DEV.
+  @param  MediaId        The Id of Media detected
+  @param  Lba            The logic block address
+  @param  Token          A pointer to the token associated with the transaction.
+  @param  BufferSize     The size of Buffer
+  @param  Buffer         The buffer of the data
+  @param  IsWrite        Indicates whether it is a write operation
+
+  @retval EFI_SUCCESS           The request was queued if Token->Event is not NULL.
+                                The data was transferred correctly if Token->Event
+                                is NULL.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+ScsiDiskReadWriteBlocksEx (
+  IN     SCSI_DISK_DEV          *ScsiDiskDevice,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN OUT VOID                   *Buffer,
+  IN     BOOLEAN                IsWrite
+  );
+
+/**
+  The function is to Read Block from SCSI Disk through Block I/O2 protocol.
+
+  If Token->Event is not NULL, the read is split into SCSI commands of at most
+  SCSI_DISK_ASYNC_TRANSFER_LENGTH bytes, which are executed concurrently.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer to fill the read out data
+
+  @retval EFI_SUCCESS           The read request was queued if Token->Event is not
+                                NULL. The data was read correctly from the device
+                                if Token->Event is NULL.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+     OUT VOID                   *Buffer
+  );
+
+/**
+  The function is to Write Block to SCSI Disk through Block I/O2 protocol.
+
+  If Token->Event is not NULL, the write is split into SCSI commands of at most
+  SCSI_DISK_ASYNC_TRANSFER_LENGTH bytes, which are executed concurrently.
+
+  @param  This       The pointer of EFI_BLOCK_IO2_PROTOCOL.
+  @param  MediaId    The Id of Media detected
+  @param  Lba        The logic block address
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of Buffer
+  @param  Buffer     The buffer of data to be written into SCSI Disk
+
+  @retval EFI_SUCCESS           The write request was queued if Token->Event is not
+                                NULL. The data was written correctly to the device
+                                if Token->Event is NULL.
+  @retval EFI_DEVICE_ERROR      Fail to detect media.
+  @retval EFI_NO_MEDIA          Media is not present.
+  @retval EFI_MEDIA_CHANGED     Media has changed.
+  @retval EFI_BAD_BUFFER_SIZE   The Buffer was not a multiple of the block size of the device.
+  @retval EFI_INVALID_PARAMETER Invalid parameter passed in.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be completed due to a lack
+                                of resources.
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  );
+
+/**
+  Flush Block to Disk through Block I/O2 protocol.
+
+  The non-blocking requests in flight are completed before the Token is signaled.
+
+  @param  This              The pointer of EFI_BLOCK_IO2_PROTOCOL
+  @param  Token             A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All outstanding data was written to the device
+  @retval EFI_DEVICE_ERROR  The non-blocking requests in flight do not complete in time
+
+**/
+EFI_STATUS
+EFIAPI
+ScsiDiskFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  );
+
 
 /**
   Provides inquiry information for the controller type.
@@ -717,6 +925,111 @@ ScsiDiskWriteSectors (
   IN  UINTN             NumberOfBlocks
   );
 
+/**
+  Read or write sectors of SCSI Disk with non-blocking SCSI commands.
+
+  The transfer is split into SCSI commands of at most SCSI_DISK_ASYNC_TRANSFER_LENGTH
+  bytes. Up to SCSI_DISK_MAX_ASYNC_COMMANDS of them are executed at the same time,
+  and Token->Event is signaled when all of them are completed.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Buffer          The buffer of the data
+  @param  Lba             Logic block address
+  @param  NumberOfBlocks  The number of blocks to transfer
+  @param  IsWrite         Indicates whether it is a write operation
+  @param  Token           A pointer to the token associated with the transaction
+
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued due to a lack of resources.
+  @retval EFI_SUCCESS           The request is queued.
+
+**/
+EFI_STATUS
+ScsiDiskAsyncTransferSectors (
+  IN     SCSI_DISK_DEV        *ScsiDiskDevice,
+  IN     VOID                 *Buffer,
+  IN     EFI_LBA              Lba,
+  IN     UINTN                NumberOfBlocks,
+  IN     BOOLEAN              IsWrite,
+  IN OUT EFI_BLOCK_IO2_TOKEN  *Token
+  );
+
+/**
+  Wait until all the non-blocking requests of SCSI Disk are completed.
+
+  The wait gives up when none of the SCSI commands in flight completes within
+  the longest of their timeouts.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+  @retval EFI_SUCCESS     All the non-blocking requests are completed.
+  @retval EFI_TIMEOUT     The SCSI commands in flight do not complete in time.
+
+**/
+EFI_STATUS
+ScsiDiskWaitAsyncRequests (
+  IN  SCSI_DISK_DEV     *ScsiDiskDevice
+  );
+
+/**
+  Submit a non-blocking Read/Write(10) or Read/Write(16) command of a BlockIo2 request.
+
+  @param  Command         The pointer of SCSI_ASYNC_COMMAND
+
+  @return  EFI_STATUS is returned by calling EFI_SCSI_IO_PROTOCOL.ExecuteScsiCommand().
+
+**/
+EFI_STATUS
+ScsiDiskAsyncSubmitCommand (
+  IN  SCSI_ASYNC_COMMAND  *Command
+  );
+
+/**
+  Remove a SCSI command from its BlockIo2 request, and complete the request
+  if it has no more commands.
+
+  The caller must be at TPL_NOTIFY.
+
+  @param  Command         The pointer of SCSI_ASYNC_COMMAND
+  @param  Status          The status of the command
+
+**/
+VOID
+ScsiDiskAsyncFinishCommand (
+  IN  SCSI_ASYNC_COMMAND  *Command,
+  IN  EFI_STATUS          Status
+  );
+
+/**
+  Submit the queued SCSI commands of the BlockIo2 requests of SCSI Disk, in order,
+  while less than SCSI_DISK_MAX_ASYNC_COMMANDS of them are in flight.
+
+  The caller must be at TPL_NOTIFY.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskAsyncSubmitCommands (
+  IN  SCSI_DISK_DEV       *ScsiDiskDevice
+  );
+
+/**
+  Call back function when a non-blocking SCSI command completes.
+
+  The command is submitted again if it fails with a status which needs a retry,
+  or if the device transfers less data than requested.
+
+  @param  Event           The Event this notify function registered to.
+  @param  Context         Pointer to the SCSI_ASYNC_COMMAND.
+
+**/
+VOID
+EFIAPI
+ScsiDiskAsyncCommandNotify (
+  IN  EFI_EVENT           Event,
+  IN  VOID                *Context
+  );
+
 /**
   Submit Read(10) command.
 
@@ -10,8 +10,11 @@
 
   Step #2 - Dispatch. Remove driver from the mScheduledQueue and load and
             start it. After mScheduledQueue is drained check the
-            mDiscoveredList to see if any item has a Depex that is ready to
-            be placed on the mScheduledQueue.
+            mDepexEvaluationQueue to see if any item has a Depex that is ready
+            to be placed on the mScheduledQueue. A driver is only placed on the
+            mDepexEvaluationQueue when it is discovered or requested, or when a
+            protocol its Depex refers to is installed or uninstalled, so the
+            Depex of a waiting driver is not evaluated again on every pass.
 
   Step #3 - Adding to the mScheduledQueue requires that you process Before
             and After dependencies. This is done recursively as the call to add
@@ -57,7 +60,56 @@ LIST_ENTRY  mScheduledQueue = INITIALIZE_LIST_HEAD_VARIABLE (mScheduledQueue);
 LIST_ENTRY  mFvHandleList = INITIALIZE_LIST_HEAD_VARIABLE (mFvHandleList);           // list of KNOWN_HANDLE
 
 //
-// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning.
+// Queue of drivers whose Depex needs to be evaluated, in the order they were
+// discovered. This queue is a subset of the mDiscoveredList. List of EFI_CORE_DRIVER_ENTRY.
+//
+LIST_ENTRY  mDepexEvaluationQueue = INITIALIZE_LIST_HEAD_VARIABLE (mDepexEvaluationQueue);
+
+//
+// Drivers without a Depex that are waiting for all the architectural protocols.
+// List of EFI_CORE_DRIVER_ENTRY.
+//
+LIST_ENTRY  mEfiServicesDependentQueue = INITIALIZE_LIST_HEAD_VARIABLE (mEfiServicesDependentQueue);
+
+//
+// The dependency graph. The protocols that are referred to by a Depex, hashed
+// by protocol GUID. List of DEPEX_PROTOCOL_ENTRY.
+//
+#define DEPEX_PROTOCOL_HASH_BUCKET_COUNT  64
+LIST_ENTRY  mDepexProtocolHashTable[DEPEX_PROTOCOL_HASH_BUCKET_COUNT];
+
+#define DEPEX_PROTOCOL_ENTRY_SIGNATURE  SIGNATURE_32('d','p','x','p')
+typedef struct {
+  UINTN                   Signature;
+  LIST_ENTRY              Link;         // mDepexProtocolHashTable
+  EFI_GUID                ProtocolGuid;
+  LIST_ENTRY              DriverList;   // List of DEPEX_DRIVER_LINK
+} DEPEX_PROTOCOL_ENTRY;
+
+#define DEPEX_DRIVER_LINK_SIGNATURE  SIGNATURE_32('d','p','x','d')
+typedef struct {
+  UINTN                   Signature;
+  LIST_ENTRY              Link;         // DEPEX_PROTOCOL_ENTRY.DriverList
+  EFI_CORE_DRIVER_ENTRY   *DriverEntry;
+} DEPEX_DRIVER_LINK;
+
+//
+// TRUE if the Depex of a driver could not be added to the dependency graph. The
+// protocol notifications are then incomplete, so every pass of the dispatcher
+// evaluates the Depex of all the dependent drivers.
+//
+BOOLEAN  mDepexGraphIncomplete = FALSE;
+
+//
+// Number of drivers discovered and dispatched so far.
+//
+UINTN   mDiscoveredDriverCount = 0;
+UINT32  mDispatchedDriverCount = 0;
+
+//
+// Lock for mDiscoveredList, mScheduledQueue, mDepexEvaluationQueue,
+// mEfiServicesDependentQueue, mDepexProtocolHashTable, mDepexGraphIncomplete,
+// gDispatcherRunning.
 //
 EFI_LOCK  mDispatcherLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 
@@ -229,6 +281,229 @@ CoreReleaseDispatcherLock (
 }
 
 
+/**
+  Get the mDepexProtocolHashTable bucket of a protocol GUID.
+
+  @param  Protocol              The protocol GUID.
+
+  @return The bucket that holds the DEPEX_PROTOCOL_ENTRY of Protocol.
+
+**/
+LIST_ENTRY *
+CoreGetDepexProtocolHashBucket (
+  IN EFI_GUID   *Protocol
+  )
+{
+  UINT32              Hash;
+  UINTN               Index;
+
+  //
+  // The hash table is set up on first use
+  //
+  if (mDepexProtocolHashTable[0].ForwardLink == NULL) {
+    for (Index = 0; Index < DEPEX_PROTOCOL_HASH_BUCKET_COUNT; Index++) {
+      InitializeListHead (&mDepexProtocolHashTable[Index]);
+    }
+  }
+
+  Hash  = ReadUnaligned32 ((UINT32 *) Protocol);
+  Hash ^= ReadUnaligned32 ((UINT32 *) Protocol + 1);
+  Hash ^= ReadUnaligned32 ((UINT32 *) Protocol + 2);
+  Hash ^= ReadUnaligned32 ((UINT32 *) Protocol + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return &mDepexProtocolHashTable[Hash % DEPEX_PROTOCOL_HASH_BUCKET_COUNT];
+}
+
+
+/**
+  Find the DEPEX_PROTOCOL_ENTRY of a protocol GUID in the dependency graph.
+  The caller must hold mDispatcherLock.
+
+  @param  Protocol              The protocol GUID.
+
+  @return The DEPEX_PROTOCOL_ENTRY of Protocol, or NULL if no Depex refers to it.
+
+**/
+DEPEX_PROTOCOL_ENTRY *
+CoreFindDepexProtocolEntry (
+  IN EFI_GUID   *Protocol
+  )
+{
+  LIST_ENTRY            *Bucket;
+  LIST_ENTRY            *Link;
+  DEPEX_PROTOCOL_ENTRY  *ProtocolEntry;
+
+  ASSERT_LOCKED (&mDispatcherLock);
+
+  Bucket = CoreGetDepexProtocolHashBucket (Protocol);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    ProtocolEntry = CR (Link, DEPEX_PROTOCOL_ENTRY, Link, DEPEX_PROTOCOL_ENTRY_SIGNATURE);
+    if (CompareGuid (&ProtocolEntry->ProtocolGuid, Protocol)) {
+      return ProtocolEntry;
+    }
+  }
+
+  return NULL;
+}
+
+
+/**
+  Add the protocols referred to by the PUSH opcodes of a Depex to the dependency
+  graph, so the driver is queued for evaluation when one of them is installed or
+  uninstalled.
+
+  @param  DriverEntry           Driver whose Depex has been read.
+
+**/
+VOID
+CoreAddDepexToDependencyGraph (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  UINT8                 *Iterator;
+  UINT8                 *End;
+  EFI_GUID              ProtocolGuid;
+  DEPEX_PROTOCOL_ENTRY  *ProtocolEntry;
+  DEPEX_PROTOCOL_ENTRY  *NewProtocolEntry;
+  DEPEX_DRIVER_LINK     *DriverLink;
+
+  NewProtocolEntry = NULL;
+
+  Iterator = DriverEntry->Depex;
+  End      = Iterator + DriverEntry->DepexSize;
+  while (Iterator < End && *Iterator != EFI_DEP_END) {
+    if (*Iterator != EFI_DEP_PUSH && *Iterator != EFI_DEP_BEFORE && *Iterator != EFI_DEP_AFTER) {
+      Iterator++;
+      continue;
+    }
+
+    if ((UINTN) (End - Iterator) < sizeof (EFI_GUID) + 1) {
+      break;
+    }
+
+    if (*Iterator == EFI_DEP_PUSH) {
+      CopyMem (&ProtocolGuid, Iterator + 1, sizeof (EFI_GUID));
+
+      //
+      // Memory can not be allocated while the dispatcher lock is held, so
+      // allocate a protocol entry in case the protocol is not in the graph yet.
+      //
+      if (NewProtocolEntry == NULL) {
+        NewProtocolEntry = AllocatePool (sizeof (DEPEX_PROTOCOL_ENTRY));
+      }
+      DriverLink = AllocatePool (sizeof (DEPEX_DRIVER_LINK));
+      if (NewProtocolEntry == NULL || DriverLink == NULL) {
+        //
+        // Fall back to evaluating all the dependent drivers in every pass
+        //
+        DEBUG ((DEBUG_ERROR, "Fail to add Depex of FFS(%g) to dependency graph\n", &DriverEntry->FileName));
+        if (DriverLink != NULL) {
+          FreePool (DriverLink);
+        }
+        CoreAcquireDispatcherLock ();
+        mDepexGraphIncomplete = TRUE;
+        CoreReleaseDispatcherLock ();
+        break;
+      }
+
+      DriverLink->Signature   = DEPEX_DRIVER_LINK_SIGNATURE;
+      DriverLink->DriverEntry = DriverEntry;
+
+      CoreAcquireDispatcherLock ();
+
+      ProtocolEntry = CoreFindDepexProtocolEntry (&ProtocolGuid);
+      if (ProtocolEntry == NULL) {
+        ProtocolEntry = NewProtocolEntry;
+        NewProtocolEntry = NULL;
+
+        ProtocolEntry->Signature = DEPEX_PROTOCOL_ENTRY_SIGNATURE;
+        CopyGuid (&ProtocolEntry->ProtocolGuid, &ProtocolGuid);
+        InitializeListHead (&ProtocolEntry->DriverList);
+        InsertTailList (CoreGetDepexProtocolHashBucket (&ProtocolGuid), &ProtocolEntry->Link);
+      }
+      InsertTailList (&ProtocolEntry->DriverList, &DriverLink->Link);
+
+      CoreReleaseDispatcherLock ();
+    }
+
+    Iterator += sizeof (EFI_GUID) + 1;
+  }
+
+  if (NewProtocolEntry != NULL) {
+    FreePool (NewProtocolEntry);
+  }
+}
+
+
+/**
+  Put a driver on the mDepexEvaluationQueue, if it is not already there. The
+  queue is kept in the order the drivers were discovered, so the drivers that
+  become ready in the same pass are scheduled in that order.
+  The caller must hold mDispatcherLock.
+
+  @param  DriverEntry           Driver whose Depex needs to be evaluated.
+
+**/
+VOID
+CoreQueueDepexEvaluation (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  LIST_ENTRY            *Link;
+  EFI_CORE_DRIVER_ENTRY *QueuedEntry;
+
+  ASSERT_LOCKED (&mDispatcherLock);
+
+  if (DriverEntry->DepexEvaluationLink.ForwardLink != NULL) {
+    return;
+  }
+
+  for (Link = mDepexEvaluationQueue.BackLink; Link != &mDepexEvaluationQueue; Link = Link->BackLink) {
+    QueuedEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, DepexEvaluationLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    if (QueuedEntry->DiscoveredOrder < DriverEntry->DiscoveredOrder) {
+      break;
+    }
+  }
+
+  InsertHeadList (Link, &DriverEntry->DepexEvaluationLink);
+}
+
+
+/**
+  Queue the drivers whose dependency expressions refer to a protocol for
+  evaluation by the next pass of the dispatcher. It is called whenever an
+  interface of the protocol is installed or uninstalled.
+
+  @param  Protocol              The protocol that was installed or uninstalled.
+
+**/
+VOID
+CoreNotifyDepexProtocol (
+  IN EFI_GUID   *Protocol
+  )
+{
+  DEPEX_PROTOCOL_ENTRY  *ProtocolEntry;
+  LIST_ENTRY            *Link;
+  DEPEX_DRIVER_LINK     *DriverLink;
+
+  CoreAcquireDispatcherLock ();
+
+  ProtocolEntry = CoreFindDepexProtocolEntry (Protocol);
+  if (ProtocolEntry != NULL) {
+    for (Link = ProtocolEntry->DriverList.ForwardLink; Link != &ProtocolEntry->DriverList; Link = Link->ForwardLink) {
+      DriverLink = CR (Link, DEPEX_DRIVER_LINK, Link, DEPEX_DRIVER_LINK_SIGNATURE);
+      if (DriverLink->DriverEntry->Dependent) {
+        CoreQueueDepexEvaluation (DriverLink->DriverEntry);
+      }
+    }
+  }
+
+  CoreReleaseDispatcherLock ();
+}
+
+
 /**
   Read Depex and pre-process the Depex for Before and After. If Section Extraction
   protocol returns an error via ReadSection defer the reading of the Depex.
@@ -288,6 +563,10 @@ CoreGetDepexSectionAndPreProccess (
     //
     CorePreProcessDepex (DriverEntry);
     DriverEntry->DepexProtocolError = FALSE;
+
+    if (!DriverEntry->Before && !DriverEntry->After) {
+      CoreAddDepexToDependencyGraph (DriverEntry);
+    }
   }
 
   return Status;
@@ -332,6 +611,7 @@ CoreSchedule (
       CoreAcquireDispatcherLock ();
       DriverEntry->Unrequested  = FALSE;
       DriverEntry->Dependent    = TRUE;
+      CoreQueueDepexEvaluation (DriverEntry);
       CoreReleaseDispatcherLock ();
 
       DEBUG ((DEBUG_DISPATCH, "Schedule FFS(%g) - EFI_SUCCESS\n", DriverName));
@@ -414,7 +694,7 @@ CoreEmptyCallbackFunction (
 /**
   This is the main Dispatcher for DXE and it exits when there are no more
   drivers to run. Drain the mScheduledQueue and load and start a PE
-  image for each driver. Search the mDiscoveredList to see if any driver can
+  image for each driver. Search the mDepexEvaluationQueue to see if any driver can
   be placed on the mScheduledQueue. If no drivers are placed on the
   mScheduledQueue exit the function. On exit it is assumed the Bds()
   will be called, and when the Bds() exits the Dispatcher will be called
@@ -433,9 +713,11 @@ CoreDispatcher (
 {
   EFI_STATUS                      Status;
   EFI_STATUS                      ReturnStatus;
+  LIST_ENTRY                      EvaluationList;
   LIST_ENTRY                      *Link;
   EFI_CORE_DRIVER_ENTRY           *DriverEntry;
   BOOLEAN                         ReadyToRun;
+  BOOLEAN                         Schedulable;
   EFI_EVENT                       DxeDispatchEvent;
   
 
@@ -526,6 +808,7 @@ CoreDispatcher (
 
       DriverEntry->Scheduled    = FALSE;
       DriverEntry->Initialized  = TRUE;
+      DriverEntry->DispatchOrder = ++mDispatchedDriverCount;
       RemoveEntryList (&DriverEntry->ScheduledLink);
 
       CoreReleaseDispatcherLock ();
@@ -544,6 +827,16 @@ CoreDispatcher (
           sizeof (DriverEntry->ImageHandle)
           );
         ASSERT (DriverEntry->ImageHandle != NULL);
+
+        //
+        // Record the evaluation of the Depex that made the driver ready, tagged
+        // with the dispatch order of the driver. The drivers scheduled by the
+        // A Priori file or by BEFORE/AFTER have no Depex evaluation to record.
+        //
+        if (DriverEntry->DepexStartTick != 0) {
+          PERF_START_EX (DriverEntry->ImageHandle, "Depex:", NULL, DriverEntry->DepexStartTick, DriverEntry->DispatchOrder);
+          PERF_END_EX (DriverEntry->ImageHandle, "Depex:", NULL, DriverEntry->DepexEndTick, DriverEntry->DispatchOrder);
+        }
   
         Status = CoreStartImage (DriverEntry->ImageHandle, NULL, NULL);
   
@@ -568,23 +861,92 @@ CoreDispatcher (
     }
 
     //
-    // Search DriverList for items to place on Scheduled Queue
+    // Search the Depex Evaluation Queue for items to place on Scheduled Queue.
+    // The queue is moved to a local list first, so the drivers queued while
+    // it is processed are left for the next pass.
     //
+    CoreAcquireDispatcherLock ();
+
+    if (!IsListEmpty (&mEfiServicesDependentQueue) && !EFI_ERROR (CoreAllEfiServicesAvailable ())) {
+      while (!IsListEmpty (&mEfiServicesDependentQueue)) {
+        DriverEntry = CR (
+                        mEfiServicesDependentQueue.ForwardLink,
+                        EFI_CORE_DRIVER_ENTRY,
+                        DepexEvaluationLink,
+                        EFI_CORE_DRIVER_ENTRY_SIGNATURE
+                        );
+        RemoveEntryList (&DriverEntry->DepexEvaluationLink);
+        DriverEntry->DepexEvaluationLink.ForwardLink = NULL;
+        CoreQueueDepexEvaluation (DriverEntry);
+      }
+    }
+
+    if (mDepexGraphIncomplete) {
+      for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
+        DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+        if (DriverEntry->Dependent) {
+          CoreQueueDepexEvaluation (DriverEntry);
+        }
+      }
+    }
+
+    InitializeListHead (&EvaluationList);
+    if (!IsListEmpty (&mDepexEvaluationQueue)) {
+      EvaluationList.ForwardLink            = mDepexEvaluationQueue.ForwardLink;
+      EvaluationList.BackLink               = mDepexEvaluationQueue.BackLink;
+      EvaluationList.ForwardLink->BackLink  = &EvaluationList;
+      EvaluationList.BackLink->ForwardLink  = &EvaluationList;
+      InitializeListHead (&mDepexEvaluationQueue);
+    }
+
+    CoreReleaseDispatcherLock ();
+
     ReadyToRun = FALSE;
-    for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
-      DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    while (!IsListEmpty (&EvaluationList)) {
+      DriverEntry = CR (
+                      EvaluationList.ForwardLink,
+                      EFI_CORE_DRIVER_ENTRY,
+                      DepexEvaluationLink,
+                      EFI_CORE_DRIVER_ENTRY_SIGNATURE
+                      );
+
+      CoreAcquireDispatcherLock ();
+      RemoveEntryList (&DriverEntry->DepexEvaluationLink);
+      DriverEntry->DepexEvaluationLink.ForwardLink = NULL;
+      CoreReleaseDispatcherLock ();
 
       if (DriverEntry->DepexProtocolError){
         //
         // If Section Extraction Protocol did not let the Depex be read before retry the read
         //
         Status = CoreGetDepexSectionAndPreProccess (DriverEntry);
+        if (DriverEntry->DepexProtocolError) {
+          CoreAcquireDispatcherLock ();
+          CoreQueueDepexEvaluation (DriverEntry);
+          CoreReleaseDispatcherLock ();
+          continue;
+        }
       }
 
       if (DriverEntry->Dependent) {
-        if (CoreIsSchedulable (DriverEntry)) {
+        PERF_CODE (
+          DriverEntry->DepexStartTick = GetPerformanceCounter ();
+        );
+        Schedulable = CoreIsSchedulable (DriverEntry);
+        PERF_CODE (
+          DriverEntry->DepexEndTick = GetPerformanceCounter ();
+        );
+
+        if (Schedulable) {
           CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (DriverEntry);
           ReadyToRun = TRUE;
+        } else if (DriverEntry->Depex == NULL) {
+          //
+          // A driver without a Depex waits for the architectural protocols
+          //
+          CoreAcquireDispatcherLock ();
+          InsertTailList (&mEfiServicesDependentQueue, &DriverEntry->DepexEvaluationLink);
+          CoreReleaseDispatcherLock ();
         }
       } else {
         if (DriverEntry->Unrequested) {
@@ -914,6 +1276,10 @@ CoreAddToDriverList (
   CoreAcquireDispatcherLock ();
 
   InsertTailList (&mDiscoveredList, &DriverEntry->Link);
+  DriverEntry->DiscoveredOrder = mDiscoveredDriverCount++;
+  if (DriverEntry->Dependent || DriverEntry->DepexProtocolError) {
+    CoreQueueDepexEvaluation (DriverEntry);
+  }
 
   CoreReleaseDispatcherLock ();
 
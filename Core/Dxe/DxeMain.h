@@ -71,6 +71,9 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Ppi/VectorHandoffInfo.h>
 #include <Guid/ZeroGuid.h>
 #include <Guid/MemoryProfile.h>
+#include <Guid/ProtocolDatabaseStatistics.h>
+#include <Guid/SectionStreamCacheStatistics.h>
+#include <Guid/FvFileIndexHob.h>
 
 #include <Library/DxeCoreEntryPoint.h>
 #include <Library/DebugLib.h>
@@ -174,6 +177,12 @@ typedef struct {
   EFI_HANDLE                      ImageHandle;
   BOOLEAN                         IsFvImage;
 
+  LIST_ENTRY                      DepexEvaluationLink;  // mDepexEvaluationQueue
+  UINTN                           DiscoveredOrder;
+  UINT32                          DispatchOrder;
+  UINT64                          DepexStartTick;
+  UINT64                          DepexEndTick;
+
 } EFI_CORE_DRIVER_ENTRY;
 
 //
@@ -269,6 +278,8 @@ extern EFI_GUID                                 *gDxeCoreFileName;
 extern EFI_LOADED_IMAGE_PROTOCOL                *gDxeCoreLoadedImage;
 
 extern EFI_MEMORY_TYPE_INFORMATION              gMemoryTypeInformation[EfiMaxMemoryType + 1];
+extern PROTOCOL_DATABASE_STATISTICS             gProtocolDatabaseStatistics;
+extern SECTION_STREAM_CACHE_STATISTICS          gSectionStreamCacheStatistics;
 
 extern BOOLEAN                                  gDispatcherRunning;
 extern EFI_RUNTIME_ARCH_PROTOCOL                gRuntimeTemplate;
@@ -469,6 +480,20 @@ CoreInitializeDispatcher (
   );
 
 
+/**
+  Queue the drivers whose dependency expressions refer to a protocol for
+  evaluation by the next pass of the dispatcher. It is called whenever an
+  interface of the protocol is installed or uninstalled.
+
+  @param  Protocol              The protocol that was installed or uninstalled.
+
+**/
+VOID
+CoreNotifyDepexProtocol (
+  IN EFI_GUID   *Protocol
+  );
+
+
 /**
   This is the POSTFIX version of the dependency evaluator.  This code does
   not need to handle Before or After, as it is not valid to call this
@@ -2052,7 +2077,7 @@ CoreGetIoSpaceMap (
 /**
   This is the main Dispatcher for DXE and it exits when there are no more
   drivers to run. Drain the mScheduledQueue and load and start a PE
-  image for each driver. Search the mDiscoveredList to see if any driver can
+  image for each driver. Search the mDepexEvaluationQueue to see if any driver can
   be placed on the mScheduledQueue. If no drivers are placed on the
   mScheduledQueue exit the function. On exit it is assumed the Bds()
   will be called, and when the Bds() exits the Dispatcher will be called
@@ -2842,6 +2867,20 @@ CoreUpdateProfile (
   IN VOID                   *Buffer
   );
 
+/**
+  Get the statistics of the pool slab allocator.
+
+  @param  SlabClass             Buffer to receive one record for each slab size
+                                class. It may be NULL to get the record count only.
+
+  @return The number of slab size classes.
+
+**/
+UINTN
+CoreGetPoolSlabStatistics (
+  OUT MEMORY_PROFILE_POOL_SLAB_CLASS  *SlabClass OPTIONAL
+  );
+
 /**
   Internal function.  Converts a memory range to use new attributes.
 
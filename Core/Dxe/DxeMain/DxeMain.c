@@ -328,6 +328,18 @@ DxeMain (
   Status = CoreInstallConfigurationTable (&gEfiMemoryTypeInformationGuid, &gMemoryTypeInformation);
   ASSERT_EFI_ERROR (Status);
 
+  //
+  // Install the live Protocol Database Statistics into the EFI System Tables's Configuration Table
+  //
+  Status = CoreInstallConfigurationTable (&gEdkiiProtocolDatabaseStatisticsGuid, &gProtocolDatabaseStatistics);
+  ASSERT_EFI_ERROR (Status);
+
+  //
+  // Install the live Section Stream Cache Statistics into the EFI System Tables's Configuration Table
+  //
+  Status = CoreInstallConfigurationTable (&gEdkiiSectionStreamCacheStatisticsGuid, &gSectionStreamCacheStatistics);
+  ASSERT_EFI_ERROR (Status);
+
   //
   // If Loading modules At fixed address feature is enabled, install Load moduels at fixed address
   // Configuration Table so that user could easily to retrieve the top address to load Dxe and PEI
@@ -1,6 +1,11 @@
 /** @file
   Core Timer Services
 
+  The timer database is a hashed timing wheel. Each slot of the wheel covers
+  2^TIMER_WHEEL_SLOT_SHIFT units of 100ns, and holds the timers whose trigger
+  time falls into it, modulo the size of the wheel. The timers of a slot are not
+  sorted, so setting and canceling a timer take constant time.
+
 Copyright (c) 2006 - 2013, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
@@ -16,20 +21,98 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "DxeMain.h"
 #include "Event.h"
 
+#define TIMER_WHEEL_SLOT_SHIFT  16
+#define TIMER_WHEEL_SLOT_SIZE   LShiftU64 (1, TIMER_WHEEL_SLOT_SHIFT)
+#define TIMER_WHEEL_SLOT_COUNT  256
+
+#define TIME_TO_TIMER_WHEEL_INDEX(a)  RShiftU64 ((a), TIMER_WHEEL_SLOT_SHIFT)
+#define TIME_TO_TIMER_WHEEL_SLOT(a)   ((UINTN) TIME_TO_TIMER_WHEEL_INDEX (a) & (TIMER_WHEEL_SLOT_COUNT - 1))
+
+#define TIMER_WHEEL_SLOT_BIT(a)       LShiftU64 (1, (a) % 64)
+
+//
+// The trigger time used when no timer is queued
+//
+#define TIMER_NOT_TRIGGERED           ((UINT64) -1)
+
 //
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+LIST_ENTRY       mEfiTimerWheel[TIMER_WHEEL_SLOT_COUNT];
+UINT64           mEfiTimerWheelBitmap[TIMER_WHEEL_SLOT_COUNT / 64];
+UINT64           mEfiTimerWheelTime = 0;
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+//
+// The earliest trigger time of the queued timers. It is protected by
+// mEfiSystemTimeLock, since it is checked on every timer tick.
+//
+UINT64           mEfiTimerNextTriggerTime = TIMER_NOT_TRIGGERED;
+
 //
 // Timer functions
 //
+
+/**
+  Round a trigger time up to the end of its timer wheel slot, if timer
+  coalescing is enabled.
+
+  With timer coalescing, all the timers that expire in the same slot of the
+  timer wheel are signaled by the same timer tick, instead of each of them
+  waking up the timer check on its own. A periodic timer whose period is shorter
+  than a slot is not coalesced, since that would stretch its period to the slot.
+
+  @param  TriggerTime            The trigger time to round.
+  @param  Period                 The period of the timer, or 0 for a one-shot timer.
+
+  @return The trigger time the timer is queued with.
+
+**/
+UINT64
+CoreCoalesceTriggerTime (
+  IN UINT64   TriggerTime,
+  IN UINT64   Period
+  )
+{
+  UINT64          SlotMask;
+
+  if (!FeaturePcdGet (PcdDxeTimerCoalescing)) {
+    return TriggerTime;
+  }
+
+  if (Period != 0 && Period < TIMER_WHEEL_SLOT_SIZE) {
+    return TriggerTime;
+  }
+
+  SlotMask = TIMER_WHEEL_SLOT_SIZE - 1;
+  if ((TriggerTime | SlotMask) == TIMER_NOT_TRIGGERED) {
+    return TriggerTime;
+  }
+
+  return TriggerTime | SlotMask;
+}
+
+/**
+  Update the earliest trigger time of the queued timers.
+
+  @param  TriggerTime            The new earliest trigger time.
+
+**/
+VOID
+CoreSetNextTriggerTime (
+  IN UINT64   TriggerTime
+  )
+{
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerNextTriggerTime = TriggerTime;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
 /**
   Inserts the timer event.
 
@@ -43,8 +126,7 @@ CoreInsertEventTimer (
   )
 {
   UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  UINTN           Slot;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
@@ -54,17 +136,40 @@ CoreInsertEventTimer (
   TriggerTime = Event->Timer.TriggerTime;
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Insert the timer into the slot of the timer wheel its trigger time falls into
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  Slot = TIME_TO_TIMER_WHEEL_SLOT (TriggerTime);
+  InsertTailList (&mEfiTimerWheel[Slot], &Event->Timer.Link);
+  mEfiTimerWheelBitmap[Slot / 64] |= TIMER_WHEEL_SLOT_BIT (Slot);
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
-      break;
-    }
+  if (TriggerTime < mEfiTimerNextTriggerTime) {
+    CoreSetNextTriggerTime (TriggerTime);
   }
+}
+
+/**
+  Removes the timer event from the timer database.
+
+  @param  Event                  Points to the internal structure of timer event
+                                 to be removed
 
-  InsertTailList (Link, &Event->Timer.Link);
+**/
+VOID
+CoreRemoveEventTimer (
+  IN IEVENT   *Event
+  )
+{
+  UINTN           Slot;
+
+  ASSERT_LOCKED (&mEfiTimerLock);
+
+  Slot = TIME_TO_TIMER_WHEEL_SLOT (Event->Timer.TriggerTime);
+  RemoveEntryList (&Event->Timer.Link);
+  Event->Timer.Link.ForwardLink = NULL;
+
+  if (IsListEmpty (&mEfiTimerWheel[Slot])) {
+    mEfiTimerWheelBitmap[Slot / 64] &= ~TIMER_WHEEL_SLOT_BIT (Slot);
+  }
 }
 
 /**
@@ -88,7 +193,49 @@ CoreCurrentSystemTime (
 }
 
 /**
-  Checks the sorted timer list against the current system time.
+  Find the start time of the first non-empty slot after the slot of the current
+  time.
+
+  The slots are found from the bitmap of the timer wheel, so the timers of the
+  slots are not walked. The slot of the current time is found last, and then
+  stands for its next turn.
+
+  @param  SystemTime             The current system time.
+
+  @return The start time of the slot, or TIMER_NOT_TRIGGERED if the wheel is empty.
+
+**/
+UINT64
+CoreFindNextTimerWheelSlotTime (
+  IN UINT64   SystemTime
+  )
+{
+  UINTN           Slot;
+  UINTN           Distance;
+  UINTN           Index;
+  UINT64          Bits;
+
+  Slot     = TIME_TO_TIMER_WHEEL_SLOT (SystemTime);
+  Distance = 1;
+  while (Distance <= TIMER_WHEEL_SLOT_COUNT) {
+    Index = (Slot + Distance) % TIMER_WHEEL_SLOT_COUNT;
+    Bits  = RShiftU64 (mEfiTimerWheelBitmap[Index / 64], Index % 64);
+    if (Bits != 0) {
+      Distance += (UINTN) LowBitSet64 (Bits);
+      if (Distance > TIMER_WHEEL_SLOT_COUNT) {
+        break;
+      }
+      return LShiftU64 (TIME_TO_TIMER_WHEEL_INDEX (SystemTime) + Distance, TIMER_WHEEL_SLOT_SHIFT);
+    }
+
+    Distance += 64 - Index % 64;
+  }
+
+  return TIMER_NOT_TRIGGERED;
+}
+
+/**
+  Checks the timer wheel against the current system time.
   Signals any expired event timer.
 
   @param  CheckEvent             Not used
@@ -103,6 +250,13 @@ CoreCheckTimers (
   )
 {
   UINT64                  SystemTime;
+  UINT64                  NextTriggerTime;
+  UINT64                  SlotCount;
+  UINTN                   Slot;
+  UINTN                   Index;
+  LIST_ENTRY              ExpiredList;
+  LIST_ENTRY              *Link;
+  LIST_ENTRY              *ExpiredLink;
   IEVENT                  *Event;
 
   //
@@ -111,18 +265,75 @@ CoreCheckTimers (
   CoreAcquireLock (&mEfiTimerLock);
   SystemTime = CoreCurrentSystemTime ();
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  //
+  // Visit the slots from the one of the last check up to the one of the current
+  // time. If the wheel has turned since the last check, every slot is visited once.
+  //
+  SlotCount = TIME_TO_TIMER_WHEEL_INDEX (SystemTime) - TIME_TO_TIMER_WHEEL_INDEX (mEfiTimerWheelTime) + 1;
+  if (SlotCount > TIMER_WHEEL_SLOT_COUNT) {
+    SlotCount = TIMER_WHEEL_SLOT_COUNT;
+  }
+  Slot = TIME_TO_TIMER_WHEEL_SLOT (mEfiTimerWheelTime);
+
+  NextTriggerTime = TIMER_NOT_TRIGGERED;
+  InitializeListHead (&ExpiredList);
+  for (Index = 0; Index < (UINTN) SlotCount; Index++) {
+    if ((mEfiTimerWheelBitmap[Slot / 64] & TIMER_WHEEL_SLOT_BIT (Slot)) != 0) {
+      Link = mEfiTimerWheel[Slot].ForwardLink;
+      while (Link != &mEfiTimerWheel[Slot]) {
+        Event = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+        Link  = Link->ForwardLink;
+
+        if (Event->Timer.TriggerTime > SystemTime) {
+          if (Event->Timer.TriggerTime < NextTriggerTime) {
+            NextTriggerTime = Event->Timer.TriggerTime;
+          }
+          continue;
+        }
+
+        //
+        // Move the expired timer to the expired list, which is kept sorted by
+        // trigger time. Timers with the same trigger time stay in the order they
+        // were set, as the slots are visited in time order and filled in that order.
+        //
+        RemoveEntryList (&Event->Timer.Link);
+        ExpiredLink = ExpiredList.BackLink;
+        while (ExpiredLink != &ExpiredList &&
+               CR (ExpiredLink, IEVENT, Timer.Link, EVENT_SIGNATURE)->Timer.TriggerTime > Event->Timer.TriggerTime) {
+          ExpiredLink = ExpiredLink->BackLink;
+        }
+        InsertHeadList (ExpiredLink, &Event->Timer.Link);
+      }
 
-    //
-    // If this timer is not expired, then we're done
-    //
-    if (Event->Timer.TriggerTime > SystemTime) {
-      break;
+      if (IsListEmpty (&mEfiTimerWheel[Slot])) {
+        mEfiTimerWheelBitmap[Slot / 64] &= ~TIMER_WHEEL_SLOT_BIT (Slot);
+      }
     }
 
+    Slot = (Slot + 1) % TIMER_WHEEL_SLOT_COUNT;
+  }
+
+  //
+  // The slot of the current time may still receive timers that expire later in it,
+  // so the next check starts from it.
+  //
+  mEfiTimerWheelTime = SystemTime;
+
+  //
+  // The timers left in the visited slots have been compared above. For the other
+  // slots, the start of the first non-empty one is the earliest time any of their
+  // timers may expire. If its timers expire in a later turn of the wheel, the
+  // check at that time moves on to the next slot. The periodic timers set again
+  // below lower this time as they are inserted.
+  //
+  NextTriggerTime = MIN (NextTriggerTime, CoreFindNextTimerWheelSlotTime (SystemTime));
+  CoreSetNextTriggerTime (NextTriggerTime);
+
+  while (!IsListEmpty (&ExpiredList)) {
+    Event = CR (ExpiredList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+
     //
-    // Remove this timer from the timer queue
+    // Remove this timer from the expired list
     //
 
     RemoveEntryList (&Event->Timer.Link);
@@ -140,7 +351,10 @@ CoreCheckTimers (
       //
       // Compute the timers new trigger time
       //
-      Event->Timer.TriggerTime = Event->Timer.TriggerTime + Event->Timer.Period;
+      Event->Timer.TriggerTime = CoreCoalesceTriggerTime (
+                                   Event->Timer.TriggerTime + Event->Timer.Period,
+                                   Event->Timer.Period
+                                   );
 
       //
       // If that's before now, then reset the timer to start from now
@@ -171,6 +385,11 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Slot;
+
+  for (Slot = 0; Slot < TIMER_WHEEL_SLOT_COUNT; Slot++) {
+    InitializeListHead (&mEfiTimerWheel[Slot]);
+  }
 
   Status = CoreCreateEventInternal (
              EVT_NOTIFY_SIGNAL,
@@ -197,8 +416,6 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
-
   //
   // Check runtiem flag in case there are ticks while exiting boot services
   //
@@ -210,15 +427,11 @@ CoreTimerTick (
   mEfiSystemTime += Duration;
 
   //
-  // If the head of the list is expired, fire the timer event
+  // If the earliest timer is expired, fire the timer event
   // to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
-
-    if (Event->Timer.TriggerTime <= mEfiSystemTime) {
-      CoreSignalEvent (mEfiCheckTimerEvent);
-    }
+  if (mEfiTimerNextTriggerTime <= mEfiSystemTime) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
   }
 
   CoreReleaseLock (&mEfiSystemTimeLock);
@@ -271,8 +484,7 @@ CoreSetTimer (
   // If the timer is queued to the timer database, remove it
   //
   if (Event->Timer.Link.ForwardLink != NULL) {
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
+    CoreRemoveEventTimer (Event);
   }
 
   Event->Timer.TriggerTime = 0;
@@ -288,6 +500,9 @@ CoreSetTimer (
     }
 
     Event->Timer.TriggerTime = CoreCurrentSystemTime () + TriggerTime;
+    if (TriggerTime != 0) {
+      Event->Timer.TriggerTime = CoreCoalesceTriggerTime (Event->Timer.TriggerTime, Event->Timer.Period);
+    }
     CoreInsertEventTimer (Event);
 
     if (TriggerTime == 0) {
@@ -269,12 +269,10 @@ FreeFvDeviceResource (
   while (&FfsFileEntry->Link != &FvDevice->FfsFileListHeader) {
     NextEntry = (&FfsFileEntry->Link)->ForwardLink;
 
-    if (FfsFileEntry->StreamHandle != 0) {
-      //
-      // Close stream and free resources from SEP
-      //
-      CloseSectionStream (FfsFileEntry->StreamHandle, FALSE);
-    }
+    //
+    // Close stream and free resources from SEP
+    //
+    FvInvalidateSectionStream (FfsFileEntry);
 
     if (FfsFileEntry->FileCached) {
       //
@@ -304,6 +302,68 @@ FreeFvDeviceResource (
 }
 
 
+/**
+  Build the FFS file list of a memory-mapped FV from the file index that PEI
+  core passed in a HOB, so the FV is not walked and validated again.
+
+  @param  FvDevice              A pointer to the FvDevice to be checked.
+  @param  PhysicalAddress       The base address of the memory-mapped FV.
+
+  @retval EFI_SUCCESS           The FFS file list is built.
+  @retval EFI_NOT_FOUND         PEI core did not pass a file index for the FV.
+  @retval EFI_OUT_OF_RESOURCES  No enough buffer could be allocated.
+  @retval EFI_VOLUME_CORRUPTED  The file index does not fit in the FV.
+
+**/
+EFI_STATUS
+FvCheckWithFileIndex (
+  IN OUT FV_DEVICE             *FvDevice,
+  IN     EFI_PHYSICAL_ADDRESS  PhysicalAddress
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER            *FwVolHeader;
+  EFI_HOB_GUID_TYPE                     *GuidHob;
+  FV_FILE_INDEX_HOB                     *FileIndexHob;
+  FFS_FILE_LIST_ENTRY                   *FfsFileEntry;
+  UINT32                                *FileOffset;
+  UINTN                                 Index;
+
+  FwVolHeader  = FvDevice->FwVolHeader;
+  FileIndexHob = NULL;
+  for (GuidHob = GetFirstGuidHob (&gEdkiiFvFileIndexHobGuid);
+       GuidHob != NULL;
+       GuidHob = GetNextGuidHob (&gEdkiiFvFileIndexHobGuid, GET_NEXT_HOB (GuidHob))) {
+    FileIndexHob = GET_GUID_HOB_DATA (GuidHob);
+    if ((FileIndexHob->FvBase == PhysicalAddress) &&
+        (FileIndexHob->FvLength == FwVolHeader->FvLength) &&
+        (FileIndexHob->FvChecksum == FwVolHeader->Checksum)) {
+      break;
+    }
+  }
+  if (GuidHob == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  FileOffset = (UINT32 *) (FileIndexHob + 1);
+  for (Index = 0; Index < FileIndexHob->FileCount; Index++) {
+    if ((FileOffset[Index] < FwVolHeader->HeaderLength) ||
+        (FileOffset[Index] + sizeof (EFI_FFS_FILE_HEADER) > FwVolHeader->FvLength)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    FfsFileEntry = AllocateZeroPool (sizeof (FFS_FILE_LIST_ENTRY));
+    if (FfsFileEntry == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    FfsFileEntry->FfsHeader  = (EFI_FFS_FILE_HEADER *) (UINTN) (PhysicalAddress + FileOffset[Index]);
+    FfsFileEntry->FileCached = FALSE;
+    InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+  }
+
+  DEBUG ((EFI_D_INFO, "FV %lx: %d files from the PEI file index\n", PhysicalAddress, FileIndexHob->FileCount));
+  return EFI_SUCCESS;
+}
 
 /**
   Check if an FV is consistent and allocate cache for it.
@@ -344,6 +404,7 @@ FvCheck (
 
   FileCached = FALSE;
   CacheFfsHeader = NULL;
+  PhysicalAddress = 0;
 
   Fvb = FvDevice->Fvb;
   FwVolHeader = FvDevice->FwVolHeader;
@@ -468,6 +529,18 @@ FvCheck (
   Status = EFI_SUCCESS;
   InitializeListHead (&FvDevice->FfsFileListHeader);
 
+  //
+  // The files of a memory-mapped FV have been validated by PEI core if
+  // it passed the file index of the FV.
+  //
+  if (FvDevice->IsMemoryMapped) {
+    Status = FvCheckWithFileIndex (FvDevice, PhysicalAddress);
+    if (Status != EFI_NOT_FOUND) {
+      goto Done;
+    }
+    Status = EFI_SUCCESS;
+  }
+
   //
   // Build FFS list
   //
@@ -523,7 +596,22 @@ FvCheck (
     }
 
     CacheFfsHeader = FfsHeader;
-    if ((CacheFfsHeader->Attributes & FFS_ATTRIB_CHECKSUM) == FFS_ATTRIB_CHECKSUM) {
+    if (FvDevice->IsMemoryMapped && FeaturePcdGet (PcdDxeFvLazyFileValidation)) {
+      //
+      // Leave the file in place. FvReadFile () caches the file and verifies
+      // its data checksum when the file is read first.
+      //
+      FileState = GetFileState (FvDevice->ErasePolarity, CacheFfsHeader);
+      if ((FileState != EFI_FILE_DATA_VALID) &&
+          (FileState != EFI_FILE_MARKED_FOR_UPDATE) &&
+          (FileState != EFI_FILE_DELETED)) {
+        //
+        // File system is corrupted
+        //
+        Status = EFI_VOLUME_CORRUPTED;
+        goto Done;
+      }
+    } else if ((CacheFfsHeader->Attributes & FFS_ATTRIB_CHECKSUM) == FFS_ATTRIB_CHECKSUM) {
       if (FvDevice->IsMemoryMapped) {
         //
         // Memory mapped FV has not been cached.
@@ -540,7 +628,8 @@ FvCheck (
       }
     }
 
-    if (!IsValidFfsFile (FvDevice->ErasePolarity, CacheFfsHeader)) {
+    if (!(FvDevice->IsMemoryMapped && FeaturePcdGet (PcdDxeFvLazyFileValidation)) &&
+        !IsValidFfsFile (FvDevice->ErasePolarity, CacheFfsHeader)) {
       //
       // File system is corrupted
       //
@@ -578,6 +667,7 @@ FvCheck (
 
       FfsFileEntry->FfsHeader = CacheFfsHeader;
       FfsFileEntry->FileCached = FileCached;
+      FfsFileEntry->ChecksumPending = (BOOLEAN) (FvDevice->IsMemoryMapped && FeaturePcdGet (PcdDxeFvLazyFileValidation));
       FileCached = FALSE;
       InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
     }
@@ -719,7 +809,10 @@ NotifyFwVolBlock (
         FvDevice->AuthenticationStatus = GetFvbAuthenticationStatus (Fvb);
       }
       
-      if (!EFI_ERROR (FvCheck (FvDevice))) {
+      PERF_START (Handle, "FvCheck:", NULL, 0);
+      Status = FvCheck (FvDevice);
+      PERF_END (Handle, "FvCheck:", NULL, 0);
+      if (!EFI_ERROR (Status)) {
         //
         // Install an New FV protocol on the existing handle
         //
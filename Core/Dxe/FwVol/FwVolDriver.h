@@ -19,6 +19,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define FV2_DEVICE_SIGNATURE SIGNATURE_32 ('_', 'F', 'V', '2')
 
+//
+// Maximum number of section streams kept open by FvReadFileSection ()
+//
+#define SECTION_STREAM_CACHE_SIZE  16
+
 //
 // Used to track all non-deleted files
 //
@@ -27,6 +32,9 @@ typedef struct {
   EFI_FFS_FILE_HEADER             *FfsHeader;
   UINTN                           StreamHandle;
   BOOLEAN                         FileCached;
+  BOOLEAN                         ChecksumPending;    // Data checksum deferred to the first read
+  LIST_ENTRY                      StreamCacheLink;    // mSectionStreamCache
+  UINTN                           StreamUseCount;
 } FFS_FILE_LIST_ENTRY;
 
 typedef struct {
@@ -184,6 +192,7 @@ FvGetNextFile (
   @retval EFI_ACCESS_DENIED          Could not read.
   @retval EFI_INVALID_PARAMETER      Invalid parameter.
   @retval EFI_OUT_OF_RESOURCES       Not enough buffer to be allocated.
+  @retval EFI_VOLUME_CORRUPTED       The data checksum of the file is bad.
 
 **/
 EFI_STATUS
@@ -240,6 +249,20 @@ FvReadFileSection (
   );
 
 
+/**
+  Close the cached section stream of a file, so the sections of the file are
+  not served from stale data. It is called when the file or its firmware volume
+  goes away.
+
+  @param  FfsEntry                   The file whose section stream is closed.
+
+**/
+VOID
+FvInvalidateSectionStream (
+  IN FFS_FILE_LIST_ENTRY    *FfsEntry
+  );
+
+
 /**
   Writes one or more files to the firmware volume.
 
@@ -29,6 +29,18 @@ Required Alignment             Alignment Value in FFS         Alignment Value in
 **/
 UINT8 mFvAttributes[] = {0, 4, 7, 9, 10, 12, 15, 16};
 
+//
+// The section streams opened by FvReadFileSection () are kept open in a cache
+// of at most SECTION_STREAM_CACHE_SIZE streams, so the encapsulation sections
+// of a file are only extracted once for all the sections read from it. The
+// most recently used stream is at the head of the list, and the least recently
+// used one is closed when the cache is full. A stream that is being read is
+// taken off the list, so it is never closed under its reader.
+//
+LIST_ENTRY                       mSectionStreamCache     = INITIALIZE_LIST_HEAD_VARIABLE (mSectionStreamCache);
+EFI_LOCK                         mSectionStreamCacheLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
+SECTION_STREAM_CACHE_STATISTICS  gSectionStreamCacheStatistics = { 0, 0, 0, 0, 0, SECTION_STREAM_CACHE_SIZE };
+
 /**
   Convert the FFS File Attributes to FV File Attributes
 
@@ -257,6 +269,7 @@ FvGetNextFile (
   @retval EFI_ACCESS_DENIED          Could not read.
   @retval EFI_INVALID_PARAMETER      Invalid parameter.
   @retval EFI_OUT_OF_RESOURCES       Not enough buffer to be allocated.
+  @retval EFI_VOLUME_CORRUPTED       The data checksum of the file is bad.
 
 **/
 EFI_STATUS
@@ -334,6 +347,18 @@ FvReadFile (
     }
   }
 
+  if (FvDevice->LastKey->ChecksumPending) {
+    //
+    // The data checksum of the file was deferred by FvCheck (), verify it
+    // on the cached file now.
+    //
+    if (!IsValidFfsFile (FvDevice->ErasePolarity, FfsHeader)) {
+      DEBUG ((EFI_D_ERROR, "FFS file %g is corrupted\n", NameGuid));
+      return EFI_VOLUME_CORRUPTED;
+    }
+    FvDevice->LastKey->ChecksumPending = FALSE;
+  }
+
   //
   // Remember callers buffer size
   //
@@ -393,6 +418,144 @@ FvReadFile (
 
 
 
+/**
+  Take the section stream of a file out of the section stream cache for a read.
+  The section stream is opened if it is not in the cache.
+
+  @param  FfsEntry                   The file to read sections from.
+  @param  FileSize                   The size of the section stream of the file.
+  @param  FileBuffer                 The section stream of the file.
+
+  @retval EFI_SUCCESS                FfsEntry->StreamHandle is the section stream
+                                     of the file. FvReleaseSectionStream () must be
+                                     called when the read is done.
+  @retval Others                     The section stream could not be opened.
+
+**/
+EFI_STATUS
+FvAcquireSectionStream (
+  IN FFS_FILE_LIST_ENTRY    *FfsEntry,
+  IN UINTN                  FileSize,
+  IN VOID                   *FileBuffer
+  )
+{
+  EFI_STATUS                Status;
+  UINTN                     StreamHandle;
+
+  CoreAcquireLock (&mSectionStreamCacheLock);
+  if (FfsEntry->StreamHandle != 0) {
+    gSectionStreamCacheStatistics.HitCount++;
+    if (FfsEntry->StreamUseCount == 0) {
+      RemoveEntryList (&FfsEntry->StreamCacheLink);
+      gSectionStreamCacheStatistics.CachedStreamCount--;
+    }
+    FfsEntry->StreamUseCount++;
+    CoreReleaseLock (&mSectionStreamCacheLock);
+    return EFI_SUCCESS;
+  }
+  gSectionStreamCacheStatistics.MissCount++;
+  CoreReleaseLock (&mSectionStreamCacheLock);
+
+  Status = OpenSectionStream (FileSize, FileBuffer, &StreamHandle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  CoreAcquireLock (&mSectionStreamCacheLock);
+  if (FfsEntry->StreamHandle == 0) {
+    FfsEntry->StreamHandle = StreamHandle;
+    StreamHandle = 0;
+  } else if (FfsEntry->StreamUseCount == 0) {
+    //
+    // A nested read has opened and cached the stream in the meantime
+    //
+    RemoveEntryList (&FfsEntry->StreamCacheLink);
+    gSectionStreamCacheStatistics.CachedStreamCount--;
+  }
+  FfsEntry->StreamUseCount++;
+  CoreReleaseLock (&mSectionStreamCacheLock);
+
+  if (StreamHandle != 0) {
+    CloseSectionStream (StreamHandle, FALSE);
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Put the section stream of a file back in the section stream cache after a
+  read. If the cache is full, the least recently used section stream is closed.
+
+  @param  FfsEntry                   The file whose sections were read.
+
+**/
+VOID
+FvReleaseSectionStream (
+  IN FFS_FILE_LIST_ENTRY    *FfsEntry
+  )
+{
+  FFS_FILE_LIST_ENTRY       *LruEntry;
+  UINTN                     StreamHandle;
+
+  StreamHandle = 0;
+
+  CoreAcquireLock (&mSectionStreamCacheLock);
+  ASSERT (FfsEntry->StreamUseCount != 0);
+  FfsEntry->StreamUseCount--;
+  if (FfsEntry->StreamUseCount == 0) {
+    InsertHeadList (&mSectionStreamCache, &FfsEntry->StreamCacheLink);
+    gSectionStreamCacheStatistics.CachedStreamCount++;
+
+    if (gSectionStreamCacheStatistics.CachedStreamCount > SECTION_STREAM_CACHE_SIZE) {
+      LruEntry = BASE_CR (mSectionStreamCache.BackLink, FFS_FILE_LIST_ENTRY, StreamCacheLink);
+      RemoveEntryList (&LruEntry->StreamCacheLink);
+      gSectionStreamCacheStatistics.CachedStreamCount--;
+      gSectionStreamCacheStatistics.EvictionCount++;
+      StreamHandle = LruEntry->StreamHandle;
+      LruEntry->StreamHandle = 0;
+    }
+  }
+  CoreReleaseLock (&mSectionStreamCacheLock);
+
+  if (StreamHandle != 0) {
+    CloseSectionStream (StreamHandle, FALSE);
+  }
+}
+
+
+/**
+  Close the cached section stream of a file, so the sections of the file are
+  not served from stale data. It is called when the file or its firmware volume
+  goes away.
+
+  @param  FfsEntry                   The file whose section stream is closed.
+
+**/
+VOID
+FvInvalidateSectionStream (
+  IN FFS_FILE_LIST_ENTRY    *FfsEntry
+  )
+{
+  UINTN                     StreamHandle;
+
+  CoreAcquireLock (&mSectionStreamCacheLock);
+  StreamHandle = FfsEntry->StreamHandle;
+  if (StreamHandle != 0) {
+    ASSERT (FfsEntry->StreamUseCount == 0);
+    RemoveEntryList (&FfsEntry->StreamCacheLink);
+    gSectionStreamCacheStatistics.CachedStreamCount--;
+    gSectionStreamCacheStatistics.InvalidationCount++;
+    FfsEntry->StreamHandle = 0;
+  }
+  CoreReleaseLock (&mSectionStreamCacheLock);
+
+  if (StreamHandle != 0) {
+    CloseSectionStream (StreamHandle, FALSE);
+  }
+}
+
+
 /**
   Locates a section in a given FFS File and
   copies it to the supplied buffer (not including section header).
@@ -483,15 +646,9 @@ FvReadFileSection (
   //
   // Use FfsEntry to cache Section Extraction Protocol Information
   //
-  if (FfsEntry->StreamHandle == 0) {
-    Status = OpenSectionStream (
-               FileSize,
-               FileBuffer,
-               &FfsEntry->StreamHandle
-               );
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
+  Status = FvAcquireSectionStream (FfsEntry, FileSize, FileBuffer);
+  if (EFI_ERROR (Status)) {
+    goto Done;
   }
 
   //
@@ -508,6 +665,8 @@ FvReadFileSection (
              FvDevice->IsFfs3Fv
              );
 
+  FvReleaseSectionStream (FfsEntry);
+
   if (!EFI_ERROR (Status)) {
     //
     // Inherit the authentication status.
@@ -516,7 +675,7 @@ FvReadFileSection (
   }
 
   //
-  // Close of stream defered to close of FfsHeader list to allow SEP to cache data
+  // Close of stream defered to eviction from the section stream cache to allow SEP to cache data
   //
 
 Done:
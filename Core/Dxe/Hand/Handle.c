@@ -16,16 +16,22 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "Handle.h"
 
 
+#define PROTOCOL_HASH_BUCKET_COUNT  64
+
 //
-// mProtocolDatabase     - A list of all protocols in the system.  (simple list for now)
+// mProtocolDatabase     - A list of all protocols in the system.
+// mProtocolHashTable    - The protocols of mProtocolDatabase hashed by protocol GUID
 // gHandleList           - A list of all the handles in the system
 // gProtocolDatabaseLock - Lock to protect the mProtocolDatabase
 // gHandleDatabaseKey    -  The Key to show that the handle has been created/modified
+// gProtocolDatabaseStatistics - Counters of the lookups in the protocol database
 //
 LIST_ENTRY      mProtocolDatabase     = INITIALIZE_LIST_HEAD_VARIABLE (mProtocolDatabase);
+LIST_ENTRY      mProtocolHashTable[PROTOCOL_HASH_BUCKET_COUNT];
 LIST_ENTRY      gHandleList           = INITIALIZE_LIST_HEAD_VARIABLE (gHandleList);
 EFI_LOCK        gProtocolDatabaseLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 UINT64          gHandleDatabaseKey    = 0;
+PROTOCOL_DATABASE_STATISTICS  gProtocolDatabaseStatistics;
 
 
 
@@ -85,6 +91,43 @@ CoreValidateHandle (
 
 
 
+/**
+  Get the mProtocolHashTable bucket of a protocol GUID.
+
+  @param  Protocol               The ID of the protocol
+
+  @return The bucket that holds the protocol entry of Protocol
+
+**/
+LIST_ENTRY *
+CoreGetProtocolHashBucket (
+  IN EFI_GUID   *Protocol
+  )
+{
+  UINT32              Hash;
+  UINTN               Index;
+
+  //
+  // The hash table is set up on first use
+  //
+  if (mProtocolHashTable[0].ForwardLink == NULL) {
+    for (Index = 0; Index < PROTOCOL_HASH_BUCKET_COUNT; Index++) {
+      InitializeListHead (&mProtocolHashTable[Index]);
+    }
+  }
+
+  Hash  = ReadUnaligned32 ((UINT32 *) Protocol);
+  Hash ^= ReadUnaligned32 ((UINT32 *) Protocol + 1);
+  Hash ^= ReadUnaligned32 ((UINT32 *) Protocol + 2);
+  Hash ^= ReadUnaligned32 ((UINT32 *) Protocol + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return &mProtocolHashTable[Hash % PROTOCOL_HASH_BUCKET_COUNT];
+}
+
+
+
 /**
   Finds the protocol entry for the requested protocol.
   The gProtocolDatabaseLock must be owned
@@ -101,6 +144,7 @@ CoreFindProtocolEntry (
   IN BOOLEAN    Create
   )
 {
+  LIST_ENTRY          *Bucket;
   LIST_ENTRY          *Link;
   PROTOCOL_ENTRY      *Item;
   PROTOCOL_ENTRY      *ProtEntry;
@@ -108,15 +152,18 @@ CoreFindProtocolEntry (
   ASSERT_LOCKED(&gProtocolDatabaseLock);
 
   //
-  // Search the database for the matching GUID
+  // Search the hash bucket of the GUID for the matching GUID
   //
 
+  gProtocolDatabaseStatistics.ProtocolLookupCount++;
+  Bucket = CoreGetProtocolHashBucket (Protocol);
   ProtEntry = NULL;
-  for (Link = mProtocolDatabase.ForwardLink;
-       Link != &mProtocolDatabase;
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink) {
 
-    Item = CR(Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
+    gProtocolDatabaseStatistics.ProtocolScanCount++;
+    Item = CR(Link, PROTOCOL_ENTRY, HashLink, PROTOCOL_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->ProtocolID, Protocol)) {
 
       //
@@ -148,6 +195,7 @@ CoreFindProtocolEntry (
       // Add it to protocol database
       //
       InsertTailList (&mProtocolDatabase, &ProtEntry->AllEntries);
+      InsertTailList (Bucket, &ProtEntry->HashLink);
     }
   }
 
@@ -472,6 +520,11 @@ CoreInstallProtocolInterfaceNotify (
   if (Notify) {
     CoreNotifyProtocolEntry (ProtEntry);
   }
+
+  //
+  // Let the dispatcher evaluate the drivers that depend on this protocol again
+  //
+  CoreNotifyDepexProtocol (Protocol);
   Status = EFI_SUCCESS;
 
 Done:
@@ -786,6 +839,7 @@ CoreUninstallProtocolInterface (
     //
     Prot->Signature = 0;
     CoreFreePool (Prot);
+    CoreNotifyDepexProtocol (Protocol);
     Status = EFI_SUCCESS;
   }
 
@@ -904,13 +958,23 @@ CoreGetProtocolInterface (
 
   Handle = (IHANDLE *)UserHandle;
 
+  //
+  // Resolve the GUID once, so the handle's protocol interfaces are
+  // matched by their protocol entry instead of by GUID
+  //
+  ProtEntry = CoreFindProtocolEntry (Protocol, FALSE);
+  if (ProtEntry == NULL) {
+    return NULL;
+  }
+
   //
   // Look at each protocol interface for a match
   //
+  gProtocolDatabaseStatistics.HandleProtocolLookupCount++;
   for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link = Link->ForwardLink) {
+    gProtocolDatabaseStatistics.HandleProtocolScanCount++;
     Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
-    ProtEntry = Prot->Protocol;
-    if (CompareGuid (&ProtEntry->ProtocolID, Protocol)) {
+    if (Prot->Protocol == ProtEntry) {
       return Prot;
     }
   }
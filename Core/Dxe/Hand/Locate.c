@@ -29,6 +29,7 @@ typedef struct {
   VOID            *SearchKey;
   LIST_ENTRY      *Position;
   PROTOCOL_ENTRY  *ProtEntry;
+  UINTN           ScanCount;
 } LOCATE_POSITION;
 
 typedef
@@ -144,6 +145,7 @@ CoreLocateHandle (
   Position.Protocol  = Protocol;
   Position.SearchKey = SearchKey;
   Position.Position  = &gHandleList;
+  Position.ScanCount = 0;
 
   ResultSize = 0;
   ResultBuffer = (IHANDLE **) Buffer;
@@ -153,6 +155,7 @@ CoreLocateHandle (
   // Lock the protocol database
   //
   CoreAcquireProtocolLock ();
+  gProtocolDatabaseStatistics.LocateHandleCount++;
 
   //
   // Get the search function based on type
@@ -253,6 +256,7 @@ CoreLocateHandle (
     }
   }
 
+  gProtocolDatabaseStatistics.LocateHandleScanCount += Position.ScanCount;
   CoreReleaseProtocolLock ();
   return Status;
 }
@@ -289,6 +293,7 @@ CoreGetNextLocateAllHandles (
   Handle      = NULL;
   *Interface  = NULL;
   if (Position->Position != &gHandleList) {
+    Position->ScanCount++;
     Handle = CR (Position->Position, IHANDLE, AllHandles, EFI_HANDLE_SIGNATURE);
   }
 
@@ -336,6 +341,7 @@ CoreGetNextLocateByRegisterNotify (
     //
     Link = ProtNotify->Position->ForwardLink;
     if (Link != &ProtNotify->Protocol->Protocols) {
+      Position->ScanCount++;
       Prot = CR (Link, PROTOCOL_INTERFACE, ByProtocol, PROTOCOL_INTERFACE_SIGNATURE);
       Handle = Prot->Handle;
       *Interface = Prot->Interface;
@@ -387,6 +393,7 @@ CoreGetNextLocateByProtocol (
     //
     // Get the handle
     //
+    Position->ScanCount++;
     Prot = CR(Link, PROTOCOL_INTERFACE, ByProtocol, PROTOCOL_INTERFACE_SIGNATURE);
     Handle = Prot->Handle;
     *Interface = Prot->Interface;
@@ -577,11 +584,13 @@ CoreLocateProtocol (
   Position.Protocol  = Protocol;
   Position.SearchKey = Registration;
   Position.Position  = &gHandleList;
+  Position.ScanCount = 0;
 
   //
   // Lock the protocol database
   //
   CoreAcquireProtocolLock ();
+  gProtocolDatabaseStatistics.LocateProtocolCount++;
 
   mEfiLocateHandleRequest += 1;
 
@@ -613,6 +622,7 @@ CoreLocateProtocol (
   }
 
 Done:
+  gProtocolDatabaseStatistics.LocateProtocolScanCount += Position.ScanCount;
   CoreReleaseProtocolLock ();
   return Status;
 }
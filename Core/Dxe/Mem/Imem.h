@@ -46,7 +46,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 
 #define MEMORY_MAP_SIGNATURE   SIGNATURE_32('m','m','a','p')
-typedef struct {
+typedef struct _MEMORY_MAP {
   UINTN           Signature;
   LIST_ENTRY      Link;
   BOOLEAN         FromPages;
@@ -57,6 +57,16 @@ typedef struct {
 
   UINT64          VirtualStart;
   UINT64          Attribute;
+
+  //
+  // Node of the balanced tree that indexes the memory map by Start address.
+  // IndexMaxFreeSize is the size of the largest EfiConventionalMemory
+  // descriptor in the subtree rooted at this node.
+  //
+  struct _MEMORY_MAP  *IndexLeft;
+  struct _MEMORY_MAP  *IndexRight;
+  UINTN               IndexHeight;
+  UINT64              IndexMaxFreeSize;
 } MEMORY_MAP;
 
 //
@@ -1191,6 +1191,9 @@ MemoryProfileGetDataSize (
     TotalSize += sizeof (MEMORY_PROFILE_ALLOC_INFO) * (UINTN) DriverInfoData->DriverInfo.AllocRecordCount;
   }
 
+  TotalSize += sizeof (MEMORY_PROFILE_POOL_SLAB);
+  TotalSize += sizeof (MEMORY_PROFILE_POOL_SLAB_CLASS) * CoreGetPoolSlabStatistics (NULL);
+
   return TotalSize;
 }
 
@@ -1208,6 +1211,7 @@ MemoryProfileCopyData (
   MEMORY_PROFILE_CONTEXT            *Context;
   MEMORY_PROFILE_DRIVER_INFO        *DriverInfo;
   MEMORY_PROFILE_ALLOC_INFO         *AllocInfo;
+  MEMORY_PROFILE_POOL_SLAB          *PoolSlab;
   MEMORY_PROFILE_CONTEXT_DATA       *ContextData;
   MEMORY_PROFILE_DRIVER_INFO_DATA   *DriverInfoData;
   MEMORY_PROFILE_ALLOC_INFO_DATA    *AllocInfoData;
@@ -1254,6 +1258,13 @@ MemoryProfileCopyData (
 
     DriverInfo = (MEMORY_PROFILE_DRIVER_INFO *) ((UINTN) (DriverInfo + 1) + sizeof (MEMORY_PROFILE_ALLOC_INFO) * (UINTN) DriverInfo->AllocRecordCount);
   }
+
+  PoolSlab = (MEMORY_PROFILE_POOL_SLAB *) DriverInfo;
+  PoolSlab->Header.Signature = MEMORY_PROFILE_POOL_SLAB_SIGNATURE;
+  PoolSlab->Header.Length    = sizeof (MEMORY_PROFILE_POOL_SLAB);
+  PoolSlab->Header.Revision  = MEMORY_PROFILE_POOL_SLAB_REVISION;
+  ZeroMem (PoolSlab->Reserved, sizeof (PoolSlab->Reserved));
+  PoolSlab->SlabClassCount   = (UINT32) CoreGetPoolSlabStatistics ((MEMORY_PROFILE_POOL_SLAB_CLASS *) (PoolSlab + 1));
 }
 
 /**
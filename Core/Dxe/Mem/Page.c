@@ -51,6 +51,12 @@ UINTN         mFreeMapStack = 0;
 ///
 LIST_ENTRY   mFreeMemoryMapEntryList = INITIALIZE_LIST_HEAD_VARIABLE (mFreeMemoryMapEntryList);
 BOOLEAN      mMemoryTypeInformationInitialized = FALSE;
+///
+/// Root of the balanced tree that indexes the descriptors of gMemoryMap by
+/// Start address. gMemoryMap stays the source of truth for GetMemoryMap (),
+/// the tree only speeds up the lookups of the page allocator.
+///
+MEMORY_MAP   *mMemoryMapIndex = NULL;
 
 EFI_MEMORY_TYPE_STATISTICS mMemoryTypeStatistics[EfiMaxMemoryType + 1] = {
   { 0, MAX_ADDRESS, 0, 0, EfiMaxMemoryType, TRUE,  FALSE },  // EfiReservedMemoryType
@@ -150,6 +156,272 @@ RemoveMemoryMapEntry (
   }
 }
 
+/**
+  Internal function.  Recomputes the height and the largest free size
+  of a node of the memory map index from its children.
+
+  @param  Node                   The node to update
+
+**/
+VOID
+UpdateMemoryMapIndexNode (
+  IN OUT MEMORY_MAP      *Node
+  )
+{
+  UINTN   LeftHeight;
+  UINTN   RightHeight;
+  UINT64  MaxFreeSize;
+
+  LeftHeight  = (Node->IndexLeft  == NULL) ? 0 : Node->IndexLeft->IndexHeight;
+  RightHeight = (Node->IndexRight == NULL) ? 0 : Node->IndexRight->IndexHeight;
+  Node->IndexHeight = MAX (LeftHeight, RightHeight) + 1;
+
+  MaxFreeSize = 0;
+  if (Node->Type == EfiConventionalMemory) {
+    MaxFreeSize = Node->End - Node->Start + 1;
+  }
+  if ((Node->IndexLeft != NULL) && (Node->IndexLeft->IndexMaxFreeSize > MaxFreeSize)) {
+    MaxFreeSize = Node->IndexLeft->IndexMaxFreeSize;
+  }
+  if ((Node->IndexRight != NULL) && (Node->IndexRight->IndexMaxFreeSize > MaxFreeSize)) {
+    MaxFreeSize = Node->IndexRight->IndexMaxFreeSize;
+  }
+  Node->IndexMaxFreeSize = MaxFreeSize;
+}
+
+/**
+  Internal function.  Restores the balance of a subtree of the memory map index
+  whose children differ in height by at most two.
+
+  @param  Node                   The root of the subtree
+
+  @return The new root of the subtree
+
+**/
+MEMORY_MAP *
+BalanceMemoryMapIndexNode (
+  IN OUT MEMORY_MAP      *Node
+  )
+{
+  MEMORY_MAP  *Child;
+  UINTN       LeftHeight;
+  UINTN       RightHeight;
+
+  UpdateMemoryMapIndexNode (Node);
+
+  LeftHeight  = (Node->IndexLeft  == NULL) ? 0 : Node->IndexLeft->IndexHeight;
+  RightHeight = (Node->IndexRight == NULL) ? 0 : Node->IndexRight->IndexHeight;
+
+  if (LeftHeight > RightHeight + 1) {
+    //
+    // Rotate right, after rotating the left child left if it leans right
+    //
+    Child = Node->IndexLeft;
+    if (((Child->IndexLeft  == NULL) ? 0 : Child->IndexLeft->IndexHeight) <
+        ((Child->IndexRight == NULL) ? 0 : Child->IndexRight->IndexHeight)) {
+      Node->IndexLeft   = Child->IndexRight;
+      Child->IndexRight = Node->IndexLeft->IndexLeft;
+      Node->IndexLeft->IndexLeft = Child;
+      UpdateMemoryMapIndexNode (Child);
+      Child = Node->IndexLeft;
+    }
+    Node->IndexLeft   = Child->IndexRight;
+    Child->IndexRight = Node;
+    UpdateMemoryMapIndexNode (Node);
+    UpdateMemoryMapIndexNode (Child);
+    return Child;
+  }
+
+  if (RightHeight > LeftHeight + 1) {
+    //
+    // Rotate left, after rotating the right child right if it leans left
+    //
+    Child = Node->IndexRight;
+    if (((Child->IndexRight == NULL) ? 0 : Child->IndexRight->IndexHeight) <
+        ((Child->IndexLeft  == NULL) ? 0 : Child->IndexLeft->IndexHeight)) {
+      Node->IndexRight = Child->IndexLeft;
+      Child->IndexLeft = Node->IndexRight->IndexRight;
+      Node->IndexRight->IndexRight = Child;
+      UpdateMemoryMapIndexNode (Child);
+      Child = Node->IndexRight;
+    }
+    Node->IndexRight = Child->IndexLeft;
+    Child->IndexLeft = Node;
+    UpdateMemoryMapIndexNode (Node);
+    UpdateMemoryMapIndexNode (Child);
+    return Child;
+  }
+
+  return Node;
+}
+
+/**
+  Internal function.  Inserts a descriptor into a subtree of the memory map index.
+
+  @param  Root                   The root of the subtree
+  @param  Entry                  The descriptor to insert
+
+  @return The new root of the subtree
+
+**/
+MEMORY_MAP *
+InsertMemoryMapIndexNode (
+  IN OUT MEMORY_MAP      *Root,
+  IN OUT MEMORY_MAP      *Entry
+  )
+{
+  if (Root == NULL) {
+    Entry->IndexLeft  = NULL;
+    Entry->IndexRight = NULL;
+    UpdateMemoryMapIndexNode (Entry);
+    return Entry;
+  }
+
+  ASSERT (Entry->Start != Root->Start);
+  if (Entry->Start < Root->Start) {
+    Root->IndexLeft  = InsertMemoryMapIndexNode (Root->IndexLeft, Entry);
+  } else {
+    Root->IndexRight = InsertMemoryMapIndexNode (Root->IndexRight, Entry);
+  }
+
+  return BalanceMemoryMapIndexNode (Root);
+}
+
+/**
+  Internal function.  Removes the descriptor with the lowest Start address
+  from a subtree of the memory map index.
+
+  @param  Root                   The root of the subtree
+  @param  Lowest                 Returns the removed descriptor
+
+  @return The new root of the subtree
+
+**/
+MEMORY_MAP *
+RemoveLowestMemoryMapIndexNode (
+  IN OUT MEMORY_MAP      *Root,
+  OUT    MEMORY_MAP      **Lowest
+  )
+{
+  if (Root->IndexLeft == NULL) {
+    *Lowest = Root;
+    return Root->IndexRight;
+  }
+
+  Root->IndexLeft = RemoveLowestMemoryMapIndexNode (Root->IndexLeft, Lowest);
+  return BalanceMemoryMapIndexNode (Root);
+}
+
+/**
+  Internal function.  Removes a descriptor from a subtree of the memory map index.
+
+  @param  Root                   The root of the subtree
+  @param  Entry                  The descriptor to remove
+
+  @return The new root of the subtree
+
+**/
+MEMORY_MAP *
+RemoveMemoryMapIndexNode (
+  IN OUT MEMORY_MAP      *Root,
+  IN OUT MEMORY_MAP      *Entry
+  )
+{
+  MEMORY_MAP  *Lowest;
+
+  ASSERT (Root != NULL);
+  if (Root == NULL) {
+    return NULL;
+  }
+
+  if (Entry->Start < Root->Start) {
+    Root->IndexLeft  = RemoveMemoryMapIndexNode (Root->IndexLeft, Entry);
+  } else if (Entry->Start > Root->Start) {
+    Root->IndexRight = RemoveMemoryMapIndexNode (Root->IndexRight, Entry);
+  } else {
+    ASSERT (Root == Entry);
+    if (Root->IndexRight == NULL) {
+      return Root->IndexLeft;
+    }
+
+    //
+    // Replace the node with its successor
+    //
+    Lowest = NULL;
+    Root->IndexRight   = RemoveLowestMemoryMapIndexNode (Root->IndexRight, &Lowest);
+    Lowest->IndexLeft  = Root->IndexLeft;
+    Lowest->IndexRight = Root->IndexRight;
+    Root = Lowest;
+  }
+
+  return BalanceMemoryMapIndexNode (Root);
+}
+
+/**
+  Internal function.  Adds a descriptor of gMemoryMap to the memory map index.
+  The Start, End and Type of the descriptor must not change while it is in the index.
+
+  @param  Entry                  The descriptor to add
+
+**/
+VOID
+InsertMemoryMapIndex (
+  IN OUT MEMORY_MAP      *Entry
+  )
+{
+  mMemoryMapIndex = InsertMemoryMapIndexNode (mMemoryMapIndex, Entry);
+}
+
+/**
+  Internal function.  Removes a descriptor of gMemoryMap from the memory map index.
+
+  @param  Entry                  The descriptor to remove
+
+**/
+VOID
+RemoveMemoryMapIndex (
+  IN OUT MEMORY_MAP      *Entry
+  )
+{
+  mMemoryMapIndex = RemoveMemoryMapIndexNode (mMemoryMapIndex, Entry);
+}
+
+/**
+  Internal function.  Finds the descriptor that covers an address.
+
+  @param  Address                The address to look for
+
+  @return The descriptor that covers Address, or NULL if there is none
+
+**/
+MEMORY_MAP *
+FindMemoryMapEntry (
+  IN UINT64              Address
+  )
+{
+  MEMORY_MAP  *Node;
+  MEMORY_MAP  *Entry;
+
+  //
+  // Find the descriptor with the highest Start that is not above Address
+  //
+  Entry = NULL;
+  Node  = mMemoryMapIndex;
+  while (Node != NULL) {
+    if (Node->Start <= Address) {
+      Entry = Node;
+      Node  = Node->IndexRight;
+    } else {
+      Node  = Node->IndexLeft;
+    }
+  }
+
+  if ((Entry != NULL) && (Entry->End >= Address)) {
+    return Entry;
+  }
+  return NULL;
+}
+
 /**
   Internal function.  Adds a ranges to the memory map.
   The range must not already exist in the map.
@@ -170,7 +442,6 @@ CoreAddRange (
   IN UINT64                   Attribute
   )
 {
-  LIST_ENTRY        *Link;
   MEMORY_MAP        *Entry;
 
   ASSERT ((Start & EFI_PAGE_MASK) == 0);
@@ -217,29 +488,20 @@ CoreAddRange (
   // and the same Attribute
   //
 
-  Link = gMemoryMap.ForwardLink;
-  while (Link != &gMemoryMap) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    Link  = Link->ForwardLink;
+  Entry = (Start == 0) ? NULL : FindMemoryMapEntry (Start - 1);
+  if ((Entry != NULL) && (Entry->Type == Type) && (Entry->Attribute == Attribute) && (Entry->End + 1 == Start)) {
 
-    if (Entry->Type != Type) {
-      continue;
-    }
-
-    if (Entry->Attribute != Attribute) {
-      continue;
-    }
-
-    if (Entry->End + 1 == Start) {
-
-      Start = Entry->Start;
-      RemoveMemoryMapEntry (Entry);
+    Start = Entry->Start;
+    RemoveMemoryMapIndex (Entry);
+    RemoveMemoryMapEntry (Entry);
+  }
 
-    } else if (Entry->Start == End + 1) {
+  Entry = (End + 1 == 0) ? NULL : FindMemoryMapEntry (End + 1);
+  if ((Entry != NULL) && (Entry->Type == Type) && (Entry->Attribute == Attribute) && (Entry->Start == End + 1)) {
 
-      End = Entry->End;
-      RemoveMemoryMapEntry (Entry);
-    }
+    End = Entry->End;
+    RemoveMemoryMapIndex (Entry);
+    RemoveMemoryMapEntry (Entry);
   }
 
   //
@@ -254,6 +516,7 @@ CoreAddRange (
   mMapStack[mMapDepth].VirtualStart  = 0;
   mMapStack[mMapDepth].Attribute     = Attribute;
   InsertTailList (&gMemoryMap, &mMapStack[mMapDepth].Link);
+  InsertMemoryMapIndex (&mMapStack[mMapDepth]);
 
   mMapDepth += 1;
   ASSERT (mMapDepth < MAX_MAP_DEPTH);
@@ -356,11 +619,13 @@ CoreFreeMemoryMapStack (
       //
       // Move this entry to general memory
       //
+      RemoveMemoryMapIndex (&mMapStack[mMapDepth]);
       RemoveEntryList (&mMapStack[mMapDepth].Link);
       mMapStack[mMapDepth].Link.ForwardLink = NULL;
 
       CopyMem (Entry , &mMapStack[mMapDepth], sizeof (MEMORY_MAP));
       Entry->FromPages = TRUE;
+      InsertMemoryMapIndex (Entry);
 
       //
       // Find insertion location
@@ -708,7 +973,6 @@ CoreConvertPagesEx (
   UINT64          RangeEnd;
   UINT64          Attribute;
   EFI_MEMORY_TYPE MemType;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
 
   Entry = NULL;
@@ -734,15 +998,8 @@ CoreConvertPagesEx (
     //
     // Find the entry that the covers the range
     //
-    for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-      Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-      if (Entry->Start <= Start && Entry->End > Start) {
-        break;
-      }
-    }
-
-    if (Link == &gMemoryMap) {
+    Entry = FindMemoryMapEntry (Start);
+    if (Entry == NULL) {
       DEBUG ((DEBUG_ERROR | DEBUG_PAGE, "ConvertPages: failed to find range %lx - %lx\n", Start, End));
       return EFI_NOT_FOUND;
     }
@@ -800,8 +1057,10 @@ CoreConvertPagesEx (
     }
 
     //
-    // Pull range out of descriptor
+    // Pull range out of descriptor. The descriptor leaves the index while
+    // it is being clipped.
     //
+    RemoveMemoryMapIndex (Entry);
     if (Entry->Start == Start) {
 
       //
@@ -838,6 +1097,7 @@ CoreConvertPagesEx (
 
       Entry->End = Start - 1;
       ASSERT (Entry->Start < Entry->End);
+      InsertMemoryMapIndex (Entry);
 
       Entry = &mMapStack[mMapDepth];
       InsertTailList (&gMemoryMap, &Entry->Link);
@@ -864,6 +1124,8 @@ CoreConvertPagesEx (
     if (Entry->Start == Entry->End + 1) {
       RemoveMemoryMapEntry (Entry);
       Entry = NULL;
+    } else {
+      InsertMemoryMapIndex (Entry);
     }
 
     //
@@ -958,6 +1220,88 @@ CoreUpdateMemoryAttributes (
 }
 
 
+/**
+  Internal function.  Finds the highest free range in a subtree of the memory
+  map index that satisfies an allocation request.
+
+  Subtrees without a free descriptor large enough for the request, and subtrees
+  outside of the requested address range, are not visited. The subtrees are
+  visited from the highest address down, so the first match is the best one.
+
+  @param  Node                   The root of the subtree
+  @param  MaxAddress             The end of the page the range must be below
+  @param  MinAddress             The address that the range must be above
+  @param  NumberOfBytes          Number of bytes needed
+  @param  Alignment              Bits to align with
+
+  @return The last address of the range, or 0 if the range was not found
+
+**/
+UINT64
+FindFreeRangeInMemoryMapIndex (
+  IN MEMORY_MAP       *Node,
+  IN UINT64           MaxAddress,
+  IN UINT64           MinAddress,
+  IN UINT64           NumberOfBytes,
+  IN UINTN            Alignment
+  )
+{
+  UINT64          Target;
+  UINT64          DescStart;
+  UINT64          DescEnd;
+  UINT64          DescNumberOfBytes;
+
+  if ((Node == NULL) || (Node->IndexMaxFreeSize < NumberOfBytes)) {
+    return 0;
+  }
+
+  if (Node->Start < MaxAddress) {
+    Target = FindFreeRangeInMemoryMapIndex (Node->IndexRight, MaxAddress, MinAddress, NumberOfBytes, Alignment);
+    if (Target != 0) {
+      return Target;
+    }
+
+    //
+    // If it's not a free entry, don't bother with it.
+    // If desc is below min allowed address, skip it
+    //
+    if ((Node->Type == EfiConventionalMemory) && (Node->End >= MinAddress)) {
+      DescStart = Node->Start;
+      DescEnd = Node->End;
+
+      //
+      // If desc ends past max allowed address, clip the end
+      //
+      if (DescEnd >= MaxAddress) {
+        DescEnd = MaxAddress;
+      }
+
+      DescEnd = ((DescEnd + 1) & (~(Alignment - 1))) - 1;
+
+      //
+      // Compute the number of bytes we can used from this
+      // descriptor, and see it's enough to satisfy the request.
+      // The start of the allocated range must not be below the
+      // min address allowed
+      //
+      DescNumberOfBytes = DescEnd - DescStart + 1;
+
+      if ((DescNumberOfBytes >= NumberOfBytes) && ((DescEnd - NumberOfBytes + 1) >= MinAddress)) {
+        return DescEnd;
+      }
+    }
+  }
+
+  //
+  // Every descriptor in the left subtree ends below Node
+  //
+  if (Node->Start > MinAddress) {
+    return FindFreeRangeInMemoryMapIndex (Node->IndexLeft, MaxAddress, MinAddress, NumberOfBytes, Alignment);
+  }
+
+  return 0;
+}
+
 /**
   Internal function. Finds a consecutive free page range below
   the requested address.
@@ -983,11 +1327,6 @@ CoreFindFreePagesI (
 {
   UINT64          NumberOfBytes;
   UINT64          Target;
-  UINT64          DescStart;
-  UINT64          DescEnd;
-  UINT64          DescNumberOfBytes;
-  LIST_ENTRY      *Link;
-  MEMORY_MAP      *Entry;
 
   if ((MaxAddress < EFI_PAGE_MASK) ||(NumberOfPages == 0)) {
     return 0;
@@ -1016,59 +1355,11 @@ CoreFindFreePagesI (
   }
 
   NumberOfBytes = LShiftU64 (NumberOfPages, EFI_PAGE_SHIFT);
-  Target = 0;
-
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-    //
-    // If it's not a free entry, don't bother with it
-    //
-    if (Entry->Type != EfiConventionalMemory) {
-      continue;
-    }
 
-    DescStart = Entry->Start;
-    DescEnd = Entry->End;
-
-    //
-    // If desc is past max allowed address or below min allowed address, skip it
-    //
-    if ((DescStart >= MaxAddress) || (DescEnd < MinAddress)) {
-      continue;
-    }
-
-    //
-    // If desc ends past max allowed address, clip the end
-    //
-    if (DescEnd >= MaxAddress) {
-      DescEnd = MaxAddress;
-    }
-
-    DescEnd = ((DescEnd + 1) & (~(Alignment - 1))) - 1;
-
-    //
-    // Compute the number of bytes we can used from this
-    // descriptor, and see it's enough to satisfy the request
-    //
-    DescNumberOfBytes = DescEnd - DescStart + 1;
-
-    if (DescNumberOfBytes >= NumberOfBytes) {
-      //
-      // If the start of the allocated range is below the min address allowed, skip it
-      //
-      if ((DescEnd - NumberOfBytes + 1) < MinAddress) {
-        continue;
-      }
-
-      //
-      // If this is the best match so far remember it
-      //
-      if (DescEnd > Target) {
-        Target = DescEnd;
-      }
-    }
-  }
+  //
+  // The highest free descriptor that can hold the request is the best match
+  //
+  Target = FindFreeRangeInMemoryMapIndex (mMemoryMapIndex, MaxAddress, MinAddress, NumberOfBytes, Alignment);
 
   //
   // If this is a grow down, adjust target to be the allocation base
@@ -1324,7 +1615,6 @@ CoreInternalFreePages (
   )
 {
   EFI_STATUS      Status;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
   UINTN           Alignment;
 
@@ -1336,21 +1626,14 @@ CoreInternalFreePages (
   //
   // Find the entry that the covers the range
   //
-  Entry = NULL;
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR(Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    if (Entry->Start <= Memory && Entry->End > Memory) {
-        break;
-    }
-  }
-  if (Link == &gMemoryMap) {
+  Entry = FindMemoryMapEntry (Memory);
+  if (Entry == NULL) {
     Status = EFI_NOT_FOUND;
     goto Done;
   }
 
   Alignment = EFI_DEFAULT_PAGE_ALLOCATION_ALIGNMENT;
 
-  ASSERT (Entry != NULL);
   if  (Entry->Type == EfiACPIReclaimMemory   ||
        Entry->Type == EfiACPIMemoryNVS       ||
        Entry->Type == EfiRuntimeServicesCode ||
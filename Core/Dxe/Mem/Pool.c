@@ -62,6 +62,37 @@ STATIC CONST UINT16 mPoolSizeTable[] = {
 
 #define MAX_POOL_SIZE     (MAX_ADDRESS - POOL_OVERHEAD)
 
+//
+// Small allocations are served from slabs. A slab is one pool page that holds
+// objects of a single size class. The size classes are multiples of the cache
+// line size, so an object never shares a cache line with its neighbours.
+//
+#define POOL_SLAB_ALIGNMENT       64
+#define POOL_SLAB_CLASS_COUNT     8
+#define POOL_SLAB_MAX_SIZE        (POOL_SLAB_ALIGNMENT * POOL_SLAB_CLASS_COUNT)
+
+#define SIZE_TO_SLAB_CLASS(a)     (((a) - 1) / POOL_SLAB_ALIGNMENT)
+#define SLAB_CLASS_TO_SIZE(a)     (((a) + 1) * POOL_SLAB_ALIGNMENT)
+
+#define POOL_SLAB_FREE_SIGNATURE  SIGNATURE_32('p','s','f','0')
+typedef struct _POOL_SLAB_FREE {
+  UINT32                  Signature;
+  UINT32                  Reserved;
+  struct _POOL_SLAB_FREE  *Next;
+} POOL_SLAB_FREE;
+
+#define POOL_SLAB_SIGNATURE       SIGNATURE_32('p','s','l','b')
+typedef struct {
+  UINT32          Signature;
+  UINT32          Class;
+  UINT32          ObjectCount;
+  UINT32          FreeCount;
+  POOL_SLAB_FREE  *FreeObject;
+  LIST_ENTRY      Link;
+} POOL_SLAB;
+
+#define POOL_SLAB_OBJECT_OFFSET   ALIGN_VALUE (sizeof (POOL_SLAB), POOL_SLAB_ALIGNMENT)
+
 //
 // Globals
 //
@@ -72,6 +103,7 @@ typedef struct {
     UINTN            Used;
     EFI_MEMORY_TYPE  MemoryType;
     LIST_ENTRY       FreeList[MAX_POOL_LIST];
+    LIST_ENTRY       SlabList[POOL_SLAB_CLASS_COUNT];
     LIST_ENTRY       Link;
 } POOL;
 
@@ -85,6 +117,11 @@ POOL            mPoolHead[EfiMaxMemoryType];
 //
 LIST_ENTRY      mPoolHeadList = INITIALIZE_LIST_HEAD_VARIABLE (mPoolHeadList);
 
+//
+// Slab allocator statistics for each size class, summed over all memory types.
+//
+MEMORY_PROFILE_POOL_SLAB_CLASS  mPoolSlabStatistics[POOL_SLAB_CLASS_COUNT];
+
 /**
   Get pool size table index from the specified size.
 
@@ -128,6 +165,9 @@ CoreInitializePool (
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&mPoolHead[Type].FreeList[Index]);
     }
+    for (Index=0; Index < POOL_SLAB_CLASS_COUNT; Index++) {
+      InitializeListHead (&mPoolHead[Type].SlabList[Index]);
+    }
   }
 }
 
@@ -177,6 +217,9 @@ LookupPoolHead (
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&Pool->FreeList[Index]);
     }
+    for (Index=0; Index < POOL_SLAB_CLASS_COUNT; Index++) {
+      InitializeListHead (&Pool->SlabList[Index]);
+    }
 
     InsertHeadList (&mPoolHeadList, &Pool->Link);
 
@@ -186,7 +229,207 @@ LookupPoolHead (
   return NULL;
 }
 
+/**
+  Allocate an object from the slabs of a pool.
+  Caller must have the memory lock held
+
+  @param  Pool                   The pool to allocate from
+  @param  Class                  The slab size class of the object
+  @param  Granularity            The size of one slab
 
+  @return The allocated object, or NULL
+
+**/
+STATIC
+POOL_HEAD *
+AllocatePoolSlabObject (
+  IN POOL   *Pool,
+  IN UINTN  Class,
+  IN UINTN  Granularity
+  )
+{
+  POOL_SLAB       *Slab;
+  POOL_SLAB_FREE  *Free;
+  CHAR8           *NewPage;
+  UINTN           ObjectSize;
+  UINTN           Offset;
+
+  //
+  // If no slab of this class has a free object, go get another page
+  //
+  if (IsListEmpty (&Pool->SlabList[Class])) {
+    NewPage = CoreAllocatePoolPages (Pool->MemoryType, EFI_SIZE_TO_PAGES (Granularity), Granularity);
+    if (NewPage == NULL) {
+      return NULL;
+    }
+
+    Slab = (POOL_SLAB *) NewPage;
+    Slab->Signature   = POOL_SLAB_SIGNATURE;
+    Slab->Class       = (UINT32) Class;
+    Slab->ObjectCount = 0;
+    Slab->FreeObject  = NULL;
+
+    //
+    // Put the objects on the free list so that the lowest one is used first
+    //
+    ObjectSize = SLAB_CLASS_TO_SIZE (Class);
+    Offset = POOL_SLAB_OBJECT_OFFSET + ((Granularity - POOL_SLAB_OBJECT_OFFSET) / ObjectSize) * ObjectSize;
+    while (Offset > POOL_SLAB_OBJECT_OFFSET) {
+      Offset -= ObjectSize;
+      Free = (POOL_SLAB_FREE *) &NewPage[Offset];
+      Free->Signature  = POOL_SLAB_FREE_SIGNATURE;
+      Free->Next       = Slab->FreeObject;
+      Slab->FreeObject = Free;
+      Slab->ObjectCount++;
+    }
+    Slab->FreeCount = Slab->ObjectCount;
+    InsertHeadList (&Pool->SlabList[Class], &Slab->Link);
+
+    mPoolSlabStatistics[Class].SlabAllocateCount++;
+    mPoolSlabStatistics[Class].CurrentSlabPages += EFI_SIZE_TO_PAGES (Granularity);
+    if (mPoolSlabStatistics[Class].PeakSlabPages < mPoolSlabStatistics[Class].CurrentSlabPages) {
+      mPoolSlabStatistics[Class].PeakSlabPages = mPoolSlabStatistics[Class].CurrentSlabPages;
+    }
+  }
+
+  Slab = CR (Pool->SlabList[Class].ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+  Free = Slab->FreeObject;
+  ASSERT (Free != NULL);
+  ASSERT (Free->Signature == POOL_SLAB_FREE_SIGNATURE);
+  Slab->FreeObject = Free->Next;
+  Slab->FreeCount--;
+
+  //
+  // A full slab has nothing more to give, so take it off the list
+  //
+  if (Slab->FreeCount == 0) {
+    RemoveEntryList (&Slab->Link);
+  }
+
+  mPoolSlabStatistics[Class].AllocateCount++;
+  return (POOL_HEAD *) Free;
+}
+
+/**
+  Return an object to the slab it was allocated from.
+  Caller must have the memory lock held
+
+  @param  Pool                   The pool the object belongs to
+  @param  Slab                   The slab the object belongs to
+  @param  Head                   The object to free
+  @param  Granularity            The size of one slab
+
+**/
+STATIC
+VOID
+FreePoolSlabObject (
+  IN POOL       *Pool,
+  IN POOL_SLAB  *Slab,
+  IN POOL_HEAD  *Head,
+  IN UINTN      Granularity
+  )
+{
+  POOL_SLAB_FREE  *Free;
+  UINTN           Class;
+
+  Class = Slab->Class;
+  ASSERT (Class < POOL_SLAB_CLASS_COUNT);
+
+  Free = (POOL_SLAB_FREE *) Head;
+  Free->Signature  = POOL_SLAB_FREE_SIGNATURE;
+  Free->Next       = Slab->FreeObject;
+  Slab->FreeObject = Free;
+  Slab->FreeCount++;
+  mPoolSlabStatistics[Class].FreeCount++;
+
+  //
+  // A full slab that gets an object back can serve allocations again
+  //
+  if (Slab->FreeCount == 1) {
+    InsertHeadList (&Pool->SlabList[Class], &Slab->Link);
+  }
+
+  //
+  // Return an empty slab to the page allocator. The last slab of the class is
+  // kept, so that an allocate/free pair does not thrash the page allocator.
+  //
+  if ((Slab->FreeCount == Slab->ObjectCount) &&
+      (Pool->SlabList[Class].ForwardLink != Pool->SlabList[Class].BackLink)) {
+    RemoveEntryList (&Slab->Link);
+    Slab->Signature = 0;
+    CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN) Slab, EFI_SIZE_TO_PAGES (Granularity));
+
+    mPoolSlabStatistics[Class].SlabReleaseCount++;
+    mPoolSlabStatistics[Class].CurrentSlabPages -= EFI_SIZE_TO_PAGES (Granularity);
+  }
+}
+
+/**
+  Return all of the slabs of a pool to the page allocator.
+  Caller must have the memory lock held, and all of the objects
+  of the pool must have been freed.
+
+  @param  Pool                   The pool to release the slabs of
+  @param  Granularity            The size of one slab
+
+**/
+STATIC
+VOID
+ReleasePoolSlabs (
+  IN POOL   *Pool,
+  IN UINTN  Granularity
+  )
+{
+  POOL_SLAB   *Slab;
+  UINTN       Class;
+
+  for (Class = 0; Class < POOL_SLAB_CLASS_COUNT; Class++) {
+    while (!IsListEmpty (&Pool->SlabList[Class])) {
+      Slab = CR (Pool->SlabList[Class].ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+      ASSERT (Slab->FreeCount == Slab->ObjectCount);
+      RemoveEntryList (&Slab->Link);
+      Slab->Signature = 0;
+      CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN) Slab, EFI_SIZE_TO_PAGES (Granularity));
+
+      mPoolSlabStatistics[Class].SlabReleaseCount++;
+      mPoolSlabStatistics[Class].CurrentSlabPages -= EFI_SIZE_TO_PAGES (Granularity);
+    }
+  }
+}
+
+/**
+  Get the statistics of the pool slab allocator.
+
+  @param  SlabClass              Buffer to receive one record for each slab size
+                                 class. It may be NULL to get the record count only.
+
+  @return The number of slab size classes.
+
+**/
+UINTN
+CoreGetPoolSlabStatistics (
+  OUT MEMORY_PROFILE_POOL_SLAB_CLASS  *SlabClass OPTIONAL
+  )
+{
+  UINTN   Class;
+
+  if (SlabClass == NULL) {
+    return POOL_SLAB_CLASS_COUNT;
+  }
+
+  CoreAcquireMemoryLock ();
+  CopyMem (SlabClass, mPoolSlabStatistics, sizeof (mPoolSlabStatistics));
+  CoreReleaseMemoryLock ();
+
+  for (Class = 0; Class < POOL_SLAB_CLASS_COUNT; Class++) {
+    SlabClass[Class].Header.Signature = MEMORY_PROFILE_POOL_SLAB_CLASS_SIGNATURE;
+    SlabClass[Class].Header.Length    = sizeof (MEMORY_PROFILE_POOL_SLAB_CLASS);
+    SlabClass[Class].Header.Revision  = MEMORY_PROFILE_POOL_SLAB_CLASS_REVISION;
+    SlabClass[Class].ObjectSize       = (UINT32) SLAB_CLASS_TO_SIZE (Class);
+  }
+
+  return POOL_SLAB_CLASS_COUNT;
+}
 
 /**
   Allocate pool of a particular type.
@@ -336,6 +579,15 @@ CoreAllocatePoolI (
   }
   Head = NULL;
 
+  //
+  // Small allocations are served from the slabs, unless a block of the
+  // right size is already sitting on the free list
+  //
+  if ((Size <= POOL_SLAB_MAX_SIZE) && IsListEmpty (&Pool->FreeList[Index])) {
+    Head = AllocatePoolSlabObject (Pool, SIZE_TO_SLAB_CLASS (Size), Granularity);
+    goto Done;
+  }
+
   //
   // If allocation is over max size, just allocate pages for the request
   // (slow)
@@ -521,6 +773,7 @@ CoreFreePoolI (
   POOL_HEAD   *Head;
   POOL_TAIL   *Tail;
   POOL_FREE   *Free;
+  POOL_SLAB   *Slab;
   UINTN       Index;
   UINTN       NoPages;
   UINTN       Size;
@@ -586,11 +839,20 @@ CoreFreePoolI (
   DEBUG_CLEAR_MEMORY (Head, Size);
 
   //
-  // If it's not on the list, it must be pool pages
+  // A slab object lives in a page that starts with the slab header
   //
-  if (Index >= SIZE_TO_LIST (Granularity)) {
+  Slab = (POOL_SLAB *) ((UINTN) Head & ~(Granularity - 1));
+  if (Slab->Signature == POOL_SLAB_SIGNATURE) {
+
+    //
+    // Return the object to its slab
+    //
+    FreePoolSlabObject (Pool, Slab, Head, Granularity);
+
+  } else if (Index >= SIZE_TO_LIST (Granularity)) {
 
     //
+    // If it's not on the list, it must be pool pages.
     // Return the memory pages back to free memory
     //
     NoPages = EFI_SIZE_TO_PAGES(Size) + EFI_SIZE_TO_PAGES (Granularity) - 1;
@@ -662,6 +924,7 @@ CoreFreePoolI (
   // list entry for that memory type
   //
   if ((INT32)Pool->MemoryType < 0 && Pool->Used == 0) {
+    ReleasePoolSlabs (Pool, Granularity);
     RemoveEntryList (&Pool->Link);
     CoreFreePoolI (Pool);
   }
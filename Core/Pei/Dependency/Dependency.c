@@ -251,3 +251,55 @@ PeimDispatchReadiness (
     }
   }
 }
+
+/**
+
+  Get the PPI hash chains that a dependency expression refers to.
+
+  Only the installation of a PPI in one of these hash chains can change the
+  result of the dependency expression.
+
+  @param DependencyExpression   Pointer to a dependency expression.
+
+  @return The bit mask of the PPI hash chains that the dependency expression refers to.
+          All the bits are set if the dependency expression is not a well-formed Grammar.
+
+**/
+UINT32
+PeimDepexPpiHashMask (
+  IN VOID               *DependencyExpression
+  )
+{
+  DEPENDENCY_EXPRESSION_OPERAND  *Iterator;
+  UINT32                         HashMask;
+  UINTN                          PushCount;
+
+  Iterator  = DependencyExpression;
+  HashMask  = 0;
+  PushCount = 0;
+
+  while (PushCount < MAX_GRAMMAR_SIZE) {
+    switch (*(Iterator++)) {
+      case (EFI_DEP_PUSH):
+        HashMask |= (UINT32) 1 << PpiGuidHash ((EFI_GUID *) Iterator);
+        Iterator  = Iterator + sizeof (EFI_GUID);
+        PushCount++;
+        break;
+
+      case (EFI_DEP_END):
+        return HashMask;
+
+      case (EFI_DEP_AND):
+      case (EFI_DEP_OR):
+      case (EFI_DEP_NOT):
+      case (EFI_DEP_TRUE):
+      case (EFI_DEP_FALSE):
+        break;
+
+      default:
+        return MAX_UINT32;
+    }
+  }
+
+  return MAX_UINT32;
+}
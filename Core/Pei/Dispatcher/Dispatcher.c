@@ -786,7 +786,8 @@ PeiDispatcher (
         PeimFileHandle = Private->CurrentFileHandle = Private->CurrentFvFileHandles[PeimCount];
 
         if (Private->Fv[FvCount].PeimState[PeimCount] == PEIM_STATE_NOT_DISPATCHED) {
-          if (!DepexSatisfied (Private, PeimFileHandle, PeimCount)) {
+          if (!PeimDepexMayBeSatisfied (Private, &Private->Fv[FvCount].PeimDepexWait[PeimCount]) ||
+              !DepexSatisfied (Private, PeimFileHandle, PeimCount)) {
             Private->PeimNeedingDispatch = TRUE;
           } else {
             Status = CoreFvHandle->FvPpi->GetFileInfo (CoreFvHandle->FvPpi, PeimFileHandle, &FvFileInfo);
@@ -819,7 +820,8 @@ PeiDispatcher (
                 // The PEIM has its dependencies satisfied, and its entry point
                 // has been found, so invoke it.
                 //
-                PERF_START (PeimFileHandle, "PEIM", NULL, 0);
+                Private->DispatchedPeimCount++;
+                PERF_START_EX (PeimFileHandle, "PEIM", NULL, 0, Private->DispatchedPeimCount);
 
                 REPORT_STATUS_CODE_WITH_EXTENDED_DATA (
                   EFI_PROGRESS_CODE,
@@ -848,7 +850,7 @@ PeiDispatcher (
                   (VOID *)(&PeimFileHandle),
                   sizeof (PeimFileHandle)
                   );
-                PERF_END (PeimFileHandle, "PEIM", NULL, 0);
+                PERF_END_EX (PeimFileHandle, "PEIM", NULL, 0, Private->DispatchedPeimCount);
 
               }
             }
@@ -1211,6 +1213,7 @@ DepexSatisfied (
   EFI_STATUS           Status;
   VOID                 *DepexData;
   EFI_FV_FILE_INFO     FileInfo;
+  PEIM_DEPEX_WAIT      *DepexWait;
 
   Status = PeiServicesFfsGetFileInfo (FileHandle, &FileInfo);
   if (EFI_ERROR (Status)) {
@@ -1247,7 +1250,54 @@ DepexSatisfied (
   //
   // Evaluate a given DEPEX
   //
-  return PeimDispatchReadiness (&Private->Ps, DepexData);
+  DepexWait = &Private->Fv[Private->CurrentPeimFvCount].PeimDepexWait[PeimCount];
+  DepexWait->InstallSequence = Private->PpiData.InstallSequence;
+  if (PeimDispatchReadiness (&Private->Ps, DepexData)) {
+    return TRUE;
+  }
+
+  //
+  // The DEPEX can only become TRUE after a PPI it refers to is installed.
+  //
+  if (!DepexWait->Waiting) {
+    DepexWait->PpiHashMask = PeimDepexPpiHashMask (DepexData);
+    DepexWait->Waiting     = TRUE;
+  }
+  return FALSE;
+}
+
+/**
+  This routine checks whether a PPI that the DEPEX of a PEIM refers to has been
+  installed since the DEPEX was last evaluated to FALSE. If not, evaluating the
+  DEPEX again would return FALSE too.
+
+  @param Private         PeiCore's private data structure
+  @param DepexWait       The DEPEX waiting record of the PEIM.
+
+  @retval TRUE   The DEPEX needs to be evaluated.
+  @retval FALSE  The DEPEX is still not satisfied.
+
+**/
+BOOLEAN
+PeimDepexMayBeSatisfied (
+  IN PEI_CORE_INSTANCE          *Private,
+  IN PEIM_DEPEX_WAIT            *DepexWait
+  )
+{
+  UINTN                Index;
+
+  if (!DepexWait->Waiting) {
+    return TRUE;
+  }
+
+  for (Index = 0; Index < PEI_PPI_HASH_BUCKET_COUNT; Index++) {
+    if (((DepexWait->PpiHashMask & ((UINT32) 1 << Index)) != 0) &&
+        (Private->PpiData.HashInstallSequence[Index] > DepexWait->InstallSequence)) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
 }
 
 /**
@@ -256,6 +256,15 @@ FindFileEx (
   UINT8                                 FileState;
   UINT8                                 DataCheckSum;
   BOOLEAN                               IsFfs3Fv;
+  PEI_CORE_FV_HANDLE                    *CoreFvHandle;
+
+  //
+  // Search the file index of the FV if it has been built.
+  //
+  CoreFvHandle = FvHandleToCoreHandle (FvHandle);
+  if ((CoreFvHandle != NULL) && (CoreFvHandle->FileIndex != NULL) && (AprioriFile == NULL)) {
+    return FindFileInIndex (CoreFvHandle->FileIndex, FvHandle, FileName, SearchType, FileHandle);
+  }
   
   //
   // Convert the handle of FV to FV header for memory-mapped firmware volume
@@ -420,6 +429,238 @@ FindFileEx (
   return EFI_NOT_FOUND;  
 }
 
+/**
+  Get the name hash chain of a file in the FV file index.
+
+  @param FileName        Pointer to the name of the file.
+
+  @return The index of the hash chain.
+
+**/
+UINTN
+FvFileNameHash (
+  IN CONST EFI_GUID      *FileName
+  )
+{
+  UINT32                 Hash;
+
+  Hash  = ReadUnaligned32 ((UINT32 *) FileName) ^ ReadUnaligned32 ((UINT32 *) FileName + 1) ^
+          ReadUnaligned32 ((UINT32 *) FileName + 2) ^ ReadUnaligned32 ((UINT32 *) FileName + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return Hash % PEI_FV_FILE_INDEX_HASH_BUCKET_COUNT;
+}
+
+/**
+  Search the file index of a FV for the next matching file, with the same
+  result as walking the FV with FindFileEx().
+
+  @param FileIndex       Pointer to the file index of the FV.
+  @param FvHandle        Pointer to the FV header of the volume to search
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      On entry, the file to start the search after, or NULL to
+                         start with the first file. On exit, the file found.
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+FindFileInIndex (
+  IN        PEI_FV_FILE_INDEX        *FileIndex,
+  IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle
+  )
+{
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  UINTN                                 Index;
+  UINTN                                 Low;
+  UINTN                                 High;
+  UINTN                                 Offset;
+  EFI_FV_FILETYPE                       FileType;
+
+  if (FileName != NULL) {
+    for (Index = FileIndex->NameHashHead[FvFileNameHash (FileName)];
+         Index != PEI_FV_FILE_INDEX_END;
+         Index = FileIndex->File[Index].NameHashNext) {
+      FfsFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) FvHandle + FileIndex->File[Index].Offset);
+      if (CompareGuid (&FfsFileHeader->Name, FileName)) {
+        *FileHandle = FfsFileHeader;
+        return EFI_SUCCESS;
+      }
+    }
+
+    *FileHandle = NULL;
+    return EFI_NOT_FOUND;
+  }
+
+  if (*FileHandle == NULL) {
+    Index = 0;
+  } else {
+    Offset = (UINTN) *FileHandle - (UINTN) FvHandle;
+    Index  = FileIndex->LastFile;
+    if ((Index < FileIndex->FileCount) && (FileIndex->File[Index].Offset == Offset)) {
+      Index++;
+    } else {
+      //
+      // Find the first file after the current one.
+      //
+      Low  = 0;
+      High = FileIndex->FileCount;
+      while (Low < High) {
+        Index = (Low + High) / 2;
+        if (FileIndex->File[Index].Offset <= Offset) {
+          Low  = Index + 1;
+        } else {
+          High = Index;
+        }
+      }
+      Index = Low;
+    }
+  }
+
+  for (; Index < FileIndex->FileCount; Index++) {
+    FileType = FileIndex->File[Index].Type;
+    if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
+      if ((FileType != EFI_FV_FILETYPE_PEIM) &&
+          (FileType != EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) &&
+          (FileType != EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+        continue;
+      }
+    } else if ((SearchType != FileType) && (SearchType != EFI_FV_FILETYPE_ALL)) {
+      continue;
+    }
+
+    FileIndex->LastFile = (UINT32) Index;
+    *FileHandle = (EFI_PEI_FILE_HANDLE) ((UINT8 *) FvHandle + FileIndex->File[Index].Offset);
+    return EFI_SUCCESS;
+  }
+
+  *FileHandle = NULL;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Build the file index of a FV that is searched by the build-in
+  EFI_PEI_FIRMWARE_VOLUME_PPI, and pass it to DXE core in a HOB.
+
+  The files are validated once here, so the following searches of the FV
+  do not need to walk the FV and calculate the checksums again.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the FV.
+
+**/
+VOID
+BuildFvFileIndex (
+  IN PEI_CORE_FV_HANDLE          *CoreFvHandle
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_FIRMWARE_VOLUME_HEADER    *FwVolHeader;
+  EFI_FFS_FILE_HEADER           *FfsFileHeader;
+  EFI_PEI_FILE_HANDLE           FileHandle;
+  PEI_FV_FILE_INDEX             *FileIndex;
+  FV_FILE_INDEX_HOB             *FileIndexHob;
+  UINT32                        *FileOffset;
+  UINT16                        *Link;
+  UINTN                         FileCount;
+  UINTN                         Index;
+  UINT64                        NextOffset;
+  UINT8                         *Buffer;
+  UINT8                         ErasedByte;
+
+  if (!FeaturePcdGet (PcdPeiCoreFvFileIndex)) {
+    return;
+  }
+
+  //
+  // Only the FVs searched by FindFileEx() are indexed.
+  //
+  if ((CoreFvHandle->FvPpi != &mPeiFfs2FwVol.Fv) && (CoreFvHandle->FvPpi != &mPeiFfs3FwVol.Fv)) {
+    return;
+  }
+
+  ASSERT (CoreFvHandle->FileIndex == NULL);
+  FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *) CoreFvHandle->FvHandle;
+
+  FileCount  = 0;
+  FileHandle = NULL;
+  while (!EFI_ERROR (FindFileEx (CoreFvHandle->FvHandle, NULL, EFI_FV_FILETYPE_ALL, &FileHandle, NULL))) {
+    FileCount++;
+  }
+  if ((FileCount == 0) || (FileCount >= PEI_FV_FILE_INDEX_END)) {
+    return;
+  }
+
+  FileIndex = AllocatePool (sizeof (PEI_FV_FILE_INDEX) + (FileCount - 1) * sizeof (PEI_FV_FILE_INDEX_ENTRY));
+  if (FileIndex == NULL) {
+    return;
+  }
+
+  FileIndex->FileCount = (UINT32) FileCount;
+  FileIndex->LastFile  = 0;
+  SetMem (FileIndex->NameHashHead, sizeof (FileIndex->NameHashHead), 0xFF);
+
+  FileHandle = NULL;
+  for (Index = 0; Index < FileCount; Index++) {
+    Status = FindFileEx (CoreFvHandle->FvHandle, NULL, EFI_FV_FILETYPE_ALL, &FileHandle, NULL);
+    ASSERT_EFI_ERROR (Status);
+    FfsFileHeader = (EFI_FFS_FILE_HEADER *) FileHandle;
+
+    FileIndex->File[Index].Offset       = (UINT32) ((UINTN) FfsFileHeader - (UINTN) FwVolHeader);
+    FileIndex->File[Index].NameHashNext = PEI_FV_FILE_INDEX_END;
+    FileIndex->File[Index].Type         = FfsFileHeader->Type;
+    FileIndex->File[Index].Reserved     = 0;
+
+    Link = &FileIndex->NameHashHead[FvFileNameHash (&FfsFileHeader->Name)];
+    while (*Link != PEI_FV_FILE_INDEX_END) {
+      Link = &FileIndex->File[*Link].NameHashNext;
+    }
+    *Link = (UINT16) Index;
+  }
+
+  CoreFvHandle->FileIndex = FileIndex;
+  DEBUG ((EFI_D_INFO, "The FV %p has %d files indexed\n", FwVolHeader, (UINT32) FileCount));
+
+  //
+  // DXE core also lists the deleted files and stops at the free space, so only
+  // pass the index on if the last indexed file is followed by the free space.
+  //
+  if (IS_FFS_FILE2 (FfsFileHeader)) {
+    NextOffset = FileIndex->File[FileCount - 1].Offset + GET_OCCUPIED_SIZE (FFS_FILE2_SIZE (FfsFileHeader), 8);
+  } else {
+    NextOffset = FileIndex->File[FileCount - 1].Offset + GET_OCCUPIED_SIZE (FFS_FILE_SIZE (FfsFileHeader), 8);
+  }
+  if (NextOffset + sizeof (EFI_FFS_FILE_HEADER) <= FwVolHeader->FvLength) {
+    ErasedByte = (UINT8) (((FwVolHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0) ? 0xFF : 0);
+    Buffer     = (UINT8 *) FwVolHeader + (UINTN) NextOffset;
+    for (Index = 0; Index < sizeof (EFI_FFS_FILE_HEADER); Index++) {
+      if (Buffer[Index] != ErasedByte) {
+        return;
+      }
+    }
+  }
+
+  FileIndexHob = BuildGuidHob (&gEdkiiFvFileIndexHobGuid, sizeof (FV_FILE_INDEX_HOB) + FileCount * sizeof (UINT32));
+  if (FileIndexHob == NULL) {
+    return;
+  }
+  FileIndexHob->FvBase     = (EFI_PHYSICAL_ADDRESS) (UINTN) FwVolHeader;
+  FileIndexHob->FvLength   = FwVolHeader->FvLength;
+  FileIndexHob->FvChecksum = FwVolHeader->Checksum;
+  FileIndexHob->Reserved   = 0;
+  FileIndexHob->FileCount  = (UINT32) FileCount;
+  FileOffset = (UINT32 *) (FileIndexHob + 1);
+  for (Index = 0; Index < FileCount; Index++) {
+    FileOffset[Index] = FileIndex->File[Index].Offset;
+  }
+}
+
 /**
   Initialize PeiCore Fv List.
 
@@ -486,6 +727,7 @@ PeiInitializeFv (
     FvHandle
     ));    
   PrivateData->FvCount ++;
+  BuildFvFileIndex (&PrivateData->Fv[PrivateData->FvCount - 1]);
                             
   //
   // Post a call-back for the FvInfoPPI and FvInfo2PPI services to expose
@@ -600,6 +842,7 @@ FirmwareVolmeInfoPpiNotifyCallback (
       FvHandle
       ));    
     PrivateData->FvCount ++;
+    BuildFvFileIndex (&PrivateData->Fv[PrivateData->FvCount - 1]);
 
     //
     // Scan and process the new discoveried FV for EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE 
@@ -308,6 +308,43 @@ FindFileEx (
   IN OUT    EFI_PEI_FV_HANDLE        *AprioriFile  OPTIONAL
   );
 
+/**
+  Search the file index of a FV for the next matching file, with the same
+  result as walking the FV with FindFileEx().
+
+  @param FileIndex       Pointer to the file index of the FV.
+  @param FvHandle        Pointer to the FV header of the volume to search
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      On entry, the file to start the search after, or NULL to
+                         start with the first file. On exit, the file found.
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+FindFileInIndex (
+  IN        PEI_FV_FILE_INDEX        *FileIndex,
+  IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle
+  );
+
+/**
+  Build the file index of a FV that is searched by the build-in
+  EFI_PEI_FIRMWARE_VOLUME_PPI, and pass it to DXE core in a HOB.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the FV.
+
+**/
+VOID
+BuildFvFileIndex (
+  IN PEI_CORE_FV_HANDLE          *CoreFvHandle
+  );
+
 /**
   Report the information for a new discoveried FV in unknown format.
   
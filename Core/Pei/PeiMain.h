@@ -47,6 +47,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
 #include <Guid/AprioriFileName.h>
+#include <Guid/FvFileIndexHob.h>
 
 ///
 /// It is an FFS type extension used for PeiFindFileEx. It indicates current
@@ -63,6 +64,11 @@ typedef union {
   VOID                        *Raw;
 } PEI_PPI_LIST_POINTERS;
 
+///
+/// Number of hash chains the installed PPIs and the registered notifies are indexed by.
+///
+#define PEI_PPI_HASH_BUCKET_COUNT  16
+
 ///
 /// PPI database structure which contains two link: PpiList and NotifyList. PpiList
 /// is in head of PpiListPtrs array and notify is in end of PpiListPtrs.
@@ -92,6 +98,29 @@ typedef struct {
   /// Ppi database has the PcdPeiCoreMaxPpiSupported number of entries.
   ///
   PEI_PPI_LIST_POINTERS   *PpiListPtrs;
+  ///
+  /// Index of the first installed PPI in each hash chain, or -1 if the chain is empty.
+  /// The PPIs of a chain are in ascending index order.
+  ///
+  INTN                    PpiHashHead[PEI_PPI_HASH_BUCKET_COUNT];
+  ///
+  /// Index of the first registered notify in each hash chain, or -1 if the chain is empty.
+  /// The notifies of a chain are in descending index order.
+  ///
+  INTN                    NotifyHashHead[PEI_PPI_HASH_BUCKET_COUNT];
+  ///
+  /// Index of the next entry in the same hash chain for each entry of PpiListPtrs,
+  /// or -1 for the last entry of a chain.
+  ///
+  INTN                    *HashNext;
+  ///
+  /// Incremented each time a PPI is installed or reinstalled.
+  ///
+  UINT32                  InstallSequence;
+  ///
+  /// InstallSequence of the last PPI installed or reinstalled in each hash chain.
+  ///
+  UINT32                  HashInstallSequence[PEI_PPI_HASH_BUCKET_COUNT];
 } PEI_PPI_DATABASE;
 
 
@@ -105,6 +134,60 @@ typedef struct {
 #define PEIM_STATE_REGISITER_FOR_SHADOW   0x02
 #define PEIM_STATE_DONE                   0x03
 
+///
+/// Records the dependency expression of a PEIM that is waiting for PPIs, so that
+/// the dependency expression is only evaluated again after one of the PPIs it
+/// refers to is installed.
+///
+typedef struct {
+  ///
+  /// TRUE if the dependency expression has been evaluated to FALSE.
+  ///
+  BOOLEAN                             Waiting;
+  ///
+  /// Bit mask of the PPI hash chains that the dependency expression refers to.
+  ///
+  UINT32                              PpiHashMask;
+  ///
+  /// PpiData.InstallSequence when the dependency expression was last evaluated.
+  ///
+  UINT32                              InstallSequence;
+} PEIM_DEPEX_WAIT;
+
+#define PEI_FV_FILE_INDEX_HASH_BUCKET_COUNT  32
+#define PEI_FV_FILE_INDEX_END                0xFFFF
+
+typedef struct {
+  ///
+  /// Offset of the FFS file header from the start of the firmware volume.
+  ///
+  UINT32                              Offset;
+  ///
+  /// Index of the next file in the same name hash chain, or PEI_FV_FILE_INDEX_END.
+  ///
+  UINT16                              NameHashNext;
+  EFI_FV_FILETYPE                     Type;
+  UINT8                               Reserved;
+} PEI_FV_FILE_INDEX_ENTRY;
+
+///
+/// Index of the valid FFS files of a memory-mapped firmware volume, in volume order.
+///
+typedef struct {
+  UINT32                              FileCount;
+  ///
+  /// Index of the file that was found last, so that searching for the next
+  /// file does not need to look the current file up.
+  ///
+  UINT32                              LastFile;
+  ///
+  /// Index of the first file in each name hash chain, or PEI_FV_FILE_INDEX_END.
+  /// The files of a chain are in volume order.
+  ///
+  UINT16                              NameHashHead[PEI_FV_FILE_INDEX_HASH_BUCKET_COUNT];
+  PEI_FV_FILE_INDEX_ENTRY             File[1];
+} PEI_FV_FILE_INDEX;
+
 typedef struct {
   EFI_FIRMWARE_VOLUME_HEADER          *FvHeader;
   EFI_PEI_FIRMWARE_VOLUME_PPI         *FvPpi;
@@ -117,6 +200,14 @@ typedef struct {
   // Ponter to the buffer with the PcdPeiCoreMaxPeimPerFv number of Entries.
   //
   EFI_PEI_FILE_HANDLE                 *FvFileHandles;
+  //
+  // Ponter to the buffer with the PcdPeiCoreMaxPeimPerFv number of Entries.
+  //
+  PEIM_DEPEX_WAIT                     *PeimDepexWait;
+  //
+  // Pointer to the file index of the FV, or NULL if the FV is not indexed.
+  //
+  PEI_FV_FILE_INDEX                   *FileIndex;
   BOOLEAN                             ScanFv;
   UINT32                              AuthenticationStatus;
 } PEI_CORE_FV_HANDLE;
@@ -217,6 +308,11 @@ struct _PEI_CORE_INSTANCE {
   BOOLEAN                            PeimNeedingDispatch;
   BOOLEAN                            PeimDispatchOnThisPass;
   BOOLEAN                            PeimDispatcherReenter;
+  ///
+  /// The number of PEIMs whose entry point has been called. It is used as the
+  /// identifier of the performance records of the PEIMs.
+  ///
+  UINT32                             DispatchedPeimCount;
   EFI_PEI_HOB_POINTERS               HobList;
   BOOLEAN                            SwitchStackSignal;
   BOOLEAN                            PeiMemoryInstalled;
@@ -351,6 +447,24 @@ PeimDispatchReadiness (
   IN VOID               *DependencyExpression
   );
 
+/**
+
+  Get the PPI hash chains that a dependency expression refers to.
+
+  Only the installation of a PPI in one of these hash chains can change the
+  result of the dependency expression.
+
+  @param DependencyExpression   Pointer to a dependency expression.
+
+  @return The bit mask of the PPI hash chains that the dependency expression refers to.
+          All the bits are set if the dependency expression is not a well-formed Grammar.
+
+**/
+UINT32
+PeimDepexPpiHashMask (
+  IN VOID               *DependencyExpression
+  );
+
 /**
   Conduct PEIM dispatch.
 
@@ -401,6 +515,24 @@ DepexSatisfied (
   IN UINTN                      PeimCount
   );
 
+/**
+  This routine checks whether a PPI that the DEPEX of a PEIM refers to has been
+  installed since the DEPEX was last evaluated to FALSE. If not, evaluating the
+  DEPEX again would return FALSE too.
+
+  @param Private         PeiCore's private data structure
+  @param DepexWait       The DEPEX waiting record of the PEIM.
+
+  @retval TRUE           The DEPEX needs to be evaluated.
+  @retval FALSE          The DEPEX is still not satisfied.
+
+**/
+BOOLEAN
+PeimDepexMayBeSatisfied (
+  IN PEI_CORE_INSTANCE          *Private,
+  IN PEIM_DEPEX_WAIT            *DepexWait
+  );
+
 //
 // PPI support functions
 //
@@ -419,6 +551,20 @@ InitializePpiServices (
   IN PEI_CORE_INSTANCE   *OldCoreData
   );
 
+/**
+
+  Get the hash chain of a PPI GUID.
+
+  @param Guid            Pointer to GUID of the PPI.
+
+  @return The index of the hash chain.
+
+**/
+UINTN
+PpiGuidHash (
+  IN CONST EFI_GUID      *Guid
+  );
+
 /**
 
   Migrate the Hob list from the temporary memory stack to PEI installed memory.
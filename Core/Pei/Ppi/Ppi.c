@@ -14,6 +14,133 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "PeiMain.h"
 
+/**
+
+  Get the hash chain of a PPI GUID.
+
+  @param Guid            Pointer to GUID of the PPI.
+
+  @return The index of the hash chain.
+
+**/
+UINTN
+PpiGuidHash (
+  IN CONST EFI_GUID      *Guid
+  )
+{
+  UINT32                 Hash;
+
+  Hash  = ((UINT32 *)Guid)[0] ^ ((UINT32 *)Guid)[1] ^ ((UINT32 *)Guid)[2] ^ ((UINT32 *)Guid)[3];
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return Hash % PEI_PPI_HASH_BUCKET_COUNT;
+}
+
+/**
+
+  Compare two PPI GUIDs.
+
+  Don't use CompareGuid function here for performance reasons.
+  Instead we compare the GUID as INT32 at a time and branch
+  on the first failed comparison.
+
+  @param Guid1           Pointer to the first GUID.
+  @param Guid2           Pointer to the second GUID.
+
+  @retval TRUE           The GUIDs are the same.
+  @retval FALSE          The GUIDs are different.
+
+**/
+BOOLEAN
+IsSamePpiGuid (
+  IN CONST EFI_GUID      *Guid1,
+  IN CONST EFI_GUID      *Guid2
+  )
+{
+  return (BOOLEAN) ((((INT32 *)Guid1)[0] == ((INT32 *)Guid2)[0]) &&
+                    (((INT32 *)Guid1)[1] == ((INT32 *)Guid2)[1]) &&
+                    (((INT32 *)Guid1)[2] == ((INT32 *)Guid2)[2]) &&
+                    (((INT32 *)Guid1)[3] == ((INT32 *)Guid2)[3]));
+}
+
+/**
+
+  Append an entry of the PPI database to the end of its hash chain.
+
+  @param PpiData         Pointer to the PPI database.
+  @param HashHead        PpiHashHead for an installed PPI, NotifyHashHead for a notify.
+  @param Index           Index of the entry in PpiListPtrs.
+  @param Guid            Pointer to GUID of the entry.
+
+**/
+VOID
+InsertPpiHashEntry (
+  IN PEI_PPI_DATABASE    *PpiData,
+  IN INTN                *HashHead,
+  IN INTN                Index,
+  IN CONST EFI_GUID      *Guid
+  )
+{
+  INTN                   *Link;
+
+  Link = &HashHead[PpiGuidHash (Guid)];
+  while (*Link != -1) {
+    Link = &PpiData->HashNext[*Link];
+  }
+
+  PpiData->HashNext[Index] = -1;
+  *Link = Index;
+}
+
+/**
+
+  Record that a PPI is installed in the PPI database, so that the dispatcher
+  evaluates again the dependency expressions of the PEIMs waiting for it.
+
+  @param PpiData         Pointer to the PPI database.
+  @param Guid            Pointer to GUID of the installed PPI.
+
+**/
+VOID
+RecordPpiInstall (
+  IN PEI_PPI_DATABASE    *PpiData,
+  IN CONST EFI_GUID      *Guid
+  )
+{
+  PpiData->InstallSequence++;
+  PpiData->HashInstallSequence[PpiGuidHash (Guid)] = PpiData->InstallSequence;
+}
+
+/**
+
+  Rebuild the hash chains of the PPI database. It is needed when entries of
+  PpiListPtrs are moved or removed.
+
+  @param PpiData         Pointer to the PPI database.
+
+**/
+VOID
+RebuildPpiHash (
+  IN PEI_PPI_DATABASE    *PpiData
+  )
+{
+  INTN                   Index;
+
+  for (Index = 0; Index < PEI_PPI_HASH_BUCKET_COUNT; Index++) {
+    PpiData->PpiHashHead[Index]    = -1;
+    PpiData->NotifyHashHead[Index] = -1;
+  }
+
+  for (Index = 0; Index < PpiData->PpiListEnd; Index++) {
+    InsertPpiHashEntry (PpiData, PpiData->PpiHashHead, Index, PpiData->PpiListPtrs[Index].Ppi->Guid);
+  }
+
+  for (Index = PcdGet32 (PcdPeiCoreMaxPpiSupported) - 1; Index > PpiData->NotifyListEnd; Index--) {
+    InsertPpiHashEntry (PpiData, PpiData->NotifyHashHead, Index, PpiData->PpiListPtrs[Index].Notify->Guid);
+  }
+}
+
 /**
 
   Initialize PPI services.
@@ -33,6 +160,7 @@ InitializePpiServices (
     PrivateData->PpiData.NotifyListEnd = PcdGet32 (PcdPeiCoreMaxPpiSupported)-1;
     PrivateData->PpiData.DispatchListEnd = PcdGet32 (PcdPeiCoreMaxPpiSupported)-1;
     PrivateData->PpiData.LastDispatchedNotify = PcdGet32 (PcdPeiCoreMaxPpiSupported)-1;
+    RebuildPpiHash (&PrivateData->PpiData);
   }
 }
 
@@ -221,12 +349,15 @@ PeiInstallPpi (
     //
     if ((PpiList->Flags & EFI_PEI_PPI_DESCRIPTOR_PPI) == 0) {
       PrivateData->PpiData.PpiListEnd = LastCallbackInstall;
+      RebuildPpiHash (&PrivateData->PpiData);
       DEBUG((EFI_D_ERROR, "ERROR -> InstallPpi: %g %p\n", PpiList->Guid, PpiList->Ppi));
       return  EFI_INVALID_PARAMETER;
     }
 
     DEBUG((EFI_D_INFO, "Install PPI: %g\n", PpiList->Guid));
     PrivateData->PpiData.PpiListPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR*) PpiList;
+    InsertPpiHashEntry (&PrivateData->PpiData, PrivateData->PpiData.PpiHashHead, Index, PpiList->Guid);
+    RecordPpiInstall (&PrivateData->PpiData, PpiList->Guid);
     PrivateData->PpiData.PpiListEnd++;
 
     //
@@ -314,6 +445,14 @@ PeiReInstallPpi (
   DEBUG((EFI_D_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
   ASSERT (Index < (INTN)(PcdGet32 (PcdPeiCoreMaxPpiSupported)));
   PrivateData->PpiData.PpiListPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  if (!IsSamePpiGuid (OldPpi->Guid, NewPpi->Guid)) {
+    RebuildPpiHash (&PrivateData->PpiData);
+    //
+    // The old PPI is gone, which may satisfy a dependency expression using NOT.
+    //
+    RecordPpiInstall (&PrivateData->PpiData, OldPpi->Guid);
+  }
+  RecordPpiInstall (&PrivateData->PpiData, NewPpi->Guid);
 
   //
   // Dispatch any callback level notifies for the newly installed PPI.
@@ -359,28 +498,21 @@ PeiLocatePpi (
 {
   PEI_CORE_INSTANCE   *PrivateData;
   INTN                Index;
-  EFI_GUID            *CheckGuid;
   EFI_PEI_PPI_DESCRIPTOR  *TempPtr;
 
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
 
   //
-  // Search the data base for the matching instance of the GUIDed PPI.
+  // Search the hash chain of the GUID for the matching instance of the GUIDed PPI.
+  // The chain is in install order, so the instances are counted the same way.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiListEnd; Index++) {
+  for (Index = PrivateData->PpiData.PpiHashHead[PpiGuidHash (Guid)];
+       Index != -1;
+       Index = PrivateData->PpiData.HashNext[Index]) {
     TempPtr = PrivateData->PpiData.PpiListPtrs[Index].Ppi;
-    CheckGuid = TempPtr->Guid;
 
-    //
-    // Don't use CompareGuid function here for performance reasons.
-    // Instead we compare the GUID as INT32 at a time and branch
-    // on the first failed comparison.
-    //
-    if ((((INT32 *)Guid)[0] == ((INT32 *)CheckGuid)[0]) &&
-        (((INT32 *)Guid)[1] == ((INT32 *)CheckGuid)[1]) &&
-        (((INT32 *)Guid)[2] == ((INT32 *)CheckGuid)[2]) &&
-        (((INT32 *)Guid)[3] == ((INT32 *)CheckGuid)[3])) {
+    if (IsSamePpiGuid (Guid, TempPtr->Guid)) {
       if (Instance == 0) {
 
         if (PpiDescriptor != NULL) {
@@ -462,6 +594,7 @@ PeiNotifyPpi (
     //
     if ((NotifyList->Flags & EFI_PEI_PPI_DESCRIPTOR_NOTIFY_TYPES) == 0) {
         PrivateData->PpiData.NotifyListEnd = LastCallbackNotify;
+        RebuildPpiHash (&PrivateData->PpiData);
         DEBUG((EFI_D_ERROR, "ERROR -> InstallNotify: %g %p\n", NotifyList->Guid, NotifyList->Notify));
       return  EFI_INVALID_PARAMETER;
     }
@@ -471,6 +604,7 @@ PeiNotifyPpi (
     }
 
     PrivateData->PpiData.PpiListPtrs[Index].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
+    InsertPpiHashEntry (&PrivateData->PpiData, PrivateData->PpiData.NotifyHashHead, Index, NotifyList->Guid);
 
     PrivateData->PpiData.NotifyListEnd--;
     DEBUG((EFI_D_INFO, "Register PPI Notify: %g\n", NotifyList->Guid));
@@ -502,6 +636,11 @@ PeiNotifyPpi (
     }
 
     LastCallbackNotify -= NotifyDispatchCount;
+
+    //
+    // The notifies have moved in PpiListPtrs
+    //
+    RebuildPpiHash (&PrivateData->PpiData);
   }
 
   //
@@ -583,10 +722,51 @@ ProcessNotifyList (
   return;
 }
 
+/**
+
+  Call a notify for an installed PPI.
+
+  @param PrivateData        PeiCore's private data structure
+  @param NotifyIndex        Index of the notify in PpiListPtrs.
+  @param InstallIndex       Index of the installed PPI in PpiListPtrs.
+
+**/
+VOID
+InvokeNotify (
+  IN PEI_CORE_INSTANCE  *PrivateData,
+  IN INTN                NotifyIndex,
+  IN INTN                InstallIndex
+  )
+{
+  EFI_PEI_NOTIFY_DESCRIPTOR   *NotifyDescriptor;
+  EFI_PEI_PPI_DESCRIPTOR      *PpiDescriptor;
+
+  NotifyDescriptor = PrivateData->PpiData.PpiListPtrs[NotifyIndex].Notify;
+  PpiDescriptor    = PrivateData->PpiData.PpiListPtrs[InstallIndex].Ppi;
+
+  DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
+    PpiDescriptor->Guid,
+    NotifyDescriptor->Notify
+    ));
+  NotifyDescriptor->Notify (
+                      (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
+                      NotifyDescriptor,
+                      PpiDescriptor->Ppi
+                      );
+}
+
 /**
 
   Dispatch notifications.
 
+  The notifies are invoked in the same order as a full scan of the ranges would
+  invoke them: by notify, newest first, then by installed PPI, oldest first.
+  Only the entries on the hash chains of the GUIDs involved are matched. When
+  fewer PPIs than notifies are in the ranges, as when PPIs are installed, the
+  notifies are found on the hash chains of the installed PPIs. Otherwise, as
+  when notifies are registered, the installed PPIs are found on the hash chains
+  of the notifies.
+
   @param PrivateData        PeiCore's private data structure
   @param NotifyType         Type of notify to fire.
   @param InstallStartIndex  Install Beginning index.
@@ -607,38 +787,68 @@ DispatchNotify (
 {
   INTN                   Index1;
   INTN                   Index2;
+  INTN                   NextNotify;
+  INTN                   Notify;
   EFI_GUID                *SearchGuid;
   EFI_GUID                *CheckGuid;
-  EFI_PEI_NOTIFY_DESCRIPTOR   *NotifyDescriptor;
+  PEI_PPI_DATABASE        *PpiData;
+
+  PpiData = &PrivateData->PpiData;
 
   //
-  // Remember that Installs moves up and Notifies moves down.
+  // Remember that Installs moves up and Notifies moves down. The PPIs of a
+  // hash chain are in ascending index order, the notifies of a hash chain are
+  // in descending index order.
   //
-  for (Index1 = NotifyStartIndex; Index1 > NotifyStopIndex; Index1--) {
-    NotifyDescriptor = PrivateData->PpiData.PpiListPtrs[Index1].Notify;
+  if (InstallStopIndex - InstallStartIndex < NotifyStartIndex - NotifyStopIndex) {
+    //
+    // Find the next notify, in descending order, that matches any of the
+    // installed PPIs, and invoke it for each of them. Usually a single PPI
+    // is installed, and only the notifies on its hash chain are visited.
+    //
+    Index1 = NotifyStartIndex + 1;
+    for (;;) {
+      NextNotify = NotifyStopIndex;
+      for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
+        SearchGuid = PpiData->PpiListPtrs[Index2].Ppi->Guid;
+        for (Notify = PpiData->NotifyHashHead[PpiGuidHash (SearchGuid)];
+             Notify != -1 && Notify > NextNotify;
+             Notify = PpiData->HashNext[Notify]) {
+          if (Notify < Index1 && IsSamePpiGuid (SearchGuid, PpiData->PpiListPtrs[Notify].Notify->Guid)) {
+            NextNotify = Notify;
+            break;
+          }
+        }
+      }
 
-    CheckGuid = NotifyDescriptor->Guid;
+      if (NextNotify == NotifyStopIndex) {
+        break;
+      }
 
-    for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
-      SearchGuid = PrivateData->PpiData.PpiListPtrs[Index2].Ppi->Guid;
-      //
-      // Don't use CompareGuid function here for performance reasons.
-      // Instead we compare the GUID as INT32 at a time and branch
-      // on the first failed comparison.
-      //
-      if ((((INT32 *)SearchGuid)[0] == ((INT32 *)CheckGuid)[0]) &&
-          (((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
-          (((INT32 *)SearchGuid)[2] == ((INT32 *)CheckGuid)[2]) &&
-          (((INT32 *)SearchGuid)[3] == ((INT32 *)CheckGuid)[3])) {
-        DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
-          SearchGuid,
-          NotifyDescriptor->Notify
-          ));
-        NotifyDescriptor->Notify (
-                            (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
-                            NotifyDescriptor,
-                            (PrivateData->PpiData.PpiListPtrs[Index2].Ppi)->Ppi
-                            );
+      Index1    = NextNotify;
+      CheckGuid = PpiData->PpiListPtrs[Index1].Notify->Guid;
+      for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
+        SearchGuid = PpiData->PpiListPtrs[Index2].Ppi->Guid;
+        if (IsSamePpiGuid (SearchGuid, CheckGuid)) {
+          InvokeNotify (PrivateData, Index1, Index2);
+        }
+      }
+    }
+  } else {
+    for (Index1 = NotifyStartIndex; Index1 > NotifyStopIndex; Index1--) {
+      CheckGuid = PpiData->PpiListPtrs[Index1].Notify->Guid;
+
+      for (Index2 = PpiData->PpiHashHead[PpiGuidHash (CheckGuid)]; Index2 != -1; Index2 = PpiData->HashNext[Index2]) {
+        if (Index2 < InstallStartIndex) {
+          continue;
+        }
+        if (Index2 >= InstallStopIndex) {
+          break;
+        }
+        SearchGuid = PpiData->PpiListPtrs[Index2].Ppi->Guid;
+        if (IsSamePpiGuid (SearchGuid, CheckGuid)) {
+          InvokeNotify (PrivateData, Index1, Index2);
+        }
       }
     }
   }
@@ -437,6 +437,7 @@ SmmMain (
   }
 
   RegisterSmramProfileHandler ();
+  RegisterSmiHandlerStatisticsHandler ();
 
   return EFI_SUCCESS;
 }
@@ -35,6 +35,7 @@
 #include <Guid/EventLegacyBios.h>
 #include <Guid/ZeroGuid.h>
 #include <Guid/MemoryProfile.h>
+#include <Guid/SmiHandlerStatistics.h>
 
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -900,6 +901,26 @@ RegisterSmramProfileHandler (
   VOID
   );
 
+/**
+  Get the fragmentation information of the SMRAM free memory and pool.
+
+  @param  Fragmentation         Returns the fragmentation information.
+
+**/
+VOID
+SmmGetSmramFragmentation (
+  OUT MEMORY_PROFILE_SMRAM_FRAGMENTATION  *Fragmentation
+  );
+
+/**
+  Register SMI handler statistics handler.
+
+**/
+VOID
+RegisterSmiHandlerStatisticsHandler (
+  VOID
+  );
+
 /**
   SMRAM profile ready to lock callback function.
 
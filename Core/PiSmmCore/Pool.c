@@ -15,6 +15,14 @@
 #include "PiSmmCore.h"
 
 LIST_ENTRY  mSmmPoolLists[MAX_POOL_INDEX];
+
+//
+// Pool page accounting, reported in the SMRAM profile
+//
+UINT64      mSmmPoolPages;
+UINT64      mSmmPoolPeakPages;
+UINT64      mSmmPoolPageReleaseCount;
+UINT64      mSmmFreePoolSize;
 //
 // To cache the SMRAM base since when Loading modules At fixed address feature is enabled, 
 // all module is assigned an offset relative the SMRAM base in build time.
@@ -98,6 +106,40 @@ SmmInitializeMemoryServices (
 
 }
 
+/**
+  Internal Function. Put a pool block on the free list of its size.
+
+  @param  FreePoolHdr           The pool block to put on the free list.
+  @param  PoolIndex             Index which indicate the Pool size.
+
+**/
+VOID
+InternalInsertFreePool (
+  IN FREE_POOL_HEADER  *FreePoolHdr,
+  IN UINTN             PoolIndex
+  )
+{
+  FreePoolHdr->Header.Available = TRUE;
+  InsertHeadList (&mSmmPoolLists[PoolIndex], &FreePoolHdr->Link);
+  mSmmFreePoolSize += FreePoolHdr->Header.Size;
+}
+
+/**
+  Internal Function. Take a pool block off the free list of its size.
+
+  @param  FreePoolHdr           The pool block to take off the free list.
+
+**/
+VOID
+InternalRemoveFreePool (
+  IN FREE_POOL_HEADER  *FreePoolHdr
+  )
+{
+  RemoveEntryList (&FreePoolHdr->Link);
+  FreePoolHdr->Header.Available = FALSE;
+  mSmmFreePoolSize -= FreePoolHdr->Header.Size;
+}
+
 /**
   Internal Function. Allocate a pool by specified PoolIndex.
 
@@ -126,15 +168,18 @@ InternalAllocPoolByIndex (
       return EFI_OUT_OF_RESOURCES;
     }
     Hdr = (FREE_POOL_HEADER *) (UINTN) Address;
+    mSmmPoolPages += EFI_SIZE_TO_PAGES (MAX_POOL_SIZE << 1);
+    if (mSmmPoolPages > mSmmPoolPeakPages) {
+      mSmmPoolPeakPages = mSmmPoolPages;
+    }
   } else if (!IsListEmpty (&mSmmPoolLists[PoolIndex])) {
     Hdr = BASE_CR (GetFirstNode (&mSmmPoolLists[PoolIndex]), FREE_POOL_HEADER, Link);
-    RemoveEntryList (&Hdr->Link);
+    InternalRemoveFreePool (Hdr);
   } else {
     Status = InternalAllocPoolByIndex (PoolIndex + 1, &Hdr);
     if (!EFI_ERROR (Status)) {
       Hdr->Header.Size >>= 1;
-      Hdr->Header.Available = TRUE;
-      InsertHeadList (&mSmmPoolLists[PoolIndex], &Hdr->Link);
+      InternalInsertFreePool (Hdr, PoolIndex);
       Hdr = (FREE_POOL_HEADER*)((UINT8*)Hdr + Hdr->Header.Size);
     }
   }
@@ -151,6 +196,12 @@ InternalAllocPoolByIndex (
 /**
   Internal Function. Free a pool by specified PoolIndex.
 
+  A pool block is split from a block twice its size and aligned on its size,
+  so its buddy, the other half of that block, is found by flipping the size bit
+  of its address. The freed block is merged with its buddy as long as the buddy
+  is free and not split, and a page that is entirely free again is returned to
+  the page allocator, so freed pool does not stay stranded in small blocks.
+
   @param  FreePoolHdr           The pool to free.
 
   @retval EFI_SUCCESS           Pool successfully freed.
@@ -161,19 +212,77 @@ InternalFreePoolByIndex (
   IN FREE_POOL_HEADER  *FreePoolHdr
   )
 {
-  UINTN  PoolIndex;
+  UINTN             PoolIndex;
+  FREE_POOL_HEADER  *Buddy;
 
   ASSERT ((FreePoolHdr->Header.Size & (FreePoolHdr->Header.Size - 1)) == 0);
   ASSERT (((UINTN)FreePoolHdr & (FreePoolHdr->Header.Size - 1)) == 0);
   ASSERT (FreePoolHdr->Header.Size >= MIN_POOL_SIZE);
 
   PoolIndex = (UINTN) (HighBitSet32 ((UINT32)FreePoolHdr->Header.Size) - MIN_POOL_SHIFT);
-  FreePoolHdr->Header.Available = TRUE;
   ASSERT (PoolIndex < MAX_POOL_INDEX);
-  InsertHeadList (&mSmmPoolLists[PoolIndex], &FreePoolHdr->Link);
+
+  while (PoolIndex < MAX_POOL_INDEX) {
+    Buddy = (FREE_POOL_HEADER *) ((UINTN) FreePoolHdr ^ FreePoolHdr->Header.Size);
+    if (!Buddy->Header.Available || Buddy->Header.Size != FreePoolHdr->Header.Size) {
+      break;
+    }
+
+    InternalRemoveFreePool (Buddy);
+    if (Buddy < FreePoolHdr) {
+      FreePoolHdr = Buddy;
+    }
+    FreePoolHdr->Header.Size <<= 1;
+    PoolIndex++;
+  }
+
+  if (PoolIndex == MAX_POOL_INDEX) {
+    mSmmPoolPages -= EFI_SIZE_TO_PAGES (MAX_POOL_SIZE << 1);
+    mSmmPoolPageReleaseCount++;
+    return SmmInternalFreePages (
+             (EFI_PHYSICAL_ADDRESS) (UINTN) FreePoolHdr,
+             EFI_SIZE_TO_PAGES (MAX_POOL_SIZE << 1)
+             );
+  }
+
+  InternalInsertFreePool (FreePoolHdr, PoolIndex);
   return EFI_SUCCESS;
 }
 
+/**
+  Get the fragmentation information of the SMRAM free memory and pool.
+
+  @param  Fragmentation         Returns the fragmentation information.
+
+**/
+VOID
+SmmGetSmramFragmentation (
+  OUT MEMORY_PROFILE_SMRAM_FRAGMENTATION  *Fragmentation
+  )
+{
+  LIST_ENTRY      *Node;
+  FREE_PAGE_LIST  *Pages;
+
+  ZeroMem (Fragmentation, sizeof (*Fragmentation));
+  Fragmentation->Header.Signature = MEMORY_PROFILE_SMRAM_FRAGMENTATION_SIGNATURE;
+  Fragmentation->Header.Length    = sizeof (MEMORY_PROFILE_SMRAM_FRAGMENTATION);
+  Fragmentation->Header.Revision  = MEMORY_PROFILE_SMRAM_FRAGMENTATION_REVISION;
+
+  for (Node = mSmmMemoryMap.ForwardLink; Node != &mSmmMemoryMap; Node = Node->ForwardLink) {
+    Pages = BASE_CR (Node, FREE_PAGE_LIST, Link);
+    Fragmentation->FreePageRangeCount++;
+    Fragmentation->TotalFreePages += Pages->NumberOfPages;
+    if (Pages->NumberOfPages > Fragmentation->LargestFreePages) {
+      Fragmentation->LargestFreePages = Pages->NumberOfPages;
+    }
+  }
+
+  Fragmentation->PoolPages            = mSmmPoolPages;
+  Fragmentation->PeakPoolPages        = mSmmPoolPeakPages;
+  Fragmentation->PoolPageReleaseCount = mSmmPoolPageReleaseCount;
+  Fragmentation->FreePoolSize         = mSmmFreePoolSize;
+}
+
 /**
   Allocate pool of a particular type.
 
@@ -20,9 +20,15 @@
 
 #define SMI_ENTRY_SIGNATURE  SIGNATURE_32('s','m','i','e')
 
+//
+// Number of buckets of the SMI entry hash table, must be a power of 2
+//
+#define SMI_ENTRY_HASH_BUCKET_COUNT  32
+
  typedef struct {
   UINTN       Signature;
   LIST_ENTRY  AllEntries;  // All entries
+  LIST_ENTRY  HashLink;    // Link on the mSmiEntryHashList bucket of HandlerType
 
   EFI_GUID    HandlerType; // Type of interrupt
   LIST_ENTRY  SmiHandlers; // All handlers
@@ -35,11 +41,195 @@
   LIST_ENTRY                    Link;        // Link on SMI_ENTRY.SmiHandlers
   EFI_SMM_HANDLER_ENTRY_POINT2  Handler;     // The smm handler's entry point
   SMI_ENTRY                     *SmiEntry;
+  BOOLEAN                       ToRemove;    // Unregistered while SmiManage() is running
+
+  //
+  // Statistics, only updated when PcdSmiHandlerStatistics is TRUE
+  //
+  UINT64                        InvocationCount;
+  UINT64                        TotalTicks;
+  UINT64                        MaximumTicks;
+  UINT32                        Histogram[SMI_HANDLER_STATISTICS_HISTOGRAM_BUCKETS];
 } SMI_HANDLER;
 
 LIST_ENTRY  mRootSmiHandlerList = INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiHandlerList);
 LIST_ENTRY  mSmiEntryList       = INITIALIZE_LIST_HEAD_VARIABLE (mSmiEntryList);
 
+//
+// SMI entries hashed by handler type. The heads are initialized on first use.
+//
+LIST_ENTRY  mSmiEntryHashList[SMI_ENTRY_HASH_BUCKET_COUNT];
+
+//
+// Number of SmiManage() calls in progress, and number of the handlers unregistered
+// meanwhile. They are only marked, and removed when the outermost SmiManage() returns.
+//
+UINTN       mSmiManageCallingDepth = 0;
+UINTN       mSmiHandlerToRemoveCount = 0;
+
+//
+// Properties of the performance counter used to time the SMI handlers
+//
+UINT64      mSmiPerformanceCounterStartValue;
+UINT64      mSmiPerformanceCounterEndValue;
+UINT64      mSmiPerformanceCounterFrequency;
+
+/**
+  Get the SMI entry hash table bucket of a handler type.
+
+  @param  HandlerType            The type of the interrupt
+
+  @return The head of the bucket.
+
+**/
+LIST_ENTRY *
+SmiEntryHashBucket (
+  IN CONST EFI_GUID  *HandlerType
+  )
+{
+  UINT32      Hash;
+  LIST_ENTRY  *Bucket;
+
+  Hash  = ReadUnaligned32 ((UINT32 *) HandlerType) ^ ReadUnaligned32 ((UINT32 *) HandlerType + 1) ^
+          ReadUnaligned32 ((UINT32 *) HandlerType + 2) ^ ReadUnaligned32 ((UINT32 *) HandlerType + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  Bucket = &mSmiEntryHashList[Hash & (SMI_ENTRY_HASH_BUCKET_COUNT - 1)];
+  if (Bucket->ForwardLink == NULL) {
+    InitializeListHead (Bucket);
+  }
+  return Bucket;
+}
+
+/**
+  Account one invocation of an SMI handler in its statistics.
+
+  @param  SmiHandler             The SMI handler that was invoked
+  @param  StartTicks             Performance counter value before the handler was invoked
+  @param  EndTicks               Performance counter value after the handler returned
+
+**/
+VOID
+UpdateSmiHandlerStatistics (
+  IN SMI_HANDLER  *SmiHandler,
+  IN UINT64       StartTicks,
+  IN UINT64       EndTicks
+  )
+{
+  UINT64      Ticks;
+  UINTN       Bucket;
+
+  if (mSmiPerformanceCounterEndValue >= mSmiPerformanceCounterStartValue) {
+    Ticks = EndTicks - StartTicks;
+  } else {
+    Ticks = StartTicks - EndTicks;
+  }
+
+  if (RShiftU64 (Ticks, SMI_HANDLER_STATISTICS_HISTOGRAM_SHIFT) == 0) {
+    Bucket = 0;
+  } else {
+    Bucket = (UINTN) HighBitSet64 (Ticks) - SMI_HANDLER_STATISTICS_HISTOGRAM_SHIFT + 1;
+    if (Bucket >= SMI_HANDLER_STATISTICS_HISTOGRAM_BUCKETS) {
+      Bucket = SMI_HANDLER_STATISTICS_HISTOGRAM_BUCKETS - 1;
+    }
+  }
+
+  SmiHandler->InvocationCount++;
+  SmiHandler->TotalTicks += Ticks;
+  if (Ticks > SmiHandler->MaximumTicks) {
+    SmiHandler->MaximumTicks = Ticks;
+  }
+  SmiHandler->Histogram[Bucket]++;
+}
+
+/**
+  Remove an SMI handler from its list and free it. The SMI entry is freed too
+  when its last handler is removed.
+
+  @param  SmiHandler             The SMI handler to remove
+
+  @retval TRUE                   The SMI entry of the handler was freed.
+  @retval FALSE                  The SMI entry still has handlers, or the handler
+                                 is a root SMI handler.
+
+**/
+BOOLEAN
+RemoveSmiHandler (
+  IN SMI_HANDLER  *SmiHandler
+  )
+{
+  SMI_ENTRY    *SmiEntry;
+
+  SmiEntry = SmiHandler->SmiEntry;
+
+  RemoveEntryList (&SmiHandler->Link);
+  FreePool (SmiHandler);
+
+  if (SmiEntry == NULL) {
+    //
+    // This is root SMI handler
+    //
+    return FALSE;
+  }
+
+  if (IsListEmpty (&SmiEntry->SmiHandlers)) {
+    //
+    // No handler registered for this interrupt now, remove the SMI_ENTRY
+    //
+    RemoveEntryList (&SmiEntry->AllEntries);
+    RemoveEntryList (&SmiEntry->HashLink);
+
+    FreePool (SmiEntry);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+  Remove all the SMI handlers marked by SmiHandlerUnRegister() while SmiManage()
+  was running.
+
+**/
+VOID
+RemoveMarkedSmiHandlers (
+  VOID
+  )
+{
+  LIST_ENTRY   *EntryLink;
+  LIST_ENTRY   *Link;
+  LIST_ENTRY   *Head;
+  SMI_ENTRY    *SmiEntry;
+  SMI_HANDLER  *SmiHandler;
+
+  Head = &mRootSmiHandlerList;
+  EntryLink = mSmiEntryList.ForwardLink;
+  for (;;) {
+    for (Link = Head->ForwardLink; Link != Head;) {
+      SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+      Link       = Link->ForwardLink;
+      if (SmiHandler->ToRemove) {
+        mSmiHandlerToRemoveCount--;
+        if (RemoveSmiHandler (SmiHandler)) {
+          //
+          // The SMI entry is freed with its last handler
+          //
+          break;
+        }
+      }
+    }
+
+    if (EntryLink == &mSmiEntryList || mSmiHandlerToRemoveCount == 0) {
+      break;
+    }
+
+    SmiEntry  = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    EntryLink = EntryLink->ForwardLink;
+    Head      = &SmiEntry->SmiHandlers;
+  }
+}
+
 /**
   Finds the SMI entry for the requested handler type.
 
@@ -56,19 +246,21 @@ SmmCoreFindSmiEntry (
   IN BOOLEAN   Create
   )
 {
+  LIST_ENTRY  *Bucket;
   LIST_ENTRY  *Link;
   SMI_ENTRY   *Item;
   SMI_ENTRY   *SmiEntry;
 
   //
-  // Search the SMI entry list for the matching GUID
+  // Search the hash bucket of the GUID for the matching SMI entry
   //
   SmiEntry = NULL;
-  for (Link = mSmiEntryList.ForwardLink;
-       Link != &mSmiEntryList;
+  Bucket   = SmiEntryHashBucket (HandlerType);
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink) {
 
-    Item = CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    Item = CR (Link, SMI_ENTRY, HashLink, SMI_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->HandlerType, HandlerType)) {
       //
       // This is the SMI entry
@@ -93,9 +285,10 @@ SmmCoreFindSmiEntry (
       InitializeListHead (&SmiEntry->SmiHandlers);
 
       //
-      // Add it to SMI entry list
+      // Add it to SMI entry list and to the hash bucket of its GUID
       //
       InsertTailList (&mSmiEntryList, &SmiEntry->AllEntries);
+      InsertTailList (Bucket, &SmiEntry->HashLink);
     }
   }
   return SmiEntry;
@@ -129,10 +322,15 @@ SmiManage (
   SMI_ENTRY    *SmiEntry;
   SMI_HANDLER  *SmiHandler;
   BOOLEAN      SuccessReturn;
+  BOOLEAN      WillReturn;
   EFI_STATUS   Status;
+  UINT64       StartTicks;
   
   Status = EFI_NOT_FOUND;
+  StartTicks = 0;
   SuccessReturn = FALSE;
+  WillReturn = FALSE;
+  SmiEntry = NULL;
   if (HandlerType == NULL) {
     //
     // Root SMI handler
@@ -154,9 +352,22 @@ SmiManage (
     Head = &SmiEntry->SmiHandlers;
   }
 
+  mSmiManageCallingDepth++;
+
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
 
+    if (SmiHandler->ToRemove) {
+      //
+      // Unregistered by a handler invoked before it
+      //
+      continue;
+    }
+
+    if (FeaturePcdGet (PcdSmiHandlerStatistics)) {
+      StartTicks = GetPerformanceCounter ();
+    }
+
     Status = SmiHandler->Handler (
                (EFI_HANDLE) SmiHandler,
                Context,
@@ -164,6 +375,10 @@ SmiManage (
                CommBufferSize
                );
 
+    if (FeaturePcdGet (PcdSmiHandlerStatistics)) {
+      UpdateSmiHandlerStatistics (SmiHandler, StartTicks, GetPerformanceCounter ());
+    }
+
     switch (Status) {
     case EFI_INTERRUPT_PENDING:
       //
@@ -171,7 +386,7 @@ SmiManage (
       // no additional handlers will be processed and EFI_INTERRUPT_PENDING will be returned.
       //
       if (HandlerType != NULL) {
-        return EFI_INTERRUPT_PENDING;
+        WillReturn = TRUE;
       }
       break;
 
@@ -182,7 +397,7 @@ SmiManage (
       // additional handlers will be processed.
       //
       if (HandlerType != NULL) {
-        return EFI_SUCCESS;
+        WillReturn = TRUE;
       }
       SuccessReturn = TRUE;
       break;
@@ -209,6 +424,25 @@ SmiManage (
       ASSERT (FALSE);
       break;
     }
+
+    if (WillReturn) {
+      break;
+    }
+  }
+
+  ASSERT (mSmiManageCallingDepth > 0);
+  mSmiManageCallingDepth--;
+
+  //
+  // Remove the handlers unregistered by the SMI handlers. Head and SmiEntry may be
+  // freed by this.
+  //
+  if (mSmiManageCallingDepth == 0 && mSmiHandlerToRemoveCount != 0) {
+    RemoveMarkedSmiHandlers ();
+  }
+
+  if (WillReturn) {
+    return Status;
   }
 
   if (SuccessReturn) {
@@ -295,7 +529,6 @@ SmiHandlerUnRegister (
   )
 {
   SMI_HANDLER  *SmiHandler;
-  SMI_ENTRY    *SmiEntry;
 
   SmiHandler = (SMI_HANDLER *) DispatchHandle;
 
@@ -307,26 +540,242 @@ SmiHandlerUnRegister (
     return EFI_INVALID_PARAMETER;
   }
 
-  SmiEntry = SmiHandler->SmiEntry;
-
-  RemoveEntryList (&SmiHandler->Link);
-  FreePool (SmiHandler);
-
-  if (SmiEntry == NULL) {
+  if (mSmiManageCallingDepth > 0) {
     //
-    // This is root SMI handler
+    // Called from an SMI handler. SmiManage() may still walk the list of the handler,
+    // so the handler and its SMI entry are removed when SmiManage() returns.
     //
+    if (!SmiHandler->ToRemove) {
+      SmiHandler->ToRemove = TRUE;
+      mSmiHandlerToRemoveCount++;
+    }
     return EFI_SUCCESS;
   }
 
-  if (IsListEmpty (&SmiEntry->SmiHandlers)) {
+  RemoveSmiHandler (SmiHandler);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the number of SMI handlers, root SMI handlers included.
+
+  @return The number of SMI handlers.
+
+**/
+UINTN
+GetSmiHandlerCount (
+  VOID
+  )
+{
+  LIST_ENTRY   *EntryLink;
+  LIST_ENTRY   *Link;
+  SMI_ENTRY    *SmiEntry;
+  UINTN        Count;
+
+  Count = 0;
+  for (Link = mRootSmiHandlerList.ForwardLink; Link != &mRootSmiHandlerList; Link = Link->ForwardLink) {
+    Count++;
+  }
+
+  for (EntryLink = mSmiEntryList.ForwardLink; EntryLink != &mSmiEntryList; EntryLink = EntryLink->ForwardLink) {
+    SmiEntry = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    for (Link = SmiEntry->SmiHandlers.ForwardLink; Link != &SmiEntry->SmiHandlers; Link = Link->ForwardLink) {
+      Count++;
+    }
+  }
+
+  return Count;
+}
+
+/**
+  Copy the statistics of the SMI handlers of one list to a buffer.
+
+  @param  Head           The head of the SMI handler list
+  @param  Record         The buffer to receive the records
+  @param  MaximumCount   The maximum number of records to copy
+
+  @return The number of records copied.
+
+**/
+UINTN
+CopySmiHandlerStatistics (
+  IN  LIST_ENTRY                     *Head,
+  OUT SMI_HANDLER_STATISTICS_RECORD  *Record,
+  IN  UINTN                          MaximumCount
+  )
+{
+  LIST_ENTRY   *Link;
+  SMI_HANDLER  *SmiHandler;
+  UINTN        Count;
+
+  Count = 0;
+  for (Link = Head->ForwardLink; Link != Head && Count < MaximumCount; Link = Link->ForwardLink) {
+    SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+
+    if (SmiHandler->SmiEntry == NULL) {
+      ZeroMem (&Record[Count].HandlerType, sizeof (EFI_GUID));
+    } else {
+      CopyGuid (&Record[Count].HandlerType, &SmiHandler->SmiEntry->HandlerType);
+    }
+    Record[Count].Handler         = (PHYSICAL_ADDRESS) (UINTN) SmiHandler->Handler;
+    Record[Count].InvocationCount = SmiHandler->InvocationCount;
+    Record[Count].TotalTicks      = SmiHandler->TotalTicks;
+    Record[Count].MaximumTicks    = SmiHandler->MaximumTicks;
+    CopyMem (Record[Count].Histogram, SmiHandler->Histogram, sizeof (SmiHandler->Histogram));
+    Count++;
+  }
+
+  return Count;
+}
+
+/**
+  Dispatch function for the SMI handler statistics requests.
+
+  Caution: This function may receive untrusted input.
+  Communicate buffer and buffer size are external input, so this function will do basic validation.
+
+  @param DispatchHandle  The unique handle assigned to this handler by SmiHandlerRegister().
+  @param Context         Points to an optional handler context which was specified when the
+                         handler was registered.
+  @param CommBuffer      A pointer to a collection of data in memory that will
+                         be conveyed from a non-SMM environment into an SMM environment.
+  @param CommBufferSize  The size of the CommBuffer.
+
+  @retval EFI_SUCCESS Command is handled successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+SmiHandlerStatisticsHandler (
+  IN EFI_HANDLE  DispatchHandle,
+  IN CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID    *CommBuffer      OPTIONAL,
+  IN OUT UINTN   *CommBufferSize  OPTIONAL
+  )
+{
+  SMI_HANDLER_STATISTICS_PARAMETER_HEADER    *ParameterHeader;
+  SMI_HANDLER_STATISTICS_PARAMETER_GET_INFO  *ParameterGetInfo;
+  SMI_HANDLER_STATISTICS_PARAMETER_GET_DATA  *ParameterGetData;
+  SMI_HANDLER_STATISTICS_DATA_HEADER         *DataHeader;
+  SMI_HANDLER_STATISTICS_RECORD              *Record;
+  PHYSICAL_ADDRESS                           DataBuffer;
+  UINT64                                     BufferSize;
+  UINTN                                      TempCommBufferSize;
+  UINTN                                      HandlerCount;
+  UINTN                                      DataSize;
+  UINTN                                      Count;
+  LIST_ENTRY                                 *EntryLink;
+  SMI_ENTRY                                  *SmiEntry;
+
+  //
+  // If input is invalid, stop processing this SMI
+  //
+  if (CommBuffer == NULL || CommBufferSize == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  TempCommBufferSize = *CommBufferSize;
+
+  if (TempCommBufferSize < sizeof (SMI_HANDLER_STATISTICS_PARAMETER_HEADER)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerStatisticsHandler: SMM communication buffer size invalid!\n"));
+    return EFI_SUCCESS;
+  }
+
+  if (!SmmIsBufferOutsideSmmValid ((UINTN) CommBuffer, TempCommBufferSize)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerStatisticsHandler: SMM communication buffer in SMRAM or overflow!\n"));
+    return EFI_SUCCESS;
+  }
+
+  ParameterHeader = (SMI_HANDLER_STATISTICS_PARAMETER_HEADER *) CommBuffer;
+  ParameterHeader->ReturnStatus = (UINT64) -1;
+
+  HandlerCount = GetSmiHandlerCount ();
+  DataSize     = sizeof (SMI_HANDLER_STATISTICS_DATA_HEADER) + HandlerCount * sizeof (SMI_HANDLER_STATISTICS_RECORD);
+
+  switch (ParameterHeader->Command) {
+  case SMI_HANDLER_STATISTICS_COMMAND_GET_INFO:
+    if (TempCommBufferSize != sizeof (SMI_HANDLER_STATISTICS_PARAMETER_GET_INFO)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerStatisticsHandler: SMM communication buffer size invalid!\n"));
+      return EFI_SUCCESS;
+    }
+    ParameterGetInfo = (SMI_HANDLER_STATISTICS_PARAMETER_GET_INFO *) CommBuffer;
+    ParameterGetInfo->DataSize            = DataSize;
+    ParameterGetInfo->Header.ReturnStatus = 0;
+    break;
+
+  case SMI_HANDLER_STATISTICS_COMMAND_GET_DATA:
+    if (TempCommBufferSize != sizeof (SMI_HANDLER_STATISTICS_PARAMETER_GET_DATA)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerStatisticsHandler: SMM communication buffer size invalid!\n"));
+      return EFI_SUCCESS;
+    }
+    ParameterGetData = (SMI_HANDLER_STATISTICS_PARAMETER_GET_DATA *) CommBuffer;
+
     //
-    // No handler registered for this interrupt now, remove the SMI_ENTRY
+    // Take a copy of the parameters, so they can not be changed after they are checked
     //
-    RemoveEntryList (&SmiEntry->AllEntries);
+    DataBuffer = ParameterGetData->DataBuffer;
+    BufferSize = ParameterGetData->DataSize;
+    ParameterGetData->DataSize = DataSize;
 
-    FreePool (SmiEntry);
+    if (BufferSize < DataSize) {
+      ParameterGetData->Header.ReturnStatus = (UINT64) (INT64) (INTN) EFI_BUFFER_TOO_SMALL;
+      break;
+    }
+
+    if (!SmmIsBufferOutsideSmmValid ((UINTN) DataBuffer, DataSize)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerStatisticsHandler: SMM DataBuffer in SMRAM or overflow!\n"));
+      ParameterGetData->Header.ReturnStatus = (UINT64) (INT64) (INTN) EFI_ACCESS_DENIED;
+      break;
+    }
+
+    DataHeader = (SMI_HANDLER_STATISTICS_DATA_HEADER *) (UINTN) DataBuffer;
+    Record     = (SMI_HANDLER_STATISTICS_RECORD *) (DataHeader + 1);
+
+    Count = CopySmiHandlerStatistics (&mRootSmiHandlerList, Record, HandlerCount);
+    for (EntryLink = mSmiEntryList.ForwardLink; EntryLink != &mSmiEntryList; EntryLink = EntryLink->ForwardLink) {
+      SmiEntry = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      Count += CopySmiHandlerStatistics (&SmiEntry->SmiHandlers, Record + Count, HandlerCount - Count);
+    }
+
+    DataHeader->RecordCount                 = (UINT32) Count;
+    DataHeader->Reserved                    = 0;
+    DataHeader->PerformanceCounterFrequency = mSmiPerformanceCounterFrequency;
+    ParameterGetData->Header.ReturnStatus   = 0;
+    break;
+
+  default:
+    break;
   }
 
   return EFI_SUCCESS;
 }
+
+/**
+  Register SMI handler statistics handler.
+
+**/
+VOID
+RegisterSmiHandlerStatisticsHandler (
+  VOID
+  )
+{
+  EFI_STATUS    Status;
+  EFI_HANDLE    DispatchHandle;
+
+  if (!FeaturePcdGet (PcdSmiHandlerStatistics)) {
+    return;
+  }
+
+  mSmiPerformanceCounterFrequency = GetPerformanceCounterProperties (
+                                      &mSmiPerformanceCounterStartValue,
+                                      &mSmiPerformanceCounterEndValue
+                                      );
+
+  Status = SmiHandlerRegister (
+             SmiHandlerStatisticsHandler,
+             &gEdkiiSmiHandlerStatisticsGuid,
+             &DispatchHandle
+             );
+  ASSERT_EFI_ERROR (Status);
+}
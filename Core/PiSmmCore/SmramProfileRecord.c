@@ -1242,6 +1242,7 @@ SmramProfileGetDataSize (
 
   TotalSize += (sizeof (MEMORY_PROFILE_FREE_MEMORY) + Index * sizeof (MEMORY_PROFILE_DESCRIPTOR));
   TotalSize += (sizeof (MEMORY_PROFILE_MEMORY_RANGE) + mFullSmramRangeCount * sizeof (MEMORY_PROFILE_DESCRIPTOR));
+  TotalSize += sizeof (MEMORY_PROFILE_SMRAM_FRAGMENTATION);
 
   return TotalSize;
 }
@@ -1368,6 +1369,8 @@ SmramProfileCopyData (
     MemoryProfileDescriptor->Size = mFullSmramRanges[Index].PhysicalSize;
     MemoryProfileDescriptor++; 
   }
+
+  SmmGetSmramFragmentation ((MEMORY_PROFILE_SMRAM_FRAGMENTATION *) MemoryProfileDescriptor);
 }
 
 /**
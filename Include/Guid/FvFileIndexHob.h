@@ -0,0 +1,55 @@
+/** @file
+  FV file index HOB definitions.
+
+  The PEI core indexes the FFS files of each memory-mapped firmware volume it
+  dispatches from, after validating their headers and checksums. The index of
+  each volume is passed to the DXE core in a GUID HOB, so the DXE core does not
+  have to walk and validate the same volume again.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _FV_FILE_INDEX_HOB_H_
+#define _FV_FILE_INDEX_HOB_H_
+
+#define EDKII_FV_FILE_INDEX_HOB_GUID { \
+  0xbff724b8, 0x307d, 0x4e88, { 0xa5, 0x0b, 0x37, 0x05, 0x17, 0x55, 0x93, 0x31 } \
+};
+
+typedef struct {
+  ///
+  /// Base address of the firmware volume.
+  ///
+  EFI_PHYSICAL_ADDRESS    FvBase;
+  ///
+  /// FvLength of the firmware volume header.
+  ///
+  UINT64                  FvLength;
+  ///
+  /// Checksum of the firmware volume header, used to make sure the volume
+  /// at FvBase is still the one that was indexed.
+  ///
+  UINT16                  FvChecksum;
+  UINT16                  Reserved;
+  ///
+  /// Number of entries in the FileOffset array that follows this structure.
+  ///
+  UINT32                  FileCount;
+  ///
+  /// UINT32 FileOffset[FileCount];
+  /// Offsets from FvBase of the FFS file headers in the volume, in volume order.
+  /// Only the valid, non-deleted files that are not pad files are listed.
+  ///
+} FV_FILE_INDEX_HOB;
+
+extern EFI_GUID gEdkiiFvFileIndexHobGuid;
+
+#endif
@@ -110,6 +110,46 @@ typedef struct {
   //MEMORY_PROFILE_DESCRIPTOR     MemoryDescriptor[MemoryRangeCount];
 } MEMORY_PROFILE_MEMORY_RANGE;
 
+#define MEMORY_PROFILE_POOL_SLAB_CLASS_SIGNATURE SIGNATURE_32 ('M','P','S','C')
+#define MEMORY_PROFILE_POOL_SLAB_CLASS_REVISION 0x0001
+
+typedef struct {
+  MEMORY_PROFILE_COMMON_HEADER  Header;
+  UINT32                        ObjectSize;
+  UINT8                         Reserved[4];
+  UINT64                        AllocateCount;
+  UINT64                        FreeCount;
+  UINT64                        SlabAllocateCount;
+  UINT64                        SlabReleaseCount;
+  UINT64                        CurrentSlabPages;
+  UINT64                        PeakSlabPages;
+} MEMORY_PROFILE_POOL_SLAB_CLASS;
+
+#define MEMORY_PROFILE_POOL_SLAB_SIGNATURE SIGNATURE_32 ('M','P','P','S')
+#define MEMORY_PROFILE_POOL_SLAB_REVISION 0x0001
+
+typedef struct {
+  MEMORY_PROFILE_COMMON_HEADER  Header;
+  UINT32                        SlabClassCount;
+  UINT8                         Reserved[4];
+  //MEMORY_PROFILE_POOL_SLAB_CLASS  SlabClass[SlabClassCount];
+} MEMORY_PROFILE_POOL_SLAB;
+
+#define MEMORY_PROFILE_SMRAM_FRAGMENTATION_SIGNATURE SIGNATURE_32 ('M','P','S','F')
+#define MEMORY_PROFILE_SMRAM_FRAGMENTATION_REVISION 0x0001
+
+typedef struct {
+  MEMORY_PROFILE_COMMON_HEADER  Header;
+  UINT32                        FreePageRangeCount;
+  UINT8                         Reserved[4];
+  UINT64                        TotalFreePages;
+  UINT64                        LargestFreePages;
+  UINT64                        PoolPages;
+  UINT64                        PeakPoolPages;
+  UINT64                        PoolPageReleaseCount;
+  UINT64                        FreePoolSize;
+} MEMORY_PROFILE_SMRAM_FRAGMENTATION;
+
 //
 // UEFI memory profile layout:
 // +--------------------------------+
@@ -127,6 +167,12 @@ typedef struct {
 // +--------------------------------+
 // | ALLOC_INFO(n, mn)              |
 // +--------------------------------+
+// | POOL_SLAB                      |
+// +--------------------------------+
+// | POOL_SLAB_CLASS(1)             |
+// +--------------------------------+
+// | POOL_SLAB_CLASS(r)             |
+// +--------------------------------+
 //
 
 typedef struct _EDKII_MEMORY_PROFILE_PROTOCOL EDKII_MEMORY_PROFILE_PROTOCOL;
@@ -231,6 +277,8 @@ struct _EDKII_MEMORY_PROFILE_PROTOCOL {
 // +--------------------------------+
 // | MEMORY RANGE DESCRIPTOR(q)     |
 // +--------------------------------+
+// | SMRAM_FRAGMENTATION            |
+// +--------------------------------+
 //
 
 //
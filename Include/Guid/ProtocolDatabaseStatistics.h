@@ -0,0 +1,63 @@
+/** @file
+  Protocol database statistics definitions.
+
+  The DXE core counts the lookups in its protocol database and the number of
+  entries each lookup visits. The live counters are exposed in the EFI system
+  table with gEdkiiProtocolDatabaseStatisticsGuid.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _PROTOCOL_DATABASE_STATISTICS_H_
+#define _PROTOCOL_DATABASE_STATISTICS_H_
+
+#define EDKII_PROTOCOL_DATABASE_STATISTICS_GUID { \
+  0x119d9039, 0xc9df, 0x4c47, { 0x88, 0xfd, 0xd8, 0x92, 0xc8, 0x95, 0x55, 0xb9 } \
+};
+
+typedef struct {
+  ///
+  /// Number of lookups of a protocol GUID in the protocol database.
+  ///
+  UINT64    ProtocolLookupCount;
+  ///
+  /// Number of protocol entries compared by those lookups.
+  ///
+  UINT64    ProtocolScanCount;
+  ///
+  /// Number of lookups of a protocol on a single handle.
+  ///
+  UINT64    HandleProtocolLookupCount;
+  ///
+  /// Number of protocol interfaces visited by those lookups.
+  ///
+  UINT64    HandleProtocolScanCount;
+  ///
+  /// Number of LocateHandle () requests.
+  ///
+  UINT64    LocateHandleCount;
+  ///
+  /// Number of handles and protocol interfaces visited by LocateHandle ().
+  ///
+  UINT64    LocateHandleScanCount;
+  ///
+  /// Number of LocateProtocol () requests.
+  ///
+  UINT64    LocateProtocolCount;
+  ///
+  /// Number of protocol interfaces visited by LocateProtocol ().
+  ///
+  UINT64    LocateProtocolScanCount;
+} PROTOCOL_DATABASE_STATISTICS;
+
+extern EFI_GUID gEdkiiProtocolDatabaseStatisticsGuid;
+
+#endif
@@ -0,0 +1,57 @@
+/** @file
+  Section stream cache statistics definitions.
+
+  The DXE core keeps the section streams opened to read the sections of FV
+  files in a bounded LRU cache, so the encapsulation sections of a file are
+  not decompressed again for each section read from it. The live counters of
+  the cache are exposed in the EFI system table with
+  gEdkiiSectionStreamCacheStatisticsGuid.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _SECTION_STREAM_CACHE_STATISTICS_H_
+#define _SECTION_STREAM_CACHE_STATISTICS_H_
+
+#define EDKII_SECTION_STREAM_CACHE_STATISTICS_GUID { \
+  0x8dd4f9e3, 0x68e0, 0x4768, { 0xab, 0x35, 0x54, 0x9f, 0xaf, 0xe3, 0x71, 0xe7 } \
+};
+
+typedef struct {
+  ///
+  /// Number of section reads served by a section stream already in the cache.
+  ///
+  UINT64    HitCount;
+  ///
+  /// Number of section reads that had to open a new section stream.
+  ///
+  UINT64    MissCount;
+  ///
+  /// Number of section streams closed to keep the cache within its size.
+  ///
+  UINT64    EvictionCount;
+  ///
+  /// Number of section streams closed because their file or firmware volume went away.
+  ///
+  UINT64    InvalidationCount;
+  ///
+  /// Number of section streams currently in the cache.
+  ///
+  UINT32    CachedStreamCount;
+  ///
+  /// Maximum number of section streams the cache holds.
+  ///
+  UINT32    MaximumStreamCount;
+} SECTION_STREAM_CACHE_STATISTICS;
+
+extern EFI_GUID gEdkiiSectionStreamCacheStatisticsGuid;
+
+#endif
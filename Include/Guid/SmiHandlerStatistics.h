@@ -0,0 +1,102 @@
+/** @file
+  SMI handler statistics definitions.
+
+  When PcdSmiHandlerStatistics is TRUE, the SMM core counts the invocations of
+  each SMI handler and the time spent in it. The statistics are read from
+  outside of SMM with an SMM communicate request whose header GUID is
+  gEdkiiSmiHandlerStatisticsGuid.
+
+  The data returned by SMI_HANDLER_STATISTICS_COMMAND_GET_DATA is one
+  SMI_HANDLER_STATISTICS_DATA_HEADER followed by RecordCount
+  SMI_HANDLER_STATISTICS_RECORD structures, one for each registered handler.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _SMI_HANDLER_STATISTICS_H_
+#define _SMI_HANDLER_STATISTICS_H_
+
+#define EDKII_SMI_HANDLER_STATISTICS_GUID { \
+  0x824ecac8, 0x4dc7, 0x4265, { 0x8e, 0xf2, 0xf5, 0x2b, 0xe2, 0x32, 0xfb, 0x79 } \
+};
+
+//
+// The handler duration histogram has SMI_HANDLER_STATISTICS_HISTOGRAM_BUCKETS
+// buckets. Bucket 0 counts the invocations shorter than
+// 2^SMI_HANDLER_STATISTICS_HISTOGRAM_SHIFT performance counter ticks, bucket n
+// counts the invocations from 2^(SHIFT + n - 1) to 2^(SHIFT + n) ticks, and the
+// last bucket also counts all of the longer ones.
+//
+#define SMI_HANDLER_STATISTICS_HISTOGRAM_BUCKETS  16
+#define SMI_HANDLER_STATISTICS_HISTOGRAM_SHIFT    10
+
+//
+// SMI handler statistics command
+//
+#define SMI_HANDLER_STATISTICS_COMMAND_GET_INFO   0x1
+#define SMI_HANDLER_STATISTICS_COMMAND_GET_DATA   0x2
+
+typedef struct {
+  UINT32                            Command;
+  UINT32                            DataLength;
+  UINT64                            ReturnStatus;
+} SMI_HANDLER_STATISTICS_PARAMETER_HEADER;
+
+typedef struct {
+  SMI_HANDLER_STATISTICS_PARAMETER_HEADER   Header;
+  UINT64                                    DataSize;
+} SMI_HANDLER_STATISTICS_PARAMETER_GET_INFO;
+
+typedef struct {
+  SMI_HANDLER_STATISTICS_PARAMETER_HEADER   Header;
+  UINT64                                    DataSize;
+  PHYSICAL_ADDRESS                          DataBuffer;
+} SMI_HANDLER_STATISTICS_PARAMETER_GET_DATA;
+
+typedef struct {
+  ///
+  /// Number of SMI_HANDLER_STATISTICS_RECORD structures that follow.
+  ///
+  UINT32                            RecordCount;
+  UINT32                            Reserved;
+  ///
+  /// Frequency, in Hz, of the performance counter the durations are measured with.
+  ///
+  UINT64                            PerformanceCounterFrequency;
+} SMI_HANDLER_STATISTICS_DATA_HEADER;
+
+typedef struct {
+  ///
+  /// Type of interrupt the handler is registered for, zero for a root SMI handler.
+  ///
+  EFI_GUID                          HandlerType;
+  ///
+  /// Entry point of the handler.
+  ///
+  PHYSICAL_ADDRESS                  Handler;
+  ///
+  /// Number of times the handler was invoked.
+  ///
+  UINT64                            InvocationCount;
+  ///
+  /// Total and longest time spent in the handler, in performance counter ticks.
+  ///
+  UINT64                            TotalTicks;
+  UINT64                            MaximumTicks;
+  ///
+  /// Invocation count of each duration bucket.
+  ///
+  UINT32                            Histogram[SMI_HANDLER_STATISTICS_HISTOGRAM_BUCKETS];
+} SMI_HANDLER_STATISTICS_RECORD;
+
+extern EFI_GUID gEdkiiSmiHandlerStatisticsGuid;
+
+#endif
@@ -70,6 +70,24 @@ typedef struct {
 #define SMM_VARIABLE_FUNCTION_VAR_CHECK_VARIABLE_PROPERTY_SET  9
 
 #define SMM_VARIABLE_FUNCTION_VAR_CHECK_VARIABLE_PROPERTY_GET  10
+//
+// The payload for this function is VARIABLE_RECLAIM_STATISTICS.
+//
+#define SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS  11
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_SET_VARIABLES.
+//
+#define SMM_VARIABLE_FUNCTION_SET_VARIABLES           12
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE.
+// It returns the sizes of the variable stores held by the runtime variable cache.
+//
+#define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO  13
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE.
+// It is only accepted before the end of DXE.
+//
+#define SMM_VARIABLE_FUNCTION_INIT_RUNTIME_CACHE      14
 
 ///
 /// Size of SMM communicate header, without including the payload.
@@ -113,6 +131,17 @@ typedef struct {
 
 typedef SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAME SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE;
 
+///
+/// This structure is used to communicate with SMI handler by SetVariables.
+/// Data holds EntryCount SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE records, each one
+/// followed by its variable data and starting at a UINTN aligned offset of Data.
+///
+typedef struct {
+  UINTN       EntryCount;
+  UINTN       FailedEntry;  // Return index of the rejected entry
+  UINT8       Data[1];
+} SMM_VARIABLE_COMMUNICATE_SET_VARIABLES;
+
 typedef struct {
   EFI_GUID                      Guid;
   UINTN                         NameSize;
@@ -120,4 +149,35 @@ typedef struct {
   CHAR16                        Name[1];
 } SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY;
 
+///
+/// This structure is used to communicate with SMI handler by GetRuntimeCacheInfo and InitRuntimeCache.
+///
+typedef struct {
+  EFI_PHYSICAL_ADDRESS  CacheBase;          // Input for InitRuntimeCache
+  UINTN                 CacheSize;
+  UINTN                 VolatileStoreSize;  // Return the size of the volatile variable store
+  UINTN                 NvStoreSize;        // Return the size of the non-volatile variable store
+} SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE;
+
+///
+/// Header of the runtime variable cache. It is followed by the copy of the volatile
+/// variable store, and then by the copy of the non-volatile variable store which
+/// starts at a UINT64 aligned offset.
+///
+/// The SMM variable module makes Sequence odd while it updates the cache, and even
+/// again once the update is done. A reader must retry or fall back to the SMI when
+/// Sequence is odd or has changed during the read.
+///
+typedef struct {
+  UINT32      Sequence;
+  BOOLEAN     Ready;              // The cache holds all of the variables
+  UINT8       Reserved[3];
+} VARIABLE_RUNTIME_CACHE_HEADER;
+
+#define VARIABLE_RUNTIME_CACHE_VOLATILE_STORE_OFFSET  sizeof (VARIABLE_RUNTIME_CACHE_HEADER)
+#define VARIABLE_RUNTIME_CACHE_NV_STORE_OFFSET(VolatileStoreSize) \
+  (VARIABLE_RUNTIME_CACHE_VOLATILE_STORE_OFFSET + ALIGN_VALUE ((VolatileStoreSize), sizeof (UINT64)))
+#define VARIABLE_RUNTIME_CACHE_SIZE(VolatileStoreSize, NvStoreSize) \
+  (VARIABLE_RUNTIME_CACHE_NV_STORE_OFFSET (VolatileStoreSize) + ALIGN_VALUE ((NvStoreSize), sizeof (UINT64)))
+
 #endif // _SMM_VARIABLE_COMMON_H_
\ No newline at end of file
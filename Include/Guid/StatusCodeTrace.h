@@ -0,0 +1,83 @@
+/** @file
+  Status code trace definitions.
+
+  When PcdStatusCodeUseTrace is TRUE, the PEI, DXE and SMM status code handlers
+  record every status code as a fixed-size binary record in a ring, one ring for
+  each phase. No string is formatted when a status code is reported; the rings
+  are decoded to text later, either by a shell application or from a memory dump.
+
+  The PEI ring is a GUID'ed HOB whose GUID is gEdkiiStatusCodeTraceGuid, and the
+  DXE status code handler copies it to runtime memory. The rings that survive to
+  the OS are listed in a STATUS_CODE_TRACE_TABLE, installed in the EFI system
+  table with gEdkiiStatusCodeTraceGuid.
+
+  Each ring is one STATUS_CODE_TRACE_HEADER followed by MaxRecords
+  STATUS_CODE_TRACE_RECORD structures. A writer reserves the record at
+  WriteIndex % MaxRecords by incrementing WriteIndex, fills it, and then sets its
+  Sequence to the reserved WriteIndex plus 1. The record reserved as WriteIndex N
+  is valid only if its Sequence is N + 1, so a record that is still being
+  written or has been overwritten can be told by the reader.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _STATUS_CODE_TRACE_H_
+#define _STATUS_CODE_TRACE_H_
+
+#define EDKII_STATUS_CODE_TRACE_GUID { \
+  0x071040eb, 0x16b7, 0x4363, { 0x8c, 0xa8, 0x79, 0x22, 0x7e, 0xee, 0x14, 0x21 } \
+};
+
+#define STATUS_CODE_TRACE_SIGNATURE        SIGNATURE_32 ('S','C','T','R')
+#define STATUS_CODE_TRACE_REVISION         0x0001
+
+#define STATUS_CODE_TRACE_TABLE_SIGNATURE  SIGNATURE_32 ('S','C','T','T')
+
+typedef enum {
+  StatusCodeTracePhasePei,
+  StatusCodeTracePhaseDxe,
+  StatusCodeTracePhaseSmm,
+  StatusCodeTracePhaseMax
+} STATUS_CODE_TRACE_PHASE;
+
+typedef struct {
+  UINT32                  Signature;
+  UINT16                  Revision;
+  UINT16                  Phase;            ///< STATUS_CODE_TRACE_PHASE of the ring.
+  UINT32                  RecordSize;       ///< sizeof (STATUS_CODE_TRACE_RECORD).
+  UINT32                  MaxRecords;       ///< Number of records in the ring, a power of 2.
+  UINT32                  WriteIndex;       ///< Number of records reserved since the ring was created.
+  UINT32                  Reserved;
+  UINT64                  TimerFrequency;   ///< Frequency of the TimeStamp of the records, in Hz.
+} STATUS_CODE_TRACE_HEADER;
+
+typedef struct {
+  UINT64                  TimeStamp;        ///< Performance counter value when the status code was reported.
+  EFI_GUID                CallerId;         ///< Zero if the caller did not provide it.
+  EFI_STATUS_CODE_TYPE    CodeType;
+  EFI_STATUS_CODE_VALUE   Value;
+  UINT32                  Instance;
+  UINT32                  Sequence;         ///< WriteIndex of the record plus 1, set once the record is complete.
+} STATUS_CODE_TRACE_RECORD;
+
+typedef struct {
+  UINT32                  Signature;
+  UINT32                  Reserved;
+  ///
+  /// Physical address of the STATUS_CODE_TRACE_HEADER of each phase, 0 if the
+  /// ring of the phase does not exist.
+  ///
+  EFI_PHYSICAL_ADDRESS    Ring[StatusCodeTracePhaseMax];
+} STATUS_CODE_TRACE_TABLE;
+
+extern EFI_GUID gEdkiiStatusCodeTraceGuid;
+
+#endif
@@ -0,0 +1,55 @@
+/** @file
+  Non-volatile variable store reclaim statistics definitions.
+
+  If PcdVariableCollectStatistics is TRUE, the variable driver collects the
+  statistics of the non-volatile variable store garbage collection and exposes
+  them in the EFI system table with gEdkiiVariableReclaimStatisticsGuid.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _VARIABLE_RECLAIM_STATISTICS_H_
+#define _VARIABLE_RECLAIM_STATISTICS_H_
+
+#define EDKII_VARIABLE_RECLAIM_STATISTICS_GUID { \
+  0x862c056a, 0x66a5, 0x4781, { 0xba, 0xd1, 0x4d, 0x25, 0x94, 0x14, 0xb9, 0x87 } \
+};
+
+typedef struct {
+  ///
+  /// Number of non-volatile variable store reclaims.
+  ///
+  UINT32    ReclaimCount;
+  ///
+  /// Number of reclaims that found nothing to write back to the flash.
+  ///
+  UINT32    SkippedCount;
+  ///
+  /// Total bytes written back to the flash by reclaim.
+  ///
+  UINT64    BytesMoved;
+  ///
+  /// Total flash blocks erased and rewritten by reclaim.
+  ///
+  UINT64    BlocksErased;
+  ///
+  /// Total time spent in reclaim, in nanoseconds.
+  ///
+  UINT64    TotalTimeInNanoSeconds;
+  ///
+  /// Longest single reclaim, in nanoseconds.
+  ///
+  UINT64    MaxTimeInNanoSeconds;
+} VARIABLE_RECLAIM_STATISTICS;
+
+extern EFI_GUID gEdkiiVariableReclaimStatisticsGuid;
+
+#endif
@@ -0,0 +1,80 @@
+/** @file
+  Variable Batch Protocol is related to EDK II-specific implementation of variables
+  and intended for use as a means to set a group of non-volatile variables with
+  all-or-nothing semantics, using a single fault tolerant write of the variable store.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __VARIABLE_BATCH_H__
+#define __VARIABLE_BATCH_H__
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0x4c51ce16, 0x9ca2, 0x415e, { 0x98, 0x9a, 0x4e, 0xe2, 0xfc, 0x25, 0x63, 0x94 } \
+  }
+
+typedef struct _EDKII_VARIABLE_BATCH_PROTOCOL  EDKII_VARIABLE_BATCH_PROTOCOL;
+
+///
+/// One variable update of a batch. The fields have the same meaning as the
+/// parameters of SetVariable ().
+///
+typedef struct {
+  CHAR16      *VariableName;
+  EFI_GUID    VendorGuid;
+  UINT32      Attributes;
+  UINTN       DataSize;
+  VOID        *Data;
+} EDKII_VARIABLE_BATCH_ENTRY;
+
+/**
+  Set a group of non-volatile variables as one transaction.
+
+  The updates are applied in order, so a later entry sees the result of an earlier
+  one. Either all of the updates are written to the variable store, or none of them.
+
+  @param[in]  This          The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]  EntryCount    Number of entries in Entries.
+  @param[in]  Entries       The variable updates to apply.
+  @param[out] FailedEntry   Optional pointer to the index of the entry that was rejected.
+                            It is set to EntryCount if no entry was rejected.
+
+  @retval EFI_SUCCESS           All of the updates were written to the variable store.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0 or Entries is NULL.
+                                Or an entry does not have the EFI_VARIABLE_NON_VOLATILE attribute.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough resource to stage the updates.
+  @retval EFI_BAD_BUFFER_SIZE   The batch is too large to be passed to the variable driver.
+  @retval Others                The status returned by SetVariable () for the entry FailedEntry,
+                                or the status of writing the variable store. None of the updates
+                                was written to the variable store.
+**/
+typedef
+EFI_STATUS
+(EFIAPI * EDKII_VARIABLE_BATCH_PROTOCOL_SET_VARIABLES) (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL    *This,
+  IN       UINTN                            EntryCount,
+  IN       EDKII_VARIABLE_BATCH_ENTRY       *Entries,
+  OUT      UINTN                            *FailedEntry OPTIONAL
+  );
+
+///
+/// Variable Batch Protocol is related to EDK II-specific implementation of variables
+/// and intended for use as a means to set a group of non-volatile variables with
+/// all-or-nothing semantics.
+///
+struct _EDKII_VARIABLE_BATCH_PROTOCOL {
+  EDKII_VARIABLE_BATCH_PROTOCOL_SET_VARIABLES  SetVariables;
+};
+
+extern EFI_GUID gEdkiiVariableBatchProtocolGuid;
+
+#endif
@@ -50,6 +50,7 @@ StatusCodeHandlerPeiEntry (
   // Dispatch initialization request to sub-statuscode-devices.
   // If enable UseSerial, then initialize serial port.
   // if enable UseMemory, then initialize memory status code worker.
+  // if enable UseTrace, then initialize status code trace worker.
   //
   if (FeaturePcdGet (PcdStatusCodeUseSerial)) {
     Status = SerialPortInitialize();
@@ -63,6 +64,13 @@ StatusCodeHandlerPeiEntry (
     Status = RscHandlerPpi->Register (MemoryStatusCodeReportWorker);                     
     ASSERT_EFI_ERROR (Status);
   }
+  if (FeaturePcdGet (PcdStatusCodeUseTrace)) {
+    Status = TraceStatusCodeInitializeWorker ();
+    if (!EFI_ERROR (Status)) {
+      Status = RscHandlerPpi->Register (TraceStatusCodeReportWorker);
+      ASSERT_EFI_ERROR (Status);
+    }
+  }
 
   return EFI_SUCCESS;
 }
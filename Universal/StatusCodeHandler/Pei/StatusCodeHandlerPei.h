@@ -21,6 +21,7 @@
 #include <Guid/MemoryStatusCodeRecord.h>
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Guid/StatusCodeDataTypeDebug.h>
+#include <Guid/StatusCodeTrace.h>
 
 #include <Library/DebugLib.h>
 #include <Library/PrintLib.h>
@@ -31,6 +32,9 @@
 #include <Library/PeiServicesLib.h>
 #include <Library/PeimEntryPoint.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/BaseLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
 
 //
 // Define the maximum message length
@@ -120,6 +124,56 @@ MemoryStatusCodeReportWorker (
   IN CONST EFI_STATUS_CODE_DATA *Data OPTIONAL
   );
 
+/**
+  Create the status code trace ring in a GUID'ed HOB.
+
+  @retval EFI_SUCCESS           The status code trace ring is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the ring.
+
+**/
+EFI_STATUS
+TraceStatusCodeInitializeWorker (
+  VOID
+  );
+
+/**
+  Record status code in the status code trace ring. If the ring is full,
+  the oldest record is overwritten.
+
+  The record is reserved by an atomic increment, so status codes reported by
+  several processors at the same time are recorded without any lock.
+
+  @param  PeiServices      An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  CodeType         Indicates the type of status code being reported.
+  @param  Value            Describes the current status of a hardware or
+                           software entity. This includes information about the class and
+                           subclass that is used to classify the entity as well as an operation.
+                           For progress codes, the operation is the current activity.
+                           For error codes, it is the exception.For debug codes,it is not defined at this time.
+  @param  Instance         The enumeration of a hardware or software entity within
+                           the system. A system may contain multiple entities that match a class/subclass
+                           pairing. The instance differentiates between them. An instance of 0 indicates
+                           that instance information is unavailable, not meaningful, or not relevant.
+                           Valid instance numbers start with 1.
+  @param  CallerId         This optional parameter may be used to identify the caller.
+                           This parameter allows the status code driver to apply different rules to
+                           different callers.
+  @param  Data             This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS      Status code successfully recorded in the status code trace ring.
+
+**/
+EFI_STATUS
+EFIAPI
+TraceStatusCodeReportWorker (
+  IN CONST  EFI_PEI_SERVICES    **PeiServices,
+  IN EFI_STATUS_CODE_TYPE       CodeType,
+  IN EFI_STATUS_CODE_VALUE      Value,
+  IN UINT32                     Instance,
+  IN CONST EFI_GUID             *CallerId,
+  IN CONST EFI_STATUS_CODE_DATA *Data OPTIONAL
+  );
+
 #endif
 
 
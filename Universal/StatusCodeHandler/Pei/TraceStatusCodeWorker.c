@@ -0,0 +1,121 @@
+/** @file
+  Binary status code trace worker.
+
+  The PEI status code trace ring is kept in a GUID'ed HOB, which is found again
+  on every report because the HOB list is moved when permanent memory is installed.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "StatusCodeHandlerPei.h"
+
+/**
+  Create the status code trace ring in a GUID'ed HOB.
+
+  @retval EFI_SUCCESS           The status code trace ring is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the ring.
+
+**/
+EFI_STATUS
+TraceStatusCodeInitializeWorker (
+  VOID
+  )
+{
+  STATUS_CODE_TRACE_HEADER  *Trace;
+  UINTN                     Size;
+
+  Size  = PcdGet16 (PcdStatusCodeTraceSize) * 1024;
+  Trace = BuildGuidHob (&gEdkiiStatusCodeTraceGuid, Size);
+  if (Trace == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ZeroMem (Trace, Size);
+
+  Trace->Signature      = STATUS_CODE_TRACE_SIGNATURE;
+  Trace->Revision       = STATUS_CODE_TRACE_REVISION;
+  Trace->Phase          = StatusCodeTracePhasePei;
+  Trace->RecordSize     = sizeof (STATUS_CODE_TRACE_RECORD);
+  Trace->MaxRecords     = GetPowerOfTwo32 ((UINT32) ((Size - sizeof (STATUS_CODE_TRACE_HEADER)) / sizeof (STATUS_CODE_TRACE_RECORD)));
+  Trace->TimerFrequency = GetPerformanceCounterProperties (NULL, NULL);
+  ASSERT (Trace->MaxRecords != 0);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Record status code in the status code trace ring. If the ring is full,
+  the oldest record is overwritten.
+
+  @param  PeiServices      An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  CodeType         Indicates the type of status code being reported.
+  @param  Value            Describes the current status of a hardware or
+                           software entity. This includes information about the class and
+                           subclass that is used to classify the entity as well as an operation.
+                           For progress codes, the operation is the current activity.
+                           For error codes, it is the exception.For debug codes,it is not defined at this time.
+  @param  Instance         The enumeration of a hardware or software entity within
+                           the system. A system may contain multiple entities that match a class/subclass
+                           pairing. The instance differentiates between them. An instance of 0 indicates
+                           that instance information is unavailable, not meaningful, or not relevant.
+                           Valid instance numbers start with 1.
+  @param  CallerId         This optional parameter may be used to identify the caller.
+                           This parameter allows the status code driver to apply different rules to
+                           different callers.
+  @param  Data             This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS      Status code successfully recorded in the status code trace ring.
+
+**/
+EFI_STATUS
+EFIAPI
+TraceStatusCodeReportWorker (
+  IN CONST  EFI_PEI_SERVICES        **PeiServices,
+  IN EFI_STATUS_CODE_TYPE           CodeType,
+  IN EFI_STATUS_CODE_VALUE          Value,
+  IN UINT32                         Instance,
+  IN CONST EFI_GUID                 *CallerId,
+  IN CONST EFI_STATUS_CODE_DATA     *Data OPTIONAL
+  )
+{
+  EFI_HOB_GUID_TYPE                 *GuidHob;
+  STATUS_CODE_TRACE_HEADER          *Trace;
+  STATUS_CODE_TRACE_RECORD          *Record;
+  UINT32                            Index;
+
+  GuidHob = GetFirstGuidHob (&gEdkiiStatusCodeTraceGuid);
+  if (GuidHob == NULL) {
+    return EFI_SUCCESS;
+  }
+  Trace = (STATUS_CODE_TRACE_HEADER *) GET_GUID_HOB_DATA (GuidHob);
+
+  Index  = InterlockedIncrement (&Trace->WriteIndex) - 1;
+  Record = (STATUS_CODE_TRACE_RECORD *) (Trace + 1);
+  Record = &Record[Index & (Trace->MaxRecords - 1)];
+
+  Record->Sequence  = 0;
+  Record->TimeStamp = GetPerformanceCounter ();
+  if (CallerId != NULL) {
+    CopyGuid (&Record->CallerId, CallerId);
+  } else {
+    ZeroMem (&Record->CallerId, sizeof (EFI_GUID));
+  }
+  Record->CodeType  = CodeType;
+  Record->Value     = Value;
+  Record->Instance  = Instance;
+
+  //
+  // Make the record complete before it is marked valid.
+  //
+  MemoryFence ();
+  Record->Sequence  = Index + 1;
+
+  return EFI_SUCCESS;
+}
@@ -14,6 +14,260 @@
 
 #include "StatusCodeHandlerRuntimeDxe.h"
 
+//
+// Ring buffer of the status code strings waiting to be written to the serial port.
+// Status codes are reported at the TPL of their callers, so the report worker and
+// the drain both raise the TPL to TPL_HIGH_LEVEL while they update the buffer, and
+// neither interrupts the other. The buffer is empty when the head equals the tail.
+//
+UINT8                                 *mSerialBuffer          = NULL;
+UINTN                                 mSerialBufferSize;
+UINTN                                 mSerialBufferHead;
+UINTN                                 mSerialBufferTail;
+UINT64                                mSerialBufferReportedDrops;
+EFI_EVENT                             mSerialBufferIdleEvent  = NULL;
+EFI_EVENT                             mSerialBufferTimerEvent = NULL;
+SERIAL_STATUS_CODE_BUFFER_STATISTICS  mSerialBufferStatistics;
+
+/**
+  Write the oldest queued status code strings to the serial port.
+
+  @param  MaxSize          The maximum number of bytes to write.
+
+**/
+VOID
+DrainSerialStatusCodeBuffer (
+  IN UINTN                    MaxSize
+  )
+{
+  EFI_TPL         OldTpl;
+  UINTN           Size;
+  CHAR8           Buffer[MAX_DEBUG_MESSAGE_LENGTH];
+  UINTN           CharCount;
+
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+
+  if (mSerialBuffer != NULL && mSerialBufferHead != mSerialBufferTail) {
+    if (mSerialBufferTail > mSerialBufferHead) {
+      Size = mSerialBufferTail - mSerialBufferHead;
+    } else {
+      Size = mSerialBufferSize - mSerialBufferHead;
+    }
+    Size = MIN (Size, MaxSize);
+
+    SerialPortWrite (mSerialBuffer + mSerialBufferHead, Size);
+    mSerialBufferHead += Size;
+    if (mSerialBufferHead == mSerialBufferSize) {
+      mSerialBufferHead = 0;
+    }
+
+    //
+    // Tell how many strings were lost once the strings before them are all written.
+    //
+    if (mSerialBufferHead == mSerialBufferTail &&
+        mSerialBufferReportedDrops != mSerialBufferStatistics.DroppedRecords) {
+      CharCount = AsciiSPrint (
+                    Buffer,
+                    sizeof (Buffer),
+                    "\n\r%ld status code string(s) dropped, serial status code buffer full\n\r",
+                    mSerialBufferStatistics.DroppedRecords - mSerialBufferReportedDrops
+                    );
+      SerialPortWrite ((UINT8 *) Buffer, CharCount);
+      mSerialBufferReportedDrops = mSerialBufferStatistics.DroppedRecords;
+    }
+  }
+
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Write all of the queued status code strings to the serial port.
+
+**/
+VOID
+FlushSerialStatusCodeBuffer (
+  VOID
+  )
+{
+  if (mSerialBuffer == NULL) {
+    return;
+  }
+
+  while (mSerialBufferHead != mSerialBufferTail) {
+    DrainSerialStatusCodeBuffer (mSerialBufferSize);
+  }
+}
+
+/**
+  Event notification function draining the serial status code buffer.
+
+  @param  Event         Event whose notification function is being invoked.
+  @param  Context       The maximum number of bytes to write.
+
+**/
+VOID
+EFIAPI
+SerialStatusCodeBufferDrainNotify (
+  IN EFI_EVENT                Event,
+  IN VOID                     *Context
+  )
+{
+  DrainSerialStatusCodeBuffer ((UINTN) Context);
+}
+
+/**
+  Queue a status code string in the serial status code buffer.
+
+  The caller must raise the TPL to TPL_HIGH_LEVEL, so that the buffer is not
+  drained at the same time.
+
+  @param  Buffer           The status code string.
+  @param  Size             The size of the status code string.
+
+  @retval TRUE             The string is queued.
+  @retval FALSE            The buffer is full, the string is dropped.
+
+**/
+BOOLEAN
+EnqueueSerialStatusCode (
+  IN UINT8                    *Buffer,
+  IN UINTN                    Size
+  )
+{
+  UINTN           Used;
+  UINTN           FirstSize;
+  UINTN           Tail;
+
+  if (mSerialBufferTail >= mSerialBufferHead) {
+    Used = mSerialBufferTail - mSerialBufferHead;
+  } else {
+    Used = mSerialBufferSize - mSerialBufferHead + mSerialBufferTail;
+  }
+
+  //
+  // One byte is kept free so that a full buffer can be told from an empty one.
+  //
+  if (Size > mSerialBufferSize - 1 - Used) {
+    mSerialBufferStatistics.DroppedRecords++;
+    mSerialBufferStatistics.DroppedBytes += Size;
+    return FALSE;
+  }
+
+  FirstSize = MIN (Size, mSerialBufferSize - mSerialBufferTail);
+  CopyMem (mSerialBuffer + mSerialBufferTail, Buffer, FirstSize);
+  CopyMem (mSerialBuffer, Buffer + FirstSize, Size - FirstSize);
+  Tail = mSerialBufferTail + Size;
+  if (Tail >= mSerialBufferSize) {
+    Tail -= mSerialBufferSize;
+  }
+  mSerialBufferTail = Tail;
+
+  mSerialBufferStatistics.EnqueuedRecords++;
+  mSerialBufferStatistics.PeakUsage = MAX (mSerialBufferStatistics.PeakUsage, Used + Size);
+  return TRUE;
+}
+
+/**
+  Allocate the serial status code buffer and create the events draining it.
+
+  Once the buffer is set up, the status code strings are queued in it instead of
+  being written to the serial port synchronously.
+
+  @retval EFI_SUCCESS          The serial status code buffer is set up, or it is disabled
+                               by PcdStatusCodeSerialBufferSize.
+  @retval EFI_OUT_OF_RESOURCES There is not enough memory for the buffer.
+
+**/
+EFI_STATUS
+SerialStatusCodeBufferInitializeWorker (
+  VOID
+  )
+{
+  EFI_STATUS      Status;
+  UINTN           BufferSize;
+  UINT8           *Buffer;
+
+  BufferSize = (UINTN) PcdGet32 (PcdStatusCodeSerialBufferSize) * 1024;
+  if (BufferSize == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Buffer = AllocatePool (BufferSize);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Drain the buffer when the CPU is idle, and also periodically in case
+  // the boot keeps the CPU busy for long.
+  //
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SerialStatusCodeBufferDrainNotify,
+                  (VOID *) (UINTN) SERIAL_STATUS_CODE_IDLE_DRAIN_SIZE,
+                  &gIdleLoopEventGuid,
+                  &mSerialBufferIdleEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SerialStatusCodeBufferDrainNotify,
+                  (VOID *) (UINTN) SERIAL_STATUS_CODE_TIMER_DRAIN_SIZE,
+                  &mSerialBufferTimerEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->SetTimer (mSerialBufferTimerEvent, TimerPeriodic, SERIAL_STATUS_CODE_DRAIN_PERIOD);
+  ASSERT_EFI_ERROR (Status);
+
+  mSerialBufferSize = BufferSize;
+  mSerialBufferHead = 0;
+  mSerialBufferTail = 0;
+  mSerialBuffer     = Buffer;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write all of the queued status code strings to the serial port, and stop queuing
+  the status code strings.
+
+  It is called when exiting boot services, as the serial status code worker is
+  not available at runtime.
+
+**/
+VOID
+SerialStatusCodeBufferStopWorker (
+  VOID
+  )
+{
+  if (mSerialBuffer == NULL) {
+    return;
+  }
+
+  DEBUG ((
+    EFI_D_INFO,
+    "Serial status code buffer: %ld queued, %ld dropped (%ld bytes), %ld flushed, peak %d bytes\n",
+    mSerialBufferStatistics.EnqueuedRecords,
+    mSerialBufferStatistics.DroppedRecords,
+    mSerialBufferStatistics.DroppedBytes,
+    mSerialBufferStatistics.SynchronousFlushes,
+    mSerialBufferStatistics.PeakUsage
+    ));
+
+  gBS->SetTimer (mSerialBufferTimerEvent, TimerCancel, 0);
+  FlushSerialStatusCodeBuffer ();
+
+  //
+  // The memory of the buffer is not freed, as memory services must not be used
+  // while exiting boot services.
+  //
+  mSerialBuffer = NULL;
+}
+
 /**
   Convert status code value and extended data to readable ASCII string, send string to serial I/O device.
  
@@ -51,12 +305,19 @@ SerialStatusCodeReportWorker (
   UINT32          LineNumber;
   UINTN           CharCount;
   BASE_LIST       Marker;
+  BOOLEAN         Synchronous;
+  EFI_TPL         OldTpl;
 
   Buffer[0] = '\0';
+  Synchronous = FALSE;
 
   if (Data != NULL &&
       ReportStatusCodeExtractAssertInfo (CodeType, Value, Data, &Filename, &Description, &LineNumber)) {
     //
+    // The system may stop right after ASSERT(), so it must reach the serial port now.
+    //
+    Synchronous = TRUE;
+    //
     // Print ASSERT() information into output buffer.
     //
     CharCount = AsciiSPrint (
@@ -153,8 +414,20 @@ SerialStatusCodeReportWorker (
   }
 
   //
-  // Call SerialPort Lib function to do print.
+  // Queue the string if the serial status code buffer is set up, otherwise
+  // call SerialPort Lib function to do print.
   //
+  if (mSerialBuffer != NULL && !Synchronous) {
+    OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    EnqueueSerialStatusCode ((UINT8 *) Buffer, CharCount);
+    gBS->RestoreTPL (OldTpl);
+    return EFI_SUCCESS;
+  }
+
+  if (mSerialBuffer != NULL) {
+    mSerialBufferStatistics.SynchronousFlushes++;
+    FlushSerialStatusCodeBuffer ();
+  }
   SerialPortWrite ((UINT8 *) Buffer, CharCount);
 
   return EFI_SUCCESS;
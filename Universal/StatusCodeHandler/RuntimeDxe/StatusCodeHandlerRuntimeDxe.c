@@ -36,6 +36,7 @@ UnregisterBootTimeHandlers (
   )
 {
   if (FeaturePcdGet (PcdStatusCodeUseSerial)) {
+    SerialStatusCodeBufferStopWorker ();
     mRscHandlerProtocol->Unregister (SerialStatusCodeReportWorker);
   }
 }
@@ -63,6 +64,14 @@ VirtualAddressChangeCallBack (
     0,
     (VOID **) &mRtMemoryStatusCodeTable
     );
+
+  //
+  // Convert status code trace ring to virtual address;
+  //
+  EfiConvertPointer (
+    0,
+    (VOID **) &mDxeStatusCodeTrace
+    );
 }
 
 /**
@@ -97,6 +106,10 @@ InitializationDispatcherWorker (
     Status = RtMemoryStatusCodeInitializeWorker ();
     ASSERT_EFI_ERROR (Status);
   }
+  if (FeaturePcdGet (PcdStatusCodeUseTrace)) {
+    Status = TraceStatusCodeInitializeWorker ();
+    ASSERT_EFI_ERROR (Status);
+  }
 
   //
   // Replay Status code which saved in GUID'ed HOB to all supported devices. 
@@ -178,11 +191,16 @@ StatusCodeHandlerRuntimeDxeEntry (
   InitializationDispatcherWorker ();
 
   if (FeaturePcdGet (PcdStatusCodeUseSerial)) {
+    Status = SerialStatusCodeBufferInitializeWorker ();
+    ASSERT_EFI_ERROR (Status);
     mRscHandlerProtocol->Register (SerialStatusCodeReportWorker, TPL_HIGH_LEVEL);
   }
   if (FeaturePcdGet (PcdStatusCodeUseMemory)) {
     mRscHandlerProtocol->Register (RtMemoryStatusCodeReportWorker, TPL_HIGH_LEVEL);
   }
+  if (FeaturePcdGet (PcdStatusCodeUseTrace) && mDxeStatusCodeTrace != NULL) {
+    mRscHandlerProtocol->Register (TraceStatusCodeReportWorker, TPL_HIGH_LEVEL);
+  }
 
   Status = gBS->CreateEventEx (
                   EVT_NOTIFY_SIGNAL,
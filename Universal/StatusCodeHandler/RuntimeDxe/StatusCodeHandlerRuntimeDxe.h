@@ -21,8 +21,11 @@
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Guid/StatusCodeDataTypeDebug.h>
 #include <Guid/EventGroup.h>
+#include <Guid/IdleLoopEvent.h>
+#include <Guid/StatusCodeTrace.h>
 
 #include <Library/SynchronizationLib.h>
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/ReportStatusCodeLib.h>
@@ -34,12 +37,37 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiRuntimeLib.h>
 #include <Library/SerialPortLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiLib.h>
 
 //
 // Define the maximum message length
 //
 #define MAX_DEBUG_MESSAGE_LENGTH 0x100
 
+//
+// Number of bytes written to the serial port each time the serial status code
+// buffer is drained from the idle loop and from the periodic timer.
+//
+#define SERIAL_STATUS_CODE_IDLE_DRAIN_SIZE   64
+#define SERIAL_STATUS_CODE_TIMER_DRAIN_SIZE  16
+
+//
+// Period of the timer draining the serial status code buffer, in 100ns units.
+//
+#define SERIAL_STATUS_CODE_DRAIN_PERIOD      100000
+
+//
+// Statistics of the serial status code buffer
+//
+typedef struct {
+  UINT64   EnqueuedRecords;
+  UINT64   DroppedRecords;
+  UINT64   DroppedBytes;
+  UINT64   SynchronousFlushes;
+  UINTN    PeakUsage;
+} SERIAL_STATUS_CODE_BUFFER_STATISTICS;
+
 //
 // Runtime memory status code worker definition
 //
@@ -50,6 +78,7 @@ typedef struct {
 } RUNTIME_MEMORY_STATUSCODE_HEADER;
 
 extern RUNTIME_MEMORY_STATUSCODE_HEADER  *mRtMemoryStatusCodeTable;
+extern STATUS_CODE_TRACE_HEADER          *mDxeStatusCodeTrace;
 
 /**
   Locates Serial I/O Protocol as initialization for serial status code worker.
@@ -62,6 +91,35 @@ EfiSerialStatusCodeInitializeWorker (
   VOID
   );
 
+/**
+  Allocate the serial status code buffer and create the events draining it.
+
+  Once the buffer is set up, the status code strings are queued in it instead of
+  being written to the serial port synchronously.
+
+  @retval EFI_SUCCESS          The serial status code buffer is set up, or it is disabled
+                               by PcdStatusCodeSerialBufferSize.
+  @retval EFI_OUT_OF_RESOURCES There is not enough memory for the buffer.
+
+**/
+EFI_STATUS
+SerialStatusCodeBufferInitializeWorker (
+  VOID
+  );
+
+/**
+  Write all of the queued status code strings to the serial port, and stop queuing
+  the status code strings.
+
+  It is called when exiting boot services, as the serial status code worker is
+  not available at runtime.
+
+**/
+VOID
+SerialStatusCodeBufferStopWorker (
+  VOID
+  );
+
 
 /**
   Convert status code value and extended data to readable ASCII string, send string to serial I/O device.
@@ -131,4 +189,48 @@ RtMemoryStatusCodeReportWorker (
   IN EFI_STATUS_CODE_DATA               *Data OPTIONAL
   );
 
+/**
+  Create the DXE status code trace ring, and publish it with the PEI one in the
+  status code trace table.
+
+  @retval EFI_SUCCESS           The status code trace ring is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the ring.
+
+**/
+EFI_STATUS
+TraceStatusCodeInitializeWorker (
+  VOID
+  );
+
+/**
+  Record status code in the DXE status code trace ring. If the ring is full,
+  the oldest record is overwritten.
+
+  The record is reserved by an atomic increment, so status codes reported at the
+  same time are recorded without any lock.
+
+  @param  CodeType                Indicates the type of status code being reported.
+  @param  Value                   Describes the current status of a hardware or software entity.
+                                  This included information about the class and subclass that is used to
+                                  classify the entity as well as an operation.
+  @param  Instance                The enumeration of a hardware or software entity within
+                                  the system. Valid instance numbers start with 1.
+  @param  CallerId                This optional parameter may be used to identify the caller.
+                                  This parameter allows the status code driver to apply different rules to
+                                  different callers.
+  @param  Data                    This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS             Status code successfully recorded in the status code trace ring.
+
+**/
+EFI_STATUS
+EFIAPI
+TraceStatusCodeReportWorker (
+  IN EFI_STATUS_CODE_TYPE               CodeType,
+  IN EFI_STATUS_CODE_VALUE              Value,
+  IN UINT32                             Instance,
+  IN EFI_GUID                           *CallerId,
+  IN EFI_STATUS_CODE_DATA               *Data OPTIONAL
+  );
+
 #endif
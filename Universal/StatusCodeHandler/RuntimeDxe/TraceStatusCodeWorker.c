@@ -0,0 +1,173 @@
+/** @file
+  Binary status code trace worker.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "StatusCodeHandlerRuntimeDxe.h"
+
+STATUS_CODE_TRACE_HEADER  *mDxeStatusCodeTrace = NULL;
+
+/**
+  Get the status code trace table from the EFI system table. The table is
+  installed if it does not exist yet.
+
+  @return The status code trace table, or NULL if it can not be installed.
+
+**/
+STATUS_CODE_TRACE_TABLE *
+GetStatusCodeTraceTable (
+  VOID
+  )
+{
+  EFI_STATUS                Status;
+  STATUS_CODE_TRACE_TABLE   *Table;
+
+  Status = EfiGetSystemConfigurationTable (&gEdkiiStatusCodeTraceGuid, (VOID **) &Table);
+  if (!EFI_ERROR (Status)) {
+    return Table;
+  }
+
+  Table = AllocateRuntimeZeroPool (sizeof (STATUS_CODE_TRACE_TABLE));
+  if (Table == NULL) {
+    return NULL;
+  }
+  Table->Signature = STATUS_CODE_TRACE_TABLE_SIGNATURE;
+
+  Status = gBS->InstallConfigurationTable (&gEdkiiStatusCodeTraceGuid, Table);
+  if (EFI_ERROR (Status)) {
+    FreePool (Table);
+    return NULL;
+  }
+  return Table;
+}
+
+/**
+  Copy the status code trace ring of PEI, found in the GUID'ed HOB, to runtime memory.
+
+  @return The copy of the PEI status code trace ring, or NULL if there is none.
+
+**/
+STATUS_CODE_TRACE_HEADER *
+CopyPeiStatusCodeTrace (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE         *GuidHob;
+
+  GuidHob = GetFirstGuidHob (&gEdkiiStatusCodeTraceGuid);
+  if (GuidHob == NULL) {
+    return NULL;
+  }
+
+  return AllocateRuntimeCopyPool (GET_GUID_HOB_DATA_SIZE (GuidHob), GET_GUID_HOB_DATA (GuidHob));
+}
+
+/**
+  Create the DXE status code trace ring, and publish it with the PEI one in the
+  status code trace table.
+
+  @retval EFI_SUCCESS           The status code trace ring is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the ring.
+
+**/
+EFI_STATUS
+TraceStatusCodeInitializeWorker (
+  VOID
+  )
+{
+  STATUS_CODE_TRACE_TABLE   *Table;
+  STATUS_CODE_TRACE_HEADER  *PeiTrace;
+  UINTN                     Size;
+
+  Size = PcdGet16 (PcdStatusCodeTraceSize) * 1024;
+  mDxeStatusCodeTrace = AllocateRuntimeZeroPool (Size);
+  if (mDxeStatusCodeTrace == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mDxeStatusCodeTrace->Signature      = STATUS_CODE_TRACE_SIGNATURE;
+  mDxeStatusCodeTrace->Revision       = STATUS_CODE_TRACE_REVISION;
+  mDxeStatusCodeTrace->Phase          = StatusCodeTracePhaseDxe;
+  mDxeStatusCodeTrace->RecordSize     = sizeof (STATUS_CODE_TRACE_RECORD);
+  mDxeStatusCodeTrace->MaxRecords     = GetPowerOfTwo32 ((UINT32) ((Size - sizeof (STATUS_CODE_TRACE_HEADER)) / sizeof (STATUS_CODE_TRACE_RECORD)));
+  mDxeStatusCodeTrace->TimerFrequency = GetPerformanceCounterProperties (NULL, NULL);
+  ASSERT (mDxeStatusCodeTrace->MaxRecords != 0);
+
+  Table = GetStatusCodeTraceTable ();
+  if (Table != NULL) {
+    Table->Ring[StatusCodeTracePhaseDxe] = (EFI_PHYSICAL_ADDRESS) (UINTN) mDxeStatusCodeTrace;
+    PeiTrace = CopyPeiStatusCodeTrace ();
+    if (PeiTrace != NULL) {
+      Table->Ring[StatusCodeTracePhasePei] = (EFI_PHYSICAL_ADDRESS) (UINTN) PeiTrace;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Record status code in the DXE status code trace ring. If the ring is full,
+  the oldest record is overwritten.
+
+  The record is reserved by an atomic increment, so status codes reported at the
+  same time are recorded without any lock.
+
+  @param  CodeType                Indicates the type of status code being reported.
+  @param  Value                   Describes the current status of a hardware or software entity.
+                                  This included information about the class and subclass that is used to
+                                  classify the entity as well as an operation.
+  @param  Instance                The enumeration of a hardware or software entity within
+                                  the system. Valid instance numbers start with 1.
+  @param  CallerId                This optional parameter may be used to identify the caller.
+                                  This parameter allows the status code driver to apply different rules to
+                                  different callers.
+  @param  Data                    This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS             Status code successfully recorded in the status code trace ring.
+
+**/
+EFI_STATUS
+EFIAPI
+TraceStatusCodeReportWorker (
+  IN EFI_STATUS_CODE_TYPE               CodeType,
+  IN EFI_STATUS_CODE_VALUE              Value,
+  IN UINT32                             Instance,
+  IN EFI_GUID                           *CallerId,
+  IN EFI_STATUS_CODE_DATA               *Data OPTIONAL
+  )
+{
+  UINT32                                Index;
+  STATUS_CODE_TRACE_RECORD              *Record;
+
+  Index  = InterlockedIncrement (&mDxeStatusCodeTrace->WriteIndex) - 1;
+  Record = (STATUS_CODE_TRACE_RECORD *) (mDxeStatusCodeTrace + 1);
+  Record = &Record[Index & (mDxeStatusCodeTrace->MaxRecords - 1)];
+
+  Record->Sequence  = 0;
+  Record->TimeStamp = GetPerformanceCounter ();
+  if (CallerId != NULL) {
+    CopyGuid (&Record->CallerId, CallerId);
+  } else {
+    ZeroMem (&Record->CallerId, sizeof (EFI_GUID));
+  }
+  Record->CodeType  = CodeType;
+  Record->Value     = Value;
+  Record->Instance  = Instance;
+
+  //
+  // Make the record complete before it is marked valid.
+  //
+  MemoryFence ();
+  Record->Sequence  = Index + 1;
+
+  return EFI_SUCCESS;
+}
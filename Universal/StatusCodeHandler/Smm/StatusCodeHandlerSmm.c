@@ -45,6 +45,10 @@ InitializationDispatcherWorker (
     Status = MemoryStatusCodeInitializeWorker ();
     ASSERT_EFI_ERROR (Status);
   }
+  if (FeaturePcdGet (PcdStatusCodeUseTrace)) {
+    Status = TraceStatusCodeInitializeWorker ();
+    ASSERT_EFI_ERROR (Status);
+  }
 }
 
 /**
@@ -85,6 +89,9 @@ StatusCodeHandlerSmmEntry (
   if (FeaturePcdGet (PcdStatusCodeUseMemory)) {
     mRscHandlerProtocol->Register (MemoryStatusCodeReportWorker);
   }
+  if (FeaturePcdGet (PcdStatusCodeUseTrace) && mSmmStatusCodeTrace != NULL) {
+    mRscHandlerProtocol->Register (TraceStatusCodeReportWorker);
+  }
 
   return EFI_SUCCESS;
 }
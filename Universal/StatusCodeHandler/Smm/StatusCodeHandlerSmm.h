@@ -20,6 +20,7 @@
 #include <Guid/MemoryStatusCodeRecord.h>
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Guid/StatusCodeDataTypeDebug.h>
+#include <Guid/StatusCodeTrace.h>
 
 #include <Library/SynchronizationLib.h>
 #include <Library/DebugLib.h>
@@ -31,6 +32,10 @@
 #include <Library/SerialPortLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/BaseLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
 
 //
 // Define the maximum message length
@@ -47,6 +52,7 @@ typedef struct {
 } RUNTIME_MEMORY_STATUSCODE_HEADER;
 
 extern RUNTIME_MEMORY_STATUSCODE_HEADER  *mSmmMemoryStatusCodeTable;
+extern STATUS_CODE_TRACE_HEADER          *mSmmStatusCodeTrace;
 
 /**
   Locates Serial I/O Protocol as initialization for serial status code worker.
@@ -128,4 +134,44 @@ MemoryStatusCodeReportWorker (
   IN EFI_STATUS_CODE_DATA               *Data OPTIONAL
   );
 
+/**
+  Create the SMM status code trace ring, and publish it in the status code trace table.
+
+  @retval EFI_SUCCESS           The status code trace ring is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the ring.
+
+**/
+EFI_STATUS
+TraceStatusCodeInitializeWorker (
+  VOID
+  );
+
+/**
+  Record status code in the SMM status code trace ring. If the ring is full,
+  the oldest record is overwritten.
+
+  @param  CodeType                Indicates the type of status code being reported.
+  @param  Value                   Describes the current status of a hardware or software entity.
+                                  This included information about the class and subclass that is used to
+                                  classify the entity as well as an operation.
+  @param  Instance                The enumeration of a hardware or software entity within
+                                  the system. Valid instance numbers start with 1.
+  @param  CallerId                This optional parameter may be used to identify the caller.
+                                  This parameter allows the status code driver to apply different rules to
+                                  different callers.
+  @param  Data                    This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS             Status code successfully recorded in the status code trace ring.
+
+**/
+EFI_STATUS
+EFIAPI
+TraceStatusCodeReportWorker (
+  IN EFI_STATUS_CODE_TYPE               CodeType,
+  IN EFI_STATUS_CODE_VALUE              Value,
+  IN UINT32                             Instance,
+  IN EFI_GUID                           *CallerId,
+  IN EFI_STATUS_CODE_DATA               *Data OPTIONAL
+  );
+
 #endif
@@ -0,0 +1,159 @@
+/** @file
+  Binary status code trace worker.
+
+  The SMM status code trace ring lives outside of SMRAM, so it can be read by the
+  status code trace decoder. The location, the size and the write index of the ring
+  are kept in SMRAM, and the ring is only written through them.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "StatusCodeHandlerSmm.h"
+
+STATUS_CODE_TRACE_HEADER  *mSmmStatusCodeTrace = NULL;
+UINT32                    mSmmStatusCodeTraceWriteIndex = 0;
+UINT32                    mSmmStatusCodeTraceMaxRecords = 0;
+
+/**
+  Get the status code trace table from the EFI system table. The table is
+  installed if it does not exist yet.
+
+  @return The status code trace table, or NULL if it can not be installed.
+
+**/
+STATUS_CODE_TRACE_TABLE *
+GetStatusCodeTraceTable (
+  VOID
+  )
+{
+  EFI_STATUS                Status;
+  STATUS_CODE_TRACE_TABLE   *Table;
+
+  Status = EfiGetSystemConfigurationTable (&gEdkiiStatusCodeTraceGuid, (VOID **) &Table);
+  if (!EFI_ERROR (Status)) {
+    return Table;
+  }
+
+  Status = gBS->AllocatePool (EfiRuntimeServicesData, sizeof (STATUS_CODE_TRACE_TABLE), (VOID **) &Table);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+  ZeroMem (Table, sizeof (STATUS_CODE_TRACE_TABLE));
+  Table->Signature = STATUS_CODE_TRACE_TABLE_SIGNATURE;
+
+  Status = gBS->InstallConfigurationTable (&gEdkiiStatusCodeTraceGuid, Table);
+  if (EFI_ERROR (Status)) {
+    gBS->FreePool (Table);
+    return NULL;
+  }
+  return Table;
+}
+
+/**
+  Create the SMM status code trace ring, and publish it in the status code trace table.
+
+  @retval EFI_SUCCESS           The status code trace ring is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the ring.
+
+**/
+EFI_STATUS
+TraceStatusCodeInitializeWorker (
+  VOID
+  )
+{
+  EFI_STATUS                Status;
+  STATUS_CODE_TRACE_TABLE   *Table;
+  UINTN                     Size;
+
+  Size   = PcdGet16 (PcdStatusCodeTraceSize) * 1024;
+  Status = gBS->AllocatePool (EfiRuntimeServicesData, Size, (VOID **) &mSmmStatusCodeTrace);
+  if (EFI_ERROR (Status)) {
+    mSmmStatusCodeTrace = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ZeroMem (mSmmStatusCodeTrace, Size);
+
+  mSmmStatusCodeTraceMaxRecords = GetPowerOfTwo32 ((UINT32) ((Size - sizeof (STATUS_CODE_TRACE_HEADER)) / sizeof (STATUS_CODE_TRACE_RECORD)));
+  ASSERT (mSmmStatusCodeTraceMaxRecords != 0);
+
+  mSmmStatusCodeTrace->Signature      = STATUS_CODE_TRACE_SIGNATURE;
+  mSmmStatusCodeTrace->Revision       = STATUS_CODE_TRACE_REVISION;
+  mSmmStatusCodeTrace->Phase          = StatusCodeTracePhaseSmm;
+  mSmmStatusCodeTrace->RecordSize     = sizeof (STATUS_CODE_TRACE_RECORD);
+  mSmmStatusCodeTrace->MaxRecords     = mSmmStatusCodeTraceMaxRecords;
+  mSmmStatusCodeTrace->TimerFrequency = GetPerformanceCounterProperties (NULL, NULL);
+
+  Table = GetStatusCodeTraceTable ();
+  if (Table != NULL) {
+    Table->Ring[StatusCodeTracePhaseSmm] = (EFI_PHYSICAL_ADDRESS) (UINTN) mSmmStatusCodeTrace;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Record status code in the SMM status code trace ring. If the ring is full,
+  the oldest record is overwritten.
+
+  The record is reserved by an atomic increment, so status codes reported by
+  several processors at the same time are recorded without any lock.
+
+  @param  CodeType                Indicates the type of status code being reported.
+  @param  Value                   Describes the current status of a hardware or software entity.
+                                  This included information about the class and subclass that is used to
+                                  classify the entity as well as an operation.
+  @param  Instance                The enumeration of a hardware or software entity within
+                                  the system. Valid instance numbers start with 1.
+  @param  CallerId                This optional parameter may be used to identify the caller.
+                                  This parameter allows the status code driver to apply different rules to
+                                  different callers.
+  @param  Data                    This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS             Status code successfully recorded in the status code trace ring.
+
+**/
+EFI_STATUS
+EFIAPI
+TraceStatusCodeReportWorker (
+  IN EFI_STATUS_CODE_TYPE               CodeType,
+  IN EFI_STATUS_CODE_VALUE              Value,
+  IN UINT32                             Instance,
+  IN EFI_GUID                           *CallerId,
+  IN EFI_STATUS_CODE_DATA               *Data OPTIONAL
+  )
+{
+  UINT32                                Index;
+  STATUS_CODE_TRACE_RECORD              *Record;
+
+  Index  = InterlockedIncrement (&mSmmStatusCodeTraceWriteIndex) - 1;
+  Record = (STATUS_CODE_TRACE_RECORD *) (mSmmStatusCodeTrace + 1);
+  Record = &Record[Index & (mSmmStatusCodeTraceMaxRecords - 1)];
+
+  Record->Sequence  = 0;
+  Record->TimeStamp = GetPerformanceCounter ();
+  if (CallerId != NULL) {
+    CopyGuid (&Record->CallerId, CallerId);
+  } else {
+    ZeroMem (&Record->CallerId, sizeof (EFI_GUID));
+  }
+  Record->CodeType  = CodeType;
+  Record->Value     = Value;
+  Record->Instance  = Instance;
+
+  //
+  // Make the record complete before it is marked valid.
+  //
+  MemoryFence ();
+  Record->Sequence  = Index + 1;
+  mSmmStatusCodeTrace->WriteIndex = mSmmStatusCodeTraceWriteIndex;
+
+  return EFI_SUCCESS;
+}
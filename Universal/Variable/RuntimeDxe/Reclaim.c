@@ -16,6 +16,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "Variable.h"
 
+///
+/// Statistics of the non-volatile variable store reclaim.
+///
+VARIABLE_RECLAIM_STATISTICS   mVariableReclaimStatistics;
+
 /**
   Gets LBA of block and offset by given address.
 
@@ -99,8 +104,15 @@ GetLbaAndOffsetByAddress (
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the span between the first and the last byte that differs from the
+  current flash content is written, so the blocks that are not changed by
+  the reclaim are neither erased nor rewritten. The span is still written
+  with a single FTW record to keep the update fault tolerant.
+
   @param  VariableBase   Base address of variable to write
   @param  VariableBuffer Point to the variable data buffer.
+  @param  IsReclaim      TRUE if the write is done by a reclaim, and is
+                         recorded in the reclaim statistics.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -110,16 +122,51 @@ GetLbaAndOffsetByAddress (
 EFI_STATUS
 FtwVariableSpace (
   IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  IN VARIABLE_STORE_HEADER  *VariableBuffer,
+  IN BOOLEAN                IsReclaim
   )
 {
   EFI_STATUS                         Status;
   EFI_HANDLE                         FvbHandle;
   EFI_LBA                            VarLba;
   UINTN                              VarOffset;
+  EFI_LBA                            LastLba;
+  UINTN                              LastOffset;
   UINTN                              FtwBufferSize;
+  UINTN                              DirtyStart;
+  UINTN                              DirtyEnd;
+  UINT8                              *FlashBuffer;
+  UINT8                              *NewBuffer;
   EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
 
+  FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
+  ASSERT (FtwBufferSize == VariableBuffer->Size);
+
+  //
+  // Find the span of the variable store that is changed by the reclaim.
+  //
+  FlashBuffer = (UINT8 *) (UINTN) VariableBase;
+  NewBuffer   = (UINT8 *) VariableBuffer;
+  for (DirtyStart = 0; DirtyStart < FtwBufferSize; DirtyStart++) {
+    if (FlashBuffer[DirtyStart] != NewBuffer[DirtyStart]) {
+      break;
+    }
+  }
+  if (DirtyStart == FtwBufferSize) {
+    //
+    // The flash content is already up to date, nothing to write.
+    //
+    if (IsReclaim && FeaturePcdGet (PcdVariableCollectStatistics)) {
+      mVariableReclaimStatistics.SkippedCount++;
+    }
+    return EFI_SUCCESS;
+  }
+  for (DirtyEnd = FtwBufferSize; DirtyEnd > DirtyStart; DirtyEnd--) {
+    if (FlashBuffer[DirtyEnd - 1] != NewBuffer[DirtyEnd - 1]) {
+      break;
+    }
+  }
+
   //
   // Locate fault tolerant write protocol.
   //
@@ -135,28 +182,67 @@ FtwVariableSpace (
     return Status;
   }
   //
-  // Get LBA and Offset by address.
+  // Get LBA and Offset of the first and the last changed byte.
   //
-  Status = GetLbaAndOffsetByAddress (VariableBase, &VarLba, &VarOffset);
+  Status = GetLbaAndOffsetByAddress (VariableBase + DirtyStart, &VarLba, &VarOffset);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+  Status = GetLbaAndOffsetByAddress (VariableBase + DirtyEnd - 1, &LastLba, &LastOffset);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
-
-  FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
-  ASSERT (FtwBufferSize == VariableBuffer->Size);
 
   //
   // FTW write record.
   //
   Status = FtwProtocol->Write (
                           FtwProtocol,
-                          VarLba,         // LBA
-                          VarOffset,      // Offset
-                          FtwBufferSize,  // NumBytes
-                          NULL,           // PrivateData NULL
-                          FvbHandle,      // Fvb Handle
-                          (VOID *) VariableBuffer // write buffer
+                          VarLba,                   // LBA
+                          VarOffset,                // Offset
+                          DirtyEnd - DirtyStart,    // NumBytes
+                          NULL,                     // PrivateData NULL
+                          FvbHandle,                // Fvb Handle
+                          NewBuffer + DirtyStart    // write buffer
                           );
 
+  if (!EFI_ERROR (Status) && IsReclaim && FeaturePcdGet (PcdVariableCollectStatistics)) {
+    mVariableReclaimStatistics.BytesMoved   += DirtyEnd - DirtyStart;
+    mVariableReclaimStatistics.BlocksErased += LastLba - VarLba + 1;
+  }
+
   return Status;
 }
+
+/**
+  Record one non-volatile variable store reclaim in the reclaim statistics.
+
+  @param  StartTick      Performance counter value when the reclaim started.
+
+**/
+VOID
+RecordVariableReclaim (
+  IN UINT64                 StartTick
+  )
+{
+  UINT64                             EndTick;
+  UINT64                             CounterStart;
+  UINT64                             CounterEnd;
+  UINT64                             Ticks;
+  UINT64                             Time;
+
+  EndTick = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterStart < CounterEnd) {
+    Ticks = EndTick - StartTick;
+  } else {
+    Ticks = StartTick - EndTick;
+  }
+  Time = GetTimeInNanoSecond (Ticks);
+
+  mVariableReclaimStatistics.ReclaimCount++;
+  mVariableReclaimStatistics.TotalTimeInNanoSeconds += Time;
+  if (Time > mVariableReclaimStatistics.MaxTimeInNanoSeconds) {
+    mVariableReclaimStatistics.MaxTimeInNanoSeconds = Time;
+  }
+}
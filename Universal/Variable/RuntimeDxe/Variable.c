@@ -60,6 +60,13 @@ BOOLEAN                mEnableLocking         = TRUE;
 //
 VAR_ERROR_FLAG         mCurrentBootVarErrFlag = VAR_ERROR_FLAG_NO_ERROR;
 
+///
+/// The variable returned by the last GetNextVariableName () call, it lets the
+/// next call continue the enumeration without looking the variable up again.
+/// It is invalidated whenever any variable store is modified.
+///
+VARIABLE_ENUMERATION_CURSOR  mVariableEnumerationCursor;
+
 /**
   Routine used to track statistical information about variable usage. 
   The data is stored in the EFI system table so it can be accessed later.
@@ -232,10 +239,28 @@ UpdateVariableStore (
   FwVolHeader = NULL;
   DataPtr     = DataPtrIndex;
 
+  mVariableEnumerationCursor.Valid = FALSE;
+
   //
   // Check if the Data is Volatile.
   //
-  if (!Volatile) {
+  if (!Volatile && mVariableBatch.Active) {
+    //
+    // A batch is in progress, so the staging store stands in for the flash
+    // and just do a simple mem copy.
+    //
+    if (SetByIndex) {
+      DataPtr += mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+    }
+
+    if ((DataPtr < (UINTN) mVariableBatch.StagingStore) ||
+        ((DataPtr + DataSize) > ((UINTN) mVariableBatch.StagingStore + mVariableBatch.StagingStore->Size))) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    CopyMem ((UINT8 *)(UINTN)DataPtr, Buffer, DataSize);
+    return EFI_SUCCESS;
+  } else if (!Volatile) {
     ASSERT (Fvb != NULL);
     Status = Fvb->GetPhysicalAddress(Fvb, &FvVolHdr);
     ASSERT_EFI_ERROR (Status);
@@ -528,6 +553,32 @@ GetEndPointer (
   return (VARIABLE_HEADER *) HEADER_ALIGN ((UINTN) VarStoreHeader + VarStoreHeader->Size);
 }
 
+/**
+
+  Gets the variable store of the given type.
+
+  The non-volatile variable store is returned as its memory copy.
+
+  @param Type            The type of the variable store.
+
+  @return Pointer to the Variable Store Header, NULL if the store is not present.
+
+**/
+VARIABLE_STORE_HEADER *
+GetVariableStoreByType (
+  IN VARIABLE_STORE_TYPE         Type
+  )
+{
+  switch (Type) {
+  case VariableStoreTypeVolatile:
+    return (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+  case VariableStoreTypeHob:
+    return (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase;
+  default:
+    return mNvVariableCache;
+  }
+}
+
 /**
   Record variable error flag.
 
@@ -794,6 +845,14 @@ Reclaim (
   UINTN                 HwErrVariableTotalSize;
   VARIABLE_HEADER       *UpdatingVariable;
   VARIABLE_HEADER       *UpdatingInDeletedTransition;
+  UINT64                StartTick;
+
+  mVariableEnumerationCursor.Valid = FALSE;
+
+  StartTick = 0;
+  if (!IsVolatile && FeaturePcdGet (PcdVariableCollectStatistics)) {
+    StartTick = GetPerformanceCounter ();
+  }
 
   UpdatingVariable = NULL;
   UpdatingInDeletedTransition = NULL;
@@ -985,13 +1044,23 @@ Reclaim (
     *LastVariableOffset = (UINTN) (CurrPtr - ValidBuffer);
     Status  = EFI_SUCCESS;
   } else {
-    //
-    // If non-volatile variable store, perform FTW here.
-    //
-    Status = FtwVariableSpace (
-              VariableBase,
-              (VARIABLE_STORE_HEADER *) ValidBuffer
-              );
+    if (mVariableBatch.Active) {
+      //
+      // The batch staging store stands in for the flash, it reaches the flash
+      // when the batch is committed.
+      //
+      CopyMem ((UINT8 *) (UINTN) VariableBase, ValidBuffer, VariableStoreHeader->Size);
+      Status = EFI_SUCCESS;
+    } else {
+      //
+      // If non-volatile variable store, perform FTW here.
+      //
+      Status = FtwVariableSpace (
+                VariableBase,
+                (VARIABLE_STORE_HEADER *) ValidBuffer,
+                TRUE
+                );
+    }
     if (!EFI_ERROR (Status)) {
       *LastVariableOffset = (UINTN) (CurrPtr - ValidBuffer);
       mVariableModuleGlobal->HwErrVariableTotalSize = HwErrVariableTotalSize;
@@ -1027,6 +1096,15 @@ Done:
     CopyMem (mNvVariableCache, (UINT8 *)(UINTN)VariableBase, VariableStoreHeader->Size);
   }
 
+  //
+  // The variable store has been rewritten, so rebuild its index.
+  //
+  RebuildVariableIndex (IsVolatile ? VariableStoreTypeVolatile : VariableStoreTypeNv);
+
+  if (!IsVolatile && FeaturePcdGet (PcdVariableCollectStatistics)) {
+    RecordVariableReclaim (StartTick);
+  }
+
   return Status;
 }
 
@@ -1050,9 +1128,20 @@ FindVariableEx (
   IN OUT VARIABLE_POINTER_TRACK  *PtrTrack
   )
 {
+  EFI_STATUS                     Status;
   VARIABLE_HEADER                *InDeletedVariable;
   VOID                           *Point;
 
+  if (VariableName[0] != 0) {
+    //
+    // Look up the variable by the index if the store range is indexed.
+    //
+    Status = FindVariableByIndex (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+  }
+
   PtrTrack->InDeletedTransitionPtr = NULL;
 
   //
@@ -2234,6 +2323,7 @@ UpdateVariable (
     // update the memory copy of Flash region.
     //
     CopyMem ((UINT8 *)mNvVariableCache + CacheOffset, (UINT8 *)NextVariable, VarSize);
+    AddVariableToIndex (VariableStoreTypeNv, (VARIABLE_HEADER *) ((UINT8 *) mNvVariableCache + CacheOffset));
   } else {
     //
     // Create a volatile variable.
@@ -2275,6 +2365,10 @@ UpdateVariable (
       goto Done;
     }
 
+    AddVariableToIndex (
+      VariableStoreTypeVolatile,
+      (VARIABLE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase + mVariableModuleGlobal->VolatileLastVariableOffset)
+      );
     mVariableModuleGlobal->VolatileLastVariableOffset += HEADER_ALIGN (VarSize);
   }
 
@@ -2541,6 +2635,83 @@ Done:
 
 
 
+/**
+  Locate the variable returned by the last GetNextVariableName () call.
+
+  The cursor is only used when the caller continues the enumeration from that
+  variable and no variable store has been modified since, so the result is the
+  same as what FindVariable () would return.
+
+  @param  VariableName        Name of the variable passed by the caller.
+  @param  VendorGuid          Vendor GUID passed by the caller.
+  @param  PtrTrack            Return the position of the variable.
+
+  @retval TRUE                The variable has been located by the cursor.
+  @retval FALSE               The cursor cannot be used.
+
+**/
+BOOLEAN
+GetVariableEnumerationCursor (
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+  VARIABLE_HEADER         *Variable;
+
+  if (!mVariableEnumerationCursor.Valid ||
+      (mVariableEnumerationCursor.AtRuntime != AtRuntime ()) ||
+      (VariableName[0] == 0)) {
+    return FALSE;
+  }
+
+  VariableStoreHeader = GetVariableStoreByType (mVariableEnumerationCursor.Type);
+  if (VariableStoreHeader == NULL) {
+    return FALSE;
+  }
+
+  Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + mVariableEnumerationCursor.Offset);
+  if (!CompareGuid (VendorGuid, &Variable->VendorGuid) ||
+      (StrSize (VariableName) != NameSizeOfVariable (Variable)) ||
+      (CompareMem (VariableName, GetVariableNamePtr (Variable), NameSizeOfVariable (Variable)) != 0)) {
+    return FALSE;
+  }
+
+  PtrTrack->StartPtr = GetStartPointer (VariableStoreHeader);
+  PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader);
+  PtrTrack->CurrPtr  = Variable;
+  PtrTrack->InDeletedTransitionPtr = NULL;
+  PtrTrack->Volatile = (BOOLEAN) (mVariableEnumerationCursor.Type == VariableStoreTypeVolatile);
+  return TRUE;
+}
+
+/**
+  Record the variable returned by GetNextVariableName () as the enumeration cursor.
+
+  @param  VariableStoreHeader Array of the variable stores indexed by VARIABLE_STORE_TYPE.
+  @param  PtrTrack            The position of the returned variable.
+
+**/
+VOID
+SetVariableEnumerationCursor (
+  IN VARIABLE_STORE_HEADER    **VariableStoreHeader,
+  IN VARIABLE_POINTER_TRACK   *PtrTrack
+  )
+{
+  VARIABLE_STORE_TYPE     Type;
+
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    if ((VariableStoreHeader[Type] != NULL) && (PtrTrack->StartPtr == GetStartPointer (VariableStoreHeader[Type]))) {
+      mVariableEnumerationCursor.Type      = Type;
+      mVariableEnumerationCursor.Offset    = (UINTN) PtrTrack->CurrPtr - (UINTN) VariableStoreHeader[Type];
+      mVariableEnumerationCursor.AtRuntime = AtRuntime ();
+      mVariableEnumerationCursor.Valid     = TRUE;
+      return;
+    }
+  }
+}
+
 /**
 
   This code Finds the Next available variable.
@@ -2580,9 +2751,15 @@ VariableServiceGetNextVariableName (
 
   AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
 
-  Status = FindVariable (VariableName, VendorGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE);
-  if (Variable.CurrPtr == NULL || EFI_ERROR (Status)) {
-    goto Done;
+  //
+  // Continue from the variable returned by the last call if possible,
+  // otherwise look up the variable passed by the caller.
+  //
+  if (!GetVariableEnumerationCursor (VariableName, VendorGuid, &Variable)) {
+    Status = FindVariable (VariableName, VendorGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE);
+    if (Variable.CurrPtr == NULL || EFI_ERROR (Status)) {
+      goto Done;
+    }
   }
 
   if (VariableName[0] != 0) {
@@ -2688,6 +2865,7 @@ VariableServiceGetNextVariableName (
         if (VarNameSize <= *VariableNameSize) {
           CopyMem (VariableName, GetVariableNamePtr (Variable.CurrPtr), VarNameSize);
           CopyMem (VendorGuid, &Variable.CurrPtr->VendorGuid, sizeof (EFI_GUID));
+          SetVariableEnumerationCursor (VariableStoreHeader, &Variable);
           Status = EFI_SUCCESS;
         } else {
           Status = EFI_BUFFER_TOO_SMALL;
@@ -2713,6 +2891,7 @@ Done:
   Caution: This function may receive untrusted input.
   This function may be invoked in SMM mode, and datasize and data are external input.
   This function will do basic validation, before parse the data.
+  The caller must hold the variable services lock.
 
   @param VariableName                     Name of Variable to be found.
   @param VendorGuid                       Variable vendor GUID.
@@ -2729,8 +2908,7 @@ Done:
 
 **/
 EFI_STATUS
-EFIAPI
-VariableServiceSetVariable (
+VariableServiceSetVariableInternal (
   IN CHAR16                  *VariableName,
   IN EFI_GUID                *VendorGuid,
   IN UINT32                  Attributes,
@@ -2740,8 +2918,6 @@ VariableServiceSetVariable (
 {
   VARIABLE_POINTER_TRACK              Variable;
   EFI_STATUS                          Status;
-  VARIABLE_HEADER                     *NextVariable;
-  EFI_PHYSICAL_ADDRESS                Point;
   LIST_ENTRY                          *Link;
   VARIABLE_ENTRY                      *Entry;
   CHAR16                              *Name;
@@ -2800,23 +2976,6 @@ VariableServiceSetVariable (
     }
   }
 
-  AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
-
-  //
-  // Consider reentrant in MCA/INIT/NMI. It needs be reupdated.
-  //
-  if (1 < InterlockedIncrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState)) {
-    Point = mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
-    //
-    // Parse non-volatile variable data and get last variable offset.
-    //
-    NextVariable  = GetStartPointer ((VARIABLE_STORE_HEADER *) (UINTN) Point);
-    while (IsValidVariableHeader (NextVariable, GetEndPointer ((VARIABLE_STORE_HEADER *) (UINTN) Point))) {
-      NextVariable = GetNextVariablePtr (NextVariable);
-    }
-    mVariableModuleGlobal->NonVolatileLastVariableOffset = (UINTN) NextVariable - (UINTN) Point;
-  }
-
   if (mEndOfDxe && mEnableLocking) {
     //
     // Treat the variables listed in the forbidden variable list as read-only after leaving DXE phase.
@@ -2878,6 +3037,64 @@ VariableServiceSetVariable (
   Status = UpdateVariable (VariableName, VendorGuid, Data, DataSize, Attributes, &Variable);
 
 Done:
+  return Status;
+}
+
+/**
+
+  This code sets variable in storage blocks (Volatile or Non-Volatile).
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and datasize and data are external input.
+  This function will do basic validation, before parse the data.
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+
+  @return EFI_INVALID_PARAMETER           Invalid parameter.
+  @return EFI_SUCCESS                     Set successfully.
+  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @return EFI_NOT_FOUND                   Not found.
+  @return EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableServiceSetVariable (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data
+  )
+{
+  EFI_STATUS                          Status;
+  VARIABLE_HEADER                     *NextVariable;
+  EFI_PHYSICAL_ADDRESS                Point;
+
+  AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+
+  //
+  // Consider reentrant in MCA/INIT/NMI. It needs be reupdated.
+  //
+  if (1 < InterlockedIncrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState)) {
+    Point = mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+    //
+    // Parse non-volatile variable data and get last variable offset.
+    //
+    NextVariable  = GetStartPointer ((VARIABLE_STORE_HEADER *) (UINTN) Point);
+    while (IsValidVariableHeader (NextVariable, GetEndPointer ((VARIABLE_STORE_HEADER *) (UINTN) Point))) {
+      NextVariable = GetNextVariablePtr (NextVariable);
+    }
+    mVariableModuleGlobal->NonVolatileLastVariableOffset = (UINTN) NextVariable - (UINTN) Point;
+  }
+
+  Status = VariableServiceSetVariableInternal (VariableName, VendorGuid, Attributes, DataSize, Data);
+
   InterlockedDecrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
   ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
 
@@ -3355,13 +3572,15 @@ FlushHobVariableToFlash (
 
   //
   // Flush the HOB variable to flash.
+  // Don't do it in a batch, the HOB variables must not be dropped if the batch is discarded.
   //
-  if (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) {
+  if ((mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) && !mVariableBatch.Active) {
     VariableStoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase;
     //
     // Set HobVariableBase to 0, it can avoid SetVariable to call back.
     //
     mVariableModuleGlobal->VariableGlobal.HobVariableBase = 0;
+    mVariableEnumerationCursor.Valid = FALSE;
     for ( Variable = GetStartPointer (VariableStoreHeader)
         ; IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))
         ; Variable = GetNextVariablePtr (Variable)
@@ -3416,6 +3635,7 @@ FlushHobVariableToFlash (
       DEBUG ((EFI_D_INFO, "Variable driver: all HOB variables have been flushed in flash.\n"));
       if (!AtRuntime ()) {
         FreePool ((VOID *) VariableStoreHeader);
+        FreeHobVariableIndex ();
       }
     }
   }
@@ -3568,8 +3788,14 @@ VariableCommonInitialize (
     }
     FreePool (mVariableModuleGlobal);
     FreePool (VolatileVariableStore);
+    return Status;
   }
 
+  //
+  // Build the variable indexes over the volatile store and the NV store cache.
+  //
+  InitializeVariableIndex ();
+
   return Status;
 }
 
@@ -24,6 +24,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/Variable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 #include <Library/PcdLib.h>
 #include <Library/HobLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -36,6 +37,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/SynchronizationLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
 #include <Guid/GlobalVariable.h>
 #include <Guid/EventGroup.h>
 #include <Guid/VariableFormat.h>
@@ -43,6 +45,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Guid/FaultTolerantWrite.h>
 #include <Guid/HardwareErrorVariable.h>
 #include <Guid/VarErrorFlag.h>
+#include <Guid/VariableReclaimStatistics.h>
 
 #define VARIABLE_ATTRIBUTE_BS_RT        (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
 #define VARIABLE_ATTRIBUTE_NV_BS_RT     (VARIABLE_ATTRIBUTE_BS_RT | EFI_VARIABLE_NON_VOLATILE)
@@ -74,6 +77,22 @@ typedef struct {
   BOOLEAN         Volatile;
 } VARIABLE_POINTER_TRACK;
 
+typedef struct {
+  UINT32    Offset;     ///< Offset of the variable header from the variable store header.
+  UINT32    Next;       ///< Next entry in the same bucket or in the free entry list.
+} VARIABLE_INDEX_ENTRY;
+
+///
+/// Hashed index of a variable store, it is followed by
+/// UINT32 Bucket[BucketCount] and VARIABLE_INDEX_ENTRY Entry[EntryCount].
+///
+typedef struct {
+  UINT32    BucketCount;
+  UINT32    EntryCount;
+  UINT32    FreeEntry;
+  BOOLEAN   Valid;
+} VARIABLE_INDEX;
+
 typedef struct {
   EFI_PHYSICAL_ADDRESS  HobVariableBase;
   EFI_PHYSICAL_ADDRESS  VolatileVariableBase;
@@ -97,6 +116,7 @@ typedef struct {
   CHAR8           *PlatformLang;
   CHAR8           Lang[ISO_639_2_ENTRY_SIZE + 1];
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL *FvbInstance;
+  VARIABLE_INDEX  *VariableIndex[VariableStoreTypeMax];
 } VARIABLE_MODULE_GLOBAL;
 
 typedef struct {
@@ -105,6 +125,30 @@ typedef struct {
   UINTN       VariableSize;
 } VARIABLE_ENTRY_CONSISTENCY;
 
+///
+/// Position of the variable returned by the last GetNextVariableName () call.
+///
+typedef struct {
+  BOOLEAN               Valid;
+  BOOLEAN               AtRuntime;
+  VARIABLE_STORE_TYPE   Type;
+  UINTN                 Offset;     ///< Offset of the variable header from the variable store header.
+} VARIABLE_ENUMERATION_CURSOR;
+
+///
+/// State of a batch of variable updates. While a batch is active,
+/// NonVolatileVariableBase points to StagingStore instead of the flash.
+///
+typedef struct {
+  BOOLEAN                 Active;
+  EFI_PHYSICAL_ADDRESS    NonVolatileVariableBase;    ///< Base address of the variable store in flash.
+  VARIABLE_STORE_HEADER   *StagingStore;
+  UINTN                   NonVolatileLastVariableOffset;
+  UINTN                   CommonVariableTotalSize;
+  UINTN                   CommonUserVariableTotalSize;
+  UINTN                   HwErrVariableTotalSize;
+} VARIABLE_BATCH;
+
 typedef struct {
   LIST_ENTRY  Link;
   EFI_GUID    Guid;
@@ -133,6 +177,8 @@ FlushHobVariableToFlash (
 
   @param  VariableBase   Base address of the variable to write.
   @param  VariableBuffer Point to the variable data buffer.
+  @param  IsReclaim      TRUE if the write is done by a reclaim, and is
+                         recorded in the reclaim statistics.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -142,7 +188,19 @@ FlushHobVariableToFlash (
 EFI_STATUS
 FtwVariableSpace (
   IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  IN VARIABLE_STORE_HEADER  *VariableBuffer,
+  IN BOOLEAN                IsReclaim
+  );
+
+/**
+  Record one non-volatile variable store reclaim in the reclaim statistics.
+
+  @param  StartTick      Performance counter value when the reclaim started.
+
+**/
+VOID
+RecordVariableReclaim (
+  IN UINT64                 StartTick
   );
 
 
@@ -484,6 +542,38 @@ VariableServiceSetVariable (
   IN VOID                    *Data
   );
 
+/**
+
+  This code sets variable in storage blocks (Volatile or Non-Volatile).
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and datasize and data are external input.
+  This function will do basic validation, before parse the data.
+  The caller must hold the variable services lock.
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+
+  @return EFI_INVALID_PARAMETER           Invalid parameter.
+  @return EFI_SUCCESS                     Set successfully.
+  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @return EFI_NOT_FOUND                   Not found.
+  @return EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableInternal (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data
+  );
+
 /**
 
   This code returns information about the EFI variables.
@@ -565,6 +655,35 @@ VariableLockRequestToLock (
   IN       EFI_GUID                     *VendorGuid
   );
 
+/**
+  Set a group of non-volatile variables as one transaction.
+
+  The updates are applied in order, so a later entry sees the result of an earlier
+  one. Either all of the updates are written to the variable store, or none of them.
+
+  @param[in]  This          The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]  EntryCount    Number of entries in Entries.
+  @param[in]  Entries       The variable updates to apply.
+  @param[out] FailedEntry   Optional pointer to the index of the entry that was rejected.
+                            It is set to EntryCount if no entry was rejected.
+
+  @retval EFI_SUCCESS           All of the updates were written to the variable store.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0 or Entries is NULL.
+                                Or an entry does not have the EFI_VARIABLE_NON_VOLATILE attribute.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough resource to stage the updates.
+  @retval Others                The status returned by SetVariable () for the entry FailedEntry,
+                                or the status of writing the variable store. None of the updates
+                                was written to the variable store.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL    *This,
+  IN       UINTN                            EntryCount,
+  IN       EDKII_VARIABLE_BATCH_ENTRY       *Entries,
+  OUT      UINTN                            *FailedEntry OPTIONAL
+  );
+
 /**
   Check if a Unicode character is a hexadecimal character.
 
@@ -703,6 +822,186 @@ InitializeVariableQuota (
   VOID
   );
 
+/**
+
+  This code checks if variable header is valid or not.
+
+  @param Variable           Pointer to the Variable Header.
+  @param VariableStoreEnd   Pointer to the Variable Store End.
+
+  @retval TRUE              Variable header is valid.
+  @retval FALSE             Variable header is not valid.
+
+**/
+BOOLEAN
+IsValidVariableHeader (
+  IN  VARIABLE_HEADER       *Variable,
+  IN  VARIABLE_HEADER       *VariableStoreEnd
+  );
+
+/**
+
+  This code gets the size of name of variable.
+
+  @param Variable        Pointer to the Variable Header.
+
+  @return UINTN          Size of variable in bytes.
+
+**/
+UINTN
+NameSizeOfVariable (
+  IN  VARIABLE_HEADER   *Variable
+  );
+
+/**
+
+  This code gets the pointer to the variable name.
+
+  @param Variable        Pointer to the Variable Header.
+
+  @return Pointer to Variable Name which is Unicode encoding.
+
+**/
+CHAR16 *
+GetVariableNamePtr (
+  IN  VARIABLE_HEADER   *Variable
+  );
+
+/**
+
+  This code gets the pointer to the next variable header.
+
+  @param Variable        Pointer to the Variable Header.
+
+  @return Pointer to next variable header.
+
+**/
+VARIABLE_HEADER *
+GetNextVariablePtr (
+  IN  VARIABLE_HEADER   *Variable
+  );
+
+/**
+
+  Gets the pointer to the first variable header in given variable store area.
+
+  @param VarStoreHeader  Pointer to the Variable Store Header.
+
+  @return Pointer to the first variable header.
+
+**/
+VARIABLE_HEADER *
+GetStartPointer (
+  IN VARIABLE_STORE_HEADER       *VarStoreHeader
+  );
+
+/**
+
+  Gets the pointer to the end of the variable storage area.
+
+  @param VarStoreHeader  Pointer to the Variable Store Header.
+
+  @return Pointer to the end of the variable storage area.
+
+**/
+VARIABLE_HEADER *
+GetEndPointer (
+  IN VARIABLE_STORE_HEADER       *VarStoreHeader
+  );
+
+/**
+
+  Gets the variable store of the given type.
+
+  The non-volatile variable store is returned as its memory copy.
+
+  @param Type            The type of the variable store.
+
+  @return Pointer to the Variable Store Header, NULL if the store is not present.
+
+**/
+VARIABLE_STORE_HEADER *
+GetVariableStoreByType (
+  IN VARIABLE_STORE_TYPE         Type
+  );
+
+/**
+  Create and build the indexes of the volatile variable store, the HOB
+  variable store and the memory copy of the non-volatile variable store.
+
+  If an index cannot be allocated, the lookups in that store fall back to
+  walking the variable store.
+
+**/
+VOID
+InitializeVariableIndex (
+  VOID
+  );
+
+/**
+  Free the index of the HOB variable store after all HOB variables have
+  been flushed to flash and the HOB variable store has been freed.
+
+**/
+VOID
+FreeHobVariableIndex (
+  VOID
+  );
+
+/**
+  Rebuild the index of a variable store.
+
+  It must be called after the content of the variable store has been
+  rewritten, for example by Reclaim ().
+
+  @param  Type        The type of the variable store.
+
+**/
+VOID
+RebuildVariableIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  );
+
+/**
+  Add a variable that has just been written to a variable store into the index.
+
+  @param  Type        The type of the variable store.
+  @param  Variable    Pointer to the variable header in the store.
+
+**/
+VOID
+AddVariableToIndex (
+  IN VARIABLE_STORE_TYPE    Type,
+  IN VARIABLE_HEADER        *Variable
+  );
+
+/**
+  Find the variable in a variable store by the index.
+
+  It returns the same variable as walking through the store range given
+  by PtrTrack does.
+
+  @param  VariableName        Name of the variable to be found, must not be an empty string.
+  @param  VendorGuid          Vendor GUID to be found.
+  @param  IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                              check at runtime when searching variable.
+  @param  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval EFI_SUCCESS         Variable found successfully.
+  @retval EFI_NOT_FOUND       Variable not found.
+  @retval EFI_UNSUPPORTED     The range given by PtrTrack is not covered by a valid index.
+
+**/
+EFI_STATUS
+FindVariableByIndex (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  );
+
 extern VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
+extern VARIABLE_RECLAIM_STATISTICS  mVariableReclaimStatistics;
+extern VARIABLE_BATCH  mVariableBatch;
 
 #endif
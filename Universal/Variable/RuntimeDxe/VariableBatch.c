@@ -0,0 +1,210 @@
+/** @file
+  Batched update of non-volatile variables.
+
+  While a batch is active, NonVolatileVariableBase points to a staging copy of
+  the non-volatile variable store. All of the variable updates of the batch,
+  including the garbage collection they need, are done in the staging store
+  just as they would be done in the flash. When the batch is committed, the
+  staging store is written to the flash with a single fault tolerant write,
+  so either all of the updates reach the flash or none of them does.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Variable.h"
+
+extern VARIABLE_STORE_HEADER  *mNvVariableCache;
+extern VARIABLE_ENUMERATION_CURSOR  mVariableEnumerationCursor;
+
+VARIABLE_BATCH  mVariableBatch;
+
+/**
+  Start a batch of non-volatile variable updates.
+
+  The caller must hold the variable services lock.
+
+  @retval EFI_SUCCESS           The batch is started.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough resource to hold the staging store.
+
+**/
+EFI_STATUS
+BeginVariableBatch (
+  VOID
+  )
+{
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+
+  ASSERT (!mVariableBatch.Active);
+
+  VariableStoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  mVariableBatch.StagingStore = AllocateCopyPool (VariableStoreHeader->Size, VariableStoreHeader);
+  if (mVariableBatch.StagingStore == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mVariableBatch.NonVolatileVariableBase       = mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  mVariableBatch.NonVolatileLastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  mVariableBatch.CommonVariableTotalSize       = mVariableModuleGlobal->CommonVariableTotalSize;
+  mVariableBatch.CommonUserVariableTotalSize   = mVariableModuleGlobal->CommonUserVariableTotalSize;
+  mVariableBatch.HwErrVariableTotalSize        = mVariableModuleGlobal->HwErrVariableTotalSize;
+
+  mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = (EFI_PHYSICAL_ADDRESS) (UINTN) mVariableBatch.StagingStore;
+  mVariableBatch.Active = TRUE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  End a batch of non-volatile variable updates.
+
+  The caller must hold the variable services lock.
+
+  @param[in] Commit             TRUE to write the staging store to the flash.
+                                FALSE to discard the updates of the batch.
+
+  @retval EFI_SUCCESS           The updates of the batch are written to the flash.
+  @retval EFI_ABORTED           The updates of the batch are discarded.
+  @retval Others                Fail to write the staging store to the flash,
+                                the updates of the batch are discarded.
+
+**/
+EFI_STATUS
+EndVariableBatch (
+  IN BOOLEAN                    Commit
+  )
+{
+  EFI_STATUS              Status;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+
+  ASSERT (mVariableBatch.Active);
+
+  mVariableBatch.Active = FALSE;
+  mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = mVariableBatch.NonVolatileVariableBase;
+  VariableStoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) mVariableBatch.NonVolatileVariableBase;
+
+  Status = EFI_ABORTED;
+  if (Commit) {
+    //
+    // The commit of a batch is not a reclaim, keep it out of the reclaim statistics.
+    //
+    Status = FtwVariableSpace (mVariableBatch.NonVolatileVariableBase, mVariableBatch.StagingStore, FALSE);
+  }
+
+  if (EFI_ERROR (Status)) {
+    mVariableModuleGlobal->NonVolatileLastVariableOffset = mVariableBatch.NonVolatileLastVariableOffset;
+    mVariableModuleGlobal->CommonVariableTotalSize       = mVariableBatch.CommonVariableTotalSize;
+    mVariableModuleGlobal->CommonUserVariableTotalSize   = mVariableBatch.CommonUserVariableTotalSize;
+    mVariableModuleGlobal->HwErrVariableTotalSize        = mVariableBatch.HwErrVariableTotalSize;
+  }
+
+  //
+  // Make the memory copy of Flash region match the flash again.
+  //
+  CopyMem (mNvVariableCache, VariableStoreHeader, VariableStoreHeader->Size);
+  RebuildVariableIndex (VariableStoreTypeNv);
+  mVariableEnumerationCursor.Valid = FALSE;
+
+  FreePool (mVariableBatch.StagingStore);
+  mVariableBatch.StagingStore = NULL;
+
+  return Status;
+}
+
+/**
+  Set a group of non-volatile variables as one transaction.
+
+  The updates are applied in order, so a later entry sees the result of an earlier
+  one. Either all of the updates are written to the variable store, or none of them.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and the entries are external input.
+
+  @param[in]  This          The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]  EntryCount    Number of entries in Entries.
+  @param[in]  Entries       The variable updates to apply.
+  @param[out] FailedEntry   Optional pointer to the index of the entry that was rejected.
+                            It is set to EntryCount if no entry was rejected.
+
+  @retval EFI_SUCCESS           All of the updates were written to the variable store.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0 or Entries is NULL.
+                                Or an entry does not have the EFI_VARIABLE_NON_VOLATILE attribute.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough resource to stage the updates.
+  @retval Others                The status returned by SetVariable () for the entry FailedEntry,
+                                or the status of writing the variable store. None of the updates
+                                was written to the variable store.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL    *This,
+  IN       UINTN                            EntryCount,
+  IN       EDKII_VARIABLE_BATCH_ENTRY       *Entries,
+  OUT      UINTN                            *FailedEntry OPTIONAL
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_STATUS                    CommitStatus;
+  UINTN                         Index;
+
+  if (FailedEntry != NULL) {
+    *FailedEntry = EntryCount;
+  }
+
+  if (EntryCount == 0 || Entries == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Only the non-volatile variable store is staged, so volatile variables
+  // can not be part of a batch.
+  //
+  for (Index = 0; Index < EntryCount; Index++) {
+    if ((Entries[Index].Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) {
+      if (FailedEntry != NULL) {
+        *FailedEntry = Index;
+      }
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  InterlockedIncrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
+
+  Status = BeginVariableBatch ();
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < EntryCount; Index++) {
+      Status = VariableServiceSetVariableInternal (
+                 Entries[Index].VariableName,
+                 &Entries[Index].VendorGuid,
+                 Entries[Index].Attributes,
+                 Entries[Index].DataSize,
+                 Entries[Index].Data
+                 );
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_INFO, "[Variable]: Batch entry %d rejected - %r\n", Index, Status));
+        if (FailedEntry != NULL) {
+          *FailedEntry = Index;
+        }
+        break;
+      }
+    }
+
+    CommitStatus = EndVariableBatch ((BOOLEAN) !EFI_ERROR (Status));
+    if (!EFI_ERROR (Status)) {
+      Status = CommitStatus;
+    }
+  }
+
+  InterlockedDecrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
+  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+
+  return Status;
+}
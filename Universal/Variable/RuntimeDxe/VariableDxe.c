@@ -31,6 +31,7 @@ EDKII_VARIABLE_LOCK_PROTOCOL   mVariableLock              = { VariableLockReques
 EDKII_VAR_CHECK_PROTOCOL       mVarCheck                  = { VarCheckRegisterSetVariableCheckHandler,
                                                               VarCheckVariablePropertySet,
                                                               VarCheckVariablePropertyGet };
+EDKII_VARIABLE_BATCH_PROTOCOL  mVariableBatchProtocol     = { VariableBatchSetVariables };
 
 /**
   Return TRUE if ExitBootServices () has been called.
@@ -245,6 +246,9 @@ VariableClassAddressChangeEvent (
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase);
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->VariableGlobal.VolatileVariableBase);
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->VariableGlobal.HobVariableBase);
+  for (Index = 0; Index < VariableStoreTypeMax; Index++) {
+    EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->VariableIndex[Index]);
+  }
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal);
   EfiConvertPointer (0x0, (VOID **) &mNvVariableCache);  
   EfiConvertPointer (0x0, (VOID **) &mHandlerTable);
@@ -289,6 +293,7 @@ OnReadyToBoot (
   ReclaimForOS ();
   if (FeaturePcdGet (PcdVariableCollectStatistics)) {
     gBS->InstallConfigurationTable (&gEfiVariableGuid, gVariableInfo);
+    gBS->InstallConfigurationTable (&gEdkiiVariableReclaimStatisticsGuid, &mVariableReclaimStatistics);
   }
 }
 
@@ -459,6 +464,14 @@ VariableServiceInitialize (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gEdkiiVariableBatchProtocolGuid,
+                  &mVariableBatchProtocol,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   SystemTable->RuntimeServices->GetVariable         = VariableServiceGetVariable;
   SystemTable->RuntimeServices->GetNextVariableName = VariableServiceGetNextVariableName;
   SystemTable->RuntimeServices->SetVariable         = VariableServiceSetVariable;
@@ -0,0 +1,409 @@
+/** @file
+  Hashed index of the variables in the volatile variable store, the HOB
+  variable store and the memory copy of the non-volatile variable store.
+
+  The index maps the (VendorGuid, VariableName) pair of a variable to the
+  offset of its header in the variable store, so FindVariableEx () does not
+  need to walk every variable header of the store.
+
+  The index holds offsets instead of pointers and is allocated as a single
+  buffer, so only the buffer address needs to be converted at
+  SetVirtualAddressMap ().
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Variable.h"
+
+///
+/// Marks the end of a bucket chain or of the free entry list.
+///
+#define VARIABLE_INDEX_END              MAX_UINT32
+
+#define VARIABLE_INDEX_MIN_BUCKET_COUNT 16
+
+///
+/// The smallest variable that can be stored, a one character name
+/// terminator and one byte of data.
+///
+#define VARIABLE_INDEX_MIN_VARIABLE_SIZE  HEADER_ALIGN (sizeof (VARIABLE_HEADER) + sizeof (CHAR16) + 1)
+
+//
+// The bucket array and the entry array follow the VARIABLE_INDEX header
+// in the same buffer.
+//
+#define VARIABLE_INDEX_BUCKETS(Index)  ((UINT32 *) ((VARIABLE_INDEX *) (Index) + 1))
+#define VARIABLE_INDEX_ENTRIES(Index)  ((VARIABLE_INDEX_ENTRY *) (VARIABLE_INDEX_BUCKETS (Index) + (Index)->BucketCount))
+
+/**
+  Calculate the hash of a variable name and vendor GUID.
+
+  Only the characters before the null terminator are hashed, so the hash of
+  a variable in the store matches the hash of the name passed by the caller.
+
+  @param  VariableName  Pointer to the variable name.
+  @param  NameSize      Size in bytes of the buffer of VariableName.
+  @param  VendorGuid    Pointer to the vendor GUID.
+
+  @return The hash value.
+
+**/
+UINT32
+GetVariableIndexHash (
+  IN CHAR16    *VariableName,
+  IN UINTN     NameSize,
+  IN EFI_GUID  *VendorGuid
+  )
+{
+  UINT32  Hash;
+  UINT8   *Byte;
+  UINTN   Index;
+
+  //
+  // FNV-1a.
+  //
+  Hash = 0x811C9DC5;
+  Byte = (UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Byte[Index]) * 0x01000193;
+  }
+  for (Index = 0; (Index < NameSize / sizeof (CHAR16)) && (VariableName[Index] != 0); Index++) {
+    Hash = (Hash ^ VariableName[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+  Get the variable index and the variable store it covers.
+
+  @param  Type                  The type of the variable store.
+  @param  VariableStoreHeader   Return the indexed variable store.
+
+  @return Pointer to the variable index, NULL if the store is not present
+          or its index has not been created.
+
+**/
+VARIABLE_INDEX *
+GetVariableIndex (
+  IN  VARIABLE_STORE_TYPE     Type,
+  OUT VARIABLE_STORE_HEADER   **VariableStoreHeader
+  )
+{
+  *VariableStoreHeader = GetVariableStoreByType (Type);
+  if (*VariableStoreHeader == NULL) {
+    return NULL;
+  }
+
+  return mVariableModuleGlobal->VariableIndex[Type];
+}
+
+/**
+  Link a variable into the variable index.
+
+  The entries of a bucket are kept sorted by offset, so a lookup visits the
+  variables in the same order as a walk through the variable store.
+
+  @param  VariableIndex         Pointer to the variable index.
+  @param  VariableStoreHeader   Pointer to the indexed variable store.
+  @param  Variable              Pointer to the variable header in the store.
+
+**/
+VOID
+LinkVariableIndexEntry (
+  IN OUT VARIABLE_INDEX         *VariableIndex,
+  IN     VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN     VARIABLE_HEADER        *Variable
+  )
+{
+  VARIABLE_INDEX_ENTRY  *Entries;
+  UINT32                *Link;
+  UINT32                EntryIndex;
+  UINT32                Offset;
+  UINT32                Hash;
+
+  if (!VariableIndex->Valid) {
+    return;
+  }
+
+  if (VariableIndex->FreeEntry == VARIABLE_INDEX_END) {
+    //
+    // It should not happen as the index is sized for a store full of the
+    // smallest variables, fall back to walking the variable store.
+    //
+    DEBUG ((EFI_D_ERROR, "Variable: variable index is full, disable it\n"));
+    VariableIndex->Valid = FALSE;
+    return;
+  }
+
+  Entries = VARIABLE_INDEX_ENTRIES (VariableIndex);
+  Offset  = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+  Hash    = GetVariableIndexHash (GetVariableNamePtr (Variable), NameSizeOfVariable (Variable), &Variable->VendorGuid);
+
+  Link = &VARIABLE_INDEX_BUCKETS (VariableIndex)[Hash & (VariableIndex->BucketCount - 1)];
+  while ((*Link != VARIABLE_INDEX_END) && (Entries[*Link].Offset < Offset)) {
+    Link = &Entries[*Link].Next;
+  }
+
+  EntryIndex                 = VariableIndex->FreeEntry;
+  VariableIndex->FreeEntry   = Entries[EntryIndex].Next;
+  Entries[EntryIndex].Offset = Offset;
+  Entries[EntryIndex].Next   = *Link;
+  *Link                      = EntryIndex;
+}
+
+/**
+  Rebuild the index of a variable store.
+
+  It must be called after the content of the variable store has been
+  rewritten, for example by Reclaim ().
+
+  @param  Type        The type of the variable store.
+
+**/
+VOID
+RebuildVariableIndex (
+  IN VARIABLE_STORE_TYPE    Type
+  )
+{
+  VARIABLE_INDEX          *VariableIndex;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+  VARIABLE_INDEX_ENTRY    *Entries;
+  VARIABLE_HEADER         *Variable;
+  UINT32                  Index;
+
+  VariableIndex = GetVariableIndex (Type, &VariableStoreHeader);
+  if (VariableIndex == NULL) {
+    return;
+  }
+
+  SetMem32 (VARIABLE_INDEX_BUCKETS (VariableIndex), VariableIndex->BucketCount * sizeof (UINT32), VARIABLE_INDEX_END);
+  Entries = VARIABLE_INDEX_ENTRIES (VariableIndex);
+  for (Index = 0; Index < VariableIndex->EntryCount; Index++) {
+    Entries[Index].Offset = 0;
+    Entries[Index].Next   = Index + 1;
+  }
+  Entries[VariableIndex->EntryCount - 1].Next = VARIABLE_INDEX_END;
+  VariableIndex->FreeEntry = 0;
+  VariableIndex->Valid     = TRUE;
+
+  for ( Variable = GetStartPointer (VariableStoreHeader)
+      ; IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))
+      ; Variable = GetNextVariablePtr (Variable)
+      ) {
+    if (Variable->State == VAR_ADDED || Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      LinkVariableIndexEntry (VariableIndex, VariableStoreHeader, Variable);
+    }
+  }
+}
+
+/**
+  Add a variable that has just been written to a variable store into the index.
+
+  @param  Type        The type of the variable store.
+  @param  Variable    Pointer to the variable header in the store.
+
+**/
+VOID
+AddVariableToIndex (
+  IN VARIABLE_STORE_TYPE    Type,
+  IN VARIABLE_HEADER        *Variable
+  )
+{
+  VARIABLE_INDEX          *VariableIndex;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+
+  VariableIndex = GetVariableIndex (Type, &VariableStoreHeader);
+  if (VariableIndex == NULL) {
+    return;
+  }
+
+  LinkVariableIndexEntry (VariableIndex, VariableStoreHeader, Variable);
+}
+
+/**
+  Create a variable index sized for the variable store.
+
+  @param  VariableStoreHeader   Pointer to the variable store to be indexed.
+
+  @return Pointer to the variable index, NULL if it could not be allocated.
+
+**/
+VARIABLE_INDEX *
+CreateVariableIndex (
+  IN VARIABLE_STORE_HEADER  *VariableStoreHeader
+  )
+{
+  VARIABLE_INDEX          *VariableIndex;
+  UINT32                  EntryCount;
+  UINT32                  BucketCount;
+
+  EntryCount = (UINT32) ((VariableStoreHeader->Size - sizeof (VARIABLE_STORE_HEADER)) / VARIABLE_INDEX_MIN_VARIABLE_SIZE);
+  if (EntryCount == 0) {
+    return NULL;
+  }
+  BucketCount = GetPowerOfTwo32 (EntryCount / 4);
+  if (BucketCount < VARIABLE_INDEX_MIN_BUCKET_COUNT) {
+    BucketCount = VARIABLE_INDEX_MIN_BUCKET_COUNT;
+  }
+
+  VariableIndex = AllocateRuntimeZeroPool (
+                    sizeof (VARIABLE_INDEX) +
+                    BucketCount * sizeof (UINT32) +
+                    EntryCount * sizeof (VARIABLE_INDEX_ENTRY)
+                    );
+  if (VariableIndex == NULL) {
+    return NULL;
+  }
+  VariableIndex->BucketCount = BucketCount;
+  VariableIndex->EntryCount  = EntryCount;
+
+  return VariableIndex;
+}
+
+/**
+  Create and build the indexes of the volatile variable store, the HOB
+  variable store and the memory copy of the non-volatile variable store.
+
+  If an index cannot be allocated, the lookups in that store fall back to
+  walking the variable store.
+
+**/
+VOID
+InitializeVariableIndex (
+  VOID
+  )
+{
+  VARIABLE_STORE_TYPE     Type;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    VariableStoreHeader = GetVariableStoreByType (Type);
+    if (VariableStoreHeader == NULL) {
+      continue;
+    }
+    mVariableModuleGlobal->VariableIndex[Type] = CreateVariableIndex (VariableStoreHeader);
+    if (mVariableModuleGlobal->VariableIndex[Type] == NULL) {
+      DEBUG ((EFI_D_ERROR, "Variable: not enough memory for variable index %d\n", Type));
+      continue;
+    }
+    RebuildVariableIndex (Type);
+  }
+}
+
+/**
+  Free the index of the HOB variable store after all HOB variables have
+  been flushed to flash and the HOB variable store has been freed.
+
+**/
+VOID
+FreeHobVariableIndex (
+  VOID
+  )
+{
+  if (mVariableModuleGlobal->VariableIndex[VariableStoreTypeHob] != NULL) {
+    FreePool (mVariableModuleGlobal->VariableIndex[VariableStoreTypeHob]);
+    mVariableModuleGlobal->VariableIndex[VariableStoreTypeHob] = NULL;
+  }
+}
+
+/**
+  Find the variable in a variable store by the index.
+
+  It returns the same variable as walking through the store range given
+  by PtrTrack does. Entries of the variables that are found deleted are
+  released on the way, variable states never go back from DELETED.
+
+  @param  VariableName        Name of the variable to be found, must not be an empty string.
+  @param  VendorGuid          Vendor GUID to be found.
+  @param  IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                              check at runtime when searching variable.
+  @param  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval EFI_SUCCESS         Variable found successfully.
+  @retval EFI_NOT_FOUND       Variable not found.
+  @retval EFI_UNSUPPORTED     The range given by PtrTrack is not covered by a valid index.
+
+**/
+EFI_STATUS
+FindVariableByIndex (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_STORE_TYPE     Type;
+  VARIABLE_INDEX          *VariableIndex;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+  VARIABLE_INDEX_ENTRY    *Entries;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *InDeletedVariable;
+  UINT32                  *Link;
+  UINT32                  EntryIndex;
+  UINT32                  Hash;
+
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    VariableStoreHeader = GetVariableStoreByType (Type);
+    if ((VariableStoreHeader != NULL) && (PtrTrack->StartPtr == GetStartPointer (VariableStoreHeader))) {
+      break;
+    }
+  }
+  if (Type == VariableStoreTypeMax) {
+    return EFI_UNSUPPORTED;
+  }
+
+  VariableIndex = mVariableModuleGlobal->VariableIndex[Type];
+  if ((VariableIndex == NULL) || !VariableIndex->Valid ||
+      (PtrTrack->EndPtr != GetEndPointer (VariableStoreHeader))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  PtrTrack->InDeletedTransitionPtr = NULL;
+  InDeletedVariable = NULL;
+
+  Entries = VARIABLE_INDEX_ENTRIES (VariableIndex);
+  Hash    = GetVariableIndexHash (VariableName, StrSize (VariableName), VendorGuid);
+  Link    = &VARIABLE_INDEX_BUCKETS (VariableIndex)[Hash & (VariableIndex->BucketCount - 1)];
+  while (*Link != VARIABLE_INDEX_END) {
+    EntryIndex = *Link;
+    Variable   = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + Entries[EntryIndex].Offset);
+
+    if (Variable->State != VAR_ADDED && Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      //
+      // The variable has been deleted, release its entry.
+      //
+      *Link                    = Entries[EntryIndex].Next;
+      Entries[EntryIndex].Next = VariableIndex->FreeEntry;
+      VariableIndex->FreeEntry = EntryIndex;
+      continue;
+    }
+    Link = &Entries[EntryIndex].Next;
+
+    if (IgnoreRtCheck || !AtRuntime () || ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0)) {
+      if (CompareGuid (VendorGuid, &Variable->VendorGuid)) {
+        ASSERT (NameSizeOfVariable (Variable) != 0);
+        if (CompareMem (VariableName, GetVariableNamePtr (Variable), NameSizeOfVariable (Variable)) == 0) {
+          if (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+            InDeletedVariable = Variable;
+          } else {
+            PtrTrack->CurrPtr = Variable;
+            PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+            return EFI_SUCCESS;
+          }
+        }
+      }
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
@@ -47,6 +47,22 @@ UINT8                                                *mVariableBufferPayload = N
 UINTN                                                mVariableBufferPayloadSize;
 extern BOOLEAN                                       mEndOfDxe;
 extern BOOLEAN                                       mEnableLocking;
+extern VARIABLE_STORE_HEADER                         *mNvVariableCache;
+VARIABLE_RUNTIME_CACHE_HEADER                        *mVariableRuntimeCache  = NULL;
+UINTN                                                mRuntimeCacheVolatileLastOffset;
+UINTN                                                mRuntimeCacheNvLastOffset;
+
+/**
+  Update the runtime variable cache from the variable stores.
+
+  The cache is shared with the variable wrapper driver, so Sequence is kept odd
+  during the update to let the wrapper detect a cache read that races with it.
+
+**/
+VOID
+SyncVariableRuntimeCache (
+  VOID
+  );
 
 /**
 
@@ -90,6 +106,7 @@ SmmVariableSetVariable (
                      Data
                      );
   mEnableLocking = TRUE;
+  SyncVariableRuntimeCache ();
   return Status;
 }
 
@@ -404,6 +421,249 @@ SmmVariableGetStatistics (
 }
 
 
+/**
+  Set the batch of variables held by a SetVariables communicate payload.
+
+  Caution: This function may be invoked at SMM runtime.
+  SetVariables is external input. Care must be taken to make sure not security issue at runtime.
+
+  @param[in, out]  SetVariables The SetVariables payload, already copied into SMRAM.
+                                On output, FailedEntry holds the index of the rejected entry.
+  @param[in]       PayloadSize  The size of the SetVariables payload.
+
+  @retval EFI_ACCESS_DENIED     The payload is not well formed.
+  @retval Others                The status returned by VariableBatchSetVariables ().
+
+**/
+EFI_STATUS
+SmmVariableSetVariables (
+  IN OUT SMM_VARIABLE_COMMUNICATE_SET_VARIABLES        *SetVariables,
+  IN     UINTN                                         PayloadSize
+  )
+{
+  EFI_STATUS                                           Status;
+  EDKII_VARIABLE_BATCH_ENTRY                           *Entries;
+  SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE             *SmmVariableHeader;
+  UINTN                                                DataSize;
+  UINTN                                                Offset;
+  UINTN                                                InfoSize;
+  UINTN                                                Index;
+
+  SetVariables->FailedEntry = SetVariables->EntryCount;
+
+  DataSize = PayloadSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES, Data);
+  if ((SetVariables->EntryCount == 0) ||
+      (SetVariables->EntryCount > DataSize / OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name))) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  Entries = AllocatePool (SetVariables->EntryCount * sizeof (EDKII_VARIABLE_BATCH_ENTRY));
+  if (Entries == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_SUCCESS;
+  Offset = 0;
+  for (Index = 0; Index < SetVariables->EntryCount; Index++) {
+    SetVariables->FailedEntry = Index;
+    if ((Offset > DataSize) || (DataSize - Offset < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name))) {
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+    SmmVariableHeader = (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE *) &SetVariables->Data[Offset];
+    if (((UINTN)(~0) - SmmVariableHeader->DataSize < OFFSET_OF(SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name)) ||
+       ((UINTN)(~0) - SmmVariableHeader->NameSize < OFFSET_OF(SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name) + SmmVariableHeader->DataSize)) {
+      //
+      // Prevent InfoSize overflow happen
+      //
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+    InfoSize = OFFSET_OF(SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name)
+               + SmmVariableHeader->DataSize + SmmVariableHeader->NameSize;
+    if (InfoSize > DataSize - Offset) {
+      DEBUG ((EFI_D_ERROR, "SetVariables: Data size exceed communication buffer size limit!\n"));
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+
+    if (SmmVariableHeader->NameSize < sizeof (CHAR16) || SmmVariableHeader->Name[SmmVariableHeader->NameSize/sizeof (CHAR16) - 1] != L'\0') {
+      //
+      // Make sure VariableName is A Null-terminated string.
+      //
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+
+    Entries[Index].VariableName = SmmVariableHeader->Name;
+    CopyGuid (&Entries[Index].VendorGuid, &SmmVariableHeader->Guid);
+    Entries[Index].Attributes   = SmmVariableHeader->Attributes;
+    Entries[Index].DataSize     = SmmVariableHeader->DataSize;
+    Entries[Index].Data         = (UINT8 *) SmmVariableHeader->Name + SmmVariableHeader->NameSize;
+
+    //
+    // InfoSize is bounded by DataSize, so the aligned offset can not overflow.
+    //
+    Offset += ALIGN_VALUE (InfoSize, sizeof (UINTN));
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = VariableBatchSetVariables (NULL, SetVariables->EntryCount, Entries, &SetVariables->FailedEntry);
+  }
+
+  FreePool (Entries);
+  return Status;
+}
+
+
+/**
+  Get the sizes of the variable stores held by the runtime variable cache.
+
+  @param[out]  VolatileStoreSize  Return the size of the volatile variable store.
+  @param[out]  NvStoreSize        Return the size of the non-volatile variable store.
+
+**/
+VOID
+GetRuntimeCacheStoreSize (
+  OUT UINTN                                            *VolatileStoreSize,
+  OUT UINTN                                            *NvStoreSize
+  )
+{
+  *VolatileStoreSize = ((VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase)->Size;
+  *NvStoreSize       = mNvVariableCache->Size;
+}
+
+/**
+  Copy the used part of a variable store to the runtime variable cache.
+
+  The part of the cache that held variables at the last update, but is free in
+  the variable store now, is erased so the stale variables are not found there.
+
+  @param[out]      CacheStore               The copy of the variable store in the cache.
+  @param[in]       VariableStore            The variable store.
+  @param[in]       LastVariableOffset       The end offset of the used part of the variable store.
+  @param[in, out]  CachedLastVariableOffset The end offset of the used part of the cache.
+
+**/
+VOID
+UpdateRuntimeCacheStore (
+  OUT    UINT8                                         *CacheStore,
+  IN     VOID                                          *VariableStore,
+  IN     UINTN                                         LastVariableOffset,
+  IN OUT UINTN                                         *CachedLastVariableOffset
+  )
+{
+  CopyMem (CacheStore, VariableStore, LastVariableOffset);
+  if (*CachedLastVariableOffset > LastVariableOffset) {
+    SetMem (CacheStore + LastVariableOffset, *CachedLastVariableOffset - LastVariableOffset, 0xff);
+  }
+  *CachedLastVariableOffset = LastVariableOffset;
+}
+
+/**
+  Update the runtime variable cache from the variable stores.
+
+  The cache is shared with the variable wrapper driver, so Sequence is kept odd
+  during the update to let the wrapper detect a cache read that races with it.
+
+**/
+VOID
+SyncVariableRuntimeCache (
+  VOID
+  )
+{
+  UINTN                                                VolatileStoreSize;
+  UINTN                                                NvStoreSize;
+  UINT8                                                *Cache;
+
+  if (mVariableRuntimeCache == NULL) {
+    return;
+  }
+
+  GetRuntimeCacheStoreSize (&VolatileStoreSize, &NvStoreSize);
+  Cache = (UINT8 *) mVariableRuntimeCache;
+
+  mVariableRuntimeCache->Sequence++;
+  MemoryFence ();
+
+  UpdateRuntimeCacheStore (
+    Cache + VARIABLE_RUNTIME_CACHE_VOLATILE_STORE_OFFSET,
+    (VOID *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase,
+    mVariableModuleGlobal->VolatileLastVariableOffset,
+    &mRuntimeCacheVolatileLastOffset
+    );
+  UpdateRuntimeCacheStore (
+    Cache + VARIABLE_RUNTIME_CACHE_NV_STORE_OFFSET (VolatileStoreSize),
+    mNvVariableCache,
+    mVariableModuleGlobal->NonVolatileLastVariableOffset,
+    &mRuntimeCacheNvLastOffset
+    );
+
+  //
+  // The variables in the HOB variable store override the ones in the non-volatile
+  // variable store and they are not in the cache, so the cache can not be used
+  // until the HOB variables have been flushed to the flash.
+  //
+  mVariableRuntimeCache->Ready = (BOOLEAN) (mVariableModuleGlobal->VariableGlobal.HobVariableBase == 0);
+
+  MemoryFence ();
+  mVariableRuntimeCache->Sequence++;
+}
+
+/**
+  Set up the runtime variable cache in the buffer provided by the variable wrapper driver.
+
+  Caution: This function may receive untrusted input.
+  RuntimeCache is external input, so this function will validate the cache buffer.
+
+  @param[in]  RuntimeCache      The InitRuntimeCache communicate payload.
+
+  @retval EFI_SUCCESS           The runtime variable cache is set up.
+  @retval EFI_ACCESS_DENIED     The end of DXE has been signaled, or the cache has been set up.
+  @retval EFI_INVALID_PARAMETER The cache buffer is too small or overlaps with SMRAM.
+
+**/
+EFI_STATUS
+SmmVariableInitRuntimeCache (
+  IN SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE            *RuntimeCache
+  )
+{
+  EFI_PHYSICAL_ADDRESS                                 CacheBase;
+  UINTN                                                CacheSize;
+  UINTN                                                VolatileStoreSize;
+  UINTN                                                NvStoreSize;
+
+  if (mEndOfDxe || (mVariableRuntimeCache != NULL)) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  //
+  // Capture the payload to avoid it being changed after the check.
+  //
+  CacheBase = RuntimeCache->CacheBase;
+  CacheSize = RuntimeCache->CacheSize;
+
+  GetRuntimeCacheStoreSize (&VolatileStoreSize, &NvStoreSize);
+  if ((CacheSize < VARIABLE_RUNTIME_CACHE_SIZE (VolatileStoreSize, NvStoreSize)) ||
+      !SmmIsBufferOutsideSmmValid (CacheBase, CacheSize)) {
+    DEBUG ((EFI_D_ERROR, "InitRuntimeCache: Runtime cache buffer invalid!\n"));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  mVariableRuntimeCache = (VARIABLE_RUNTIME_CACHE_HEADER *) (UINTN) CacheBase;
+  ZeroMem (mVariableRuntimeCache, sizeof (VARIABLE_RUNTIME_CACHE_HEADER));
+
+  //
+  // Erase the whole cache beyond the variables at the first update.
+  //
+  mRuntimeCacheVolatileLastOffset = VolatileStoreSize;
+  mRuntimeCacheNvLastOffset       = NvStoreSize;
+  SyncVariableRuntimeCache ();
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Communication service SMI Handler entry.
 
@@ -447,6 +707,8 @@ SmmVariableHandler (
   VARIABLE_INFO_ENTRY                              *VariableInfo;
   SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE           *VariableToLock;
   SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY *CommVariableProperty;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLES           *SetVariables;
+  SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE           *RuntimeCache;
   UINTN                                            InfoSize;
   UINTN                                            NameBufferSize;
   UINTN                                            CommBufferPayloadSize;
@@ -617,6 +879,7 @@ SmmVariableHandler (
                  SmmVariableHeader->DataSize,
                  (UINT8 *)SmmVariableHeader->Name + SmmVariableHeader->NameSize
                  );
+      SyncVariableRuntimeCache ();
       break;
       
     case SMM_VARIABLE_FUNCTION_QUERY_VARIABLE_INFO:
@@ -645,6 +908,7 @@ SmmVariableHandler (
         break;
       }
       ReclaimForOS ();
+      SyncVariableRuntimeCache ();
       Status = EFI_SUCCESS;
       break;
   
@@ -672,6 +936,55 @@ SmmVariableHandler (
       *CommBufferSize = InfoSize + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE;
       break;
 
+    case SMM_VARIABLE_FUNCTION_SET_VARIABLES:
+      if (CommBufferPayloadSize < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES, Data)) {
+        DEBUG ((EFI_D_ERROR, "SetVariables: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      //
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      SetVariables = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES *) mVariableBufferPayload;
+
+      Status = SmmVariableSetVariables (SetVariables, CommBufferPayloadSize);
+      ((SMM_VARIABLE_COMMUNICATE_SET_VARIABLES *) SmmVariableFunctionHeader->Data)->FailedEntry = SetVariables->FailedEntry;
+      SyncVariableRuntimeCache ();
+      break;
+
+    case SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE)) {
+        DEBUG ((EFI_D_ERROR, "GetRuntimeCacheInfo: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      RuntimeCache = (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE *) SmmVariableFunctionHeader->Data;
+      GetRuntimeCacheStoreSize (&RuntimeCache->VolatileStoreSize, &RuntimeCache->NvStoreSize);
+      RuntimeCache->CacheSize = VARIABLE_RUNTIME_CACHE_SIZE (RuntimeCache->VolatileStoreSize, RuntimeCache->NvStoreSize);
+      Status = EFI_SUCCESS;
+      break;
+
+    case SMM_VARIABLE_FUNCTION_INIT_RUNTIME_CACHE:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE)) {
+        DEBUG ((EFI_D_ERROR, "InitRuntimeCache: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      RuntimeCache = (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE *) SmmVariableFunctionHeader->Data;
+      Status = SmmVariableInitRuntimeCache (RuntimeCache);
+      break;
+
+    case SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS:
+      if (CommBufferPayloadSize < sizeof (VARIABLE_RECLAIM_STATISTICS)) {
+        DEBUG ((EFI_D_ERROR, "GetReclaimStatistics: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      if (!FeaturePcdGet (PcdVariableCollectStatistics)) {
+        Status = EFI_UNSUPPORTED;
+        break;
+      }
+      CopyMem (SmmVariableFunctionHeader->Data, &mVariableReclaimStatistics, sizeof (VARIABLE_RECLAIM_STATISTICS));
+      Status = EFI_SUCCESS;
+      break;
+
     case SMM_VARIABLE_FUNCTION_LOCK_VARIABLE:
       if (mEndOfDxe) {
         Status = EFI_ACCESS_DENIED;
@@ -777,6 +1090,7 @@ SmmEndOfDxeCallback (
   InitializeVariableQuota ();
   if (PcdGetBool (PcdReclaimVariableSpaceAtEndOfDxe)) {
     ReclaimForOS ();
+    SyncVariableRuntimeCache ();
   }
   return EFI_SUCCESS;
 }
@@ -842,6 +1156,11 @@ SmmFtwNotificationEvent (
   
   Status = VariableWriteServiceInitialize ();
   ASSERT_EFI_ERROR (Status);
+
+  //
+  // The HOB variables may have been flushed to the flash.
+  //
+  SyncVariableRuntimeCache ();
  
   //
   // Notify the variable wrapper driver the variable write service is ready
@@ -31,6 +31,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/SmmVariable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -46,6 +47,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Guid/EventGroup.h>
 #include <Guid/VariableFormat.h>
 #include <Guid/SmmVariableCommon.h>
+#include <Guid/VariableReclaimStatistics.h>
 
 EFI_HANDLE                       mHandle                    = NULL; 
 EFI_SMM_VARIABLE_PROTOCOL       *mSmmVariable               = NULL;
@@ -58,6 +60,18 @@ UINTN                            mVariableBufferPayloadSize;
 EFI_LOCK                         mVariableServicesLock;
 EDKII_VARIABLE_LOCK_PROTOCOL     mVariableLock;
 EDKII_VAR_CHECK_PROTOCOL         mVarCheck;
+EDKII_VARIABLE_BATCH_PROTOCOL    mVariableBatchProtocol;
+
+//
+// The runtime variable cache kept up to date by the SMM variable driver.
+// Index 0 of the store arrays is the volatile variable store, index 1 is the
+// non-volatile variable store, in the order the stores are searched.
+//
+#define RUNTIME_CACHE_STORE_COUNT  2
+
+VARIABLE_RUNTIME_CACHE_HEADER   *mVariableRuntimeCache      = NULL;
+UINTN                            mRuntimeCacheStoreOffset[RUNTIME_CACHE_STORE_COUNT];
+UINTN                            mRuntimeCacheStoreSize[RUNTIME_CACHE_STORE_COUNT];
 
 /**
   Acquires lock only at boot time. Simply returns at runtime.
@@ -246,6 +260,118 @@ Done:
   return Status;
 }
 
+/**
+  Set a group of non-volatile variables as one transaction.
+
+  The updates are applied in order, so a later entry sees the result of an earlier
+  one. Either all of the updates are written to the variable store, or none of them.
+
+  @param[in]  This          The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]  EntryCount    Number of entries in Entries.
+  @param[in]  Entries       The variable updates to apply.
+  @param[out] FailedEntry   Optional pointer to the index of the entry that was rejected.
+                            It is set to EntryCount if no entry was rejected.
+
+  @retval EFI_SUCCESS           All of the updates were written to the variable store.
+  @retval EFI_INVALID_PARAMETER EntryCount is 0 or Entries is NULL.
+                                Or an entry does not have the EFI_VARIABLE_NON_VOLATILE attribute.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough resource to stage the updates.
+  @retval EFI_BAD_BUFFER_SIZE   The batch does not fit in the SMM communicate buffer.
+  @retval Others                The status returned by SetVariable () for the entry FailedEntry,
+                                or the status of writing the variable store. None of the updates
+                                was written to the variable store.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL    *This,
+  IN       UINTN                            EntryCount,
+  IN       EDKII_VARIABLE_BATCH_ENTRY       *Entries,
+  OUT      UINTN                            *FailedEntry OPTIONAL
+  )
+{
+  EFI_STATUS                                Status;
+  UINTN                                     Index;
+  UINTN                                     PayloadSize;
+  UINTN                                     InfoSize;
+  UINTN                                     Offset;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLES    *SetVariables;
+  SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE  *SmmVariableHeader;
+
+  if (FailedEntry != NULL) {
+    *FailedEntry = EntryCount;
+  }
+
+  if (EntryCount == 0 || Entries == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The whole batch is passed to SMM in one communicate buffer, so it must not
+  // exceed the SMM payload limit.
+  //
+  PayloadSize = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_SET_VARIABLES, Data);
+  for (Index = 0; Index < EntryCount; Index++) {
+    if (Entries[Index].VariableName == NULL ||
+        (Entries[Index].DataSize != 0 && Entries[Index].Data == NULL) ||
+        (Entries[Index].Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) {
+      if (FailedEntry != NULL) {
+        *FailedEntry = Index;
+      }
+      return EFI_INVALID_PARAMETER;
+    }
+    if ((StrSize (Entries[Index].VariableName) > mVariableBufferPayloadSize) ||
+        (Entries[Index].DataSize > mVariableBufferPayloadSize)) {
+      return EFI_BAD_BUFFER_SIZE;
+    }
+    InfoSize = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name) + StrSize (Entries[Index].VariableName) + Entries[Index].DataSize;
+    PayloadSize += ALIGN_VALUE (InfoSize, sizeof (UINTN));
+    if (PayloadSize > mVariableBufferPayloadSize) {
+      return EFI_BAD_BUFFER_SIZE;
+    }
+  }
+
+  AcquireLockOnlyAtBootTime(&mVariableServicesLock);
+
+  //
+  // Init the communicate buffer. The buffer data size is:
+  // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
+  //
+  Status = InitCommunicateBuffer ((VOID **) &SetVariables, PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLES);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  ASSERT (SetVariables != NULL);
+
+  SetVariables->EntryCount  = EntryCount;
+  SetVariables->FailedEntry = EntryCount;
+  Offset = 0;
+  for (Index = 0; Index < EntryCount; Index++) {
+    SmmVariableHeader = (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE *) &SetVariables->Data[Offset];
+    CopyGuid (&SmmVariableHeader->Guid, &Entries[Index].VendorGuid);
+    SmmVariableHeader->DataSize   = Entries[Index].DataSize;
+    SmmVariableHeader->NameSize   = StrSize (Entries[Index].VariableName);
+    SmmVariableHeader->Attributes = Entries[Index].Attributes;
+    CopyMem (SmmVariableHeader->Name, Entries[Index].VariableName, SmmVariableHeader->NameSize);
+    CopyMem ((UINT8 *) SmmVariableHeader->Name + SmmVariableHeader->NameSize, Entries[Index].Data, Entries[Index].DataSize);
+
+    InfoSize = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name) + SmmVariableHeader->NameSize + SmmVariableHeader->DataSize;
+    Offset  += ALIGN_VALUE (InfoSize, sizeof (UINTN));
+  }
+
+  //
+  // Send data to SMM.
+  //
+  Status = SendCommunicateBuffer (PayloadSize);
+  if (FailedEntry != NULL) {
+    *FailedEntry = SetVariables->FailedEntry;
+  }
+
+Done:
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+  return Status;
+}
+
 /**
   Register SetVariable check handler.
 
@@ -420,6 +546,442 @@ Done:
   return Status;
 }
 
+/**
+  Get the range of a variable store in the runtime variable cache.
+
+  @param[in]  StoreIndex      Index of the variable store.
+  @param[out] StartPtr        Return the first variable header of the store.
+  @param[out] EndPtr          Return the end of the store.
+
+**/
+VOID
+GetRuntimeCacheStore (
+  IN  UINTN                                 StoreIndex,
+  OUT VARIABLE_HEADER                       **StartPtr,
+  OUT VARIABLE_HEADER                       **EndPtr
+  )
+{
+  UINTN                                     Store;
+
+  Store     = (UINTN) mVariableRuntimeCache + mRuntimeCacheStoreOffset[StoreIndex];
+  *StartPtr = (VARIABLE_HEADER *) HEADER_ALIGN (Store + sizeof (VARIABLE_STORE_HEADER));
+  *EndPtr   = (VARIABLE_HEADER *) (Store + mRuntimeCacheStoreSize[StoreIndex]);
+}
+
+/**
+  Get the name size of a variable in the runtime variable cache.
+
+  @param[in]  Variable        Pointer to the variable header.
+
+  @return The size of the variable name, 0 if the variable header is not completely written.
+
+**/
+UINTN
+CachedNameSizeOfVariable (
+  IN VARIABLE_HEADER                        *Variable
+  )
+{
+  if (Variable->State    == (UINT8) (-1) ||
+      Variable->DataSize == (UINT32) (-1) ||
+      Variable->NameSize == (UINT32) (-1) ||
+      Variable->Attributes == (UINT32) (-1)) {
+    return 0;
+  }
+  return (UINTN) Variable->NameSize;
+}
+
+/**
+  Get the data size of a variable in the runtime variable cache.
+
+  @param[in]  Variable        Pointer to the variable header.
+
+  @return The size of the variable data, 0 if the variable header is not completely written.
+
+**/
+UINTN
+CachedDataSizeOfVariable (
+  IN VARIABLE_HEADER                        *Variable
+  )
+{
+  if (CachedNameSizeOfVariable (Variable) == 0) {
+    return 0;
+  }
+  return (UINTN) Variable->DataSize;
+}
+
+/**
+  Check a variable header in the runtime variable cache.
+
+  The cache may be updated by SMM at any time, so the whole variable must be
+  checked to be in the store before any part of it is accessed.
+
+  @param[in]  Variable        Pointer to the variable header.
+  @param[in]  EndPtr          End of the variable store.
+
+  @retval TRUE                The variable is in the store.
+  @retval FALSE               The end of the variables in the store has been reached.
+
+**/
+BOOLEAN
+IsValidCachedVariable (
+  IN VARIABLE_HEADER                        *Variable,
+  IN VARIABLE_HEADER                        *EndPtr
+  )
+{
+  UINTN                                     Remaining;
+  UINTN                                     NameSize;
+
+  if ((Variable >= EndPtr) ||
+      ((UINTN) EndPtr - (UINTN) Variable < sizeof (VARIABLE_HEADER)) ||
+      (Variable->StartId != VARIABLE_DATA)) {
+    return FALSE;
+  }
+
+  Remaining = (UINTN) EndPtr - (UINTN) (Variable + 1);
+  NameSize  = CachedNameSizeOfVariable (Variable);
+  if ((NameSize > Remaining) ||
+      (GET_PAD_SIZE (NameSize) > Remaining - NameSize) ||
+      (CachedDataSizeOfVariable (Variable) > Remaining - NameSize - GET_PAD_SIZE (NameSize))) {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Get the data of a variable in the runtime variable cache.
+
+  @param[in]  Variable        Pointer to the variable header.
+
+  @return Pointer to the variable data.
+
+**/
+UINT8 *
+GetCachedVariableDataPtr (
+  IN VARIABLE_HEADER                        *Variable
+  )
+{
+  UINTN                                     NameSize;
+
+  NameSize = CachedNameSizeOfVariable (Variable);
+  return (UINT8 *) (Variable + 1) + NameSize + GET_PAD_SIZE (NameSize);
+}
+
+/**
+  Get the next variable header in the runtime variable cache.
+
+  @param[in]  Variable        Pointer to the variable header.
+
+  @return Pointer to the next variable header.
+
+**/
+VARIABLE_HEADER *
+GetNextCachedVariablePtr (
+  IN VARIABLE_HEADER                        *Variable
+  )
+{
+  UINTN                                     DataSize;
+
+  DataSize = CachedDataSizeOfVariable (Variable);
+  return (VARIABLE_HEADER *) HEADER_ALIGN ((UINTN) GetCachedVariableDataPtr (Variable) + DataSize + GET_PAD_SIZE (DataSize));
+}
+
+/**
+  Find a variable in a variable store of the runtime variable cache.
+
+  The variable is searched the same way as FindVariableEx () of the SMM variable
+  driver does: an added variable is preferred to one in deleted transition, and
+  the variables without EFI_VARIABLE_RUNTIME_ACCESS are not visible at runtime.
+
+  @param[in]  VariableName        Name of the variable to be found.
+  @param[in]  VariableNameSize    Size of the variable name.
+  @param[in]  VendorGuid          Vendor GUID to be found.
+  @param[in]  StoreIndex          Index of the variable store to search.
+
+  @return Pointer to the variable header, NULL if the variable is not found.
+
+**/
+VARIABLE_HEADER *
+FindCachedVariableEx (
+  IN CHAR16                                 *VariableName,
+  IN UINTN                                  VariableNameSize,
+  IN EFI_GUID                               *VendorGuid,
+  IN UINTN                                  StoreIndex
+  )
+{
+  VARIABLE_HEADER                           *Variable;
+  VARIABLE_HEADER                           *EndPtr;
+  VARIABLE_HEADER                           *InDeletedVariable;
+
+  InDeletedVariable = NULL;
+
+  for (GetRuntimeCacheStore (StoreIndex, &Variable, &EndPtr)
+      ; IsValidCachedVariable (Variable, EndPtr)
+      ; Variable = GetNextCachedVariablePtr (Variable)
+      ) {
+    if (Variable->State != VAR_ADDED && Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      continue;
+    }
+    if (EfiAtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+      continue;
+    }
+    if ((CachedNameSizeOfVariable (Variable) != VariableNameSize) ||
+        !CompareGuid (VendorGuid, &Variable->VendorGuid) ||
+        (CompareMem (VariableName, Variable + 1, VariableNameSize) != 0)) {
+      continue;
+    }
+    if (Variable->State == VAR_ADDED) {
+      return Variable;
+    }
+    InDeletedVariable = Variable;
+  }
+
+  return InDeletedVariable;
+}
+
+/**
+  Find a variable in the runtime variable cache.
+
+  @param[in]  VariableName        Name of the variable to be found.
+  @param[in]  VendorGuid          Vendor GUID to be found.
+  @param[out] StoreIndex          Return the index of the variable store holding the variable.
+
+  @return Pointer to the variable header, NULL if the variable is not found.
+
+**/
+VARIABLE_HEADER *
+FindCachedVariable (
+  IN  CHAR16                                *VariableName,
+  IN  EFI_GUID                              *VendorGuid,
+  OUT UINTN                                 *StoreIndex
+  )
+{
+  VARIABLE_HEADER                           *Variable;
+  UINTN                                     VariableNameSize;
+
+  VariableNameSize = StrSize (VariableName);
+  for (*StoreIndex = 0; *StoreIndex < RUNTIME_CACHE_STORE_COUNT; (*StoreIndex)++) {
+    Variable = FindCachedVariableEx (VariableName, VariableNameSize, VendorGuid, *StoreIndex);
+    if (Variable != NULL) {
+      return Variable;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Start reading the runtime variable cache.
+
+  @param[out] Sequence        Return the sequence of the cache content.
+
+  @retval TRUE                The cache can be read.
+  @retval FALSE               The cache is not set up, or it is being updated by SMM.
+
+**/
+BOOLEAN
+BeginRuntimeCacheRead (
+  OUT UINT32                                *Sequence
+  )
+{
+  if (mVariableRuntimeCache == NULL) {
+    return FALSE;
+  }
+
+  *Sequence = *(volatile UINT32 *) &mVariableRuntimeCache->Sequence;
+  MemoryFence ();
+  return (BOOLEAN) (((*Sequence & BIT0) == 0) && *(volatile BOOLEAN *) &mVariableRuntimeCache->Ready);
+}
+
+/**
+  Finish reading the runtime variable cache.
+
+  @param[in]  Sequence        The sequence returned by BeginRuntimeCacheRead ().
+
+  @retval TRUE                The cache was not updated while it was read.
+  @retval FALSE               The cache was updated, the read result must be discarded.
+
+**/
+BOOLEAN
+EndRuntimeCacheRead (
+  IN UINT32                                 Sequence
+  )
+{
+  MemoryFence ();
+  return (BOOLEAN) (*(volatile UINT32 *) &mVariableRuntimeCache->Sequence == Sequence);
+}
+
+/**
+  Look up a variable in the runtime variable cache instead of sending an SMI.
+
+  @param[in]      VariableName       Name of Variable to be found.
+  @param[in]      VendorGuid         Variable vendor GUID.
+  @param[out]     Attributes         Attribute value of the variable found.
+  @param[in, out] DataSize           Size of Data found. If size is less than the
+                                     data, this value contains the required size.
+  @param[out]     Data               Data pointer.
+
+  @retval EFI_NOT_READY              The cache can not be used, the SMI must be sent.
+  @retval Others                     The same as RuntimeServiceGetVariable ().
+
+**/
+EFI_STATUS
+GetVariableFromRuntimeCache (
+  IN      CHAR16                            *VariableName,
+  IN      EFI_GUID                          *VendorGuid,
+  OUT     UINT32                            *Attributes OPTIONAL,
+  IN OUT  UINTN                             *DataSize,
+  OUT     VOID                              *Data
+  )
+{
+  EFI_STATUS                                Status;
+  UINT32                                    Sequence;
+  VARIABLE_HEADER                           *Variable;
+  UINTN                                     StoreIndex;
+  UINTN                                     VarDataSize;
+  UINT32                                    VarAttributes;
+
+  if (!BeginRuntimeCacheRead (&Sequence)) {
+    return EFI_NOT_READY;
+  }
+
+  VarDataSize   = 0;
+  VarAttributes = 0;
+  Variable = FindCachedVariable (VariableName, VendorGuid, &StoreIndex);
+  if (Variable == NULL) {
+    Status = EFI_NOT_FOUND;
+  } else {
+    VarDataSize   = CachedDataSizeOfVariable (Variable);
+    VarAttributes = Variable->Attributes;
+    if (*DataSize < VarDataSize) {
+      Status = EFI_BUFFER_TOO_SMALL;
+    } else if (Data == NULL) {
+      Status = EFI_INVALID_PARAMETER;
+    } else {
+      CopyMem (Data, GetCachedVariableDataPtr (Variable), VarDataSize);
+      Status = EFI_SUCCESS;
+    }
+  }
+
+  //
+  // Only report the result once it is known not to be torn by an update.
+  //
+  if (!EndRuntimeCacheRead (Sequence)) {
+    return EFI_NOT_READY;
+  }
+
+  if (Status == EFI_SUCCESS || Status == EFI_BUFFER_TOO_SMALL) {
+    *DataSize = VarDataSize;
+  }
+  if (Status == EFI_SUCCESS && Attributes != NULL) {
+    *Attributes = VarAttributes;
+  }
+  return Status;
+}
+
+/**
+  Look up the next variable in the runtime variable cache instead of sending an SMI.
+
+  The variable name is staged in the communicate buffer, so the caller's buffers
+  are only updated once the result is known not to be torn by an update.
+
+  @param[in, out] VariableNameSize   Size of the variable name.
+  @param[in, out] VariableName       Pointer to variable name.
+  @param[in, out] VendorGuid         Variable Vendor Guid.
+
+  @retval EFI_NOT_READY              The cache can not be used, the SMI must be sent.
+  @retval Others                     The same as RuntimeServiceGetNextVariableName ().
+
+**/
+EFI_STATUS
+GetNextVariableNameFromRuntimeCache (
+  IN OUT  UINTN                             *VariableNameSize,
+  IN OUT  CHAR16                            *VariableName,
+  IN OUT  EFI_GUID                          *VendorGuid
+  )
+{
+  EFI_STATUS                                Status;
+  UINT32                                    Sequence;
+  VARIABLE_HEADER                           *Variable;
+  VARIABLE_HEADER                           *StartPtr;
+  VARIABLE_HEADER                           *EndPtr;
+  VARIABLE_HEADER                           *AddedVariable;
+  UINTN                                     StoreIndex;
+  UINTN                                     VarNameSize;
+  UINT8                                     *NameBuffer;
+  EFI_GUID                                  Guid;
+
+  if (!BeginRuntimeCacheRead (&Sequence)) {
+    return EFI_NOT_READY;
+  }
+
+  if (VariableName[0] == 0) {
+    StoreIndex = 0;
+    GetRuntimeCacheStore (StoreIndex, &Variable, &EndPtr);
+  } else {
+    Variable = FindCachedVariable (VariableName, VendorGuid, &StoreIndex);
+    if (Variable == NULL) {
+      return EndRuntimeCacheRead (Sequence) ? EFI_NOT_FOUND : EFI_NOT_READY;
+    }
+    GetRuntimeCacheStore (StoreIndex, &StartPtr, &EndPtr);
+    Variable = GetNextCachedVariablePtr (Variable);
+  }
+
+  NameBuffer  = mVariableBuffer + SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE;
+  while (TRUE) {
+    //
+    // Switch from the volatile store to the non-volatile store.
+    //
+    while (!IsValidCachedVariable (Variable, EndPtr)) {
+      StoreIndex++;
+      if (StoreIndex == RUNTIME_CACHE_STORE_COUNT) {
+        return EndRuntimeCacheRead (Sequence) ? EFI_NOT_FOUND : EFI_NOT_READY;
+      }
+      GetRuntimeCacheStore (StoreIndex, &Variable, &EndPtr);
+    }
+
+    if ((Variable->State == VAR_ADDED || Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) &&
+        (!EfiAtRuntime () || ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0)) &&
+        (CachedNameSizeOfVariable (Variable) != 0)) {
+      if (Variable->State == VAR_ADDED) {
+        break;
+      }
+      //
+      // Don't return a variable in deleted transition if the added one exists too.
+      //
+      AddedVariable = FindCachedVariableEx ((CHAR16 *) (Variable + 1), CachedNameSizeOfVariable (Variable), &Variable->VendorGuid, StoreIndex);
+      if (AddedVariable == NULL || AddedVariable->State != VAR_ADDED) {
+        break;
+      }
+    }
+
+    Variable = GetNextCachedVariablePtr (Variable);
+  }
+
+  //
+  // Use the SMI for a name which does not fit in the communicate buffer.
+  //
+  VarNameSize = CachedNameSizeOfVariable (Variable);
+  if (VarNameSize > mVariableBufferPayloadSize) {
+    return EFI_NOT_READY;
+  }
+  CopyMem (NameBuffer, Variable + 1, VarNameSize);
+  CopyGuid (&Guid, &Variable->VendorGuid);
+
+  if (!EndRuntimeCacheRead (Sequence)) {
+    return EFI_NOT_READY;
+  }
+
+  if (VarNameSize <= *VariableNameSize) {
+    CopyMem (VariableName, NameBuffer, VarNameSize);
+    CopyGuid (VendorGuid, &Guid);
+    Status = EFI_SUCCESS;
+  } else {
+    Status = EFI_BUFFER_TOO_SMALL;
+  }
+  *VariableNameSize = VarNameSize;
+  return Status;
+}
+
 /**
   This code finds variable in storage blocks (Volatile or Non-Volatile).
 
@@ -472,6 +1034,14 @@ RuntimeServiceGetVariable (
 
   AcquireLockOnlyAtBootTime(&mVariableServicesLock);
 
+  //
+  // Read the variable from the runtime cache if possible to avoid the SMI.
+  //
+  Status = GetVariableFromRuntimeCache (VariableName, VendorGuid, Attributes, DataSize, Data);
+  if (Status != EFI_NOT_READY) {
+    goto Done;
+  }
+
   //
   // Init the communicate buffer. The buffer data size is:
   // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
@@ -579,6 +1149,14 @@ RuntimeServiceGetNextVariableName (
 
   AcquireLockOnlyAtBootTime(&mVariableServicesLock);
 
+  //
+  // Enumerate the variables in the runtime cache if possible to avoid the SMI.
+  //
+  Status = GetNextVariableNameFromRuntimeCache (VariableNameSize, VariableName, VendorGuid);
+  if (Status != EFI_NOT_READY) {
+    goto Done;
+  }
+
   //
   // Init the communicate buffer. The buffer data size is:
   // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
@@ -847,6 +1425,9 @@ OnReadyToBoot (
   IN      VOID                              *Context
   )
 {
+  EFI_STATUS                                Status;
+  VARIABLE_RECLAIM_STATISTICS               *ReclaimStatistics;
+
   //
   // Init the communicate buffer. The buffer data size is:
   // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE.
@@ -857,6 +1438,22 @@ OnReadyToBoot (
   // Send data to SMM.
   //
   SendCommunicateBuffer (0);
+
+  if (FeaturePcdGet (PcdVariableCollectStatistics)) {
+    //
+    // Get the reclaim statistics from SMM and publish them in the EFI system table.
+    //
+    Status = InitCommunicateBuffer ((VOID **) &ReclaimStatistics, sizeof (VARIABLE_RECLAIM_STATISTICS), SMM_VARIABLE_FUNCTION_GET_RECLAIM_STATISTICS);
+    if (!EFI_ERROR (Status)) {
+      Status = SendCommunicateBuffer (sizeof (VARIABLE_RECLAIM_STATISTICS));
+    }
+    if (!EFI_ERROR (Status)) {
+      ReclaimStatistics = AllocateCopyPool (sizeof (VARIABLE_RECLAIM_STATISTICS), ReclaimStatistics);
+      if (ReclaimStatistics != NULL) {
+        gBS->InstallConfigurationTable (&gEdkiiVariableReclaimStatisticsGuid, ReclaimStatistics);
+      }
+    }
+  }
 }
 
 
@@ -879,6 +1476,58 @@ VariableAddressChangeEvent (
 {
   EfiConvertPointer (0x0, (VOID **) &mVariableBuffer);
   EfiConvertPointer (0x0, (VOID **) &mSmmCommunication);
+  EfiConvertPointer (0x0, (VOID **) &mVariableRuntimeCache);
+}
+
+/**
+  Set up the runtime variable cache, which is kept up to date by the SMM variable
+  driver after each variable update, so GetVariable () and GetNextVariableName ()
+  can be done without SMI.
+
+**/
+VOID
+InitVariableRuntimeCache (
+  VOID
+  )
+{
+  EFI_STATUS                                Status;
+  SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE    *RuntimeCache;
+  UINTN                                     VolatileStoreSize;
+  UINTN                                     NvStoreSize;
+  UINTN                                     CacheSize;
+  VARIABLE_RUNTIME_CACHE_HEADER             *Cache;
+
+  Status = InitCommunicateBuffer ((VOID **) &RuntimeCache, sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE), SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO);
+  if (!EFI_ERROR (Status)) {
+    Status = SendCommunicateBuffer (sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE));
+  }
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  VolatileStoreSize = RuntimeCache->VolatileStoreSize;
+  NvStoreSize       = RuntimeCache->NvStoreSize;
+  CacheSize         = VARIABLE_RUNTIME_CACHE_SIZE (VolatileStoreSize, NvStoreSize);
+
+  Cache = AllocateRuntimeZeroPool (CacheSize);
+  if (Cache == NULL) {
+    return;
+  }
+
+  InitCommunicateBuffer ((VOID **) &RuntimeCache, sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE), SMM_VARIABLE_FUNCTION_INIT_RUNTIME_CACHE);
+  RuntimeCache->CacheBase = (EFI_PHYSICAL_ADDRESS) (UINTN) Cache;
+  RuntimeCache->CacheSize = CacheSize;
+  Status = SendCommunicateBuffer (sizeof (SMM_VARIABLE_COMMUNICATE_RUNTIME_CACHE));
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_INFO, "Variable runtime cache is not set up - %r\n", Status));
+    FreePool (Cache);
+    return;
+  }
+
+  mRuntimeCacheStoreOffset[0] = VARIABLE_RUNTIME_CACHE_VOLATILE_STORE_OFFSET;
+  mRuntimeCacheStoreSize[0]   = VolatileStoreSize;
+  mRuntimeCacheStoreOffset[1] = VARIABLE_RUNTIME_CACHE_NV_STORE_OFFSET (VolatileStoreSize);
+  mRuntimeCacheStoreSize[1]   = NvStoreSize;
+  mVariableRuntimeCache       = Cache;
 }
 
 
@@ -920,6 +1569,10 @@ SmmVariableReady (
   //
   mVariableBufferPhysical = mVariableBuffer;
 
+  if (FeaturePcdGet (PcdEnableVariableRuntimeCache)) {
+    InitVariableRuntimeCache ();
+  }
+
   gRT->GetVariable         = RuntimeServiceGetVariable;
   gRT->GetNextVariableName = RuntimeServiceGetNextVariableName;
   gRT->SetVariable         = RuntimeServiceSetVariable;
@@ -1020,6 +1673,15 @@ VariableSmmRuntimeInitialize (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  mVariableBatchProtocol.SetVariables = VariableBatchSetVariables;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gEdkiiVariableBatchProtocolGuid,
+                  &mVariableBatchProtocol,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   //
   // Smm variable service is ready
   //